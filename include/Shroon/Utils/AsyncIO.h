@@ -0,0 +1,886 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_ASYNC_IO_H
+#define SUTL_ASYNC_IO_H
+
+#include "Common.h"
+#include "Vector.h"
+#include "System.h"
+
+/*
+ * io_uring is used through raw system calls so that liburing isn't needed. It needs the
+ * `IORING_OP_READ` operation of Linux 5.6, which is detected with `IORING_FEAT_RW_CUR_POS`, and
+ * `syscall`, which strict `-std` modes hide unless a feature test macro asks for it.
+ */
+#if defined(__linux__) && !defined(SUTL_ASYNC_IO_NO_URING)
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+
+    #if defined(SYS_io_uring_setup) && defined(SYS_io_uring_enter) && defined(IORING_FEAT_RW_CUR_POS) &&\
+        (defined(_DEFAULT_SOURCE) || defined(_GNU_SOURCE) || defined(_BSD_SOURCE))
+        #define SUTL_ASYNC_IO_HAS_URING
+    #endif
+#endif
+
+/**
+ * @defgroup AsyncIO
+ * Asynchronous reads from many files into vectors, for loading a lot of data at once.
+ *
+ * Reads are queued with \p SUTLAsyncIORead and only submitted in batches, when the queue is full
+ * or when waiting for completions, so that the disk always has \p Depth reads to work on. Data is
+ * read straight into the spare capacity of the destination vector, whose size grows when the read
+ * completes.
+ *
+ * On Linux, io_uring is used. Where it isn't available, a pool of threads doing blocking reads is
+ * used instead, with the same interface.
+ * @{
+ */
+
+/**
+ * @brief The number of threads of the thread pool backend. It is 1 by default where reads have to
+ * seek, so that reads of one file don't interleave.
+ */
+#ifndef SUTL_ASYNC_IO_THREADS
+    #ifdef SUTL_SYSTEM_PREAD_SEEKS
+        #define SUTL_ASYNC_IO_THREADS 1
+    #else
+        #define SUTL_ASYNC_IO_THREADS 4
+    #endif
+#endif
+
+/**
+ * @brief The backend which performs the reads of a \p SUTLAsyncIO.
+ */
+typedef enum SUTLAsyncIOBackend
+{
+    /**
+     * @brief Pick io_uring if it is available, otherwise threads. Only used as a parameter.
+     */
+    SUTL_ASYNC_IO_AUTO,
+
+    /**
+     * @brief Linux io_uring.
+     */
+    SUTL_ASYNC_IO_URING,
+
+    /**
+     * @brief A pool of threads doing blocking reads.
+     */
+    SUTL_ASYNC_IO_POOL
+} SUTLAsyncIOBackend;
+
+/**
+ * @brief The state of one read.
+ */
+typedef struct SUTLAsyncIORequest
+{
+    /**
+     * @brief The total number of bytes read, or a negative \p errno value if reading failed.
+     */
+    long Result;
+
+    /**
+     * @brief 1 once the read has completed.
+     */
+    int Done;
+
+    /**
+     * @brief Don't access this directly. The file descriptor to read from.
+     */
+    int Fd;
+
+    /**
+     * @brief Don't access this directly. The offset in the file of the next byte to read.
+     */
+    uint64_t Offset;
+
+    /**
+     * @brief Don't access this directly. The number of bytes still to read.
+     */
+    size_t Remaining;
+
+    /**
+     * @brief Don't access this directly. Pointer to the destination vector of \p char.
+     */
+    char ** Vector;
+} SUTLAsyncIORequest;
+
+/**
+ * @brief It contains the state of a particular asynchronous I/O instance.
+ */
+typedef struct SUTLAsyncIO
+{
+    /**
+     * @brief The backend in use.
+     */
+    SUTLAsyncIOBackend Backend;
+
+    /**
+     * @brief The maximum number of reads in flight.
+     */
+    size_t Depth;
+
+    /**
+     * @brief The number of reads which haven't completed.
+     */
+    size_t Pending;
+
+    /**
+     * @brief Don't access this directly. A vector of \p SUTLAsyncIORequest, indexed by request id.
+     */
+    SUTLAsyncIORequest * Requests;
+
+    /**
+     * @brief Don't access this directly. A vector of \p size_t with the ids of the reads which
+     * weren't submitted yet.
+     */
+    size_t * Queue;
+
+    /**
+     * @brief Don't access this directly. The state of the backend.
+     */
+    void * State;
+} SUTLAsyncIO;
+
+/**
+ * @brief Creates a new \p SUTLAsyncIO.
+ *
+ * @param depth The maximum number of reads in flight.
+ * @param backend The \p SUTLAsyncIOBackend to use. \p SUTL_ASYNC_IO_URING falls back to threads if
+ * io_uring isn't available.
+ *
+ * @return A \p SUTLAsyncIO created according to the parameters given. If no backend can be
+ * created, an error is reported and its \p Depth is 0, and reads complete synchronously.
+ */
+#define SUTLAsyncIONew(depth, backend)          SUTL_InternalAsyncIONew(depth, backend)
+
+/**
+ * @brief Waits for all reads of \p aio and frees it.
+ *
+ * @param aio The \p SUTLAsyncIO to free.
+ */
+#define SUTLAsyncIOFree(aio)                    SUTL_InternalAsyncIOFree(&aio)
+
+/**
+ * @brief Queues a read of \p size bytes at \p offset of \p fd, appended to vector \p v.
+ *
+ * The capacity of \p v is reserved right away, and its size grows by the number of bytes read on
+ * completion. \p v must not be modified or be the destination of another read until then.
+ *
+ * @param aio The \p SUTLAsyncIO.
+ * @param fd The file descriptor to read from.
+ * @param v The vector of \p char to read into.
+ * @param offset The offset in the file to read from.
+ * @param size The number of bytes to read. Fewer are read at the end of the file.
+ *
+ * @return The id of the request.
+ */
+#define SUTLAsyncIORead(aio, fd, v, offset, size)  SUTL_InternalAsyncIORead(&aio, fd, &v, offset, size)
+
+/**
+ * @brief Queues a read of the whole file \p fd, appended to vector \p v. See \p SUTLAsyncIORead.
+ *
+ * @param aio The \p SUTLAsyncIO.
+ * @param fd The file descriptor to read from.
+ * @param v The vector of \p char to read into.
+ *
+ * @return The id of the request.
+ */
+#define SUTLAsyncIOReadFile(aio, fd, v)         SUTL_InternalAsyncIOReadFile(&aio, fd, &v)
+
+/**
+ * @brief Submits the queued reads and waits until at least \p count reads have completed.
+ *
+ * @param aio The \p SUTLAsyncIO.
+ * @param count The number of completions to wait for. It is limited to \p Pending.
+ *
+ * @return The number of reads which completed.
+ */
+#define SUTLAsyncIOWait(aio, count)             SUTL_InternalAsyncIOWait(&aio, count)
+
+/**
+ * @brief Submits the queued reads and waits until all reads have completed.
+ *
+ * @param aio The \p SUTLAsyncIO.
+ *
+ * @return The number of reads which completed.
+ */
+#define SUTLAsyncIOWaitAll(aio)                 SUTL_InternalAsyncIOWait(&aio, (aio).Pending)
+
+/**
+ * @brief Gets the \p SUTLAsyncIORequest with id \p id.
+ *
+ * @param aio The \p SUTLAsyncIO.
+ * @param id The id returned by \p SUTLAsyncIORead.
+ *
+ * @return A <tt>SUTLAsyncIORequest *</tt>, valid until the next read is queued.
+ */
+#define SUTLAsyncIORequestOf(aio, id)           ((aio).Requests + (id))
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+SUTLAsyncIO SUTL_InternalAsyncIONew(size_t depth, SUTLAsyncIOBackend backend);
+void SUTL_InternalAsyncIOFree(SUTLAsyncIO * aio);
+size_t SUTL_InternalAsyncIORead(SUTLAsyncIO * aio, int fd, char ** v, uint64_t offset, size_t size);
+size_t SUTL_InternalAsyncIOReadFile(SUTLAsyncIO * aio, int fd, char ** v);
+size_t SUTL_InternalAsyncIOWait(SUTLAsyncIO * aio, size_t count);
+
+size_t SUTL_InternalAsyncIOComplete(SUTLAsyncIO * aio, size_t id, long result, int final);
+int SUTL_InternalAsyncIOUringNew(SUTLAsyncIO * aio);
+void SUTL_InternalAsyncIOUringFree(SUTLAsyncIO * aio);
+size_t SUTL_InternalAsyncIOUringWait(SUTLAsyncIO * aio, size_t count);
+int SUTL_InternalAsyncIOPoolNew(SUTLAsyncIO * aio);
+void SUTL_InternalAsyncIOPoolFree(SUTLAsyncIO * aio);
+size_t SUTL_InternalAsyncIOPoolWait(SUTLAsyncIO * aio, size_t count);
+void * SUTL_InternalAsyncIOPoolWorker(void * arg);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    /*
+     * A read handed to the thread pool. Workers only see copies of the request, so the request
+     * vector can grow while they run.
+     */
+    typedef struct SUTLAsyncIOJob
+    {
+        size_t Id;
+        int Fd;
+        uint64_t Offset;
+        size_t Size;
+        char * Data;
+        long Result;
+    } SUTLAsyncIOJob;
+
+    typedef struct SUTLAsyncIOPool
+    {
+        SHRN_MUTEX Mutex;
+        SHRN_COND HasJobs;
+        SHRN_COND HasResults;
+        SHRN_THREAD Threads[SUTL_ASYNC_IO_THREADS];
+        size_t ThreadCount;
+        int Stop;
+
+        /*
+         * `Jobs` is a vector of `SUTLAsyncIOJob` consumed from `NextJob`, and `Results` is a vector
+         * of finished jobs. Both are protected by `Mutex`.
+         */
+        SUTLAsyncIOJob * Jobs;
+        size_t NextJob;
+        SUTLAsyncIOJob * Results;
+    } SUTLAsyncIOPool;
+
+    SUTLAsyncIO SUTL_InternalAsyncIONew(size_t depth, SUTLAsyncIOBackend backend)
+    {
+        SUTLAsyncIO aio;
+
+        /*
+         * Initialize the members of `aio`.
+         */
+        aio.Backend = SUTL_ASYNC_IO_URING;
+        aio.Depth = depth ? depth : 1;
+        aio.Pending = 0;
+        aio.Requests = SUTLVectorNew(SUTLAsyncIORequest);
+        aio.Queue = SUTLVectorNew(size_t);
+        aio.State = NULL;
+
+        SUTLVectorReserve(aio.Queue, aio.Depth);
+
+        if (backend != SUTL_ASYNC_IO_POOL && SUTL_InternalAsyncIOUringNew(&aio))
+            return aio;
+
+        aio.Backend = SUTL_ASYNC_IO_POOL;
+
+        if (!SUTL_InternalAsyncIOPoolNew(&aio))
+        {
+            SUTLErrorHandler("Failed to create asynchronous I/O backend.");
+            aio.Depth = 0;
+        }
+
+        return aio;
+    }
+
+    void SUTL_InternalAsyncIOFree(SUTLAsyncIO * aio)
+    {
+        if (aio->Depth)
+        {
+            SUTL_InternalAsyncIOWait(aio, aio->Pending);
+
+            if (aio->Backend == SUTL_ASYNC_IO_URING)
+                SUTL_InternalAsyncIOUringFree(aio);
+            else
+                SUTL_InternalAsyncIOPoolFree(aio);
+        }
+
+        SUTLVectorFree(aio->Queue);
+        SUTLVectorFree(aio->Requests);
+    }
+
+    size_t SUTL_InternalAsyncIORead(SUTLAsyncIO * aio, int fd, char ** v, uint64_t offset, size_t size)
+    {
+        SUTLAsyncIORequest request;
+        size_t id = SUTLVectorSize(aio->Requests);
+        size_t used = SUTLVectorSize(*v);
+
+        request.Result = 0;
+        request.Done = 0;
+        request.Fd = fd;
+        request.Offset = offset;
+        request.Remaining = size;
+        request.Vector = v;
+
+        if (SUTLVectorCapacity(*v) < used + size)
+            SUTLVectorReserve(*v, used + size);
+
+        SUTLVectorPush(aio->Requests, request);
+
+        if (!aio->Depth)
+        {
+            long done = 0;
+            long result;
+
+            /*
+             * Without a backend, read right away the same way as a pool worker.
+             */
+            while ((size_t)done < size)
+            {
+                result = (long)SHRN_PREAD(fd, *v + used + done, size - (size_t)done, (off_t)(offset + (uint64_t)done));
+
+                if (SUTL_INTERRUPTED(result))
+                    continue;
+
+                if (result <= 0)
+                {
+                    done = result < 0 ? -errno : done;
+                    break;
+                }
+
+                done += result;
+            }
+
+            aio->Pending++;
+            SUTL_InternalAsyncIOComplete(aio, id, done, 1);
+
+            return id;
+        }
+
+        /*
+         * Keep at most `Depth` reads in flight, including the queued ones.
+         */
+        if (aio->Pending == aio->Depth)
+            SUTL_InternalAsyncIOWait(aio, 1);
+
+        SUTLVectorPush(aio->Queue, id);
+        aio->Pending++;
+
+        return id;
+    }
+
+    size_t SUTL_InternalAsyncIOReadFile(SUTLAsyncIO * aio, int fd, char ** v)
+    {
+        SUTLAsyncIORequest request;
+        size_t size;
+
+        if (SHRN_FILE_SIZE(fd, size) == 0)
+            return SUTL_InternalAsyncIORead(aio, fd, v, 0, size);
+
+        /*
+         * Report the failure as a completed read, the same way as failures of the read itself.
+         */
+        request.Result = -errno;
+        request.Done = 1;
+        request.Fd = fd;
+        request.Offset = 0;
+        request.Remaining = 0;
+        request.Vector = v;
+
+        SUTLVectorPush(aio->Requests, request);
+
+        return SUTLVectorSize(aio->Requests) - 1;
+    }
+
+    size_t SUTL_InternalAsyncIOWait(SUTLAsyncIO * aio, size_t count)
+    {
+        count = count < aio->Pending ? count : aio->Pending;
+
+        if (!aio->Depth)
+            return 0;
+
+        if (aio->Backend == SUTL_ASYNC_IO_URING)
+            return SUTL_InternalAsyncIOUringWait(aio, count);
+
+        return SUTL_InternalAsyncIOPoolWait(aio, count);
+    }
+
+    size_t SUTL_InternalAsyncIOComplete(SUTLAsyncIO * aio, size_t id, long result, int final)
+    {
+        SUTLAsyncIORequest * request = aio->Requests + id;
+
+        /*
+         * Short reads are queued again for the rest unless `final` says that the end of the file
+         * was reached. Returns 1 if the request completed.
+         */
+        if (result > 0)
+        {
+            SUTLVectorSize(*request->Vector) += (size_t)result;
+
+            request->Result += result;
+            request->Offset += (uint64_t)result;
+            request->Remaining -= (size_t)result;
+
+            if (request->Remaining && !final)
+            {
+                SUTLVectorPush(aio->Queue, id);
+                return 0;
+            }
+        }
+        else if (result < 0)
+        {
+            request->Result = result;
+        }
+
+        request->Done = 1;
+        aio->Pending--;
+
+        return 1;
+    }
+
+#ifdef SUTL_ASYNC_IO_HAS_URING
+    /*
+     * Prefaulting the rings saves page faults on the first submissions, where it is supported.
+     */
+    #ifdef MAP_POPULATE
+        #define SUTLAsyncIOPopulate MAP_POPULATE
+    #else
+        #define SUTLAsyncIOPopulate 0
+    #endif
+
+    typedef struct SUTLAsyncIOUring
+    {
+        int Fd;
+
+        /*
+         * The mappings of the submission queue ring, the completion queue ring and the
+         * submission queue entries.
+         */
+        void * SqRing;
+        size_t SqRingSize;
+        void * CqRing;
+        size_t CqRingSize;
+        struct io_uring_sqe * Sqes;
+        size_t SqesSize;
+
+        unsigned * SqHead;
+        SHRN_ATOMIC(unsigned) * SqTail;
+        unsigned SqMask;
+        unsigned * SqArray;
+        unsigned SqEntries;
+
+        SHRN_ATOMIC(unsigned) * CqHead;
+        SHRN_ATOMIC(unsigned) * CqTail;
+        unsigned CqMask;
+        struct io_uring_cqe * Cqes;
+
+        /*
+         * The number of submitted reads which haven't completed.
+         */
+        size_t InFlight;
+    } SUTLAsyncIOUring;
+
+    int SUTL_InternalAsyncIOUringNew(SUTLAsyncIO * aio)
+    {
+        SUTLAsyncIOUring * ring = (SUTLAsyncIOUring *)SHRN_MALLOC(sizeof(SUTLAsyncIOUring));
+        struct io_uring_params params;
+        char * sq;
+        char * cq;
+
+        if (!ring)
+            return 0;
+
+        SHRN_MEMSET(&params, 0, sizeof(params));
+
+        ring->Fd = (int)syscall(SYS_io_uring_setup, (unsigned)aio->Depth, &params);
+
+        /*
+         * io_uring may be missing or disabled, for example by a seccomp policy.
+         */
+        if (ring->Fd < 0 || !(params.features & IORING_FEAT_RW_CUR_POS))
+        {
+            if (ring->Fd >= 0)
+                SHRN_CLOSE(ring->Fd);
+
+            SHRN_FREE(ring);
+            return 0;
+        }
+
+        ring->SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        ring->SqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+        /*
+         * Newer kernels map both rings with one call.
+         */
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            ring->SqRingSize = ring->SqRingSize > ring->CqRingSize ? ring->SqRingSize : ring->CqRingSize;
+            ring->CqRingSize = ring->SqRingSize;
+        }
+
+        ring->SqRing = mmap(NULL, ring->SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | SUTLAsyncIOPopulate, ring->Fd, IORING_OFF_SQ_RING);
+        ring->CqRing = ring->SqRing;
+
+        if (ring->SqRing != MAP_FAILED && !(params.features & IORING_FEAT_SINGLE_MMAP))
+            ring->CqRing = mmap(NULL, ring->CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | SUTLAsyncIOPopulate, ring->Fd, IORING_OFF_CQ_RING);
+
+        ring->Sqes = (struct io_uring_sqe *)mmap(NULL, ring->SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | SUTLAsyncIOPopulate, ring->Fd, IORING_OFF_SQES);
+
+        if (ring->SqRing == MAP_FAILED || ring->CqRing == MAP_FAILED || (void *)ring->Sqes == MAP_FAILED)
+        {
+            if ((void *)ring->Sqes != MAP_FAILED)
+                munmap(ring->Sqes, ring->SqesSize);
+
+            if (ring->CqRing != MAP_FAILED && ring->CqRing != ring->SqRing)
+                munmap(ring->CqRing, ring->CqRingSize);
+
+            if (ring->SqRing != MAP_FAILED)
+                munmap(ring->SqRing, ring->SqRingSize);
+
+            SHRN_CLOSE(ring->Fd);
+            SHRN_FREE(ring);
+
+            return 0;
+        }
+
+        sq = (char *)ring->SqRing;
+        cq = (char *)ring->CqRing;
+
+        ring->SqHead = (unsigned *)(sq + params.sq_off.head);
+        ring->SqTail = (SHRN_ATOMIC(unsigned) *)(sq + params.sq_off.tail);
+        ring->SqMask = *(unsigned *)(sq + params.sq_off.ring_mask);
+        ring->SqArray = (unsigned *)(sq + params.sq_off.array);
+        ring->SqEntries = params.sq_entries;
+
+        ring->CqHead = (SHRN_ATOMIC(unsigned) *)(cq + params.cq_off.head);
+        ring->CqTail = (SHRN_ATOMIC(unsigned) *)(cq + params.cq_off.tail);
+        ring->CqMask = *(unsigned *)(cq + params.cq_off.ring_mask);
+        ring->Cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+        ring->InFlight = 0;
+
+        /*
+         * The kernel may round the depth up to a power of 2.
+         */
+        aio->Depth = aio->Depth < params.sq_entries ? aio->Depth : params.sq_entries;
+        aio->State = ring;
+
+        return 1;
+    }
+
+    void SUTL_InternalAsyncIOUringFree(SUTLAsyncIO * aio)
+    {
+        SUTLAsyncIOUring * ring = (SUTLAsyncIOUring *)aio->State;
+
+        munmap(ring->Sqes, ring->SqesSize);
+
+        if (ring->CqRing != ring->SqRing)
+            munmap(ring->CqRing, ring->CqRingSize);
+
+        munmap(ring->SqRing, ring->SqRingSize);
+        SHRN_CLOSE(ring->Fd);
+
+        SHRN_FREE(ring);
+    }
+
+    size_t SUTL_InternalAsyncIOUringWait(SUTLAsyncIO * aio, size_t count)
+    {
+        SUTLAsyncIOUring * ring = (SUTLAsyncIOUring *)aio->State;
+        size_t completed = 0;
+
+        while (completed < count || SUTLVectorSize(aio->Queue))
+        {
+            unsigned tail = SHRN_ATOMIC_LOAD(ring->SqTail, SHRN_ORDER_RELAXED);
+            unsigned submit = 0;
+            unsigned head;
+            long result;
+            size_t i;
+
+            /*
+             * Fill submission queue entries for the queued reads. The queue never holds more than
+             * `Depth` reads, which all fit.
+             */
+            for (i = 0; i < SUTLVectorSize(aio->Queue); i++)
+            {
+                SUTLAsyncIORequest * request = aio->Requests + aio->Queue[i];
+                struct io_uring_sqe * sqe = ring->Sqes + (tail & ring->SqMask);
+
+                SHRN_MEMSET(sqe, 0, sizeof(*sqe));
+
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = request->Fd;
+                sqe->off = request->Offset;
+                sqe->addr = (uint64_t)(uintptr_t)(*request->Vector + SUTLVectorSize(*request->Vector));
+                sqe->len = (unsigned)(request->Remaining < 0x7FFFF000 ? request->Remaining : 0x7FFFF000);
+                sqe->user_data = aio->Queue[i];
+
+                ring->SqArray[tail & ring->SqMask] = tail & ring->SqMask;
+
+                tail++;
+                submit++;
+            }
+
+            SUTLVectorResize(aio->Queue, 0);
+
+            /*
+             * Publish the entries before the kernel can see the new tail.
+             */
+            SHRN_ATOMIC_STORE(ring->SqTail, tail, SHRN_ORDER_RELEASE);
+            ring->InFlight += submit;
+
+            do
+            {
+                result = syscall(SYS_io_uring_enter, ring->Fd, submit, completed < count ? 1 : 0, IORING_ENTER_GETEVENTS, NULL, 0);
+            } while (SUTL_INTERRUPTED(result));
+
+            if (result < 0)
+            {
+                SUTLErrorHandler("Failed to submit asynchronous reads.");
+                break;
+            }
+
+            /*
+             * Reap all available completions in one pass.
+             */
+            head = SHRN_ATOMIC_LOAD(ring->CqHead, SHRN_ORDER_RELAXED);
+
+            while (head != SHRN_ATOMIC_LOAD(ring->CqTail, SHRN_ORDER_ACQUIRE))
+            {
+                struct io_uring_cqe * cqe = ring->Cqes + (head & ring->CqMask);
+
+                ring->InFlight--;
+                completed += SUTL_InternalAsyncIOComplete(aio, (size_t)cqe->user_data, (long)cqe->res, 0);
+
+                head++;
+            }
+
+            SHRN_ATOMIC_STORE(ring->CqHead, head, SHRN_ORDER_RELEASE);
+        }
+
+        return completed;
+    }
+
+    #undef SUTLAsyncIOPopulate
+#else
+    int SUTL_InternalAsyncIOUringNew(SUTLAsyncIO * aio)
+    {
+        (void)aio;
+
+        return 0;
+    }
+
+    void SUTL_InternalAsyncIOUringFree(SUTLAsyncIO * aio)
+    {
+        (void)aio;
+    }
+
+    size_t SUTL_InternalAsyncIOUringWait(SUTLAsyncIO * aio, size_t count)
+    {
+        (void)aio;
+        (void)count;
+
+        return 0;
+    }
+#endif
+
+    void * SUTL_InternalAsyncIOPoolWorker(void * arg)
+    {
+        SUTLAsyncIOPool * pool = (SUTLAsyncIOPool *)arg;
+        SUTLAsyncIOJob job;
+        long result;
+
+        for (;;)
+        {
+            SHRN_MUTEX_LOCK(pool->Mutex);
+
+            while (pool->NextJob == SUTLVectorSize(pool->Jobs) && !pool->Stop)
+                SHRN_COND_WAIT(pool->HasJobs, pool->Mutex);
+
+            if (pool->NextJob == SUTLVectorSize(pool->Jobs))
+            {
+                SHRN_MUTEX_UNLOCK(pool->Mutex);
+                return NULL;
+            }
+
+            job = pool->Jobs[pool->NextJob++];
+
+            SHRN_MUTEX_UNLOCK(pool->Mutex);
+
+            /*
+             * Read until done, the end of the file or an error.
+             */
+            job.Result = 0;
+
+            while ((size_t)job.Result < job.Size)
+            {
+                result = (long)SHRN_PREAD(job.Fd, job.Data + job.Result, job.Size - (size_t)job.Result, (off_t)(job.Offset + (uint64_t)job.Result));
+
+                if (SUTL_INTERRUPTED(result))
+                    continue;
+
+                if (result <= 0)
+                {
+                    job.Result = result < 0 ? -errno : job.Result;
+                    break;
+                }
+
+                job.Result += result;
+            }
+
+            SHRN_MUTEX_LOCK(pool->Mutex);
+            SUTLVectorPush(pool->Results, job);
+            SHRN_COND_SIGNAL(pool->HasResults);
+            SHRN_MUTEX_UNLOCK(pool->Mutex);
+        }
+    }
+
+    int SUTL_InternalAsyncIOPoolNew(SUTLAsyncIO * aio)
+    {
+        SUTLAsyncIOPool * pool = (SUTLAsyncIOPool *)SHRN_MALLOC(sizeof(SUTLAsyncIOPool));
+
+        if (!pool)
+            return 0;
+
+        SHRN_MUTEX_INIT(pool->Mutex);
+        SHRN_COND_INIT(pool->HasJobs);
+        SHRN_COND_INIT(pool->HasResults);
+
+        pool->Stop = 0;
+        pool->Jobs = SUTLVectorNew(SUTLAsyncIOJob);
+        pool->NextJob = 0;
+        pool->Results = SUTLVectorNew(SUTLAsyncIOJob);
+
+        SUTLVectorReserve(pool->Jobs, aio->Depth);
+        SUTLVectorReserve(pool->Results, aio->Depth);
+
+        aio->State = pool;
+
+        for (pool->ThreadCount = 0; pool->ThreadCount < SUTL_ASYNC_IO_THREADS; pool->ThreadCount++)
+            if (!SHRN_THREAD_CREATE(pool->Threads[pool->ThreadCount], SUTL_InternalAsyncIOPoolWorker, pool))
+                break;
+
+        if (!pool->ThreadCount)
+        {
+            SUTL_InternalAsyncIOPoolFree(aio);
+            return 0;
+        }
+
+        return 1;
+    }
+
+    void SUTL_InternalAsyncIOPoolFree(SUTLAsyncIO * aio)
+    {
+        SUTLAsyncIOPool * pool = (SUTLAsyncIOPool *)aio->State;
+        size_t i;
+
+        SHRN_MUTEX_LOCK(pool->Mutex);
+        pool->Stop = 1;
+        SHRN_COND_BROADCAST(pool->HasJobs);
+        SHRN_MUTEX_UNLOCK(pool->Mutex);
+
+        for (i = 0; i < pool->ThreadCount; i++)
+            SHRN_THREAD_JOIN(pool->Threads[i]);
+
+        SUTLVectorFree(pool->Results);
+        SUTLVectorFree(pool->Jobs);
+
+        SHRN_COND_DESTROY(pool->HasResults);
+        SHRN_COND_DESTROY(pool->HasJobs);
+        SHRN_MUTEX_DESTROY(pool->Mutex);
+
+        SHRN_FREE(pool);
+    }
+
+    size_t SUTL_InternalAsyncIOPoolWait(SUTLAsyncIO * aio, size_t count)
+    {
+        SUTLAsyncIOPool * pool = (SUTLAsyncIOPool *)aio->State;
+        SUTLAsyncIOJob * results = SUTLVectorNew(SUTLAsyncIOJob);
+        size_t completed = 0;
+        size_t i;
+
+        SHRN_MUTEX_LOCK(pool->Mutex);
+
+        /*
+         * Hand all queued reads to the workers at once, dropping the jobs they already took.
+         */
+        if (SUTLVectorSize(aio->Queue))
+        {
+            if (pool->NextJob)
+            {
+                SUTLVectorEraseN(pool->Jobs, 0, pool->NextJob);
+                pool->NextJob = 0;
+            }
+
+            for (i = 0; i < SUTLVectorSize(aio->Queue); i++)
+            {
+                SUTLAsyncIORequest * request = aio->Requests + aio->Queue[i];
+                SUTLAsyncIOJob job;
+
+                job.Id = aio->Queue[i];
+                job.Fd = request->Fd;
+                job.Offset = request->Offset;
+                job.Size = request->Remaining;
+                job.Data = *request->Vector + SUTLVectorSize(*request->Vector);
+
+                SUTLVectorPush(pool->Jobs, job);
+            }
+
+            SUTLVectorResize(aio->Queue, 0);
+            SHRN_COND_BROADCAST(pool->HasJobs);
+        }
+
+        /*
+         * Take the finished jobs in batches, and apply them without holding the lock.
+         */
+        while (completed < count)
+        {
+            while (!SUTLVectorSize(pool->Results))
+                SHRN_COND_WAIT(pool->HasResults, pool->Mutex);
+
+            SUTLVectorResize(results, 0);
+            SUTLVectorPushN(results, pool->Results, SUTLVectorSize(pool->Results));
+            SUTLVectorResize(pool->Results, 0);
+
+            SHRN_MUTEX_UNLOCK(pool->Mutex);
+
+            for (i = 0; i < SUTLVectorSize(results); i++)
+                completed += SUTL_InternalAsyncIOComplete(aio, results[i].Id, results[i].Result, 1);
+
+            SHRN_MUTEX_LOCK(pool->Mutex);
+        }
+
+        SHRN_MUTEX_UNLOCK(pool->Mutex);
+        SUTLVectorFree(results);
+
+        return completed;
+    }
+#endif
+
+#endif
@@ -48,6 +48,7 @@
     #define SHRN_MALLOC(size)           malloc(size)
     #define SHRN_REALLOC(oldptr, size)  realloc(oldptr, size)
     #define SHRN_FREE(ptr)              free(ptr)
+    #define SHRN_STRTOD(str, end)       strtod(str, end)
 #endif
 
 #ifdef SHRN_NO_USE_STRING_H
@@ -116,6 +117,48 @@
         #define SHRN_MEMSET(ptr, val, size) SUTL_InternalMemcpy(ptr, val, size)
     #endif
 
+    #ifndef SHRN_MEMCMP
+        #warning "`SHRN_MEMCMP` should be defined if `SHRN_NO_USE_STRING_H` is defined, otherwise, a (possibly less performant) custom implementation is used."
+
+        int SUTL_InternalMemcmp(const void * ptr0, const void * ptr1, size_t size);
+
+        #ifdef SUTL_IMPLEMENTATION
+            int SUTL_InternalMemcmp(const void * ptr0, const void * ptr1, size_t size)
+            {
+                size_t i;
+
+                for (i = 0; i < size; i++)
+                    if (((const uint8_t *)ptr0)[i] != ((const uint8_t *)ptr1)[i])
+                        return ((const uint8_t *)ptr0)[i] - ((const uint8_t *)ptr1)[i];
+
+                return 0;
+            }
+        #endif
+
+        #define SHRN_MEMCMP(ptr0, ptr1, size) SUTL_InternalMemcmp(ptr0, ptr1, size)
+    #endif
+
+    #ifndef SHRN_MEMCHR
+        #warning "`SHRN_MEMCHR` should be defined if `SHRN_NO_USE_STRING_H` is defined, otherwise, a (possibly less performant) custom implementation is used."
+
+        void * SUTL_InternalMemchr(const void * ptr, int val, size_t size);
+
+        #ifdef SUTL_IMPLEMENTATION
+            void * SUTL_InternalMemchr(const void * ptr, int val, size_t size)
+            {
+                size_t i;
+
+                for (i = 0; i < size; i++)
+                    if (((const uint8_t *)ptr)[i] == (uint8_t)val)
+                        return (void *)((const uint8_t *)ptr + i);
+
+                return NULL;
+            }
+        #endif
+
+        #define SHRN_MEMCHR(ptr, val, size) SUTL_InternalMemchr(ptr, val, size)
+    #endif
+
     #ifndef SHRN_STRLEN
         #warning "`SHRN_STRLEN` should be defined if `SHRN_NO_USE_STRING_H` is defined, otherwise, a (possibly less performant) custom implementation is used."
 
@@ -167,10 +210,104 @@
     #define SHRN_MEMCPY(dst, src, size)     memcpy(dst, src, size)
     #define SHRN_MEMMOVE(dst, src, size)    memmove(dst, src, size)
     #define SHRN_MEMSET(ptr, val, size)     memset(ptr, val, size)
+    #define SHRN_MEMCMP(ptr0, ptr1, size)   memcmp(ptr0, ptr1, size)
+    #define SHRN_MEMCHR(ptr, val, size)     memchr(ptr, val, size)
     #define SHRN_STRLEN(str)                strlen(str)
     #define SHRN_STRCMP(str0, str1)         strcmp(str0, str1)
 #endif
 
+#ifndef SHRN_NO_USE_STDIO_H
+    #include <stdio.h>
+
+    #define SHRN_FORMAT_DOUBLE(buf, precision, value) sprintf(buf, "%.*g", precision, value)
+#endif
+
+/*
+ * Atomic operations, for the utilities which are shared between threads. Objects accessed with them
+ * are declared with `SHRN_ATOMIC(t)`, and `ptr` is a pointer to such an object. `order` is one of
+ * the `SHRN_ORDER` macros. `SHRN_ATOMIC_CAS` evaluates to 1 if `*ptr` was equal to `*expected` and
+ * was replaced by `desired`, otherwise it stores `*ptr` in `*expected` and evaluates to 0. The
+ * `FETCH` operations evaluate to the old value. `SHRN_PAUSE` hints to the processor that it is in a
+ * spin loop.
+ *
+ * The builtins of GCC and Clang are used if available, otherwise C11 atomics. Define
+ * `SHRN_NO_USE_ATOMICS` along with all of the atomic macros to use others. `SHRN_HAS_ATOMICS` is
+ * defined if the atomic macros are available, otherwise only `SHRN_ATOMIC` is, as the plain type.
+ */
+#if defined(SHRN_NO_USE_ATOMICS)
+    #if !defined(SHRN_ATOMIC) || !defined(SHRN_ATOMIC_LOAD) || !defined(SHRN_ATOMIC_STORE) || !defined(SHRN_ATOMIC_EXCHANGE) || !defined(SHRN_ATOMIC_CAS) || !defined(SHRN_ATOMIC_FETCH_ADD) || !defined(SHRN_ATOMIC_FETCH_SUB) || !defined(SHRN_ATOMIC_FENCE) || !defined(SHRN_PAUSE)
+        #error "`SHRN_ATOMIC` and its `LOAD`, `STORE`, `EXCHANGE`, `CAS`, `FETCH_ADD`, `FETCH_SUB` and `FENCE` macros, and `SHRN_PAUSE` must be defined if `SHRN_NO_USE_ATOMICS` is defined."
+    #endif
+
+    #if !defined(SHRN_ORDER_RELAXED) || !defined(SHRN_ORDER_ACQUIRE) || !defined(SHRN_ORDER_RELEASE) || !defined(SHRN_ORDER_ACQ_REL) || !defined(SHRN_ORDER_SEQ_CST)
+        #error "The `SHRN_ORDER` macros must be defined if `SHRN_NO_USE_ATOMICS` is defined."
+    #endif
+
+    #define SHRN_HAS_ATOMICS
+#elif defined(__GNUC__)
+    #define SHRN_ATOMIC(t)                                          t
+
+    #define SHRN_ORDER_RELAXED                                      __ATOMIC_RELAXED
+    #define SHRN_ORDER_ACQUIRE                                      __ATOMIC_ACQUIRE
+    #define SHRN_ORDER_RELEASE                                      __ATOMIC_RELEASE
+    #define SHRN_ORDER_ACQ_REL                                      __ATOMIC_ACQ_REL
+    #define SHRN_ORDER_SEQ_CST                                      __ATOMIC_SEQ_CST
+
+    #define SHRN_ATOMIC_LOAD(ptr, order)                            __atomic_load_n(ptr, order)
+    #define SHRN_ATOMIC_STORE(ptr, val, order)                      __atomic_store_n(ptr, val, order)
+    #define SHRN_ATOMIC_EXCHANGE(ptr, val, order)                   __atomic_exchange_n(ptr, val, order)
+    #define SHRN_ATOMIC_CAS(ptr, expected, desired, success, failure) \
+        __atomic_compare_exchange_n(ptr, expected, desired, 0, success, failure)
+    #define SHRN_ATOMIC_FETCH_ADD(ptr, val, order)                  __atomic_fetch_add(ptr, val, order)
+    #define SHRN_ATOMIC_FETCH_SUB(ptr, val, order)                  __atomic_fetch_sub(ptr, val, order)
+    #define SHRN_ATOMIC_FENCE(order)                                __atomic_thread_fence(order)
+
+    #if defined(__x86_64__) || defined(__i386__)
+        #define SHRN_PAUSE()                                        __builtin_ia32_pause()
+    #elif defined(__aarch64__) || defined(__arm__)
+        #define SHRN_PAUSE()                                        __asm__ __volatile__("yield")
+    #else
+        #define SHRN_PAUSE()                                        ((void)0)
+    #endif
+
+    #define SHRN_HAS_ATOMICS
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+    #include <stdatomic.h>
+
+    #define SHRN_ATOMIC(t)                                          _Atomic t
+
+    #define SHRN_ORDER_RELAXED                                      memory_order_relaxed
+    #define SHRN_ORDER_ACQUIRE                                      memory_order_acquire
+    #define SHRN_ORDER_RELEASE                                      memory_order_release
+    #define SHRN_ORDER_ACQ_REL                                      memory_order_acq_rel
+    #define SHRN_ORDER_SEQ_CST                                      memory_order_seq_cst
+
+    #define SHRN_ATOMIC_LOAD(ptr, order)                            atomic_load_explicit(ptr, order)
+    #define SHRN_ATOMIC_STORE(ptr, val, order)                      atomic_store_explicit(ptr, val, order)
+    #define SHRN_ATOMIC_EXCHANGE(ptr, val, order)                   atomic_exchange_explicit(ptr, val, order)
+    #define SHRN_ATOMIC_CAS(ptr, expected, desired, success, failure) \
+        atomic_compare_exchange_strong_explicit(ptr, expected, desired, success, failure)
+    #define SHRN_ATOMIC_FETCH_ADD(ptr, val, order)                  atomic_fetch_add_explicit(ptr, val, order)
+    #define SHRN_ATOMIC_FETCH_SUB(ptr, val, order)                  atomic_fetch_sub_explicit(ptr, val, order)
+    #define SHRN_ATOMIC_FENCE(order)                                atomic_thread_fence(order)
+    #define SHRN_PAUSE()                                            ((void)0)
+
+    #define SHRN_HAS_ATOMICS
+#else
+    /*
+     * Without atomics, objects are declared with their plain type and only used by one thread.
+     */
+    #define SHRN_ATOMIC(t)                                          t
+#endif
+
+/*
+ * The size of a cache line. Data written by different threads is kept this far apart, so that the
+ * threads don't contend for the same line.
+ */
+#ifndef SHRN_CACHE_LINE
+    #define SHRN_CACHE_LINE 64
+#endif
+
 #include "ErrorHandler.h"
 
 #endif
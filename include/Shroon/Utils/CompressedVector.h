@@ -0,0 +1,665 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_COMPRESSED_VECTOR_H
+#define SUTL_COMPRESSED_VECTOR_H
+
+#include "Common.h"
+#include "Vector.h"
+
+/**
+ * @defgroup CompressedVector
+ * An append-only sequence of \p uint64_t which is stored in compressed blocks.
+ *
+ * New elements are kept uncompressed in a tail of \p SUTL_COMPRESSED_VECTOR_BLOCK_SIZE elements.
+ * When the tail is full it is encoded as one block using the codec chosen at creation. The byte
+ * offset of every block is recorded, so any element can be reached by decoding only the block it
+ * belongs to.
+ *
+ * The following table shows the available codecs:
+ *
+ *                 Codec             |   Block layout
+ *     ------------------------------+------------------------------------------------------------
+ *      SUTL_INT_CODEC_FOR           |   minimum, bit width, bit-packed <tt>value - minimum</tt>
+ *      SUTL_INT_CODEC_DELTA_VARINT  |   first value, zigzag varint of every delta
+ *      SUTL_INT_CODEC_BP128         |   first value, bit width, zigzag deltas bit-packed in 4 lanes
+ *
+ * \p SUTL_INT_CODEC_FOR suits unsorted values within a small range and supports O(1) random access.
+ * The other two codecs suit sorted (or nearly sorted) IDs and need the block to be decoded first.
+ * The last decoded block is cached so consecutive accesses to the same block are cheap.
+ * @{
+ */
+
+/**
+ * @brief The number of elements in each compressed block.
+ */
+#define SUTL_COMPRESSED_VECTOR_BLOCK_SIZE 128
+
+/**
+ * @brief The codec used to encode the blocks of a \p SUTLCompressedVector.
+ */
+typedef enum SUTLIntCodec
+{
+    /**
+     * @brief Frame-of-reference: stores the block minimum and bit-packs the offsets from it.
+     */
+    SUTL_INT_CODEC_FOR,
+
+    /**
+     * @brief Stores the difference between consecutive elements as zigzag encoded varints.
+     */
+    SUTL_INT_CODEC_DELTA_VARINT,
+
+    /**
+     * @brief Bit-packs the zigzag encoded deltas using the 4-lane interleaved layout of
+     * SIMD-BP128. The lanes are independent so the unpack loop can be vectorized by the compiler.
+     */
+    SUTL_INT_CODEC_BP128
+} SUTLIntCodec;
+
+/**
+ * @brief It contains the state of a particular compressed vector instance.
+ */
+typedef struct SUTLCompressedVector
+{
+    /**
+     * @brief The number of elements in the compressed vector.
+     */
+    size_t Size;
+
+    /**
+     * @brief The codec used to encode the blocks.
+     */
+    SUTLIntCodec Codec;
+
+    /**
+     * @brief Don't access this directly. A vector of \p uint8_t which stores the encoded blocks.
+     */
+    uint8_t * Bytes;
+
+    /**
+     * @brief Don't access this directly. A vector of \p size_t which stores the offset of every
+     * block in \p Bytes.
+     */
+    size_t * Offsets;
+
+    /**
+     * @brief Don't access this directly. A vector of \p uint64_t which stores the elements which
+     * aren't encoded yet.
+     */
+    uint64_t * Tail;
+
+    /**
+     * @brief Don't access this directly. A vector of \p uint64_t which stores the last decoded
+     * block.
+     */
+    uint64_t * Cache;
+
+    /**
+     * @brief Don't access this directly. The index of the block stored in \p Cache. It is
+     * \p SIZE_MAX if no block is cached.
+     */
+    size_t CachedBlock;
+} SUTLCompressedVector;
+
+/**
+ * @brief Creates a new \p SUTLCompressedVector which encodes its blocks using \p codec.
+ *
+ * @param codec A \p SUTLIntCodec.
+ *
+ * @return A \p SUTLCompressedVector created according to the parameters given.
+ */
+#define SUTLCompressedVectorNew(codec)                  SUTL_InternalCompressedVectorNew(codec)
+
+/**
+ * @brief Frees a \p SUTLCompressedVector which was created using \p SUTLCompressedVectorNew.
+ *
+ * @param cv The \p SUTLCompressedVector to free.
+ */
+#define SUTLCompressedVectorFree(cv)                    SUTL_InternalCompressedVectorFree(&cv)
+
+/**
+ * @brief Pushes \p value at the end of \p cv.
+ *
+ * @param cv The compressed vector to push \p value in.
+ * @param value The value to push. It is converted to \p uint64_t.
+ */
+#define SUTLCompressedVectorPush(cv, value)             SUTL_InternalCompressedVectorPush(&cv, (uint64_t)(value))
+
+/**
+ * @brief Pushes \p count elements of type \p uint64_t from \p ptr to the end of \p cv.
+ *
+ * @param cv The compressed vector to push the elements in.
+ * @param ptr Pointer to the elements which will be pushed.
+ * @param count The number of elements to push.
+ */
+#define SUTLCompressedVectorPushN(cv, ptr, count)       SUTL_InternalCompressedVectorPushN(&cv, ptr, count)
+
+/**
+ * @brief Gets the element at index \p at in \p cv.
+ *
+ * @param cv The compressed vector to get the element from.
+ * @param at The index of the element. Must be less than the size of \p cv, otherwise 0 is
+ * returned.
+ *
+ * @return The element at index \p at.
+ */
+#define SUTLCompressedVectorGet(cv, at)                 SUTL_InternalCompressedVectorGet(&cv, at)
+
+/**
+ * @brief Gets the number of blocks in \p cv, including the unencoded tail if it isn't empty.
+ *
+ * @param cv The compressed vector to get the block count of.
+ */
+#define SUTLCompressedVectorBlockCount(cv) \
+    (SUTLVectorSize((cv).Offsets) + (SUTLVectorSize((cv).Tail) ? 1 : 0))
+
+/**
+ * @brief Decodes block \p block of \p cv into \p out.
+ *
+ * @param cv The compressed vector to decode from.
+ * @param block The index of the block to decode.
+ * @param out A <tt>uint64_t *</tt> which has space for \p SUTL_COMPRESSED_VECTOR_BLOCK_SIZE
+ * elements.
+ *
+ * @return The number of elements decoded. It is 0 if \p block doesn't exist.
+ */
+#define SUTLCompressedVectorDecodeBlock(cv, block, out) SUTL_InternalCompressedVectorDecodeBlock(&cv, block, out)
+
+/**
+ * @brief Decodes every element of \p cv and pushes them at the end of \p v.
+ *
+ * @param cv The compressed vector to decode.
+ * @param v A vector of \p uint64_t to push the elements in.
+ */
+#define SUTLCompressedVectorDecode(cv, v)               SUTL_InternalCompressedVectorDecode(&cv, &v)
+
+/**
+ * @brief Gets the number of bytes used by the elements of \p cv.
+ *
+ * @param cv The compressed vector to get the byte size of.
+ */
+#define SUTLCompressedVectorByteSize(cv) \
+    (SUTLVectorSize((cv).Bytes) + SUTLVectorSize((cv).Offsets) * sizeof(size_t) + SUTLVectorSize((cv).Tail) * sizeof(uint64_t))
+
+/**
+ * @brief Executes \p expr for each element of \p cv. The elements are decoded one block at a time.
+ *
+ * @param cv The compressed vector to iterate.
+ * @param name The name of the variable in which current element will be stored.
+ * @param expr The code block to execute for each element.
+ */
+#define SUTLCompressedVectorEach(cv, name, expr) \
+    {\
+        uint64_t sutlBlockBuf[SUTL_COMPRESSED_VECTOR_BLOCK_SIZE];\
+        size_t sutlBlock, sutlCount, i;\
+        for (sutlBlock = 0; sutlBlock < SUTLCompressedVectorBlockCount(cv); sutlBlock++)\
+        {\
+            sutlCount = SUTLCompressedVectorDecodeBlock(cv, sutlBlock, sutlBlockBuf);\
+            for (i = 0; i < sutlCount; i++)\
+            {\
+                uint64_t name = sutlBlockBuf[i];\
+                expr\
+            }\
+        }\
+    }
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+SUTLCompressedVector SUTL_InternalCompressedVectorNew(SUTLIntCodec codec);
+void SUTL_InternalCompressedVectorFree(SUTLCompressedVector * cv);
+void SUTL_InternalCompressedVectorFlushTail(SUTLCompressedVector * cv);
+void SUTL_InternalCompressedVectorPush(SUTLCompressedVector * cv, uint64_t value);
+void SUTL_InternalCompressedVectorPushN(SUTLCompressedVector * cv, const uint64_t * ptr, size_t count);
+uint64_t SUTL_InternalCompressedVectorGet(SUTLCompressedVector * cv, size_t at);
+size_t SUTL_InternalCompressedVectorDecodeBlock(SUTLCompressedVector * cv, size_t block, uint64_t * out);
+void SUTL_InternalCompressedVectorDecode(SUTLCompressedVector * cv, uint64_t ** v);
+
+size_t SUTL_InternalVarintEncode(uint8_t * out, uint64_t value);
+size_t SUTL_InternalVarintDecode(const uint8_t * in, uint64_t * value);
+unsigned SUTL_InternalBitWidth(uint64_t value);
+void SUTL_InternalBitPack(uint8_t * out, const uint64_t * in, size_t count, size_t stride, unsigned width);
+void SUTL_InternalBitUnpack(uint64_t * out, const uint8_t * in, size_t count, size_t stride, unsigned width);
+uint64_t SUTL_InternalBitGet(const uint8_t * in, size_t index, unsigned width);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    #define SUTLZigzagEncode(u) (((uint64_t)(u) << 1) ^ ((uint64_t)0 - ((uint64_t)(u) >> 63)))
+    #define SUTLZigzagDecode(z) (((uint64_t)(z) >> 1) ^ ((uint64_t)0 - ((uint64_t)(z) & 1)))
+
+    /*
+     * Upper bound of the encoded size of a block: a 10 byte varint and a width byte followed by
+     * 128 values of at most 10 bytes each.
+     */
+    #define SUTLCompressedBlockMaxSize (11 + SUTL_COMPRESSED_VECTOR_BLOCK_SIZE * 10)
+
+    size_t SUTL_InternalVarintEncode(uint8_t * out, uint64_t value)
+    {
+        size_t size = 0;
+
+        /*
+         * Emit 7 bits at a time, setting the high bit of every byte except the last.
+         */
+        while (value >= 0x80)
+        {
+            out[size++] = (uint8_t)(value | 0x80);
+            value >>= 7;
+        }
+
+        out[size++] = (uint8_t)value;
+
+        return size;
+    }
+
+    size_t SUTL_InternalVarintDecode(const uint8_t * in, uint64_t * value)
+    {
+        size_t size = 0;
+        unsigned shift = 0;
+
+        *value = 0;
+
+        while (in[size] & 0x80)
+        {
+            *value |= (uint64_t)(in[size++] & 0x7F) << shift;
+            shift += 7;
+        }
+
+        *value |= (uint64_t)in[size++] << shift;
+
+        return size;
+    }
+
+    unsigned SUTL_InternalBitWidth(uint64_t value)
+    {
+        unsigned width = 0;
+
+        while (value)
+        {
+            width++;
+            value >>= 1;
+        }
+
+        return width;
+    }
+
+    void SUTL_InternalBitPack(uint8_t * out, const uint64_t * in, size_t count, size_t stride, unsigned width)
+    {
+        uint64_t acc = 0;
+        unsigned bits = 0;
+        size_t i;
+        unsigned k;
+
+        if (!width)
+            return;
+
+        for (i = 0; i < count; i++)
+        {
+            uint64_t value = in[i * stride];
+
+            acc |= value << bits;
+
+            if (bits + width < 64)
+            {
+                bits += width;
+                continue;
+            }
+
+            /*
+             * The accumulator is full, flush it and keep the bits of `value` which didn't fit.
+             */
+            for (k = 0; k < 8; k++)
+                *out++ = (uint8_t)(acc >> (8 * k));
+
+            acc = bits ? value >> (64 - bits) : 0;
+            bits = bits + width - 64;
+        }
+
+        for (k = 0; k < bits; k += 8)
+            *out++ = (uint8_t)(acc >> k);
+    }
+
+    void SUTL_InternalBitUnpack(uint64_t * out, const uint8_t * in, size_t count, size_t stride, unsigned width)
+    {
+        uint64_t mask = width == 64 ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
+        uint64_t acc = 0;
+        unsigned bits = 0;
+        size_t i;
+
+        if (!width)
+        {
+            for (i = 0; i < count; i++)
+                out[i * stride] = 0;
+
+            return;
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            /*
+             * Refill the accumulator one byte at a time, never reading past the packed data.
+             */
+            while (bits < width && bits <= 56)
+            {
+                acc |= (uint64_t)*in++ << bits;
+                bits += 8;
+            }
+
+            if (bits >= width)
+            {
+                out[i * stride] = acc & mask;
+                acc = width == 64 ? 0 : acc >> width;
+                bits -= width;
+            }
+            else
+            {
+                /*
+                 * Only possible for widths above 56 bits, the value straddles one more byte.
+                 */
+                uint64_t next = *in++;
+
+                out[i * stride] = (acc | next << bits) & mask;
+                acc = next >> (width - bits);
+                bits = 8 - (width - bits);
+            }
+        }
+    }
+
+    uint64_t SUTL_InternalBitGet(const uint8_t * in, size_t index, unsigned width)
+    {
+        size_t bit = index * width;
+        unsigned shift = bit % 8;
+        size_t n = (shift + width + 7) / 8;
+        uint64_t value = 0;
+        size_t k;
+
+        if (!width)
+            return 0;
+
+        in += bit / 8;
+
+        for (k = 0; k < n && k < 8; k++)
+            value |= (uint64_t)in[k] << (8 * k);
+
+        value >>= shift;
+
+        if (n > 8)
+            value |= (uint64_t)in[8] << (64 - shift);
+
+        return width == 64 ? value : value & (((uint64_t)1 << width) - 1);
+    }
+
+    SUTLCompressedVector SUTL_InternalCompressedVectorNew(SUTLIntCodec codec)
+    {
+        SUTLCompressedVector cv;
+
+        /*
+         * Initialize the members of `cv`.
+         */
+        cv.Size = 0;
+        cv.Codec = codec;
+        cv.Bytes = SUTLVectorNew(uint8_t);
+        cv.Offsets = SUTLVectorNew(size_t);
+        cv.Tail = SUTLVectorNew(uint64_t);
+        cv.Cache = SUTLVectorNew(uint64_t);
+        cv.CachedBlock = SIZE_MAX;
+
+        SUTLVectorReserve(cv.Tail, SUTL_COMPRESSED_VECTOR_BLOCK_SIZE);
+        SUTLVectorResize(cv.Cache, SUTL_COMPRESSED_VECTOR_BLOCK_SIZE);
+
+        return cv;
+    }
+
+    void SUTL_InternalCompressedVectorFree(SUTLCompressedVector * cv)
+    {
+        SUTLVectorFree(cv->Cache);
+        SUTLVectorFree(cv->Tail);
+        SUTLVectorFree(cv->Offsets);
+        SUTLVectorFree(cv->Bytes);
+    }
+
+    void SUTL_InternalCompressedVectorFlushTail(SUTLCompressedVector * cv)
+    {
+        uint64_t deltas[SUTL_COMPRESSED_VECTOR_BLOCK_SIZE];
+        const uint64_t * tail = cv->Tail;
+        size_t offset = SUTLVectorSize(cv->Bytes);
+        uint8_t * out;
+        uint64_t min, bitsUsed = 0;
+        unsigned width;
+        size_t i;
+
+        /*
+         * Grow geometrically so that the byte vector isn't reallocated for every block.
+         */
+        if (SUTLVectorCapacity(cv->Bytes) < offset + SUTLCompressedBlockMaxSize)
+            SUTLVectorReserve(cv->Bytes, 2 * (offset + SUTLCompressedBlockMaxSize));
+
+        out = cv->Bytes + offset;
+
+        switch (cv->Codec)
+        {
+            case SUTL_INT_CODEC_FOR:
+                min = tail[0];
+
+                for (i = 1; i < SUTL_COMPRESSED_VECTOR_BLOCK_SIZE; i++)
+                    min = tail[i] < min ? tail[i] : min;
+
+                for (i = 0; i < SUTL_COMPRESSED_VECTOR_BLOCK_SIZE; i++)
+                {
+                    deltas[i] = tail[i] - min;
+                    bitsUsed |= deltas[i];
+                }
+
+                width = SUTL_InternalBitWidth(bitsUsed);
+
+                out += SUTL_InternalVarintEncode(out, min);
+                *out++ = (uint8_t)width;
+
+                SUTL_InternalBitPack(out, deltas, SUTL_COMPRESSED_VECTOR_BLOCK_SIZE, 1, width);
+                out += (SUTL_COMPRESSED_VECTOR_BLOCK_SIZE * width + 7) / 8;
+
+                break;
+
+            case SUTL_INT_CODEC_DELTA_VARINT:
+                out += SUTL_InternalVarintEncode(out, tail[0]);
+
+                for (i = 1; i < SUTL_COMPRESSED_VECTOR_BLOCK_SIZE; i++)
+                    out += SUTL_InternalVarintEncode(out, SUTLZigzagEncode(tail[i] - tail[i - 1]));
+
+                break;
+
+            case SUTL_INT_CODEC_BP128:
+                deltas[0] = 0;
+
+                for (i = 1; i < SUTL_COMPRESSED_VECTOR_BLOCK_SIZE; i++)
+                {
+                    deltas[i] = SUTLZigzagEncode(tail[i] - tail[i - 1]);
+                    bitsUsed |= deltas[i];
+                }
+
+                width = SUTL_InternalBitWidth(bitsUsed);
+
+                out += SUTL_InternalVarintEncode(out, tail[0]);
+                *out++ = (uint8_t)width;
+
+                /*
+                 * Lane `l` holds elements l, l + 4, l + 8... Each lane takes exactly `4 * width`
+                 * bytes, so every lane starts at a byte boundary.
+                 */
+                for (i = 0; i < 4; i++)
+                    SUTL_InternalBitPack(out + i * 4 * width, deltas + i, SUTL_COMPRESSED_VECTOR_BLOCK_SIZE / 4, 4, width);
+
+                out += SUTL_COMPRESSED_VECTOR_BLOCK_SIZE * width / 8;
+
+                break;
+        }
+
+        SUTLVectorPush(cv->Offsets, offset);
+        SUTLVectorSize(cv->Bytes) = out - cv->Bytes;
+        SUTLVectorSize(cv->Tail) = 0;
+    }
+
+    void SUTL_InternalCompressedVectorPush(SUTLCompressedVector * cv, uint64_t value)
+    {
+        SUTL_InternalCompressedVectorPushN(cv, &value, 1);
+    }
+
+    void SUTL_InternalCompressedVectorPushN(SUTLCompressedVector * cv, const uint64_t * ptr, size_t count)
+    {
+        while (count)
+        {
+            size_t space = SUTL_COMPRESSED_VECTOR_BLOCK_SIZE - SUTLVectorSize(cv->Tail);
+            size_t n = count < space ? count : space;
+
+            SUTLVectorPushN(cv->Tail, ptr, n);
+
+            cv->Size += n;
+            ptr += n;
+            count -= n;
+
+            /*
+             * Encode the tail as soon as it makes a complete block.
+             */
+            if (SUTLVectorSize(cv->Tail) == SUTL_COMPRESSED_VECTOR_BLOCK_SIZE)
+                SUTL_InternalCompressedVectorFlushTail(cv);
+        }
+    }
+
+    size_t SUTL_InternalCompressedVectorDecodeBlock(SUTLCompressedVector * cv, size_t block, uint64_t * out)
+    {
+        size_t blockCount = SUTLVectorSize(cv->Offsets);
+        const uint8_t * in;
+        uint64_t first;
+        unsigned width;
+        size_t i;
+
+        /*
+         * The block after the last encoded one is the tail.
+         */
+        if (block >= blockCount)
+        {
+            if (block > blockCount || !SUTLVectorSize(cv->Tail))
+                return 0;
+
+            SHRN_MEMCPY(out, cv->Tail, SUTLVectorSize(cv->Tail) * sizeof(uint64_t));
+
+            return SUTLVectorSize(cv->Tail);
+        }
+
+        in = cv->Bytes + cv->Offsets[block];
+        in += SUTL_InternalVarintDecode(in, &first);
+
+        switch (cv->Codec)
+        {
+            case SUTL_INT_CODEC_FOR:
+                width = *in++;
+
+                SUTL_InternalBitUnpack(out, in, SUTL_COMPRESSED_VECTOR_BLOCK_SIZE, 1, width);
+
+                for (i = 0; i < SUTL_COMPRESSED_VECTOR_BLOCK_SIZE; i++)
+                    out[i] += first;
+
+                break;
+
+            case SUTL_INT_CODEC_DELTA_VARINT:
+                out[0] = first;
+
+                for (i = 1; i < SUTL_COMPRESSED_VECTOR_BLOCK_SIZE; i++)
+                {
+                    uint64_t delta;
+                    in += SUTL_InternalVarintDecode(in, &delta);
+                    out[i] = out[i - 1] + SUTLZigzagDecode(delta);
+                }
+
+                break;
+
+            case SUTL_INT_CODEC_BP128:
+                width = *in++;
+
+                for (i = 0; i < 4; i++)
+                    SUTL_InternalBitUnpack(out + i, in + i * 4 * width, SUTL_COMPRESSED_VECTOR_BLOCK_SIZE / 4, 4, width);
+
+                out[0] = first;
+
+                for (i = 1; i < SUTL_COMPRESSED_VECTOR_BLOCK_SIZE; i++)
+                    out[i] = out[i - 1] + SUTLZigzagDecode(out[i]);
+
+                break;
+        }
+
+        return SUTL_COMPRESSED_VECTOR_BLOCK_SIZE;
+    }
+
+    uint64_t SUTL_InternalCompressedVectorGet(SUTLCompressedVector * cv, size_t at)
+    {
+        size_t block = at / SUTL_COMPRESSED_VECTOR_BLOCK_SIZE;
+        size_t index = at % SUTL_COMPRESSED_VECTOR_BLOCK_SIZE;
+
+        if (at >= cv->Size)
+        {
+            SUTLErrorHandler("Index out of range.");
+            return 0;
+        }
+
+        if (block == SUTLVectorSize(cv->Offsets))
+            return cv->Tail[index];
+
+        /*
+         * Frame-of-reference blocks can be read without decoding the whole block.
+         */
+        if (cv->Codec == SUTL_INT_CODEC_FOR)
+        {
+            const uint8_t * in = cv->Bytes + cv->Offsets[block];
+            uint64_t min;
+
+            in += SUTL_InternalVarintDecode(in, &min);
+
+            return min + SUTL_InternalBitGet(in + 1, index, *in);
+        }
+
+        if (cv->CachedBlock != block)
+        {
+            SUTL_InternalCompressedVectorDecodeBlock(cv, block, cv->Cache);
+            cv->CachedBlock = block;
+        }
+
+        return cv->Cache[index];
+    }
+
+    void SUTL_InternalCompressedVectorDecode(SUTLCompressedVector * cv, uint64_t ** v)
+    {
+        size_t size = SUTLVectorSize(*v);
+        size_t block;
+
+        SUTLVectorReserve(*v, size + cv->Size);
+
+        for (block = 0; block <= SUTLVectorSize(cv->Offsets); block++)
+            size += SUTL_InternalCompressedVectorDecodeBlock(cv, block, *v + size);
+
+        SUTLVectorSize(*v) = size;
+    }
+
+    #undef SUTLCompressedBlockMaxSize
+    #undef SUTLZigzagDecode
+    #undef SUTLZigzagEncode
+#endif
+
+#endif
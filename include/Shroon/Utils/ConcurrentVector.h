@@ -0,0 +1,289 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_CONCURRENT_VECTOR_H
+#define SUTL_CONCURRENT_VECTOR_H
+
+#include "Common.h"
+
+/**
+ * @defgroup ConcurrentVector
+ * An append-only vector which threads can push to and read from at the same time without locks.
+ *
+ * Elements are stored in buckets whose capacities are powers of two: bucket 0 holds
+ * \p SUTL_CONCURRENT_VECTOR_FIRST elements and every next bucket twice as many as the previous one.
+ * Buckets are never moved, so pointers to elements stay valid until the vector is freed. A push
+ * reserves an index by atomically incrementing the size, allocates the bucket if it is the first to
+ * reach it, copies the element and then marks it published. Readers only see published elements.
+ * @{
+ */
+
+/**
+ * @brief The base 2 logarithm of the capacity of the first bucket.
+ */
+#define SUTL_CONCURRENT_VECTOR_FIRST_BITS 5
+
+/**
+ * @brief The capacity of the first bucket.
+ */
+#define SUTL_CONCURRENT_VECTOR_FIRST ((size_t)1 << SUTL_CONCURRENT_VECTOR_FIRST_BITS)
+
+/**
+ * @brief The number of buckets, enough for any index.
+ */
+#define SUTL_CONCURRENT_VECTOR_BUCKETS (sizeof(size_t) * 8 - SUTL_CONCURRENT_VECTOR_FIRST_BITS)
+
+/**
+ * @brief It contains the buckets of a concurrent vector.
+ */
+typedef struct SUTLConcurrentVector
+{
+    /**
+     * @brief The number of reserved indices. Some of the last elements may not be published yet.
+     */
+    SHRN_ATOMIC(size_t) Size;
+
+    /**
+     * @brief The size of the element type.
+     */
+    size_t Elemsize;
+
+    /**
+     * @brief Don't access this directly. The buckets, each followed by a published flag for every
+     * element, or \p NULL if not allocated yet.
+     */
+    SHRN_ATOMIC(char *) Buckets[SUTL_CONCURRENT_VECTOR_BUCKETS];
+} SUTLConcurrentVector;
+
+/**
+ * @brief Creates a new empty \p SUTLConcurrentVector of type \p t.
+ *
+ * @param t The type of element which the vector will store.
+ *
+ * @return A \p SUTLConcurrentVector.
+ */
+#define SUTLConcurrentVectorNew(t)              SUTL_InternalConcurrentVectorNew(sizeof(t))
+
+/**
+ * @brief Frees \p cv. No thread may use it anymore.
+ *
+ * @param cv The \p SUTLConcurrentVector to free.
+ */
+#define SUTLConcurrentVectorFree(cv)            SUTL_InternalConcurrentVectorFree(&cv)
+
+/**
+ * @brief Gets the number of reserved indices of \p cv.
+ *
+ * @param cv The \p SUTLConcurrentVector.
+ *
+ * @return The size as a \p size_t. Elements at the last indices may not be published yet when other
+ * threads are pushing.
+ */
+#define SUTLConcurrentVectorSize(cv)            SHRN_ATOMIC_LOAD(&(cv).Size, SHRN_ORDER_ACQUIRE)
+
+/**
+ * @brief Pushes \p elem at the end of \p cv. Any number of threads can push at the same time.
+ *
+ * @param cv The \p SUTLConcurrentVector to push to.
+ * @param elem The element to push. Must be an lvalue.
+ *
+ * @return The index of the element as a \p size_t.
+ */
+#define SUTLConcurrentVectorPush(cv, elem)      SUTL_InternalConcurrentVectorPush(&cv, &elem)
+
+/**
+ * @brief Gets a pointer to the element at index \p i of \p cv, if it has been published.
+ *
+ * @param t The type of element stored in \p cv.
+ * @param cv The \p SUTLConcurrentVector to get from.
+ * @param i The index of the element.
+ *
+ * @return A <tt>const t *</tt> to the element, valid until \p cv is freed. If the element at \p i
+ * isn't published yet it is \p NULL, and if \p i is out of range an error is reported as well.
+ */
+#define SUTLConcurrentVectorAt(t, cv, i)        ((const t *)SUTL_InternalConcurrentVectorAt(&cv, i))
+
+/**
+ * @brief Executes \p expr for every published element of \p cv in the order of their indices.
+ *
+ * @param t The type of element stored in \p cv.
+ * @param cv The \p SUTLConcurrentVector to iterate.
+ * @param name The name of the variable which points to the current element.
+ * @param expr The code block to execute for every element.
+ */
+#define SUTLConcurrentVectorEach(t, cv, name, expr) \
+    {\
+        size_t name##_i;\
+        size_t name##_size = SUTLConcurrentVectorSize(cv);\
+        const t * name;\
+        for (name##_i = 0; name##_i < name##_size; name##_i++)\
+            if ((name = SUTLConcurrentVectorAt(t, cv, name##_i)) != NULL)\
+            {\
+                expr\
+            }\
+    }
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+SUTLConcurrentVector SUTL_InternalConcurrentVectorNew(size_t elemsize);
+void SUTL_InternalConcurrentVectorFree(SUTLConcurrentVector * cv);
+size_t SUTL_InternalConcurrentVectorPush(SUTLConcurrentVector * cv, const void * elem);
+const void * SUTL_InternalConcurrentVectorAt(SUTLConcurrentVector * cv, size_t i);
+size_t SUTL_InternalConcurrentVectorLocate(size_t i, size_t * offset);
+char * SUTL_InternalConcurrentVectorBucket(SUTLConcurrentVector * cv, size_t bucket);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    #ifndef SHRN_HAS_ATOMICS
+        #error "ConcurrentVector.h needs the atomic macros of Common.h."
+    #endif
+
+    #define SUTLConcurrentVectorCapacity(bucket)        (SUTL_CONCURRENT_VECTOR_FIRST << (bucket))
+    #define SUTLConcurrentVectorFlags(cv, data, bucket) \
+        ((SHRN_ATOMIC(unsigned char) *)((data) + SUTLConcurrentVectorCapacity(bucket) * (cv)->Elemsize))
+
+    SUTLConcurrentVector SUTL_InternalConcurrentVectorNew(size_t elemsize)
+    {
+        SUTLConcurrentVector cv;
+        size_t i;
+
+        /*
+         * Initialize the members of `cv`.
+         */
+        cv.Size = 0;
+        cv.Elemsize = elemsize;
+
+        for (i = 0; i < SUTL_CONCURRENT_VECTOR_BUCKETS; i++)
+            cv.Buckets[i] = NULL;
+
+        return cv;
+    }
+
+    void SUTL_InternalConcurrentVectorFree(SUTLConcurrentVector * cv)
+    {
+        size_t i;
+
+        for (i = 0; i < SUTL_CONCURRENT_VECTOR_BUCKETS; i++)
+        {
+            SHRN_FREE(SHRN_ATOMIC_LOAD(&cv->Buckets[i], SHRN_ORDER_ACQUIRE));
+            SHRN_ATOMIC_STORE(&cv->Buckets[i], NULL, SHRN_ORDER_RELAXED);
+        }
+
+        SHRN_ATOMIC_STORE(&cv->Size, 0, SHRN_ORDER_RELAXED);
+    }
+
+    size_t SUTL_InternalConcurrentVectorLocate(size_t i, size_t * offset)
+    {
+        size_t pos = i + SUTL_CONCURRENT_VECTOR_FIRST;
+        size_t bit;
+
+        /*
+         * Counting from `SUTL_CONCURRENT_VECTOR_FIRST`, the highest bit of the position is the
+         * first position of its bucket.
+         */
+        #if defined(__GNUC__)
+            bit = sizeof(unsigned long long) * 8 - 1 - (size_t)__builtin_clzll((unsigned long long)pos);
+        #else
+            for (bit = 0; pos >> bit > 1; bit++);
+        #endif
+
+        *offset = pos - ((size_t)1 << bit);
+
+        return bit - SUTL_CONCURRENT_VECTOR_FIRST_BITS;
+    }
+
+    char * SUTL_InternalConcurrentVectorBucket(SUTLConcurrentVector * cv, size_t bucket)
+    {
+        size_t capacity = SUTLConcurrentVectorCapacity(bucket);
+        char * data = SHRN_ATOMIC_LOAD(&cv->Buckets[bucket], SHRN_ORDER_ACQUIRE);
+        char * expected = NULL;
+
+        if (data)
+            return data;
+
+        /*
+         * Every thread which finds the bucket missing allocates one, and all but the first to
+         * install it free theirs.
+         */
+        data = (char *)SHRN_MALLOC(capacity * cv->Elemsize + capacity);
+
+        if (!data)
+        {
+            SUTLErrorHandler("Memory allocation failed.");
+            return NULL;
+        }
+
+        SHRN_MEMSET(data + capacity * cv->Elemsize, 0, capacity);
+
+        if (SHRN_ATOMIC_CAS(&cv->Buckets[bucket], &expected, data, SHRN_ORDER_ACQ_REL, SHRN_ORDER_ACQUIRE))
+            return data;
+
+        SHRN_FREE(data);
+
+        return expected;
+    }
+
+    size_t SUTL_InternalConcurrentVectorPush(SUTLConcurrentVector * cv, const void * elem)
+    {
+        size_t i = SHRN_ATOMIC_FETCH_ADD(&cv->Size, 1, SHRN_ORDER_RELAXED);
+        size_t offset;
+        size_t bucket = SUTL_InternalConcurrentVectorLocate(i, &offset);
+        char * data = SUTL_InternalConcurrentVectorBucket(cv, bucket);
+
+        if (!data)
+            return i;
+
+        /*
+         * The flag is set after the element is written, so readers which see it see the element.
+         */
+        SHRN_MEMCPY(data + offset * cv->Elemsize, elem, cv->Elemsize);
+        SHRN_ATOMIC_STORE(&SUTLConcurrentVectorFlags(cv, data, bucket)[offset], 1, SHRN_ORDER_RELEASE);
+
+        return i;
+    }
+
+    const void * SUTL_InternalConcurrentVectorAt(SUTLConcurrentVector * cv, size_t i)
+    {
+        size_t offset;
+        size_t bucket;
+        char * data;
+
+        if (i >= SHRN_ATOMIC_LOAD(&cv->Size, SHRN_ORDER_ACQUIRE))
+        {
+            SUTLErrorHandler("Index out of range.");
+            return NULL;
+        }
+
+        bucket = SUTL_InternalConcurrentVectorLocate(i, &offset);
+        data = SHRN_ATOMIC_LOAD(&cv->Buckets[bucket], SHRN_ORDER_ACQUIRE);
+
+        if (!data || !SHRN_ATOMIC_LOAD(&SUTLConcurrentVectorFlags(cv, data, bucket)[offset], SHRN_ORDER_ACQUIRE))
+            return NULL;
+
+        return data + offset * cv->Elemsize;
+    }
+
+    #undef SUTLConcurrentVectorCapacity
+    #undef SUTLConcurrentVectorFlags
+#endif
+
+#endif
@@ -0,0 +1,774 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_CSV_H
+#define SUTL_CSV_H
+
+#include "Common.h"
+#include "Vector.h"
+#include "String.h"
+#include "Swar.h"
+#include "System.h"
+
+/**
+ * @defgroup Csv
+ * A parser for delimited text like CSV and TSV which produces one vector per column.
+ *
+ * The input is scanned 64 bytes at a time. For each block, bitmasks of the quotes, delimiters and
+ * newlines are built 8 bytes at a time with plain integer operations, and the mask of the bytes
+ * inside quotes is the prefix XOR of the quote mask. The delimiters and newlines outside quotes are
+ * then visited by iterating over the set bits, so ordinary bytes are never looked at one by one.
+ *
+ * Fields are stored as \p SUTLStringView s into the input, or parsed into \p int64_t or \p double
+ * depending on the type of the column. Large inputs are split into chunks at row boundaries and
+ * parsed by several threads.
+ *
+ * Fields may be quoted with \p " to contain delimiters and newlines, and a quote inside a quoted
+ * field is written twice. CRLF line endings and empty lines are accepted.
+ * @{
+ */
+
+/**
+ * @brief Inputs are only parsed with several threads if each thread gets at least this many bytes.
+ */
+#ifndef SUTL_CSV_MIN_CHUNK
+    #define SUTL_CSV_MIN_CHUNK (1 << 20)
+#endif
+
+/**
+ * @brief The maximum number of threads used by \p SUTLCsvParse.
+ */
+#ifndef SUTL_CSV_MAX_THREADS
+    #define SUTL_CSV_MAX_THREADS 64
+#endif
+
+/**
+ * @brief The type of the values of a column.
+ */
+typedef enum SUTLCsvType
+{
+    /**
+     * @brief The values are kept as \p SUTLStringView s into the input.
+     */
+    SUTL_CSV_STRING,
+
+    /**
+     * @brief The values are parsed as decimal \p int64_t s.
+     */
+    SUTL_CSV_INT,
+
+    /**
+     * @brief The values are parsed as \p double s.
+     */
+    SUTL_CSV_DOUBLE
+} SUTLCsvType;
+
+/**
+ * @brief A column of a \p SUTLCsvTable.
+ */
+typedef struct SUTLCsvColumn
+{
+    /**
+     * @brief The name of the column from the header row. It is empty if there is no header.
+     */
+    SUTLStringView Name;
+
+    /**
+     * @brief The type of the values.
+     */
+    SUTLCsvType Type;
+
+    /**
+     * @brief The number of values which were empty, missing or couldn't be parsed as \p Type.
+     * They are stored as 0.
+     */
+    size_t InvalidCount;
+
+    /**
+     * @brief A vector of \p SUTLStringView, \p int64_t or \p double depending on \p Type, with one
+     * value per row. Use \p SUTLCsvStrings, \p SUTLCsvInts or \p SUTLCsvDoubles to access it.
+     */
+    void * Values;
+} SUTLCsvColumn;
+
+/**
+ * @brief The result of parsing delimited text.
+ */
+typedef struct SUTLCsvTable
+{
+    /**
+     * @brief The number of rows, not counting the header.
+     */
+    size_t RowCount;
+
+    /**
+     * @brief The number of rows which had fewer or more fields than there are columns. Missing
+     * fields are stored as invalid values, and extra fields are ignored.
+     */
+    size_t BadRowCount;
+
+    /**
+     * @brief A vector of \p SUTLCsvColumn.
+     */
+    SUTLCsvColumn * Columns;
+} SUTLCsvTable;
+
+/**
+ * @brief Parses delimited text into a \p SUTLCsvTable.
+ *
+ * @param data A \p SUTLStringView of the text. It must stay valid as long as the string values of
+ * the table are used.
+ * @param delimiter The character between fields, like <tt>','</tt> or <tt>'\\t'</tt>.
+ * @param header 1 if the first row contains the names of the columns.
+ * @param types A vector of \p SUTLCsvType with the type of each column. If it is \p NULL, the
+ * number of columns is taken from the first row and all of them are strings.
+ * @param threads The maximum number of threads to use. 0 or 1 parses on the calling thread.
+ *
+ * @return A \p SUTLCsvTable.
+ */
+#define SUTLCsvParse(data, delimiter, header, types, threads) SUTL_InternalCsvParse(data, delimiter, header, types, threads)
+
+/**
+ * @brief Frees a \p SUTLCsvTable which was created using \p SUTLCsvParse.
+ *
+ * @param t The \p SUTLCsvTable to free.
+ */
+#define SUTLCsvTableFree(t)                     SUTL_InternalCsvTableFree(&t)
+
+/**
+ * @brief Gets the number of columns in \p t.
+ *
+ * @param t The \p SUTLCsvTable.
+ *
+ * @return The number of columns.
+ */
+#define SUTLCsvColumnCount(t)                   SUTLVectorSize((t).Columns)
+
+/**
+ * @brief Gets the values of string column \p col of \p t.
+ *
+ * @param t The \p SUTLCsvTable.
+ * @param col The index of the column.
+ *
+ * @return A vector of \p SUTLStringView. Quoted fields don't include the outer quotes, but doubled
+ * quotes inside them are kept as they are, see \p SUTLCsvUnquote.
+ */
+#define SUTLCsvStrings(t, col)                  ((SUTLStringView *)(t).Columns[col].Values)
+
+/**
+ * @brief Gets the values of integer column \p col of \p t.
+ *
+ * @param t The \p SUTLCsvTable.
+ * @param col The index of the column.
+ *
+ * @return A vector of \p int64_t.
+ */
+#define SUTLCsvInts(t, col)                     ((int64_t *)(t).Columns[col].Values)
+
+/**
+ * @brief Gets the values of floating point column \p col of \p t.
+ *
+ * @param t The \p SUTLCsvTable.
+ * @param col The index of the column.
+ *
+ * @return A vector of \p double.
+ */
+#define SUTLCsvDoubles(t, col)                  ((double *)(t).Columns[col].Values)
+
+/**
+ * @brief Appends the content of a quoted field to \p str with every doubled quote replaced by a
+ * single one.
+ *
+ * @param view The \p SUTLStringView of the field.
+ * @param str The \p SUTLString to append to.
+ */
+#define SUTLCsvUnquote(view, str)               SUTL_InternalCsvUnquote(view, &str)
+
+/**
+ * @brief Appends \p view to \p str as a CSV field. It is quoted, with quotes inside it doubled,
+ * only if it contains \p delimiter, a quote or a line break. The check looks at 8 bytes at a time,
+ * so fields which need no quotes cost little more than a copy.
+ *
+ * Rows can be streamed by appending fields, delimiters and newlines to a reused \p SUTLString and
+ * handing it to a \p SUTLWriter whenever it is large enough.
+ *
+ * @param str The \p SUTLString to append to.
+ * @param view The \p SUTLStringView of the field.
+ * @param delimiter The character which separates fields.
+ */
+#define SUTLCsvAppendField(str, view, delimiter) SUTL_InternalCsvAppendField(&str, view, delimiter)
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+typedef struct SUTLCsvChunk
+{
+    const char * Begin;
+    const char * End;
+    const char * Stop;
+    char Delimiter;
+    int Quoted;
+    int Grow;
+    size_t RowLimit;
+    size_t QuoteCount;
+    size_t RowCount;
+    size_t BadRowCount;
+    size_t Column;
+    int RowBad;
+    SUTLCsvColumn * Columns;
+} SUTLCsvChunk;
+
+SUTLCsvTable SUTL_InternalCsvParse(SUTLStringView data, char delimiter, int header, const SUTLCsvType * types, size_t threads);
+void SUTL_InternalCsvTableFree(SUTLCsvTable * t);
+void SUTL_InternalCsvUnquote(SUTLStringView view, SUTLString * str);
+void SUTL_InternalCsvAppendField(SUTLString * str, SUTLStringView view, char delimiter);
+
+void SUTL_InternalCsvMasks(const unsigned char * block, char delimiter, uint64_t * quotes, uint64_t * delimiters, uint64_t * newlines);
+size_t SUTL_InternalCsvCountQuotes(const char * begin, const char * end);
+const char * SUTL_InternalCsvNextRow(const char * begin, const char * end, int quoted);
+SUTLCsvColumn * SUTL_InternalCsvNewColumns(const SUTLCsvColumn * like, size_t count);
+void SUTL_InternalCsvFreeColumns(SUTLCsvColumn * columns);
+void SUTL_InternalCsvPushValue(SUTLCsvColumn * col, const char * begin, const char * end);
+void SUTL_InternalCsvField(SUTLCsvChunk * chunk, const char * begin, const char * end, int last);
+void SUTL_InternalCsvParseChunk(SUTLCsvChunk * chunk);
+void * SUTL_InternalCsvCountWorker(void * arg);
+void * SUTL_InternalCsvParseWorker(void * arg);
+void SUTL_InternalCsvRun(SUTLCsvChunk * chunks, size_t count, void * (*worker)(void *));
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    void SUTL_InternalCsvMasks(const unsigned char * block, char delimiter, uint64_t * quotes, uint64_t * delimiters, uint64_t * newlines)
+    {
+        uint64_t w;
+        unsigned i;
+
+        *quotes = 0;
+        *delimiters = 0;
+        *newlines = 0;
+
+        for (i = 0; i < 64; i += 8)
+        {
+            SUTL_SWAR_LOAD(w, block + i);
+
+            *quotes |= (uint64_t)SUTL_SWAR_EQ(w, '"') << i;
+            *delimiters |= (uint64_t)SUTL_SWAR_EQ(w, (unsigned char)delimiter) << i;
+            *newlines |= (uint64_t)SUTL_SWAR_EQ(w, '\n') << i;
+        }
+    }
+
+    size_t SUTL_InternalCsvCountQuotes(const char * begin, const char * end)
+    {
+        size_t count = 0;
+        uint64_t w, m;
+
+        for (; end - begin >= 8; begin += 8)
+        {
+            SUTL_SWAR_LOAD(w, begin);
+
+            w ^= SUTL_SWAR_ONES * '"';
+            m = SUTL_SWAR_ZEROS(w);
+
+            /*
+             * Every byte of `m >> 7` is 0 or 1, so the multiplication sums them into the top byte.
+             */
+            count += (size_t)(((m >> 7) * SUTL_SWAR_ONES) >> 56);
+        }
+
+        for (; begin != end; begin++)
+            count += *begin == '"';
+
+        return count;
+    }
+
+    const char * SUTL_InternalCsvNextRow(const char * begin, const char * end, int quoted)
+    {
+        for (; begin != end; begin++)
+        {
+            if (*begin == '"')
+                quoted = !quoted;
+            else if (*begin == '\n' && !quoted)
+                return begin + 1;
+        }
+
+        return end;
+    }
+
+    SUTLCsvColumn * SUTL_InternalCsvNewColumns(const SUTLCsvColumn * like, size_t count)
+    {
+        SUTLCsvColumn * columns = SUTLVectorNew(SUTLCsvColumn);
+        SUTLCsvColumn col;
+        size_t i;
+
+        for (i = 0; i < count; i++)
+        {
+            col = like[i];
+            col.InvalidCount = 0;
+
+            if (col.Type == SUTL_CSV_INT)
+                col.Values = SUTLVectorNew(int64_t);
+            else if (col.Type == SUTL_CSV_DOUBLE)
+                col.Values = SUTLVectorNew(double);
+            else
+                col.Values = SUTLVectorNew(SUTLStringView);
+
+            SUTLVectorPush(columns, col);
+        }
+
+        return columns;
+    }
+
+    void SUTL_InternalCsvFreeColumns(SUTLCsvColumn * columns)
+    {
+        size_t i;
+
+        for (i = 0; i < SUTLVectorSize(columns); i++)
+            SUTLVectorFree(columns[i].Values);
+
+        SUTLVectorFree(columns);
+    }
+
+    void SUTL_InternalCsvPushValue(SUTLCsvColumn * col, const char * begin, const char * end)
+    {
+        SUTLStringView view;
+        int64_t i = 0;
+        double d = 0.0;
+
+        view.Data = begin;
+        view.Size = (size_t)(end - begin);
+
+        /*
+         * Grow the vector geometrically, since a push only makes room for one more value.
+         */
+        if (SUTLVectorSize(col->Values) == SUTLVectorCapacity(col->Values))
+            SUTLVectorReserve(col->Values, SUTLVectorCapacity(col->Values) * 2 + 16);
+
+        if (col->Type == SUTL_CSV_INT)
+        {
+            if (!begin || !SUTL_InternalStringViewToInt(view, &i))
+            {
+                i = 0;
+                col->InvalidCount++;
+            }
+
+            SUTLVectorPush(col->Values, i);
+        }
+        else if (col->Type == SUTL_CSV_DOUBLE)
+        {
+            if (!begin || !SUTL_InternalStringViewToDouble(view, &d))
+            {
+                d = 0.0;
+                col->InvalidCount++;
+            }
+
+            SUTLVectorPush(col->Values, d);
+        }
+        else
+        {
+            if (!begin)
+                view.Data = "";
+
+            SUTLVectorPush(col->Values, view);
+        }
+    }
+
+    void SUTL_InternalCsvField(SUTLCsvChunk * chunk, const char * begin, const char * end, int last)
+    {
+        SUTLCsvColumn col;
+        size_t count;
+
+        if (last && end != begin && end[-1] == '\r')
+            end--;
+
+        /*
+         * Empty lines aren't rows.
+         */
+        if (last && !chunk->Column && begin == end)
+            return;
+
+        if (end - begin >= 2 && *begin == '"' && end[-1] == '"')
+        {
+            begin++;
+            end--;
+        }
+
+        count = SUTLVectorSize(chunk->Columns);
+
+        if (chunk->Column == count && chunk->Grow)
+        {
+            col.Name.Data = "";
+            col.Name.Size = 0;
+            col.Type = SUTL_CSV_STRING;
+
+            col.InvalidCount = 0;
+            col.Values = SUTLVectorNew(SUTLStringView);
+
+            SUTLVectorPush(chunk->Columns, col);
+            count++;
+        }
+
+        if (chunk->Column < count)
+            SUTL_InternalCsvPushValue(&chunk->Columns[chunk->Column], begin, end);
+        else
+            chunk->RowBad = 1;
+
+        chunk->Column++;
+
+        if (!last)
+            return;
+
+        /*
+         * Fill the missing fields.
+         */
+        if (chunk->Column < count)
+        {
+            chunk->RowBad = 1;
+
+            for (; chunk->Column < count; chunk->Column++)
+                SUTL_InternalCsvPushValue(&chunk->Columns[chunk->Column], NULL, NULL);
+        }
+
+        chunk->Grow = 0;
+        chunk->RowCount++;
+        chunk->BadRowCount += (size_t)chunk->RowBad;
+        chunk->RowBad = 0;
+        chunk->Column = 0;
+    }
+
+    void SUTL_InternalCsvParseChunk(SUTLCsvChunk * chunk)
+    {
+        unsigned char tail[64];
+        const char * field = chunk->Begin;
+        size_t size = (size_t)(chunk->End - chunk->Begin);
+        uint64_t carry = chunk->Quoted ? ~(uint64_t)0 : 0;
+        uint64_t quotes, delimiters, newlines, inside, bits;
+        const unsigned char * block;
+        const char * at;
+        size_t offset;
+        unsigned bit;
+        int newline;
+
+        chunk->Stop = chunk->End;
+
+        for (offset = 0; offset < size; offset += 64)
+        {
+            block = (const unsigned char *)chunk->Begin + offset;
+
+            /*
+             * Pad the last partial block with zeros, which match none of the characters.
+             */
+            if (size - offset < 64)
+            {
+                SHRN_MEMSET(tail, 0, sizeof(tail));
+                SHRN_MEMCPY(tail, block, size - offset);
+
+                block = tail;
+            }
+
+            SUTL_InternalCsvMasks(block, chunk->Delimiter, &quotes, &delimiters, &newlines);
+
+            /*
+             * The quote state at the end of the previous block flips the whole mask.
+             */
+            inside = SUTL_InternalPrefixXor64(quotes) ^ carry;
+            carry = (uint64_t)0 - (inside >> 63);
+
+            bits = (delimiters | newlines) & ~inside;
+
+            while (bits)
+            {
+                bit = SUTL_CTZ64(bits);
+                bits &= bits - 1;
+
+                at = chunk->Begin + offset + bit;
+                newline = (int)(newlines >> bit) & 1;
+
+                SUTL_InternalCsvField(chunk, field, at, newline);
+                field = at + 1;
+
+                if (newline && chunk->RowLimit && chunk->RowCount == chunk->RowLimit)
+                {
+                    chunk->Stop = field;
+                    return;
+                }
+            }
+        }
+
+        /*
+         * The last row may not end with a newline.
+         */
+        if (field != chunk->End || chunk->Column)
+            SUTL_InternalCsvField(chunk, field, chunk->End, 1);
+    }
+
+    void * SUTL_InternalCsvCountWorker(void * arg)
+    {
+        SUTLCsvChunk * chunk = (SUTLCsvChunk *)arg;
+
+        chunk->QuoteCount = SUTL_InternalCsvCountQuotes(chunk->Begin, chunk->End);
+
+        return NULL;
+    }
+
+    void * SUTL_InternalCsvParseWorker(void * arg)
+    {
+        SUTL_InternalCsvParseChunk((SUTLCsvChunk *)arg);
+
+        return NULL;
+    }
+
+    void SUTL_InternalCsvRun(SUTLCsvChunk * chunks, size_t count, void * (*worker)(void *))
+    {
+        SHRN_THREAD threads[SUTL_CSV_MAX_THREADS];
+        int started[SUTL_CSV_MAX_THREADS];
+        size_t i;
+
+        /*
+         * The first chunk is handled by the calling thread, and so is any chunk whose thread can't
+         * be started.
+         */
+        for (i = 1; i < count; i++)
+            started[i] = SHRN_THREAD_CREATE(threads[i], worker, &chunks[i]);
+
+        worker(&chunks[0]);
+
+        for (i = 1; i < count; i++)
+        {
+            if (started[i])
+                SHRN_THREAD_JOIN(threads[i]);
+            else
+                worker(&chunks[i]);
+        }
+    }
+
+    SUTLCsvTable SUTL_InternalCsvParse(SUTLStringView data, char delimiter, int header, const SUTLCsvType * types, size_t threads)
+    {
+        SUTLCsvChunk chunks[SUTL_CSV_MAX_THREADS];
+        SUTLCsvChunk first;
+        SUTLCsvColumn col;
+        SUTLCsvTable t;
+        const char * begin = data.Data;
+        const char * end = data.Data + data.Size;
+        size_t count = 0;
+        size_t i, j;
+        int quoted;
+
+        t.RowCount = 0;
+        t.BadRowCount = 0;
+        t.Columns = SUTLVectorNew(SUTLCsvColumn);
+
+        col.Name.Data = "";
+        col.Name.Size = 0;
+        col.Type = SUTL_CSV_STRING;
+        col.InvalidCount = 0;
+        col.Values = NULL;
+
+        /*
+         * The first row is parsed on its own as strings, either for the names of the columns or
+         * for the number of columns if the types aren't given.
+         */
+        SHRN_MEMSET(&first, 0, sizeof(first));
+
+        first.Begin = begin;
+        first.End = end;
+        first.Delimiter = delimiter;
+        first.Grow = 1;
+        first.RowLimit = 1;
+        first.Columns = SUTLVectorNew(SUTLCsvColumn);
+
+        if (header || !types)
+        {
+            SUTL_InternalCsvParseChunk(&first);
+
+            if (header)
+                begin = first.Stop;
+        }
+
+        count = types ? SUTLVectorSize(types) : SUTLVectorSize(first.Columns);
+
+        for (i = 0; i < count; i++)
+        {
+            if (header && i < SUTLVectorSize(first.Columns))
+                col.Name = ((SUTLStringView *)first.Columns[i].Values)[0];
+
+            if (types)
+                col.Type = types[i];
+
+            SUTLVectorPush(t.Columns, col);
+        }
+
+        SUTL_InternalCsvFreeColumns(first.Columns);
+
+        /*
+         * Split the rest into chunks which start at row boundaries.
+         */
+        if (threads > SUTL_CSV_MAX_THREADS)
+            threads = SUTL_CSV_MAX_THREADS;
+
+        if (threads < 1 || (size_t)(end - begin) / threads < SUTL_CSV_MIN_CHUNK)
+            threads = 1;
+
+        for (i = 0; i < threads; i++)
+        {
+            SHRN_MEMSET(&chunks[i], 0, sizeof(chunks[i]));
+
+            chunks[i].Begin = begin + (size_t)(end - begin) / threads * i;
+            chunks[i].End = i + 1 < threads ? begin + (size_t)(end - begin) / threads * (i + 1) : end;
+            chunks[i].Delimiter = delimiter;
+        }
+
+        if (threads > 1)
+        {
+            /*
+             * The parity of the quotes before a chunk tells whether it starts inside a quoted field.
+             * Each chunk is then moved to start after its first newline outside quotes.
+             */
+            SUTL_InternalCsvRun(chunks, threads, SUTL_InternalCsvCountWorker);
+
+            quoted = (int)(chunks[0].QuoteCount & 1);
+
+            for (i = 1; i < threads; i++)
+            {
+                const char * at = SUTL_InternalCsvNextRow(chunks[i].Begin, end, quoted);
+
+                quoted ^= (int)(chunks[i].QuoteCount & 1);
+
+                if (at < chunks[i - 1].Begin)
+                    at = chunks[i - 1].Begin;
+
+                chunks[i - 1].End = at;
+                chunks[i].Begin = at;
+            }
+        }
+
+        for (i = 0; i < threads; i++)
+            chunks[i].Columns = SUTL_InternalCsvNewColumns(t.Columns, SUTLVectorSize(t.Columns));
+
+        SUTL_InternalCsvRun(chunks, threads, SUTL_InternalCsvParseWorker);
+
+        /*
+         * Concatenate the values of the chunks in order.
+         */
+        for (j = 0; j < SUTLVectorSize(t.Columns); j++)
+        {
+            t.Columns[j].Values = chunks[0].Columns[j].Values;
+            t.Columns[j].InvalidCount = chunks[0].Columns[j].InvalidCount;
+
+            for (i = 1; i < threads; i++)
+            {
+                SUTLVectorPushN(t.Columns[j].Values, chunks[i].Columns[j].Values, SUTLVectorSize(chunks[i].Columns[j].Values));
+                t.Columns[j].InvalidCount += chunks[i].Columns[j].InvalidCount;
+            }
+        }
+
+        for (i = 0; i < threads; i++)
+        {
+            t.RowCount += chunks[i].RowCount;
+            t.BadRowCount += chunks[i].BadRowCount;
+
+            for (j = 0; j < SUTLVectorSize(chunks[i].Columns); j++)
+            {
+                if (i)
+                    SUTLVectorFree(chunks[i].Columns[j].Values);
+            }
+
+            SUTLVectorFree(chunks[i].Columns);
+        }
+
+        return t;
+    }
+
+    void SUTL_InternalCsvTableFree(SUTLCsvTable * t)
+    {
+        SUTL_InternalCsvFreeColumns(t->Columns);
+
+        t->Columns = NULL;
+        t->RowCount = 0;
+        t->BadRowCount = 0;
+    }
+
+    void SUTL_InternalCsvUnquote(SUTLStringView view, SUTLString * str)
+    {
+        size_t begin = 0;
+        size_t i;
+
+        for (i = 0; i < view.Size; i++)
+        {
+            if (view.Data[i] == '"' && i + 1 < view.Size && view.Data[i + 1] == '"')
+            {
+                SUTLStringAppendN(*str, view.Data + begin, i + 1 - begin);
+
+                begin = i + 2;
+                i++;
+            }
+        }
+
+        SUTLStringAppendN(*str, view.Data + begin, view.Size - begin);
+    }
+
+    void SUTL_InternalCsvAppendField(SUTLString * str, SUTLStringView view, char delimiter)
+    {
+        const unsigned char * data = (const unsigned char *)view.Data;
+        char quote = '"';
+        size_t begin = 0;
+        size_t i = 0;
+        uint64_t w;
+
+        /*
+         * Look for a character which needs quoting, 8 bytes at a time and then one at a time.
+         */
+        for (; i + 8 <= view.Size; i += 8)
+        {
+            SUTL_SWAR_LOAD(w, data + i);
+
+            if (SUTL_SWAR_EQ(w, delimiter) | SUTL_SWAR_EQ(w, '"') | SUTL_SWAR_EQ(w, '\n') | SUTL_SWAR_EQ(w, '\r'))
+                break;
+        }
+
+        for (; i < view.Size; i++)
+            if (data[i] == (unsigned char)delimiter || data[i] == '"' || data[i] == '\n' || data[i] == '\r')
+                break;
+
+        if (i == view.Size)
+        {
+            SUTLStringAppendN(*str, view.Data, view.Size);
+            return;
+        }
+
+        /*
+         * Copy the runs between quotes, ending each run with its quote so that it gets doubled.
+         */
+        SUTLStringAppendC(*str, quote);
+
+        for (i = 0; i < view.Size; i++)
+        {
+            if (data[i] == '"')
+            {
+                SUTLStringAppendN(*str, view.Data + begin, i + 1 - begin);
+                begin = i;
+            }
+        }
+
+        SUTLStringAppendN(*str, view.Data + begin, view.Size - begin);
+        SUTLStringAppendC(*str, quote);
+    }
+#endif
+
+#endif
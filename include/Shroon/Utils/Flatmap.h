@@ -0,0 +1,538 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_FLATMAP_H
+#define SUTL_FLATMAP_H
+
+#include "Common.h"
+#include "HashUtils.h"
+
+/**
+ * @defgroup Flatmap
+ * An open addressing hashmap for plain old data keys and values. It has the same interface as
+ * \p SUTLHashmap but stores every entry in one flat slot array instead of per bucket vectors.
+ *
+ * Every slot has a control byte which is either empty, erased or the top 7 bits of the hash of the
+ * key in the slot. Lookups probe the control bytes linearly and only compare keys whose hash bits
+ * match.
+ *
+ * The keys and values can be laid out in two ways, chosen at creation:
+ *
+ *        Layout    |   Storage
+ *     -------------+---------------------------------------------------------------------------
+ *        AoS       |   The key and value of an entry are next to each other in one slot, so a
+ *                  |   hit touches a single cache line. Best for small keys and values.
+ *        SoA       |   Keys and values are in separate arrays, so probing only touches keys.
+ *                  |   Best for large values.
+ * @{
+ */
+
+/**
+ * @brief The largest combined size of key and value for which \p SUTL_FLATMAP_LAYOUT_AUTO chooses
+ * the AoS layout. Defaults to 64 (the size of a common cache line).
+ */
+#ifndef SUTL_FLATMAP_INLINE_MAX
+    #define SUTL_FLATMAP_INLINE_MAX 64
+#endif
+
+/**
+ * @brief The layout of the entries of a \p SUTLFlatmap.
+ */
+typedef enum SUTLFlatmapLayout
+{
+    /**
+     * @brief Chooses \p SUTL_FLATMAP_LAYOUT_AOS if the key and value together are at most
+     * \p SUTL_FLATMAP_INLINE_MAX bytes, otherwise \p SUTL_FLATMAP_LAYOUT_SOA.
+     */
+    SUTL_FLATMAP_LAYOUT_AUTO,
+
+    /**
+     * @brief Keys and values are stored together in one slot array.
+     */
+    SUTL_FLATMAP_LAYOUT_AOS,
+
+    /**
+     * @brief Keys and values are stored in two parallel arrays.
+     */
+    SUTL_FLATMAP_LAYOUT_SOA
+} SUTLFlatmapLayout;
+
+/**
+ * @brief It contains the state of a particular flatmap instance.
+ */
+typedef struct SUTLFlatmap
+{
+    /**
+     * @brief The number of entries in the flatmap.
+     */
+    size_t Size;
+
+    /**
+     * @brief The size of the key type of the flatmap.
+     */
+    size_t KeySize;
+
+    /**
+     * @brief The size of the value type of the flatmap.
+     */
+    size_t ValueSize;
+
+    /**
+     * @brief The layout of the flatmap. It is never \p SUTL_FLATMAP_LAYOUT_AUTO.
+     */
+    SUTLFlatmapLayout Layout;
+
+    /**
+     * @brief Don't access this directly. The number of slots. It is always a power of 2.
+     */
+    size_t Capacity;
+
+    /**
+     * @brief Don't access this directly. The number of erased slots.
+     */
+    size_t Tombstones;
+
+    /**
+     * @brief Don't access this directly. The distance in bytes between two consecutive keys.
+     */
+    size_t KeyStride;
+
+    /**
+     * @brief Don't access this directly. The distance in bytes between two consecutive values.
+     */
+    size_t ValueStride;
+
+    /**
+     * @brief Don't access this directly. A pointer to key type. This is used to pass parameters to
+     * internal functions which allows passing rvalues to them.
+     */
+    void * ParamK;
+
+    /**
+     * @brief Don't access this directly. A pointer to value type. This is used to pass parameters
+     * to internal functions which allows passing rvalues to them.
+     */
+    void * ParamV;
+
+    /**
+     * @brief Don't access this directly. The control byte of every slot.
+     */
+    uint8_t * Ctrl;
+
+    /**
+     * @brief Don't access this directly. The key of slot \p i is at <tt>Keys + i * KeyStride</tt>.
+     * In the AoS layout this is the slot array.
+     */
+    char * Keys;
+
+    /**
+     * @brief Don't access this directly. The value of slot \p i is at
+     * <tt>Values + i * ValueStride</tt>. In the AoS layout this points inside \p Keys.
+     */
+    char * Values;
+
+    /**
+     * @brief The function pointer which hashes the key type of the flatmap.
+     */
+    size_t( * Hash)(const void *);
+
+    /**
+     * @brief The function pointer which compares two keys.
+     */
+    int( * KeyComp)(const void *, const void *);
+} SUTLFlatmap;
+
+/**
+ * @brief Creates a new \p SUTLFlatmap with key type as \p tk, value type as \p tv, key hash
+ * function as \p hash, key compare function as \p cmp and layout as \p layout.
+ *
+ * @param tk The key type for the flatmap.
+ * @param tv The value type for the flatmap.
+ * @param hash A function of the signature <tt>size_t(const void *)</tt> that hashes \p tk.
+ * @param cmp A function of signature <tt>int(const void *, const void *)</tt> that compares two
+ * \p tk s for equality. (Similar to the \p == operator)
+ * @param layout A \p SUTLFlatmapLayout.
+ *
+ * @return A \p SUTLFlatmap created according to the parameters given.
+ */
+#define SUTLFlatmapNew(tk, tv, hash, cmp, layout)  SUTL_InternalFlatmapNew(sizeof(tk), sizeof(tv), hash, cmp, layout)
+
+/**
+ * @brief Frees a \p SUTLFlatmap which was created using \p SUTLFlatmapNew.
+ *
+ * @param fm The \p SUTLFlatmap to free.
+ */
+#define SUTLFlatmapFree(fm)                        SUTL_InternalFlatmapFree(&fm)
+
+/**
+ * @brief Gets a value assigned to \p k in \p fm.
+ *
+ * @param tk The key type of \p fm.
+ * @param tv The value type of \p fm.
+ * @param fm The flatmap to get from.
+ * @param k The key to search for.
+ *
+ * @return A <tt>tv *</tt> that points to the required value. If \p k doesn't exist in \p fm then
+ * it is \p NULL. It is valid until the next insertion.
+ */
+#define SUTLFlatmapGet(tk, tv, fm, k)              (*(tk *)fm.ParamK = k, (tv *)SUTL_InternalFlatmapGet(&fm))
+
+/**
+ * @brief Gets a value whose key matches \p probe in \p fm, where \p probe doesn't need to be of the
+ * key type. This allows searching without constructing a key.
+ *
+ * @param tv The value type of \p fm.
+ * @param fm The flatmap to get from.
+ * @param probe A pointer to the probe to search for.
+ * @param hash A function of the signature <tt>size_t(const void *)</tt> that hashes the probe. It
+ * must give the same hash as the key hash function of \p fm for matching keys.
+ * @param cmp A function of signature <tt>int(const void *, const void *)</tt> that compares the
+ * probe (first parameter) with a key (second parameter) for equality.
+ *
+ * @return A <tt>tv *</tt> that points to the required value. If no key matches \p probe then it is
+ * \p NULL.
+ */
+#define SUTLFlatmapGetWith(tv, fm, probe, hash, cmp) ((tv *)SUTL_InternalFlatmapGetWith(&fm, probe, hash, cmp))
+
+/**
+ * @brief Gets a value assigned to the string of \p size characters at \p ptr in \p fm, which must
+ * be keyed by \p SUTLString and use \p SUTL_HASHFN(string).
+ *
+ * @param tv The value type of \p fm.
+ * @param fm The flatmap to get from.
+ * @param ptr Pointer to the characters to search for. They don't need to be null-terminated.
+ * @param size The number of characters.
+ *
+ * @return A <tt>tv *</tt> that points to the required value. If the string doesn't exist in \p fm
+ * then it is \p NULL.
+ */
+#define SUTLFlatmapGetN(tv, fm, ptr, size)         ((tv *)SUTL_InternalFlatmapGetN(&fm, ptr, size))
+
+/**
+ * @brief Inserts an entry with key \p k and value \p v in \p fm.
+ *
+ * @param tk The key type of \p fm.
+ * @param tv The value type of \p fm.
+ * @param fm The flatmap to insert to.
+ * @param k The key to insert.
+ * @param v The value to insert.
+ *
+ * @return A <tt>tv *</tt> that points to the inserted value. If \p k already exists, the existing
+ * value is returned unchanged. It is valid until the next insertion.
+ */
+#define SUTLFlatmapInsert(tk, tv, fm, k, v)        (*(tk *)fm.ParamK = k, *(tv *)fm.ParamV = v, (tv *)SUTL_InternalFlatmapInsert(&fm))
+
+/**
+ * @brief Erases an entry with key \p k in \p fm.
+ *
+ * @param tk The key type of \p fm.
+ * @param fm The flatmap to erase from.
+ * @param k The key of the entry to erase.
+ */
+#define SUTLFlatmapErase(tk, fm, k)                (*(tk *)fm.ParamK = k, SUTL_InternalFlatmapErase(&fm))
+
+/**
+ * @brief Executes \p expr for every entry in \p fm.
+ *
+ * @param tk The key type of \p fm.
+ * @param tv The value type of \p fm.
+ * @param fm The flatmap to iterate.
+ * @param name The prefix for current entry. Key will have suffix \p _k and value will have suffix
+ * \p _v.
+ * @param expr The code block to execute for every entry.
+ */
+#define SUTLFlatmapEach(tk, tv, fm, name, expr) \
+    {\
+        size_t i;\
+        for (i = 0; i < fm.Capacity; i++)\
+        {\
+            if (fm.Ctrl[i] & 0x80)\
+            {\
+                tk * name##_k = (tk *)(fm.Keys + i * fm.KeyStride);\
+                tv * name##_v = (tv *)(fm.Values + i * fm.ValueStride);\
+                expr\
+            }\
+        }\
+    }
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+SUTLFlatmap SUTL_InternalFlatmapNew(size_t keysize, size_t valuesize, size_t( * hash)(const void *), int ( * keycomp)(const void *, const void *), SUTLFlatmapLayout layout);
+void SUTL_InternalFlatmapFree(SUTLFlatmap * fm);
+void * SUTL_InternalFlatmapInsert(SUTLFlatmap * fm);
+void SUTL_InternalFlatmapErase(SUTLFlatmap * fm);
+void * SUTL_InternalFlatmapGet(SUTLFlatmap * fm);
+void * SUTL_InternalFlatmapGetWith(SUTLFlatmap * fm, const void * probe, size_t( * hash)(const void *), int ( * cmp)(const void *, const void *));
+void * SUTL_InternalFlatmapGetN(SUTLFlatmap * fm, const char * ptr, size_t size);
+
+size_t SUTL_InternalFlatmapAlignment(size_t size);
+void SUTL_InternalFlatmapAllocate(SUTLFlatmap * fm, size_t capacity);
+void SUTL_InternalFlatmapRelease(SUTLFlatmap * fm);
+void SUTL_InternalFlatmapRehash(SUTLFlatmap * fm, size_t capacity);
+size_t SUTL_InternalFlatmapFind(const SUTLFlatmap * fm, const void * key, uint64_t hash, int ( * cmp)(const void *, const void *));
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    #define SUTLFlatmapEmpty        0x00
+    #define SUTLFlatmapTombstone    0x01
+
+    /*
+     * Fibonacci hashing spreads weak hashes (like the identity hashes of integers) over the table.
+     */
+    #define SUTLFlatmapMix(h)       ((uint64_t)(h) * 0x9E3779B97F4A7C15ULL)
+    #define SUTLFlatmapH7(m)        (uint8_t)(0x80 | ((m) >> 57))
+    #define SUTLFlatmapKey(fm, i)   ((fm)->Keys + (i) * (fm)->KeyStride)
+    #define SUTLFlatmapValue(fm, i) ((fm)->Values + (i) * (fm)->ValueStride)
+
+    size_t SUTL_InternalFlatmapAlignment(size_t size)
+    {
+        /*
+         * The alignment of a type always divides its size, so the lowest set bit of the size is a
+         * safe alignment for it.
+         */
+        size_t align = size & (0 - size);
+
+        return align > 16 || !align ? 16 : align;
+    }
+
+    void SUTL_InternalFlatmapAllocate(SUTLFlatmap * fm, size_t capacity)
+    {
+        fm->Capacity = capacity;
+        fm->Tombstones = 0;
+        fm->Ctrl = (uint8_t *)SHRN_MALLOC(capacity);
+
+        if (!fm->Ctrl)
+        {
+            SUTLErrorHandler("Memory allocation failed.");
+            return;
+        }
+
+        SHRN_MEMSET(fm->Ctrl, SUTLFlatmapEmpty, capacity);
+
+        if (fm->Layout == SUTL_FLATMAP_LAYOUT_AOS)
+        {
+            size_t valueAlign = SUTL_InternalFlatmapAlignment(fm->ValueSize);
+            size_t keyAlign = SUTL_InternalFlatmapAlignment(fm->KeySize);
+            size_t slotAlign = valueAlign > keyAlign ? valueAlign : keyAlign;
+            size_t valueOffset = (fm->KeySize + valueAlign - 1) / valueAlign * valueAlign;
+
+            /*
+             * Every slot is padded so that the key and value of all slots stay aligned.
+             */
+            fm->KeyStride = (valueOffset + fm->ValueSize + slotAlign - 1) / slotAlign * slotAlign;
+            fm->ValueStride = fm->KeyStride;
+            fm->Keys = (char *)SHRN_MALLOC(capacity * fm->KeyStride);
+            fm->Values = fm->Keys ? fm->Keys + valueOffset : NULL;
+        }
+        else
+        {
+            fm->KeyStride = fm->KeySize;
+            fm->ValueStride = fm->ValueSize;
+            fm->Keys = (char *)SHRN_MALLOC(capacity * fm->KeySize);
+            fm->Values = (char *)SHRN_MALLOC(capacity * fm->ValueSize);
+        }
+
+        if (!fm->Keys || !fm->Values)
+            SUTLErrorHandler("Memory allocation failed.");
+    }
+
+    void SUTL_InternalFlatmapRelease(SUTLFlatmap * fm)
+    {
+        if (fm->Layout == SUTL_FLATMAP_LAYOUT_SOA)
+            SHRN_FREE(fm->Values);
+
+        SHRN_FREE(fm->Keys);
+        SHRN_FREE(fm->Ctrl);
+    }
+
+    SUTLFlatmap SUTL_InternalFlatmapNew(size_t keysize, size_t valuesize, size_t( * hash)(const void *), int ( * keycomp)(const void *, const void *), SUTLFlatmapLayout layout)
+    {
+        SUTLFlatmap fm;
+
+        if (layout == SUTL_FLATMAP_LAYOUT_AUTO)
+            layout = keysize + valuesize <= SUTL_FLATMAP_INLINE_MAX ? SUTL_FLATMAP_LAYOUT_AOS : SUTL_FLATMAP_LAYOUT_SOA;
+
+        /*
+         * Initialize the members of `fm`.
+         */
+        fm.Size = 0;
+        fm.KeySize = keysize;
+        fm.ValueSize = valuesize;
+        fm.Layout = layout;
+        fm.ParamK = SHRN_MALLOC(keysize);
+        fm.ParamV = SHRN_MALLOC(valuesize);
+        fm.Hash = hash;
+        fm.KeyComp = keycomp;
+
+        SUTL_InternalFlatmapAllocate(&fm, 16);
+
+        return fm;
+    }
+
+    void SUTL_InternalFlatmapFree(SUTLFlatmap * fm)
+    {
+        SUTL_InternalFlatmapRelease(fm);
+
+        SHRN_FREE(fm->ParamV);
+        SHRN_FREE(fm->ParamK);
+    }
+
+    size_t SUTL_InternalFlatmapFind(const SUTLFlatmap * fm, const void * key, uint64_t hash, int ( * cmp)(const void *, const void *))
+    {
+        size_t mask = fm->Capacity - 1;
+        size_t i = (size_t)(hash >> 32) & mask;
+        uint8_t h7 = SUTLFlatmapH7(hash);
+
+        /*
+         * Probe until an empty slot is found. Erased slots don't end the probe sequence.
+         */
+        while (fm->Ctrl[i] != SUTLFlatmapEmpty)
+        {
+            if (fm->Ctrl[i] == h7 && cmp(key, SUTLFlatmapKey(fm, i)))
+                return i;
+
+            i = (i + 1) & mask;
+        }
+
+        return SIZE_MAX;
+    }
+
+    void SUTL_InternalFlatmapRehash(SUTLFlatmap * fm, size_t capacity)
+    {
+        SUTLFlatmap old = *fm;
+        size_t i;
+
+        SUTL_InternalFlatmapAllocate(fm, capacity);
+
+        /*
+         * Move every entry to its new slot. No key comparison is needed since keys are unique.
+         */
+        for (i = 0; i < old.Capacity; i++)
+        {
+            if (old.Ctrl[i] & 0x80)
+            {
+                uint64_t hash = SUTLFlatmapMix(fm->Hash(SUTLFlatmapKey(&old, i)));
+                size_t j = (size_t)(hash >> 32) & (capacity - 1);
+
+                while (fm->Ctrl[j] != SUTLFlatmapEmpty)
+                    j = (j + 1) & (capacity - 1);
+
+                fm->Ctrl[j] = old.Ctrl[i];
+                SHRN_MEMCPY(SUTLFlatmapKey(fm, j), SUTLFlatmapKey(&old, i), fm->KeySize);
+                SHRN_MEMCPY(SUTLFlatmapValue(fm, j), SUTLFlatmapValue(&old, i), fm->ValueSize);
+            }
+        }
+
+        SUTL_InternalFlatmapRelease(&old);
+    }
+
+    void * SUTL_InternalFlatmapInsert(SUTLFlatmap * fm)
+    {
+        uint64_t hash = SUTLFlatmapMix(fm->Hash(fm->ParamK));
+        size_t mask, i;
+
+        i = SUTL_InternalFlatmapFind(fm, fm->ParamK, hash, fm->KeyComp);
+
+        /*
+         * If the entry already exists return it, otherwise proceed to add the new entry.
+         */
+        if (i != SIZE_MAX)
+            return SUTLFlatmapValue(fm, i);
+
+        /*
+         * Keep the load (including erased slots) under 7/8. If most of it is erased slots, rehash
+         * at the same capacity to clean them up.
+         */
+        if ((fm->Size + fm->Tombstones + 1) * 8 > fm->Capacity * 7)
+            SUTL_InternalFlatmapRehash(fm, fm->Size * 2 >= fm->Capacity ? fm->Capacity * 2 : fm->Capacity);
+
+        mask = fm->Capacity - 1;
+        i = (size_t)(hash >> 32) & mask;
+
+        while (fm->Ctrl[i] & 0x80)
+            i = (i + 1) & mask;
+
+        if (fm->Ctrl[i] == SUTLFlatmapTombstone)
+            fm->Tombstones--;
+
+        fm->Ctrl[i] = SUTLFlatmapH7(hash);
+        fm->Size++;
+
+        SHRN_MEMCPY(SUTLFlatmapKey(fm, i), fm->ParamK, fm->KeySize);
+
+        return SHRN_MEMCPY(SUTLFlatmapValue(fm, i), fm->ParamV, fm->ValueSize);
+    }
+
+    void SUTL_InternalFlatmapErase(SUTLFlatmap * fm)
+    {
+        size_t i = SUTL_InternalFlatmapFind(fm, fm->ParamK, SUTLFlatmapMix(fm->Hash(fm->ParamK)), fm->KeyComp);
+
+        if (i == SIZE_MAX)
+            return;
+
+        /*
+         * The slot can become empty only if it doesn't break any probe sequence, i.e. the next
+         * slot is already empty.
+         */
+        if (fm->Ctrl[(i + 1) & (fm->Capacity - 1)] == SUTLFlatmapEmpty)
+        {
+            fm->Ctrl[i] = SUTLFlatmapEmpty;
+        }
+        else
+        {
+            fm->Ctrl[i] = SUTLFlatmapTombstone;
+            fm->Tombstones++;
+        }
+
+        fm->Size--;
+    }
+
+    void * SUTL_InternalFlatmapGet(SUTLFlatmap * fm)
+    {
+        size_t i = SUTL_InternalFlatmapFind(fm, fm->ParamK, SUTLFlatmapMix(fm->Hash(fm->ParamK)), fm->KeyComp);
+
+        return i == SIZE_MAX ? NULL : SUTLFlatmapValue(fm, i);
+    }
+
+    void * SUTL_InternalFlatmapGetWith(SUTLFlatmap * fm, const void * probe, size_t( * hash)(const void *), int ( * cmp)(const void *, const void *))
+    {
+        size_t i = SUTL_InternalFlatmapFind(fm, probe, SUTLFlatmapMix(hash(probe)), cmp);
+
+        return i == SIZE_MAX ? NULL : SUTLFlatmapValue(fm, i);
+    }
+
+    void * SUTL_InternalFlatmapGetN(SUTLFlatmap * fm, const char * ptr, size_t size)
+    {
+        SUTLStringView probe = SUTLStringViewNew(ptr, size);
+
+        return SUTL_InternalFlatmapGetWith(fm, &probe, SUTL_HASHFN(strview), SUTL_PROBECMPFN(string));
+    }
+
+    #undef SUTLFlatmapValue
+    #undef SUTLFlatmapKey
+    #undef SUTLFlatmapH7
+    #undef SUTLFlatmapMix
+    #undef SUTLFlatmapTombstone
+    #undef SUTLFlatmapEmpty
+#endif
+
+#endif
@@ -0,0 +1,615 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_GRAPH_H
+#define SUTL_GRAPH_H
+
+#include "Common.h"
+#include "Vector.h"
+#include "System.h"
+
+/**
+ * @defgroup Graph
+ * A directed graph in compressed sparse row form, where the neighbours of all nodes are stored in
+ * one array and node \p n owns the range from \p Offsets[n] up to \p Offsets[n + 1] of it.
+ *
+ * Nodes are numbered from 0. The graph is built once from two vectors holding the source and target
+ * of every edge with a counting sort: the out-degrees are counted, turned into offsets by a prefix
+ * sum and every target is then placed at the next free slot of its source. Large edge lists are
+ * split into chunks which are counted and placed by several threads, each with its own counts, so
+ * the neighbours of a node keep the order of the edges.
+ *
+ * Breadth-first, depth-first and topological walks visit one node per call to
+ * \p SUTLGraphWalkNext, and only read the contiguous neighbour ranges.
+ * @{
+ */
+
+/**
+ * @brief Edges are only placed with several threads if each thread gets at least this many edges.
+ */
+#ifndef SUTL_GRAPH_MIN_CHUNK
+    #define SUTL_GRAPH_MIN_CHUNK (1 << 16)
+#endif
+
+/**
+ * @brief The maximum number of threads used by \p SUTLGraphNew.
+ */
+#ifndef SUTL_GRAPH_MAX_THREADS
+    #define SUTL_GRAPH_MAX_THREADS 64
+#endif
+
+/**
+ * @brief It contains a directed graph.
+ */
+typedef struct SUTLGraph
+{
+    /**
+     * @brief The number of nodes.
+     */
+    size_t NodeCount;
+
+    /**
+     * @brief The number of edges.
+     */
+    size_t EdgeCount;
+
+    /**
+     * @brief The index of the first neighbour of every node in \p Targets, followed by \p EdgeCount.
+     */
+    size_t * Offsets;
+
+    /**
+     * @brief The neighbours of all nodes, grouped by node.
+     */
+    size_t * Targets;
+} SUTLGraph;
+
+/**
+ * @brief The order in which a \p SUTLGraphWalk visits nodes.
+ */
+typedef enum SUTLGraphWalkKind
+{
+    /**
+     * @brief Nodes reachable from the start, nearest first.
+     */
+    SUTL_GRAPH_WALK_BFS,
+
+    /**
+     * @brief Nodes reachable from the start, each one before its descendants.
+     */
+    SUTL_GRAPH_WALK_DFS,
+
+    /**
+     * @brief All nodes, each one before the targets of its edges.
+     */
+    SUTL_GRAPH_WALK_TOPOLOGICAL
+} SUTLGraphWalkKind;
+
+/**
+ * @brief It contains the state of a walk over a \p SUTLGraph.
+ */
+typedef struct SUTLGraphWalk
+{
+    /**
+     * @brief The graph.
+     */
+    const SUTLGraph * Graph;
+
+    /**
+     * @brief The order of the walk.
+     */
+    SUTLGraphWalkKind Kind;
+
+    /**
+     * @brief The number of nodes visited so far.
+     */
+    size_t Count;
+
+    /**
+     * @brief Don't access this directly. The queue or stack of nodes.
+     */
+    size_t * Nodes;
+
+    /**
+     * @brief Don't access this directly. Whether every node has been seen, or its number of edges
+     * from nodes not visited yet for topological walks.
+     */
+    size_t * State;
+
+    /**
+     * @brief Don't access this directly. The next edge of every node on the stack of depth-first
+     * walks.
+     */
+    size_t * Cursors;
+
+    /**
+     * @brief Don't access this directly. The first used position of \p Nodes.
+     */
+    size_t Head;
+
+    /**
+     * @brief Don't access this directly. The position after the last used one of \p Nodes.
+     */
+    size_t Tail;
+} SUTLGraphWalk;
+
+/**
+ * @brief Builds a \p SUTLGraph from a list of edges.
+ *
+ * @param nodes The number of nodes.
+ * @param from A <tt>size_t *</tt> vector holding the source of every edge.
+ * @param to A <tt>size_t *</tt> vector of the same size holding the target of every edge.
+ * @param threads The maximum number of threads to use. 0 or 1 builds on the calling thread.
+ *
+ * @return A \p SUTLGraph. If the vectors differ in size or a node is out of range, an error is
+ * reported and the graph has no nodes.
+ */
+#define SUTLGraphNew(nodes, from, to, threads)  SUTL_InternalGraphNew(nodes, from, to, threads)
+
+/**
+ * @brief Frees \p g.
+ *
+ * @param g The \p SUTLGraph to free.
+ */
+#define SUTLGraphFree(g)                        SUTL_InternalGraphFree(&g)
+
+/**
+ * @brief Gets the number of edges from node \p n of \p g.
+ */
+#define SUTLGraphDegree(g, n)                   ((g).Offsets[(n) + 1] - (g).Offsets[n])
+
+/**
+ * @brief Gets a <tt>const size_t *</tt> to the first of the \p SUTLGraphDegree neighbours of node
+ * \p n of \p g.
+ */
+#define SUTLGraphNeighbours(g, n)               ((const size_t *)(g).Targets + (g).Offsets[n])
+
+/**
+ * @brief Executes \p expr for every neighbour of node \p n of \p g, in the order of the edges.
+ *
+ * @param g The \p SUTLGraph.
+ * @param n The node.
+ * @param name The name of the \p size_t variable holding the current neighbour.
+ * @param expr The code block to execute for every neighbour.
+ */
+#define SUTLGraphEachNeighbour(g, n, name, expr) \
+    {\
+        size_t name##_i = (g).Offsets[n];\
+        size_t name##_end = (g).Offsets[(n) + 1];\
+        size_t name;\
+        for (; name##_i < name##_end; name##_i++)\
+        {\
+            name = (g).Targets[name##_i];\
+            expr\
+        }\
+    }
+
+/**
+ * @brief Starts a breadth-first walk of \p g from node \p start.
+ *
+ * @return A \p SUTLGraphWalk, which must be freed with \p SUTLGraphWalkFree. If \p start is out of
+ * range an error is reported and the walk visits no nodes.
+ */
+#define SUTLGraphBfs(g, start)                  SUTL_InternalGraphWalkNew(&g, SUTL_GRAPH_WALK_BFS, start)
+
+/**
+ * @brief Starts a depth-first walk of \p g from node \p start, visiting nodes in preorder.
+ *
+ * @return A \p SUTLGraphWalk, which must be freed with \p SUTLGraphWalkFree. If \p start is out of
+ * range an error is reported and the walk visits no nodes.
+ */
+#define SUTLGraphDfs(g, start)                  SUTL_InternalGraphWalkNew(&g, SUTL_GRAPH_WALK_DFS, start)
+
+/**
+ * @brief Starts a walk of \p g in topological order. If \p g has a cycle, the walk stops before
+ * the nodes on or after it and reports an error.
+ *
+ * @return A \p SUTLGraphWalk, which must be freed with \p SUTLGraphWalkFree.
+ */
+#define SUTLGraphTopological(g)                 SUTL_InternalGraphWalkNew(&g, SUTL_GRAPH_WALK_TOPOLOGICAL, 0)
+
+/**
+ * @brief Visits the next node of \p walk.
+ *
+ * @param walk The \p SUTLGraphWalk.
+ * @param node A \p size_t lvalue which is set to the node.
+ *
+ * @return 1 if a node was visited, or 0 if the walk is over.
+ */
+#define SUTLGraphWalkNext(walk, node)           SUTL_InternalGraphWalkNext(&walk, &node)
+
+/**
+ * @brief Frees \p walk.
+ *
+ * @param walk The \p SUTLGraphWalk to free.
+ */
+#define SUTLGraphWalkFree(walk)                 SUTL_InternalGraphWalkFree(&walk)
+
+/**
+ * @brief Executes \p expr for every remaining node of \p walk.
+ *
+ * @param walk The \p SUTLGraphWalk.
+ * @param name The name of the \p size_t variable holding the current node.
+ * @param expr The code block to execute for every node.
+ */
+#define SUTLGraphWalkEach(walk, name, expr) \
+    {\
+        size_t name;\
+        while (SUTLGraphWalkNext(walk, name))\
+        {\
+            expr\
+        }\
+    }
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+typedef struct SUTLGraphChunk
+{
+    const size_t * From;
+    const size_t * To;
+    size_t Begin;
+    size_t End;
+    size_t NodeCount;
+    size_t * Counts;
+    size_t * Targets;
+    int Bad;
+} SUTLGraphChunk;
+
+SUTLGraph SUTL_InternalGraphNew(size_t nodes, const size_t * from, const size_t * to, size_t threads);
+void SUTL_InternalGraphFree(SUTLGraph * g);
+void * SUTL_InternalGraphCountWorker(void * arg);
+void * SUTL_InternalGraphPlaceWorker(void * arg);
+void SUTL_InternalGraphRun(SUTLGraphChunk * chunks, size_t count, void * (*worker)(void *));
+SUTLGraphWalk SUTL_InternalGraphWalkNew(const SUTLGraph * g, SUTLGraphWalkKind kind, size_t start);
+int SUTL_InternalGraphWalkNext(SUTLGraphWalk * walk, size_t * node);
+void SUTL_InternalGraphWalkFree(SUTLGraphWalk * walk);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    void * SUTL_InternalGraphCountWorker(void * arg)
+    {
+        SUTLGraphChunk * chunk = (SUTLGraphChunk *)arg;
+        size_t i;
+
+        for (i = chunk->Begin; i < chunk->End; i++)
+        {
+            if (chunk->From[i] >= chunk->NodeCount || chunk->To[i] >= chunk->NodeCount)
+            {
+                chunk->Bad = 1;
+                break;
+            }
+
+            chunk->Counts[chunk->From[i]]++;
+        }
+
+        return NULL;
+    }
+
+    void * SUTL_InternalGraphPlaceWorker(void * arg)
+    {
+        SUTLGraphChunk * chunk = (SUTLGraphChunk *)arg;
+        size_t i;
+
+        /*
+         * The counts now hold the next free slot of every node for this chunk.
+         */
+        for (i = chunk->Begin; i < chunk->End; i++)
+            chunk->Targets[chunk->Counts[chunk->From[i]]++] = chunk->To[i];
+
+        return NULL;
+    }
+
+    void SUTL_InternalGraphRun(SUTLGraphChunk * chunks, size_t count, void * (*worker)(void *))
+    {
+        SHRN_THREAD threads[SUTL_GRAPH_MAX_THREADS];
+        int started[SUTL_GRAPH_MAX_THREADS];
+        size_t i;
+
+        /*
+         * The first chunk is handled by the calling thread, and so is any chunk whose thread can't
+         * be started.
+         */
+        for (i = 1; i < count; i++)
+            started[i] = SHRN_THREAD_CREATE(threads[i], worker, &chunks[i]);
+
+        worker(&chunks[0]);
+
+        for (i = 1; i < count; i++)
+        {
+            if (started[i])
+                SHRN_THREAD_JOIN(threads[i]);
+            else
+                worker(&chunks[i]);
+        }
+    }
+
+    SUTLGraph SUTL_InternalGraphNew(size_t nodes, const size_t * from, const size_t * to, size_t threads)
+    {
+        SUTLGraphChunk chunks[SUTL_GRAPH_MAX_THREADS];
+        SUTLGraph g;
+        size_t edges = SUTLVectorSize(from);
+        size_t offset = 0;
+        size_t * counts;
+        size_t i, j;
+        int bad = 0;
+
+        g.NodeCount = 0;
+        g.EdgeCount = 0;
+        g.Offsets = NULL;
+        g.Targets = NULL;
+
+        if (SUTLVectorSize(to) != edges)
+        {
+            SUTLErrorHandler("Edge vectors differ in size.");
+            return g;
+        }
+
+        if (threads > SUTL_GRAPH_MAX_THREADS)
+            threads = SUTL_GRAPH_MAX_THREADS;
+
+        if (threads < 1 || edges / threads < SUTL_GRAPH_MIN_CHUNK)
+            threads = 1;
+
+        g.Offsets = (size_t *)SHRN_MALLOC((nodes + 1) * sizeof(size_t));
+        g.Targets = (size_t *)SHRN_MALLOC((edges ? edges : 1) * sizeof(size_t));
+        counts = (size_t *)SHRN_MALLOC((threads * nodes + 1) * sizeof(size_t));
+
+        if (!g.Offsets || !g.Targets || !counts)
+        {
+            SUTLErrorHandler("Memory allocation failed.");
+            SHRN_FREE(g.Offsets);
+            SHRN_FREE(g.Targets);
+            SHRN_FREE(counts);
+            g.Offsets = NULL;
+            g.Targets = NULL;
+            return g;
+        }
+
+        SHRN_MEMSET(counts, 0, threads * nodes * sizeof(size_t));
+
+        /*
+         * Count the out-degrees of every chunk separately.
+         */
+        for (i = 0; i < threads; i++)
+        {
+            chunks[i].From = from;
+            chunks[i].To = to;
+            chunks[i].Begin = edges / threads * i;
+            chunks[i].End = i + 1 < threads ? edges / threads * (i + 1) : edges;
+            chunks[i].NodeCount = nodes;
+            chunks[i].Counts = counts + i * nodes;
+            chunks[i].Targets = g.Targets;
+            chunks[i].Bad = 0;
+        }
+
+        SUTL_InternalGraphRun(chunks, threads, SUTL_InternalGraphCountWorker);
+
+        for (i = 0; i < threads; i++)
+            bad |= chunks[i].Bad;
+
+        if (bad)
+        {
+            SUTLErrorHandler("Node out of range.");
+            SHRN_FREE(g.Offsets);
+            SHRN_FREE(g.Targets);
+            SHRN_FREE(counts);
+            g.Offsets = NULL;
+            g.Targets = NULL;
+            return g;
+        }
+
+        /*
+         * Turn the counts into the first slot of every node for every chunk. Earlier chunks get the
+         * earlier slots, so edges keep their order.
+         */
+        for (j = 0; j < nodes; j++)
+        {
+            g.Offsets[j] = offset;
+
+            for (i = 0; i < threads; i++)
+            {
+                size_t count = chunks[i].Counts[j];
+
+                chunks[i].Counts[j] = offset;
+                offset += count;
+            }
+        }
+
+        g.Offsets[nodes] = offset;
+
+        SUTL_InternalGraphRun(chunks, threads, SUTL_InternalGraphPlaceWorker);
+
+        SHRN_FREE(counts);
+
+        g.NodeCount = nodes;
+        g.EdgeCount = edges;
+
+        return g;
+    }
+
+    void SUTL_InternalGraphFree(SUTLGraph * g)
+    {
+        SHRN_FREE(g->Offsets);
+        SHRN_FREE(g->Targets);
+
+        g->NodeCount = 0;
+        g->EdgeCount = 0;
+        g->Offsets = NULL;
+        g->Targets = NULL;
+    }
+
+    SUTLGraphWalk SUTL_InternalGraphWalkNew(const SUTLGraph * g, SUTLGraphWalkKind kind, size_t start)
+    {
+        SUTLGraphWalk walk;
+        size_t n = g->NodeCount;
+        size_t i;
+
+        walk.Graph = g;
+        walk.Kind = kind;
+        walk.Count = 0;
+        walk.Head = 0;
+        walk.Tail = 0;
+        walk.Nodes = NULL;
+        walk.State = NULL;
+        walk.Cursors = NULL;
+
+        if (kind != SUTL_GRAPH_WALK_TOPOLOGICAL && start >= n)
+        {
+            SUTLErrorHandler("Node out of range.");
+            return walk;
+        }
+
+        /*
+         * The nodes, their state and the cursors of depth-first walks share one allocation.
+         */
+        walk.Nodes = (size_t *)SHRN_MALLOC((n ? n : 1) * (kind == SUTL_GRAPH_WALK_DFS ? 3 : 2) * sizeof(size_t));
+
+        if (!walk.Nodes)
+        {
+            SUTLErrorHandler("Memory allocation failed.");
+            return walk;
+        }
+
+        walk.State = walk.Nodes + n;
+
+        if (kind == SUTL_GRAPH_WALK_DFS)
+            walk.Cursors = walk.State + n;
+
+        SHRN_MEMSET(walk.State, 0, n * sizeof(size_t));
+
+        if (kind == SUTL_GRAPH_WALK_TOPOLOGICAL)
+        {
+            /*
+             * Count the incoming edges of every node, and queue the ones without any.
+             */
+            for (i = 0; i < g->EdgeCount; i++)
+                walk.State[g->Targets[i]]++;
+
+            for (i = 0; i < n; i++)
+                if (!walk.State[i])
+                    walk.Nodes[walk.Tail++] = i;
+
+            if (n && !walk.Tail)
+                SUTLErrorHandler("Graph has a cycle.");
+        }
+        else
+        {
+            walk.Nodes[walk.Tail++] = start;
+            walk.State[start] = 1;
+
+            if (kind == SUTL_GRAPH_WALK_DFS)
+                walk.Cursors[0] = g->Offsets[start];
+        }
+
+        return walk;
+    }
+
+    int SUTL_InternalGraphWalkNext(SUTLGraphWalk * walk, size_t * node)
+    {
+        const SUTLGraph * g = walk->Graph;
+        size_t top;
+        size_t next;
+        size_t i;
+
+        if (walk->Kind == SUTL_GRAPH_WALK_DFS)
+        {
+            /*
+             * The start node is on the stack but not visited yet.
+             */
+            if (walk->Count == 0 && walk->Tail)
+            {
+                walk->Count++;
+                *node = walk->Nodes[0];
+                return 1;
+            }
+
+            /*
+             * Descend into the first unseen neighbour of the top node, popping nodes which have none.
+             */
+            while (walk->Tail)
+            {
+                top = walk->Nodes[walk->Tail - 1];
+
+                while (walk->Cursors[walk->Tail - 1] < g->Offsets[top + 1])
+                {
+                    next = g->Targets[walk->Cursors[walk->Tail - 1]++];
+
+                    if (!walk->State[next])
+                    {
+                        walk->State[next] = 1;
+                        walk->Cursors[walk->Tail] = g->Offsets[next];
+                        walk->Nodes[walk->Tail++] = next;
+                        walk->Count++;
+                        *node = next;
+                        return 1;
+                    }
+                }
+
+                walk->Tail--;
+            }
+
+            return 0;
+        }
+
+        if (walk->Head == walk->Tail)
+            return 0;
+
+        /*
+         * Every node enters the queue once: breadth-first walks when it is first seen, topological
+         * ones when its last incoming edge is visited.
+         */
+        *node = walk->Nodes[walk->Head++];
+        walk->Count++;
+
+        for (i = g->Offsets[*node]; i < g->Offsets[*node + 1]; i++)
+        {
+            next = g->Targets[i];
+
+            if (walk->Kind == SUTL_GRAPH_WALK_BFS ? !walk->State[next] : !--walk->State[next])
+            {
+                walk->State[next] = 1;
+                walk->Nodes[walk->Tail++] = next;
+            }
+        }
+
+        /*
+         * Nodes on a cycle never lose all of their incoming edges.
+         */
+        if (walk->Kind == SUTL_GRAPH_WALK_TOPOLOGICAL && walk->Head == walk->Tail && walk->Count < g->NodeCount)
+            SUTLErrorHandler("Graph has a cycle.");
+
+        return 1;
+    }
+
+    void SUTL_InternalGraphWalkFree(SUTLGraphWalk * walk)
+    {
+        SHRN_FREE(walk->Nodes);
+
+        walk->Nodes = NULL;
+        walk->State = NULL;
+        walk->Cursors = NULL;
+        walk->Head = 0;
+        walk->Tail = 0;
+    }
+#endif
+
+#endif
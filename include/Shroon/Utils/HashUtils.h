@@ -22,7 +22,7 @@
 /**
  * @defgroup HashUtils
  * This file contains hashing and compare functions for integer types, floating point types and
- * string which can be used with \p SUTLHashmap and \p SUTLHashset.
+ * string which can be used with \p SUTLHashmap, \p SUTLHashset and \p SUTLFlatmap.
  *
  * These functions have suffixes which tells what type they target.
  *
@@ -50,7 +50,18 @@
  *        double    |   double
  *        size      |   size_t
  *        ptr       |   void *
- *        string    |   char *
+ *        string    |   SUTLString
+ *        strview   |   SUTLStringView
+ *
+ * Maps keyed by \p SUTLString can be searched without creating a \p SUTLString by passing a
+ * \p SUTLStringView probe along with \p SUTL_HASHFN(strview) and \p SUTL_PROBECMPFN(string).
+ * Both string hash functions hash only the characters, so equal strings and views hash the same.
+ *
+ * Compare functions only tell if two keys are equal. Ordered containers like \p SUTLSkipList, and
+ * \p SUTLSort and \p SUTLLowerBound, take the order functions instead, which return a negative
+ * number, 0 or a positive number when the first key is less than, equal to or greater than the
+ * second one. Strings are ordered by their bytes as unsigned chars, shorter prefixes first, and NaNs
+ * are ordered after every other floating point number.
  * @{
  */
 
@@ -64,6 +75,86 @@
  */
 #define SUTL_CMPFN(suffix)  SUTLCmp_##suffix
 
+/**
+ * @brief Probe compare function with suffix \p suffix. It compares a probe of a different type
+ * (for example a \p SUTLStringView) with a key of the type targeted by \p suffix.
+ */
+#define SUTL_PROBECMPFN(suffix) SUTLProbeCmp_##suffix
+
+/**
+ * @brief Order function with suffix \p suffix.
+ */
+#define SUTL_ORDFN(suffix)  SUTLOrd_##suffix
+
+/**
+ * @brief Probe order function with suffix \p suffix. It orders a probe of a different type (for
+ * example a \p SUTLStringView) against a key of the type targeted by \p suffix.
+ */
+#define SUTL_PROBEORDFN(suffix) SUTLProbeOrd_##suffix
+
+/**
+ * @brief Orders two integer values \p a and \p b without branches, like the integer order functions.
+ *
+ * @return -1, 0 or 1 as an \p int.
+ */
+#define SUTL_ORDER(a, b)        (((a) > (b)) - ((a) < (b)))
+
+/**
+ * @brief Orders two floating point values \p a and \p b without branches, like \p SUTL_ORDFN(float)
+ * and \p SUTL_ORDFN(double), with NaNs after every other value.
+ *
+ * @return -1, 0 or 1 as an \p int.
+ */
+#define SUTL_ORDER_FLOAT(a, b)  (SUTL_ORDER(a, b) + ((a) != (a)) - ((b) != (b)))
+
+/**
+ * @brief Sorts the \p count elements of type \p t at \p data in place. The sort isn't stable.
+ *
+ * @param t The type of the elements.
+ * @param data A pointer to the first element.
+ * @param count The number of elements.
+ * @param order The order function for \p t.
+ */
+#define SUTLSort(t, data, count, order)                 SUTL_InternalSort(data, count, sizeof(t), order)
+
+/**
+ * @brief Searches the \p count sorted elements of type \p t at \p data for the first one which is
+ * not less than the key at \p kptr.
+ *
+ * @param t The type of the elements.
+ * @param data A pointer to the first element.
+ * @param count The number of elements.
+ * @param kptr A pointer to the key. It is passed as the first argument of \p order, so it can be a
+ * probe of a different type when used with a probe order function.
+ * @param order The order function for \p t.
+ *
+ * @return The index of the element as a \p size_t, or \p count if every element is less than the key.
+ */
+#define SUTLLowerBound(t, data, count, kptr, order)     SUTL_InternalLowerBound(data, count, sizeof(t), kptr, order)
+
+/**
+ * @brief Like \p SUTLLowerBound, but for elements of an arithmetic type compared with \p < inline.
+ * The loop has no data dependent branches, so it can be used on hot search paths.
+ *
+ * @param data A pointer to the first element.
+ * @param count The number of elements.
+ * @param key The key, not a pointer to it.
+ * @param res A \p size_t variable which is set to the index.
+ */
+#define SUTLLowerBoundInline(data, count, key, res) \
+    {\
+        size_t res##_n = (count);\
+        size_t res##_half;\
+        res = 0;\
+        while (res##_n > 1)\
+        {\
+            res##_half = res##_n / 2;\
+            res += (data)[res + res##_half] < (key) ? res##_half : 0;\
+            res##_n -= res##_half;\
+        }\
+        res += res##_n == 1 && (data)[res] < (key);\
+    }
+
 /**
  * @}
  *
@@ -72,6 +163,7 @@
  */
 #define SUTL_HASHFN_DECL(suffix)    size_t SUTLHash_##suffix(const void * v);
 #define SUTL_CMPFN_DECL(suffix)     int SUTLCmp_##suffix(const void * p0, const void * p1);
+#define SUTL_ORDFN_DECL(suffix)     int SUTLOrd_##suffix(const void * p0, const void * p1);
 
 SUTL_HASHFN_DECL(uchar);
 SUTL_HASHFN_DECL(ushort);
@@ -98,6 +190,7 @@ SUTL_HASHFN_DECL(float);
 SUTL_HASHFN_DECL(double);
 
 SUTL_HASHFN_DECL(string);
+SUTL_HASHFN_DECL(strview);
 
 SUTL_CMPFN_DECL(uchar);
 SUTL_CMPFN_DECL(ushort);
@@ -124,6 +217,44 @@ SUTL_CMPFN_DECL(float);
 SUTL_CMPFN_DECL(double);
 
 SUTL_CMPFN_DECL(string);
+SUTL_CMPFN_DECL(strview);
+
+SUTL_ORDFN_DECL(uchar);
+SUTL_ORDFN_DECL(ushort);
+SUTL_ORDFN_DECL(uint);
+SUTL_ORDFN_DECL(ulong);
+SUTL_ORDFN_DECL(char);
+SUTL_ORDFN_DECL(short);
+SUTL_ORDFN_DECL(int);
+SUTL_ORDFN_DECL(long);
+
+SUTL_ORDFN_DECL(u8);
+SUTL_ORDFN_DECL(u16);
+SUTL_ORDFN_DECL(u32);
+SUTL_ORDFN_DECL(u64);
+SUTL_ORDFN_DECL(i8);
+SUTL_ORDFN_DECL(i16);
+SUTL_ORDFN_DECL(i32);
+SUTL_ORDFN_DECL(i64);
+
+SUTL_ORDFN_DECL(size);
+SUTL_ORDFN_DECL(ptr);
+
+SUTL_ORDFN_DECL(float);
+SUTL_ORDFN_DECL(double);
+
+SUTL_ORDFN_DECL(string);
+SUTL_ORDFN_DECL(strview);
+
+int SUTLProbeCmp_string(const void * probe, const void * key);
+int SUTLProbeOrd_string(const void * probe, const void * key);
+
+void SUTL_InternalSort(void * data, size_t count, size_t elemsize, int( * order)(const void *, const void *));
+size_t SUTL_InternalLowerBound(const void * data, size_t count, size_t elemsize, const void * key, int( * order)(const void *, const void *));
+void SUTL_InternalSwap(char * p0, char * p1, size_t size);
+int SUTL_InternalOrderBytes(const void * p0, size_t size0, const void * p1, size_t size1);
+
+uint64_t SUTL_InternalHashBytes(const void * ptr, size_t size);
 /**
  * @}
  */
@@ -173,17 +304,31 @@ SUTL_CMPFN_DECL(string);
     SUTL_HASHFN_DEF_PRIMITIVE(float,    float);
     SUTL_HASHFN_DEF_PRIMITIVE(double,   double);
 
-    SUTL_HASHFN_DEF(string,
-        hash = SIZE_MAX;
-        size_t * buf = (size_t *)v;
-        size_t bufSize = SUTLStringSize(v) / sizeof(size_t);
-        size_t remSize = SUTLStringSize(v) % sizeof(size_t);
+    uint64_t SUTL_InternalHashBytes(const void * ptr, size_t size)
+    {
+        /*
+         * 64-bit FNV-1a.
+         */
+        uint64_t hash = 0xCBF29CE484222325ULL;
         size_t i;
-        for (i = 0; i < bufSize; i++)
-            hash ^= buf[i];
-        if (remSize)
-            for (i = 0; i < remSize; i++)
-                ((char *)hash)[i] ^= ((SUTLString)v)[bufSize * sizeof(size_t) + i];
+
+        for (i = 0; i < size; i++)
+        {
+            hash ^= ((const uint8_t *)ptr)[i];
+            hash *= 0x100000001B3ULL;
+        }
+
+        return hash;
+    }
+
+    SUTL_HASHFN_DEF(string,
+        SUTLString str = *(const SUTLString *)v;
+        hash = (size_t)SUTL_InternalHashBytes(str, SUTLStringSize(str));
+    )
+
+    SUTL_HASHFN_DEF(strview,
+        const SUTLStringView * view = (const SUTLStringView *)v;
+        hash = (size_t)SUTL_InternalHashBytes(view->Data, view->Size);
     )
 
     SUTL_CMPFN_DEF_PRIMITIVE(uchar,     unsigned char)
@@ -210,7 +355,207 @@ SUTL_CMPFN_DECL(string);
     SUTL_CMPFN_DEF_PRIMITIVE(float,     float)
     SUTL_CMPFN_DEF_PRIMITIVE(double,    double)
 
-    SUTL_CMPFN_DEF(string, res = SHRN_STRCMP((const char *)p0, (const char *)p1) == 0;)
+    SUTL_CMPFN_DEF(string,
+        SUTLString str0 = *(const SUTLString *)p0;
+        SUTLString str1 = *(const SUTLString *)p1;
+        res = SUTLStringSize(str0) == SUTLStringSize(str1) && SHRN_MEMCMP(str0, str1, SUTLStringSize(str0)) == 0;
+    )
+
+    SUTL_CMPFN_DEF(strview,
+        const SUTLStringView * view0 = (const SUTLStringView *)p0;
+        const SUTLStringView * view1 = (const SUTLStringView *)p1;
+        res = view0->Size == view1->Size && SHRN_MEMCMP(view0->Data, view1->Data, view0->Size) == 0;
+    )
+
+    int SUTLProbeCmp_string(const void * probe, const void * key)
+    {
+        const SUTLStringView * view = (const SUTLStringView *)probe;
+        SUTLString str = *(const SUTLString *)key;
+
+        return view->Size == SUTLStringSize(str) && SHRN_MEMCMP(view->Data, str, view->Size) == 0;
+    }
+
+    #define SUTL_ORDFN_DEF(suffix, expr) \
+        int SUTLOrd_##suffix(const void * p0, const void * p1)\
+        {\
+            int res = 0;\
+            expr\
+            return res;\
+        }
+
+    #define SUTL_ORDFN_DEF_PRIMITIVE(suffix, t) SUTL_ORDFN_DEF(suffix, res = SUTL_ORDER(*(const t *)p0, *(const t *)p1);)
+
+    SUTL_ORDFN_DEF_PRIMITIVE(uchar,     unsigned char)
+    SUTL_ORDFN_DEF_PRIMITIVE(ushort,    unsigned short)
+    SUTL_ORDFN_DEF_PRIMITIVE(uint,      unsigned int)
+    SUTL_ORDFN_DEF_PRIMITIVE(ulong,     unsigned long)
+    SUTL_ORDFN_DEF_PRIMITIVE(char,      signed char)
+    SUTL_ORDFN_DEF_PRIMITIVE(short,     signed short)
+    SUTL_ORDFN_DEF_PRIMITIVE(int,       signed int)
+    SUTL_ORDFN_DEF_PRIMITIVE(long,      signed long)
+
+    SUTL_ORDFN_DEF_PRIMITIVE(u8,        uint8_t)
+    SUTL_ORDFN_DEF_PRIMITIVE(u16,       uint16_t)
+    SUTL_ORDFN_DEF_PRIMITIVE(u32,       uint32_t)
+    SUTL_ORDFN_DEF_PRIMITIVE(u64,       uint64_t)
+    SUTL_ORDFN_DEF_PRIMITIVE(i8,        int8_t)
+    SUTL_ORDFN_DEF_PRIMITIVE(i16,       int16_t)
+    SUTL_ORDFN_DEF_PRIMITIVE(i32,       int32_t)
+    SUTL_ORDFN_DEF_PRIMITIVE(i64,       int64_t)
+
+    SUTL_ORDFN_DEF_PRIMITIVE(size,      size_t)
+    SUTL_ORDFN_DEF(ptr,                 res = SUTL_ORDER((size_t)*(void * const *)p0, (size_t)*(void * const *)p1);)
+
+    SUTL_ORDFN_DEF(float,               res = SUTL_ORDER_FLOAT(*(const float *)p0, *(const float *)p1);)
+    SUTL_ORDFN_DEF(double,              res = SUTL_ORDER_FLOAT(*(const double *)p0, *(const double *)p1);)
+
+    int SUTL_InternalOrderBytes(const void * p0, size_t size0, const void * p1, size_t size1)
+    {
+        size_t size = size0 < size1 ? size0 : size1;
+        int res = size ? SHRN_MEMCMP(p0, p1, size) : 0;
+
+        /*
+         * Equal up to the shorter one, so the shorter one is first.
+         */
+        return res ? res : SUTL_ORDER(size0, size1);
+    }
+
+    SUTL_ORDFN_DEF(string,
+        SUTLString str0 = *(const SUTLString *)p0;
+        SUTLString str1 = *(const SUTLString *)p1;
+        res = SUTL_InternalOrderBytes(str0, SUTLStringSize(str0), str1, SUTLStringSize(str1));
+    )
+
+    SUTL_ORDFN_DEF(strview,
+        const SUTLStringView * view0 = (const SUTLStringView *)p0;
+        const SUTLStringView * view1 = (const SUTLStringView *)p1;
+        res = SUTL_InternalOrderBytes(view0->Data, view0->Size, view1->Data, view1->Size);
+    )
+
+    int SUTLProbeOrd_string(const void * probe, const void * key)
+    {
+        const SUTLStringView * view = (const SUTLStringView *)probe;
+        SUTLString str = *(const SUTLString *)key;
+
+        return SUTL_InternalOrderBytes(view->Data, view->Size, str, SUTLStringSize(str));
+    }
+
+    void SUTL_InternalSwap(char * p0, char * p1, size_t size)
+    {
+        char tmp;
+
+        while (size--)
+        {
+            tmp = p0[size];
+            p0[size] = p1[size];
+            p1[size] = tmp;
+        }
+    }
+
+    void SUTL_InternalSort(void * data, size_t count, size_t elemsize, int( * order)(const void *, const void *))
+    {
+        #define SUTLSortAt(i) (base + (i) * elemsize)
+
+        char * base = (char *)data;
+        size_t lo = 0;
+        size_t hi = count;
+        size_t mid;
+        size_t i;
+        size_t j;
+
+        while (hi - lo > 16)
+        {
+            /*
+             * Sort the first, middle and last elements, then move the median to `lo` as the pivot.
+             */
+            mid = lo + (hi - lo) / 2;
+
+            if (order(SUTLSortAt(mid), SUTLSortAt(lo)) < 0)
+                SUTL_InternalSwap(SUTLSortAt(mid), SUTLSortAt(lo), elemsize);
+
+            if (order(SUTLSortAt(hi - 1), SUTLSortAt(mid)) < 0)
+            {
+                SUTL_InternalSwap(SUTLSortAt(hi - 1), SUTLSortAt(mid), elemsize);
+
+                if (order(SUTLSortAt(mid), SUTLSortAt(lo)) < 0)
+                    SUTL_InternalSwap(SUTLSortAt(mid), SUTLSortAt(lo), elemsize);
+            }
+
+            SUTL_InternalSwap(SUTLSortAt(lo), SUTLSortAt(mid), elemsize);
+
+            /*
+             * Partition around the pivot, stopping at equal elements so runs of them are split evenly.
+             */
+            i = lo;
+            j = hi;
+
+            for (;;)
+            {
+                while (order(SUTLSortAt(++i), SUTLSortAt(lo)) < 0)
+                    if (i == hi - 1)
+                        break;
+
+                while (order(SUTLSortAt(lo), SUTLSortAt(--j)) < 0)
+                    if (j == lo)
+                        break;
+
+                if (i >= j)
+                    break;
+
+                SUTL_InternalSwap(SUTLSortAt(i), SUTLSortAt(j), elemsize);
+            }
+
+            SUTL_InternalSwap(SUTLSortAt(lo), SUTLSortAt(j), elemsize);
+
+            /*
+             * Recurse into the smaller side and loop on the larger one, so the depth stays
+             * logarithmic.
+             */
+            if (j - lo < hi - j - 1)
+            {
+                SUTL_InternalSort(SUTLSortAt(lo), j - lo, elemsize, order);
+                lo = j + 1;
+            }
+            else
+            {
+                SUTL_InternalSort(SUTLSortAt(j + 1), hi - j - 1, elemsize, order);
+                hi = j;
+            }
+        }
+
+        /*
+         * Insertion sort the short range which is left.
+         */
+        for (i = lo + 1; i < hi; i++)
+            for (j = i; j > lo && order(SUTLSortAt(j), SUTLSortAt(j - 1)) < 0; j--)
+                SUTL_InternalSwap(SUTLSortAt(j), SUTLSortAt(j - 1), elemsize);
+
+        #undef SUTLSortAt
+    }
+
+    size_t SUTL_InternalLowerBound(const void * data, size_t count, size_t elemsize, const void * key, int( * order)(const void *, const void *))
+    {
+        size_t lo = 0;
+        size_t half;
+
+        while (count > 0)
+        {
+            half = count / 2;
+
+            if (order(key, (const char *)data + (lo + half) * elemsize) > 0)
+            {
+                lo += half + 1;
+                count -= half + 1;
+            }
+            else
+                count = half;
+        }
+
+        return lo;
+    }
+
+    #undef SUTL_ORDFN_DEF_PRIMITIVE
+    #undef SUTL_ORDFN_DEF
 
     #undef SUTL_CMPFN_DEF_PRIMITIVE
     #undef SUTL_CMPFN_DEF
@@ -219,6 +564,7 @@ SUTL_CMPFN_DECL(string);
     #undef SUTL_HASHFN_DEF
 #endif
 
+#undef SUTL_ORDFN_DECL
 #undef SUTL_CMPFN_DECL
 #undef SUTL_HASHFN_DECL
 
@@ -18,6 +18,7 @@
 
 #include "Common.h"
 #include "Vector.h"
+#include "HashUtils.h"
 
 /**
  * @defgroup Hashmap
@@ -138,6 +139,37 @@ typedef struct SUTLHashmap
  */
 #define SUTLHashmapGet(tk, tv, hm, k)          (*(tk *)hm.ParamK = k, (tv *)SUTL_InternalHashmapGet(&hm))
 
+/**
+ * @brief Gets a value whose key matches \p probe in \p hm, where \p probe doesn't need to be of the
+ * key type. This allows searching without constructing a key.
+ *
+ * @param tv The value type of \p hm.
+ * @param hm The hashmap to get from.
+ * @param probe A pointer to the probe to search for.
+ * @param hash A function of the signature <tt>size_t(const void *)</tt> that hashes the probe. It
+ * must give the same hash as the key hash function of \p hm for matching keys.
+ * @param cmp A function of signature <tt>int(const void *, const void *)</tt> that compares the
+ * probe (first parameter) with a key (second parameter) for equality.
+ *
+ * @return A <tt>tv *</tt> that points to the required value. If no key matches \p probe then it is
+ * \p NULL.
+ */
+#define SUTLHashmapGetWith(tv, hm, probe, hash, cmp) ((tv *)SUTL_InternalHashmapGetWith(&hm, probe, hash, cmp))
+
+/**
+ * @brief Gets a value assigned to the string of \p size characters at \p ptr in \p hm, which must
+ * be keyed by \p SUTLString and use \p SUTL_HASHFN(string).
+ *
+ * @param tv The value type of \p hm.
+ * @param hm The hashmap to get from.
+ * @param ptr Pointer to the characters to search for. They don't need to be null-terminated.
+ * @param size The number of characters.
+ *
+ * @return A <tt>tv *</tt> that points to the required value. If the string doesn't exist in \p hm
+ * then it is \p NULL.
+ */
+#define SUTLHashmapGetN(tv, hm, ptr, size)     ((tv *)SUTL_InternalHashmapGetN(&hm, ptr, size))
+
 /**
  * @brief Inserts an entry with key \p k and value \p v in \p hm.
  *
@@ -196,6 +228,8 @@ void SUTL_InternalHashmapFree(SUTLHashmap * hm);
 void * SUTL_InternalHashmapInsert(SUTLHashmap * hm);
 void SUTL_InternalHashmapErase(SUTLHashmap * hm);
 void * SUTL_InternalHashmapGet(SUTLHashmap * hm);
+void * SUTL_InternalHashmapGetWith(SUTLHashmap * hm, const void * probe, size_t( * hash)(const void *), int ( * cmp)(const void *, const void *));
+void * SUTL_InternalHashmapGetN(SUTLHashmap * hm, const char * ptr, size_t size);
 /**
  * @{
  */
@@ -350,6 +384,32 @@ void * SUTL_InternalHashmapGet(SUTLHashmap * hm);
          */
         return NULL;
     }
+
+    void * SUTL_InternalHashmapGetWith(SUTLHashmap * hm, const void * probe, size_t( * hash)(const void *), int ( * cmp)(const void *, const void *))
+    {
+        /*
+         * Calculate the index of `probe` using its own hash function.
+         */
+        size_t index = hash(probe) % SUTL_HASHMAP_BUCKET_COUNT;
+
+        size_t i;
+
+        /*
+         * Search the bucket with index `index` for a key that matches `probe`.
+         */
+        for (i = 0; i < SUTLVectorSize(hm->Keys[index]) / hm->KeySize; i++)
+            if (cmp(probe, hm->Keys[index] + i * hm->KeySize))
+                return hm->Values[index] + i * hm->ValueSize;
+
+        return NULL;
+    }
+
+    void * SUTL_InternalHashmapGetN(SUTLHashmap * hm, const char * ptr, size_t size)
+    {
+        SUTLStringView probe = SUTLStringViewNew(ptr, size);
+
+        return SUTL_InternalHashmapGetWith(hm, &probe, SUTL_HASHFN(strview), SUTL_PROBECMPFN(string));
+    }
 #endif
 
 #endif
@@ -18,6 +18,7 @@
 
 #include "Common.h"
 #include "Vector.h"
+#include "HashUtils.h"
 
 /**
  * @defgroup Hashset
@@ -121,6 +122,36 @@ typedef struct SUTLHashset
  */
 #define SUTLHashsetGet(tk, hs, k)          (*(tk *)hs.ParamK = k, (tk *)SUTL_InternalHashsetGet(&hs))
 
+/**
+ * @brief Gets entry which matches \p probe in \p hs, where \p probe doesn't need to be of the key
+ * type. This allows searching without constructing a key.
+ *
+ * @param tk The key type of \p hs.
+ * @param hs The hashset to get from.
+ * @param probe A pointer to the probe to search for.
+ * @param hash A function of the signature <tt>size_t(const void *)</tt> that hashes the probe. It
+ * must give the same hash as the key hash function of \p hs for matching keys.
+ * @param cmp A function of signature <tt>int(const void *, const void *)</tt> that compares the
+ * probe (first parameter) with a key (second parameter) for equality.
+ *
+ * @return A <tt>tk *</tt> that points to the required entry. If no entry matches \p probe then it
+ * is \p NULL.
+ */
+#define SUTLHashsetGetWith(tk, hs, probe, hash, cmp) ((tk *)SUTL_InternalHashsetGetWith(&hs, probe, hash, cmp))
+
+/**
+ * @brief Gets entry equal to the string of \p size characters at \p ptr in \p hs, which must
+ * store \p SUTLString and use \p SUTL_HASHFN(string).
+ *
+ * @param hs The hashset to get from.
+ * @param ptr Pointer to the characters to search for. They don't need to be null-terminated.
+ * @param size The number of characters.
+ *
+ * @return A <tt>SUTLString *</tt> that points to the required entry. If the string doesn't exist
+ * in \p hs then it is \p NULL.
+ */
+#define SUTLHashsetGetN(hs, ptr, size)     ((SUTLString *)SUTL_InternalHashsetGetN(&hs, ptr, size))
+
 /**
  * @brief Inserts an entry with key \p k in \p hs.
  *
@@ -174,6 +205,8 @@ void SUTL_InternalHashsetFree(SUTLHashset * hs);
 void * SUTL_InternalHashsetInsert(SUTLHashset * hs);
 void SUTL_InternalHashsetErase(SUTLHashset * hs);
 void * SUTL_InternalHashsetGet(SUTLHashset * hs);
+void * SUTL_InternalHashsetGetWith(SUTLHashset * hs, const void * probe, size_t( * hash)(const void *), int ( * cmp)(const void *, const void *));
+void * SUTL_InternalHashsetGetN(SUTLHashset * hs, const char * ptr, size_t size);
 /**
  * @{
  */
@@ -311,6 +344,32 @@ void * SUTL_InternalHashsetGet(SUTLHashset * hs);
          */
         return NULL;
     }
+
+    void * SUTL_InternalHashsetGetWith(SUTLHashset * hs, const void * probe, size_t( * hash)(const void *), int ( * cmp)(const void *, const void *))
+    {
+        /*
+         * Calculate the index of `probe` using its own hash function.
+         */
+        size_t index = hash(probe) % SUTL_HASHSET_BUCKET_COUNT;
+
+        size_t i;
+
+        /*
+         * Search the bucket with index `index` for a key that matches `probe`.
+         */
+        for (i = 0; i < SUTLVectorSize(hs->Keys[index]) / hs->KeySize; i++)
+            if (cmp(probe, hs->Keys[index] + i * hs->KeySize))
+                return hs->Keys[index] + i * hs->KeySize;
+
+        return NULL;
+    }
+
+    void * SUTL_InternalHashsetGetN(SUTLHashset * hs, const char * ptr, size_t size)
+    {
+        SUTLStringView probe = SUTLStringViewNew(ptr, size);
+
+        return SUTL_InternalHashsetGetWith(hs, &probe, SUTL_HASHFN(strview), SUTL_PROBECMPFN(string));
+    }
 #endif
 
 #endif
@@ -0,0 +1,478 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_INTRUSIVE_H
+#define SUTL_INTRUSIVE_H
+
+#include "Common.h"
+
+/**
+ * @defgroup Intrusive
+ * Intrusive doubly linked lists, singly headed lists and hash tables, whose links are embedded in
+ * the objects they hold.
+ *
+ * An object is put into a container through a link member of its own, so inserting allocates
+ * nothing and removing an object only needs the object. An object can be in as many containers as
+ * it has links. \p SUTL_CONTAINER_OF gets the object back from a pointer to its link. The
+ * containers never own their objects.
+ *
+ * A \p SUTLList is circular with its head as the sentinel, so it suits LRU lists and queues. A
+ * \p SUTLHList has a head of a single pointer and links which can still be removed in O(1), so it
+ * suits hash buckets, which is how \p SUTLIntrusiveHash uses it.
+ * @{
+ */
+
+/**
+ * @brief Gets a pointer to the object of type \p type whose member \p member is at \p ptr.
+ *
+ * @param ptr A pointer to the member.
+ * @param type The type of the object.
+ * @param member The name of the member.
+ */
+#define SUTL_CONTAINER_OF(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+
+/**
+ * @brief A link of a \p SUTLList, and the head of one.
+ */
+typedef struct SUTLList
+{
+    /**
+     * @brief The next link, or the head after the last one.
+     */
+    struct SUTLList * Next;
+
+    /**
+     * @brief The previous link, or the head before the first one.
+     */
+    struct SUTLList * Prev;
+} SUTLList;
+
+/**
+ * @brief A link of a \p SUTLHList.
+ */
+typedef struct SUTLHListLink
+{
+    /**
+     * @brief The next link, or \p NULL after the last one.
+     */
+    struct SUTLHListLink * Next;
+
+    /**
+     * @brief The pointer which points to this link, in the previous link or in the head.
+     */
+    struct SUTLHListLink ** PPrev;
+} SUTLHListLink;
+
+/**
+ * @brief The head of a \p SUTLHList.
+ */
+typedef struct SUTLHList
+{
+    /**
+     * @brief The first link, or \p NULL if the list is empty.
+     */
+    SUTLHListLink * First;
+} SUTLHList;
+
+/**
+ * @brief A link of a \p SUTLIntrusiveHash.
+ */
+typedef struct SUTLIntrusiveHashLink
+{
+    /**
+     * @brief The link in the bucket.
+     */
+    SUTLHListLink Link;
+
+    /**
+     * @brief The hash of the object, kept for growing the table.
+     */
+    size_t Hash;
+} SUTLIntrusiveHashLink;
+
+/**
+ * @brief It contains the buckets of an intrusive hash table.
+ */
+typedef struct SUTLIntrusiveHash
+{
+    /**
+     * @brief The number of objects.
+     */
+    size_t Size;
+
+    /**
+     * @brief The number of buckets, a power of two.
+     */
+    size_t BucketCount;
+
+    /**
+     * @brief The buckets.
+     */
+    SUTLHList * Buckets;
+} SUTLIntrusiveHash;
+
+/**
+ * @brief Makes \p head an empty \p SUTLList.
+ *
+ * @param head The \p SUTLList to initialize.
+ */
+#define SUTLListInit(head)                  ((head).Next = (head).Prev = &(head))
+
+/**
+ * @brief Checks if the \p SUTLList \p head is empty.
+ */
+#define SUTLListEmpty(head)                 ((head).Next == &(head))
+
+/**
+ * @brief Inserts \p link at the front of the \p SUTLList \p head.
+ */
+#define SUTLListPushFront(head, link)       SUTL_InternalListInsert(&link, &(head), (head).Next)
+
+/**
+ * @brief Inserts \p link at the back of the \p SUTLList \p head.
+ */
+#define SUTLListPushBack(head, link)        SUTL_InternalListInsert(&link, (head).Prev, &(head))
+
+/**
+ * @brief Inserts \p link after \p pos, a link in a \p SUTLList or its head.
+ */
+#define SUTLListInsertAfter(pos, link)      SUTL_InternalListInsert(&link, &(pos), (pos).Next)
+
+/**
+ * @brief Inserts \p link before \p pos, a link in a \p SUTLList or its head.
+ */
+#define SUTLListInsertBefore(pos, link)     SUTL_InternalListInsert(&link, (pos).Prev, &(pos))
+
+/**
+ * @brief Removes \p link from its \p SUTLList. The link is left pointing to itself, so removing it
+ * again does nothing.
+ */
+#define SUTLListRemove(link)                SUTL_InternalListRemove(&link)
+
+/**
+ * @brief Moves \p link, which is in the \p SUTLList \p head, to the front of it. This marks an
+ * object as the most recently used one in an LRU list.
+ */
+#define SUTLListMoveToFront(head, link)     (SUTL_InternalListRemove(&link), SUTLListPushFront(head, link))
+
+/**
+ * @brief Gets the object of the first link of the \p SUTLList \p head, or \p NULL if it is empty.
+ *
+ * @param type The type of the objects.
+ * @param member The name of their \p SUTLList member.
+ * @param head The \p SUTLList.
+ */
+#define SUTLListFirst(type, member, head)   (SUTLListEmpty(head) ? NULL : SUTL_CONTAINER_OF((head).Next, type, member))
+
+/**
+ * @brief Gets the object of the last link of the \p SUTLList \p head, or \p NULL if it is empty.
+ *
+ * @param type The type of the objects.
+ * @param member The name of their \p SUTLList member.
+ * @param head The \p SUTLList.
+ */
+#define SUTLListLast(type, member, head)    (SUTLListEmpty(head) ? NULL : SUTL_CONTAINER_OF((head).Prev, type, member))
+
+/**
+ * @brief Executes \p expr for every object in the \p SUTLList \p head from front to back. The
+ * current object can be removed in \p expr.
+ *
+ * @param type The type of the objects.
+ * @param member The name of their \p SUTLList member.
+ * @param head The \p SUTLList.
+ * @param name The name of the variable which points to the current object.
+ * @param expr The code block to execute for every object.
+ */
+#define SUTLListEach(type, member, head, name, expr) \
+    {\
+        SUTLList * name##_link = (head).Next;\
+        SUTLList * name##_next;\
+        type * name;\
+        for (; name##_link != &(head); name##_link = name##_next)\
+        {\
+            name##_next = name##_link->Next;\
+            name = SUTL_CONTAINER_OF(name##_link, type, member);\
+            expr\
+        }\
+    }
+
+/**
+ * @brief Makes \p head an empty \p SUTLHList.
+ */
+#define SUTLHListInit(head)                 ((head).First = NULL)
+
+/**
+ * @brief Inserts \p link at the front of the \p SUTLHList \p head.
+ */
+#define SUTLHListPushFront(head, link)      SUTL_InternalHListPushFront(&(head), &link)
+
+/**
+ * @brief Removes \p link from its \p SUTLHList.
+ */
+#define SUTLHListRemove(link)               SUTL_InternalHListRemove(&link)
+
+/**
+ * @brief Executes \p expr for every object in the \p SUTLHList \p head from front to back. The
+ * current object can be removed in \p expr.
+ *
+ * @param type The type of the objects.
+ * @param member The name of their \p SUTLHListLink member.
+ * @param head The \p SUTLHList.
+ * @param name The name of the variable which points to the current object.
+ * @param expr The code block to execute for every object.
+ */
+#define SUTLHListEach(type, member, head, name, expr) \
+    {\
+        SUTLHListLink * name##_link = (head).First;\
+        SUTLHListLink * name##_next;\
+        type * name;\
+        for (; name##_link; name##_link = name##_next)\
+        {\
+            name##_next = name##_link->Next;\
+            name = SUTL_CONTAINER_OF(name##_link, type, member);\
+            expr\
+        }\
+    }
+
+/**
+ * @brief Creates a new empty \p SUTLIntrusiveHash.
+ *
+ * @param buckets The initial number of buckets, which is rounded up to a power of two. The table
+ * doubles them when it holds more objects than buckets.
+ *
+ * @return A \p SUTLIntrusiveHash.
+ */
+#define SUTLIntrusiveHashNew(buckets)               SUTL_InternalIntrusiveHashNew(buckets)
+
+/**
+ * @brief Frees the buckets of \p ht. The objects in it are not touched.
+ *
+ * @param ht The \p SUTLIntrusiveHash to free.
+ */
+#define SUTLIntrusiveHashFree(ht)                   SUTL_InternalIntrusiveHashFree(&ht)
+
+/**
+ * @brief Inserts the object with \p link into \p ht. It doesn't check whether an equal object is
+ * already in \p ht.
+ *
+ * @param ht The \p SUTLIntrusiveHash to insert into.
+ * @param link The \p SUTLIntrusiveHashLink member of the object.
+ * @param hash The hash of the object.
+ */
+#define SUTLIntrusiveHashInsert(ht, link, hash)     SUTL_InternalIntrusiveHashInsert(&ht, &link, hash)
+
+/**
+ * @brief Removes the object with \p link from \p ht.
+ *
+ * @param ht The \p SUTLIntrusiveHash to remove from.
+ * @param link The \p SUTLIntrusiveHashLink member of the object.
+ */
+#define SUTLIntrusiveHashRemove(ht, link)           SUTL_InternalIntrusiveHashRemove(&ht, &link)
+
+/**
+ * @brief Finds an object matching \p probe in \p ht.
+ *
+ * @param type The type of the objects.
+ * @param member The name of their \p SUTLIntrusiveHashLink member.
+ * @param ht The \p SUTLIntrusiveHash to search.
+ * @param hash The hash of \p probe.
+ * @param probe A pointer passed to \p match.
+ * @param match A function of the signature <tt>int(const SUTLIntrusiveHashLink *, const void *)</tt>
+ * which checks if the object with the link (first parameter) matches the probe (second parameter).
+ *
+ * @return A <tt>type *</tt> to the first matching object, or \p NULL if none matches.
+ */
+#define SUTLIntrusiveHashFind(type, member, ht, hash, probe, match) \
+    ((type *)SUTL_InternalIntrusiveHashFind(&ht, hash, probe, match, offsetof(type, member)))
+
+/**
+ * @brief Executes \p expr for every object in \p ht. The current object can be removed in \p expr.
+ *
+ * @param type The type of the objects.
+ * @param member The name of their \p SUTLIntrusiveHashLink member.
+ * @param ht The \p SUTLIntrusiveHash to iterate.
+ * @param name The name of the variable which points to the current object.
+ * @param expr The code block to execute for every object.
+ */
+#define SUTLIntrusiveHashEach(type, member, ht, name, expr) \
+    {\
+        size_t name##_b;\
+        for (name##_b = 0; name##_b < (ht).BucketCount; name##_b++)\
+            SUTLHListEach(type, member.Link, (ht).Buckets[name##_b], name, expr)\
+    }
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+void SUTL_InternalListInsert(SUTLList * link, SUTLList * prev, SUTLList * next);
+void SUTL_InternalListRemove(SUTLList * link);
+void SUTL_InternalHListPushFront(SUTLHList * head, SUTLHListLink * link);
+void SUTL_InternalHListRemove(SUTLHListLink * link);
+
+SUTLIntrusiveHash SUTL_InternalIntrusiveHashNew(size_t buckets);
+void SUTL_InternalIntrusiveHashFree(SUTLIntrusiveHash * ht);
+void SUTL_InternalIntrusiveHashInsert(SUTLIntrusiveHash * ht, SUTLIntrusiveHashLink * link, size_t hash);
+void SUTL_InternalIntrusiveHashRemove(SUTLIntrusiveHash * ht, SUTLIntrusiveHashLink * link);
+void * SUTL_InternalIntrusiveHashFind(const SUTLIntrusiveHash * ht, size_t hash, const void * probe, int( * match)(const SUTLIntrusiveHashLink *, const void *), size_t offset);
+void SUTL_InternalIntrusiveHashGrow(SUTLIntrusiveHash * ht);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    void SUTL_InternalListInsert(SUTLList * link, SUTLList * prev, SUTLList * next)
+    {
+        link->Prev = prev;
+        link->Next = next;
+        prev->Next = link;
+        next->Prev = link;
+    }
+
+    void SUTL_InternalListRemove(SUTLList * link)
+    {
+        link->Prev->Next = link->Next;
+        link->Next->Prev = link->Prev;
+        link->Next = link->Prev = link;
+    }
+
+    void SUTL_InternalHListPushFront(SUTLHList * head, SUTLHListLink * link)
+    {
+        link->Next = head->First;
+        link->PPrev = &head->First;
+
+        if (head->First)
+            head->First->PPrev = &link->Next;
+
+        head->First = link;
+    }
+
+    void SUTL_InternalHListRemove(SUTLHListLink * link)
+    {
+        /*
+         * The link before this one is reached through `PPrev`, so the head doesn't need to be known.
+         */
+        *link->PPrev = link->Next;
+
+        if (link->Next)
+            link->Next->PPrev = link->PPrev;
+
+        link->Next = NULL;
+        link->PPrev = NULL;
+    }
+
+    SUTLIntrusiveHash SUTL_InternalIntrusiveHashNew(size_t buckets)
+    {
+        SUTLIntrusiveHash ht;
+        size_t i;
+
+        /*
+         * Initialize the members of `ht`.
+         */
+        ht.Size = 0;
+
+        for (ht.BucketCount = 1; ht.BucketCount < buckets; ht.BucketCount <<= 1);
+
+        ht.Buckets = (SUTLHList *)SHRN_MALLOC(ht.BucketCount * sizeof(SUTLHList));
+
+        if (!ht.Buckets)
+        {
+            SUTLErrorHandler("Memory allocation failed.");
+            ht.BucketCount = 0;
+
+            return ht;
+        }
+
+        for (i = 0; i < ht.BucketCount; i++)
+            SUTLHListInit(ht.Buckets[i]);
+
+        return ht;
+    }
+
+    void SUTL_InternalIntrusiveHashFree(SUTLIntrusiveHash * ht)
+    {
+        SHRN_FREE(ht->Buckets);
+
+        ht->Buckets = NULL;
+        ht->BucketCount = 0;
+        ht->Size = 0;
+    }
+
+    void SUTL_InternalIntrusiveHashGrow(SUTLIntrusiveHash * ht)
+    {
+        SUTLHList * buckets = (SUTLHList *)SHRN_MALLOC(2 * ht->BucketCount * sizeof(SUTLHList));
+        SUTLHListLink * link;
+        size_t i;
+
+        /*
+         * Keep the old buckets if the new ones can't be allocated, only the chains get longer.
+         */
+        if (!buckets)
+            return;
+
+        for (i = 0; i < 2 * ht->BucketCount; i++)
+            SUTLHListInit(buckets[i]);
+
+        for (i = 0; i < ht->BucketCount; i++)
+            while ((link = ht->Buckets[i].First) != NULL)
+            {
+                SUTL_InternalHListRemove(link);
+                SUTL_InternalHListPushFront(&buckets[((SUTLIntrusiveHashLink *)link)->Hash & (2 * ht->BucketCount - 1)], link);
+            }
+
+        SHRN_FREE(ht->Buckets);
+
+        ht->Buckets = buckets;
+        ht->BucketCount *= 2;
+    }
+
+    void SUTL_InternalIntrusiveHashInsert(SUTLIntrusiveHash * ht, SUTLIntrusiveHashLink * link, size_t hash)
+    {
+        if (ht->Size >= ht->BucketCount)
+            SUTL_InternalIntrusiveHashGrow(ht);
+
+        link->Hash = hash;
+        SUTL_InternalHListPushFront(&ht->Buckets[hash & (ht->BucketCount - 1)], &link->Link);
+        ht->Size++;
+    }
+
+    void SUTL_InternalIntrusiveHashRemove(SUTLIntrusiveHash * ht, SUTLIntrusiveHashLink * link)
+    {
+        SUTL_InternalHListRemove(&link->Link);
+        ht->Size--;
+    }
+
+    void * SUTL_InternalIntrusiveHashFind(const SUTLIntrusiveHash * ht, size_t hash, const void * probe, int( * match)(const SUTLIntrusiveHashLink *, const void *), size_t offset)
+    {
+        SUTLHListLink * link;
+
+        if (!ht->BucketCount)
+            return NULL;
+
+        /*
+         * The stored hashes are compared first, so `match` only runs for likely matches.
+         */
+        for (link = ht->Buckets[hash & (ht->BucketCount - 1)].First; link; link = link->Next)
+            if (((SUTLIntrusiveHashLink *)link)->Hash == hash && match((SUTLIntrusiveHashLink *)link, probe))
+                return (char *)link - offset;
+
+        return NULL;
+    }
+#endif
+
+#endif
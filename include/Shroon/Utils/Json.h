@@ -0,0 +1,1066 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_JSON_H
+#define SUTL_JSON_H
+
+#include "Common.h"
+#include "Vector.h"
+#include "String.h"
+#include "Hashmap.h"
+#include "HashUtils.h"
+#include "Swar.h"
+
+/**
+ * @defgroup Json
+ * A JSON parser which works in two stages and doesn't copy any strings.
+ *
+ * The first stage scans the input 64 bytes at a time and builds bitmasks of quotes, backslashes,
+ * structural characters and whitespace. Quotes escaped by backslashes are removed, the inside of
+ * strings is found with a prefix XOR of the quotes, and the offsets of all structural characters,
+ * quotes and starts of literals and numbers outside strings are collected into an index.
+ *
+ * The second stage walks the index without recursion and validates the grammar while writing a
+ * tape: a vector of \p SUTLJsonNode in document order, where each array or object node is followed
+ * by its children and knows the index of the node after them. Strings are views into the input
+ * and numbers are parsed into \p int64_t or \p double on the way.
+ * @{
+ */
+
+/**
+ * @brief The maximum depth of nested arrays and objects.
+ */
+#ifndef SUTL_JSON_MAX_DEPTH
+    #define SUTL_JSON_MAX_DEPTH 1024
+#endif
+
+/**
+ * @brief The node index returned when a node isn't found.
+ */
+#define SUTL_JSON_NONE ((size_t)-1)
+
+/**
+ * @brief The type of a \p SUTLJsonNode.
+ */
+typedef enum SUTLJsonType
+{
+    SUTL_JSON_NULL,
+    SUTL_JSON_FALSE,
+    SUTL_JSON_TRUE,
+
+    /**
+     * @brief A number without fraction or exponent that fits in \p int64_t.
+     */
+    SUTL_JSON_INT,
+
+    /**
+     * @brief Any other number.
+     */
+    SUTL_JSON_DOUBLE,
+    SUTL_JSON_STRING,
+    SUTL_JSON_ARRAY,
+    SUTL_JSON_OBJECT
+} SUTLJsonType;
+
+/**
+ * @brief A value in a \p SUTLJsonDocument.
+ */
+typedef struct SUTLJsonNode
+{
+    /**
+     * @brief The type of the value.
+     */
+    SUTLJsonType Type;
+
+    /**
+     * @brief For strings, 1 if the string contains escape sequences, see \p SUTLJsonUnescape.
+     */
+    int Escaped;
+
+    /**
+     * @brief For arrays the number of elements, and for objects the number of members.
+     */
+    uint32_t Size;
+
+    /**
+     * @brief The index of the node after this one and all its children.
+     */
+    uint32_t End;
+
+    /**
+     * @brief The value, according to \p Type.
+     */
+    union
+    {
+        int64_t Int;
+        double Double;
+
+        /**
+         * @brief The characters between the quotes, with escape sequences as they are.
+         */
+        SUTLStringView String;
+    } Value;
+} SUTLJsonNode;
+
+/**
+ * @brief The result of parsing a JSON text.
+ */
+typedef struct SUTLJsonDocument
+{
+    /**
+     * @brief The reason the text couldn't be parsed, or \p NULL if it was parsed.
+     */
+    const char * Error;
+
+    /**
+     * @brief The offset in the text at which the error was found.
+     */
+    size_t ErrorOffset;
+
+    /**
+     * @brief A vector of \p SUTLJsonNode with the root value at index 0. It is empty on error.
+     */
+    SUTLJsonNode * Nodes;
+
+    /**
+     * @brief Don't access this directly. A vector of \p uint32_t with the offsets of the structural
+     * characters, kept to be reused by \p SUTLJsonReparse.
+     */
+    uint32_t * Index;
+} SUTLJsonDocument;
+
+/**
+ * @brief Parses a JSON text.
+ *
+ * @param json A \p SUTLStringView of the text. It must be less than 4 GiB, and stay valid as long as
+ * the strings of the document are used.
+ *
+ * @return A \p SUTLJsonDocument. If the text isn't valid JSON, an error is reported and \p Error
+ * is set.
+ */
+#define SUTLJsonParse(json)                     SUTL_InternalJsonParse(json)
+
+/**
+ * @brief Parses another JSON text into \p doc, reusing its memory. This avoids allocating for every
+ * document when many are parsed one after another.
+ *
+ * @param doc The \p SUTLJsonDocument to parse into. Its previous nodes become invalid.
+ * @param json A \p SUTLStringView of the text, with the same requirements as for \p SUTLJsonParse.
+ *
+ * @return 1 on success. If the text isn't valid JSON, an error is reported, \p Error is set and 0
+ * is returned.
+ */
+#define SUTLJsonReparse(doc, json)              SUTL_InternalJsonReparse(&doc, json)
+
+/**
+ * @brief Frees a \p SUTLJsonDocument which was created using \p SUTLJsonParse.
+ *
+ * @param doc The \p SUTLJsonDocument to free.
+ */
+#define SUTLJsonDocumentFree(doc)               (SUTLVectorFree((doc).Index), SUTLVectorFree((doc).Nodes))
+
+/**
+ * @brief Gets the index of the node after node \p i and its children, which is its next sibling
+ * if it has one.
+ *
+ * @param doc The \p SUTLJsonDocument.
+ * @param i The index of the node.
+ *
+ * @return The index of the next node.
+ */
+#define SUTLJsonNext(doc, i)                    ((doc).Nodes[i].End)
+
+/**
+ * @brief Executes \p expr for each element of array \p i, or for each key of object \p i. The value
+ * of a key is the node after it.
+ *
+ * @param doc The \p SUTLJsonDocument.
+ * @param i The index of the array or object node.
+ * @param name The name of the \p size_t variable in which the index of the current node is stored.
+ * @param expr The code block to execute for each node.
+ */
+#define SUTLJsonEach(doc, i, name, expr) \
+    {\
+        size_t name;\
+        size_t SUTLJsonStep = (doc).Nodes[i].Type == SUTL_JSON_OBJECT;\
+        for (name = (i) + 1; name < (doc).Nodes[i].End; name = (doc).Nodes[name + SUTLJsonStep].End)\
+        {\
+            expr\
+        }\
+    }
+
+/**
+ * @brief Gets the value of the member named \p key of object \p i. The key is compared with the
+ * member names as they are written in the text.
+ *
+ * @param doc The \p SUTLJsonDocument.
+ * @param i The index of the object node.
+ * @param key Null-terminated name of the member.
+ *
+ * @return The index of the value, or \p SUTL_JSON_NONE if there is no such member.
+ */
+#define SUTLJsonGet(doc, i, key)                SUTL_InternalJsonGet(&doc, i, key, SHRN_STRLEN(key))
+
+/**
+ * @brief Gets the value of the member whose name is the \p size characters at \p ptr.
+ *
+ * @param doc The \p SUTLJsonDocument.
+ * @param i The index of the object node.
+ * @param ptr Pointer to the name.
+ * @param size The number of characters of the name.
+ *
+ * @return The index of the value, or \p SUTL_JSON_NONE if there is no such member.
+ */
+#define SUTLJsonGetN(doc, i, ptr, size)         SUTL_InternalJsonGet(&doc, i, ptr, size)
+
+/**
+ * @brief Gets element \p at of array \p i.
+ *
+ * @param doc The \p SUTLJsonDocument.
+ * @param i The index of the array node.
+ * @param at The position of the element.
+ *
+ * @return The index of the element, or \p SUTL_JSON_NONE if \p at is out of bounds.
+ */
+#define SUTLJsonAt(doc, i, at)                  SUTL_InternalJsonAt(&doc, i, at)
+
+/**
+ * @brief Appends the characters of a JSON string to \p str with escape sequences decoded, and
+ * \p \\u escapes converted to UTF-8.
+ *
+ * @param view The \p SUTLStringView of the string, like the \p String of a \p SUTLJsonNode.
+ * @param str The \p SUTLString to append to.
+ *
+ * @return 1 on success. If there is an invalid escape sequence, an error is reported and 0 is
+ * returned.
+ */
+#define SUTLJsonUnescape(view, str)             SUTL_InternalJsonUnescape(view, &str)
+
+/**
+ * @brief Creates a \p SUTLHashmap from the member names of object \p i to the indices of their
+ * values, for repeated lookups in large objects.
+ *
+ * @param doc The \p SUTLJsonDocument.
+ * @param i The index of the object node.
+ *
+ * @return A \p SUTLHashmap keyed by \p SUTLStringView with \p size_t values, using
+ * \p SUTL_HASHFN(strview) and \p SUTL_CMPFN(strview). The keys are views into the text.
+ */
+#define SUTLJsonToHashmap(doc, i)               SUTL_InternalJsonToHashmap(&doc, i)
+
+/**
+ * @brief Creates a vector of the elements of array \p i, which must all be integers.
+ *
+ * @param doc The \p SUTLJsonDocument.
+ * @param i The index of the array node.
+ *
+ * @return A vector of \p int64_t. If \p i isn't an array of integers, an error is reported and
+ * \p NULL is returned.
+ */
+#define SUTLJsonToInts(doc, i)                  SUTL_InternalJsonToInts(&doc, i)
+
+/**
+ * @brief Creates a vector of the elements of array \p i, which must all be numbers.
+ *
+ * @param doc The \p SUTLJsonDocument.
+ * @param i The index of the array node.
+ *
+ * @return A vector of \p double. If \p i isn't an array of numbers, an error is reported and
+ * \p NULL is returned.
+ */
+#define SUTLJsonToDoubles(doc, i)               SUTL_InternalJsonToDoubles(&doc, i)
+
+/**
+ * @brief Creates a vector of unescaped copies of the elements of array \p i, which must all be
+ * strings.
+ *
+ * @param doc The \p SUTLJsonDocument.
+ * @param i The index of the array node.
+ *
+ * @return A vector of \p SUTLString, each of which must be freed. If \p i isn't an array of
+ * strings, an error is reported and \p NULL is returned.
+ */
+#define SUTLJsonToStrings(doc, i)               SUTL_InternalJsonToStrings(&doc, i)
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+SUTLJsonDocument SUTL_InternalJsonParse(SUTLStringView json);
+int SUTL_InternalJsonReparse(SUTLJsonDocument * doc, SUTLStringView json);
+size_t SUTL_InternalJsonGet(const SUTLJsonDocument * doc, size_t i, const char * ptr, size_t size);
+size_t SUTL_InternalJsonAt(const SUTLJsonDocument * doc, size_t i, size_t at);
+int SUTL_InternalJsonUnescape(SUTLStringView view, SUTLString * str);
+SUTLHashmap SUTL_InternalJsonToHashmap(const SUTLJsonDocument * doc, size_t i);
+int64_t * SUTL_InternalJsonToInts(const SUTLJsonDocument * doc, size_t i);
+double * SUTL_InternalJsonToDoubles(const SUTLJsonDocument * doc, size_t i);
+SUTLString * SUTL_InternalJsonToStrings(const SUTLJsonDocument * doc, size_t i);
+
+const char * SUTL_InternalJsonIndex(SUTLStringView json, uint32_t ** index, size_t * offset);
+int SUTL_InternalJsonIsDelimiter(const char * p, const char * end);
+const char * SUTL_InternalJsonScalar(const char * p, const char * end, SUTLJsonNode * node);
+const char * SUTL_InternalJsonTape(SUTLStringView json, const uint32_t * index, SUTLJsonNode ** nodes, size_t * offset);
+int SUTL_InternalJsonHex(const char * p, unsigned long * out);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    const char * SUTL_InternalJsonIndex(SUTLStringView json, uint32_t ** index, size_t * offset)
+    {
+        unsigned char tail[64];
+        const unsigned char * block;
+        uint64_t quotes, backslashes, escaped, operators, spaces, controls, scalars, starts, inside, bits;
+        uint64_t inString = 0;
+        uint64_t escapeCarry = 0;
+        uint64_t scalarCarry = 0;
+        uint64_t w, folded;
+        unsigned i, bit;
+
+        *offset = 0;
+
+        for (*offset = 0; *offset < json.Size; *offset += 64)
+        {
+            block = (const unsigned char *)json.Data + *offset;
+
+            /*
+             * Pad the last partial block with spaces, which are neither part of a string nor of a
+             * literal.
+             */
+            if (json.Size - *offset < 64)
+            {
+                SHRN_MEMSET(tail, ' ', sizeof(tail));
+                SHRN_MEMCPY(tail, block, json.Size - *offset);
+
+                block = tail;
+            }
+
+            quotes = 0;
+            backslashes = 0;
+            operators = 0;
+            spaces = 0;
+            controls = 0;
+
+            for (i = 0; i < 64; i += 8)
+            {
+                SUTL_SWAR_LOAD(w, block + i);
+
+                /*
+                 * Setting bit 5 folds `[` into `{` and `]` into `}`.
+                 */
+                folded = w | (SUTL_SWAR_ONES * 0x20);
+
+                quotes |= (uint64_t)SUTL_SWAR_EQ(w, '"') << i;
+                backslashes |= (uint64_t)SUTL_SWAR_EQ(w, '\\') << i;
+                operators |= (uint64_t)SUTL_SWAR_GATHER(
+                    SUTL_SWAR_ZEROS(folded ^ (SUTL_SWAR_ONES * '{')) | SUTL_SWAR_ZEROS(folded ^ (SUTL_SWAR_ONES * '}')) |
+                    SUTL_SWAR_ZEROS(w ^ (SUTL_SWAR_ONES * ':')) | SUTL_SWAR_ZEROS(w ^ (SUTL_SWAR_ONES * ','))) << i;
+                spaces |= (uint64_t)(SUTL_SWAR_EQ(w, ' ') | SUTL_SWAR_EQ(w, '\t') | SUTL_SWAR_EQ(w, '\n') | SUTL_SWAR_EQ(w, '\r')) << i;
+                controls |= (uint64_t)SUTL_SWAR_LESS(w, 0x20) << i;
+            }
+
+            /*
+             * A backslash escapes the next character unless it is escaped itself. Backslashes are
+             * rare, so they are visited one by one.
+             */
+            escaped = escapeCarry;
+            escapeCarry = 0;
+            backslashes &= ~escaped;
+
+            while (backslashes)
+            {
+                bit = SUTL_CTZ64(backslashes);
+                backslashes &= backslashes - 1;
+
+                if (bit == 63)
+                {
+                    escapeCarry = 1;
+                }
+                else
+                {
+                    escaped |= (uint64_t)1 << (bit + 1);
+                    backslashes &= ~((uint64_t)1 << (bit + 1));
+                }
+            }
+
+            quotes &= ~escaped;
+
+            /*
+             * `inside` covers the opening quote and the characters of a string, but not the
+             * closing quote.
+             */
+            inside = SUTL_InternalPrefixXor64(quotes) ^ inString;
+            inString = (uint64_t)0 - (inside >> 63);
+
+            if (controls & inside)
+            {
+                *offset += SUTL_CTZ64(controls & inside);
+                return "Invalid control character in JSON string.";
+            }
+
+            operators &= ~inside;
+
+            /*
+             * A literal or number starts at a character outside strings which isn't whitespace, an
+             * operator or a quote and doesn't follow such a character.
+             */
+            scalars = ~(operators | spaces | quotes | inside);
+            starts = scalars & ~((scalars << 1) | scalarCarry);
+            scalarCarry = scalars >> 63;
+
+            bits = operators | quotes | starts;
+
+            /*
+             * Make room for a whole block up front, so the offsets are stored without checks.
+             */
+            if (SUTLVectorCapacity(*index) - SUTLVectorSize(*index) < 64)
+                SUTLVectorReserve(*index, SUTLVectorCapacity(*index) * 2 + 64);
+
+            while (bits)
+            {
+                (*index)[SUTLVectorSize(*index)++] = (uint32_t)(*offset + SUTL_CTZ64(bits));
+                bits &= bits - 1;
+            }
+        }
+
+        if (inString)
+        {
+            *offset = json.Size;
+            return "Unterminated JSON string.";
+        }
+
+        return NULL;
+    }
+
+    int SUTL_InternalJsonIsDelimiter(const char * p, const char * end)
+    {
+        return p == end || *p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == ',' || *p == ':' ||
+            *p == ']' || *p == '}' || *p == '[' || *p == '{' || *p == '"';
+    }
+
+    const char * SUTL_InternalJsonScalar(const char * p, const char * end, SUTLJsonNode * node)
+    {
+        const char * begin = p;
+        SUTLStringView view;
+        int integer = 1;
+
+        /*
+         * Literals.
+         */
+        if (*p == 't' || *p == 'f' || *p == 'n')
+        {
+            static const char * literals[] = { "null", "false", "true" };
+            int type = *p == 'n' ? SUTL_JSON_NULL : *p == 'f' ? SUTL_JSON_FALSE : SUTL_JSON_TRUE;
+            size_t size = SHRN_STRLEN(literals[type]);
+
+            if ((size_t)(end - p) < size || SHRN_MEMCMP(p, literals[type], size) != 0 || !SUTL_InternalJsonIsDelimiter(p + size, end))
+                return "Invalid JSON literal.";
+
+            node->Type = (SUTLJsonType)type;
+            return NULL;
+        }
+
+        /*
+         * Check the grammar of numbers, which is stricter than that of `SUTLStringViewToDouble`.
+         */
+        if (p != end && *p == '-')
+            p++;
+
+        if (p == end || (unsigned)(*p - '0') > 9)
+            return "Invalid JSON value.";
+
+        if (*p++ != '0')
+            while (p != end && (unsigned)(*p - '0') <= 9)
+                p++;
+
+        if (p != end && *p == '.')
+        {
+            integer = 0;
+
+            if (++p == end || (unsigned)(*p - '0') > 9)
+                return "Invalid JSON number.";
+
+            while (p != end && (unsigned)(*p - '0') <= 9)
+                p++;
+        }
+
+        if (p != end && (*p == 'e' || *p == 'E'))
+        {
+            integer = 0;
+
+            if (++p != end && (*p == '+' || *p == '-'))
+                p++;
+
+            if (p == end || (unsigned)(*p - '0') > 9)
+                return "Invalid JSON number.";
+
+            while (p != end && (unsigned)(*p - '0') <= 9)
+                p++;
+        }
+
+        if (!SUTL_InternalJsonIsDelimiter(p, end))
+            return "Invalid JSON number.";
+
+        view.Data = begin;
+        view.Size = (size_t)(p - begin);
+
+        /*
+         * Integers too large for `int64_t` become doubles.
+         */
+        if (integer && SUTL_InternalStringViewToInt(view, &node->Value.Int))
+        {
+            node->Type = SUTL_JSON_INT;
+            return NULL;
+        }
+
+        if (!SUTL_InternalStringViewToDouble(view, &node->Value.Double))
+            return "Invalid JSON number.";
+
+        node->Type = SUTL_JSON_DOUBLE;
+        return NULL;
+    }
+
+    const char * SUTL_InternalJsonTape(SUTLStringView json, const uint32_t * index, SUTLJsonNode ** nodes, size_t * offset)
+    {
+        enum
+        {
+            SUTLJsonValue,
+            SUTLJsonKey,
+            SUTLJsonFirstKey,
+            SUTLJsonFirstElement,
+            SUTLJsonAfterValue
+        } state = SUTLJsonValue;
+
+        const char * end = json.Data + json.Size;
+        size_t count = SUTLVectorSize(index);
+        size_t * stack = SUTLVectorNew(size_t);
+        const char * error = NULL;
+        size_t top = 0;
+        size_t idx = 0;
+        SUTLJsonNode node;
+        const char * p;
+        char c;
+
+        #define SUTLJsonFail(msg, at) { error = msg; *offset = at; break; }
+
+        SUTLVectorReserve(stack, SUTL_JSON_MAX_DEPTH);
+
+        /*
+         * A push only makes room for one more node, so grow the tape geometrically.
+         */
+        #define SUTLJsonPushNode() \
+            if (SUTLVectorSize(*nodes) == SUTLVectorCapacity(*nodes))\
+                SUTLVectorReserve(*nodes, SUTLVectorCapacity(*nodes) * 2 + 16);\
+            (*nodes)[SUTLVectorSize(*nodes)++] = node;
+
+        for (;;)
+        {
+            /*
+             * The padding of the index makes the end of input look like a space.
+             */
+            *offset = idx < count ? index[idx] : json.Size;
+            c = idx < count ? json.Data[index[idx]] : ' ';
+            p = json.Data + *offset;
+
+            if (state == SUTLJsonAfterValue)
+            {
+                if (!SUTLVectorSize(stack))
+                {
+                    if (idx != count)
+                        SUTLJsonFail("Unexpected data after JSON value.", *offset)
+
+                    break;
+                }
+
+                top = stack[SUTLVectorSize(stack) - 1];
+                idx++;
+
+                if (c == ',')
+                {
+                    state = (*nodes)[top].Type == SUTL_JSON_OBJECT ? SUTLJsonKey : SUTLJsonValue;
+                    (*nodes)[top].Size += (*nodes)[top].Type == SUTL_JSON_ARRAY;
+                    continue;
+                }
+
+                if (c != ((*nodes)[top].Type == SUTL_JSON_OBJECT ? '}' : ']'))
+                    SUTLJsonFail((*nodes)[top].Type == SUTL_JSON_OBJECT ? "Expected ',' or '}' in JSON object." : "Expected ',' or ']' in JSON array.", *offset)
+
+                (*nodes)[top].End = (uint32_t)SUTLVectorSize(*nodes);
+                SUTLVectorSize(stack)--;
+
+                continue;
+            }
+
+            if (state == SUTLJsonFirstKey || state == SUTLJsonFirstElement)
+            {
+                top = stack[SUTLVectorSize(stack) - 1];
+
+                if (c == (state == SUTLJsonFirstKey ? '}' : ']'))
+                {
+                    idx++;
+                    (*nodes)[top].End = (uint32_t)SUTLVectorSize(*nodes);
+                    SUTLVectorSize(stack)--;
+
+                    state = SUTLJsonAfterValue;
+                    continue;
+                }
+
+                (*nodes)[top].Size += state == SUTLJsonFirstElement;
+                state = state == SUTLJsonFirstKey ? SUTLJsonKey : SUTLJsonValue;
+
+                continue;
+            }
+
+            if (idx == count)
+                SUTLJsonFail("Unexpected end of JSON input.", json.Size)
+
+            idx++;
+
+            if (state == SUTLJsonKey && c != '"')
+                SUTLJsonFail("Expected a string key in JSON object.", *offset)
+
+            node.Type = SUTL_JSON_NULL;
+            node.Escaped = 0;
+            node.Size = 0;
+            node.End = (uint32_t)SUTLVectorSize(*nodes) + 1;
+
+            if (c == '{' || c == '[')
+            {
+                if (SUTLVectorSize(stack) == SUTL_JSON_MAX_DEPTH)
+                    SUTLJsonFail("JSON nesting is too deep.", *offset)
+
+                node.Type = c == '{' ? SUTL_JSON_OBJECT : SUTL_JSON_ARRAY;
+                node.Value.Int = 0;
+
+                stack[SUTLVectorSize(stack)++] = SUTLVectorSize(*nodes);
+                SUTLJsonPushNode()
+
+                state = c == '{' ? SUTLJsonFirstKey : SUTLJsonFirstElement;
+                continue;
+            }
+
+            if (c == '"')
+            {
+                /*
+                 * The next entry of the index is always the closing quote.
+                 */
+                const char * close = json.Data + index[idx++];
+
+                node.Type = SUTL_JSON_STRING;
+                node.Value.String.Data = p + 1;
+                node.Value.String.Size = (size_t)(close - p - 1);
+                node.Escaped = SHRN_MEMCHR(p + 1, '\\', node.Value.String.Size) != NULL;
+
+                SUTLJsonPushNode()
+
+                if (state == SUTLJsonKey)
+                {
+                    (*nodes)[stack[SUTLVectorSize(stack) - 1]].Size++;
+
+                    if (idx == count || json.Data[index[idx]] != ':')
+                        SUTLJsonFail("Expected ':' after key in JSON object.", idx < count ? index[idx] : json.Size)
+
+                    idx++;
+                    state = SUTLJsonValue;
+                }
+                else
+                {
+                    state = SUTLJsonAfterValue;
+                }
+
+                continue;
+            }
+
+            if (c == '}' || c == ']' || c == ',' || c == ':')
+                SUTLJsonFail("Unexpected character in JSON.", *offset)
+
+            if ((error = SUTL_InternalJsonScalar(p, end, &node)))
+                break;
+
+            SUTLJsonPushNode()
+            state = SUTLJsonAfterValue;
+        }
+
+        #undef SUTLJsonFail
+        #undef SUTLJsonPushNode
+
+        SUTLVectorFree(stack);
+
+        return error;
+    }
+
+    SUTLJsonDocument SUTL_InternalJsonParse(SUTLStringView json)
+    {
+        SUTLJsonDocument doc;
+
+        doc.Error = NULL;
+        doc.ErrorOffset = 0;
+        doc.Nodes = SUTLVectorNew(SUTLJsonNode);
+        doc.Index = SUTLVectorNew(uint32_t);
+
+        SUTL_InternalJsonReparse(&doc, json);
+
+        return doc;
+    }
+
+    int SUTL_InternalJsonReparse(SUTLJsonDocument * doc, SUTLStringView json)
+    {
+        doc->Error = NULL;
+        doc->ErrorOffset = 0;
+
+        SUTLVectorResize(doc->Nodes, 0);
+        SUTLVectorResize(doc->Index, 0);
+
+        if (json.Size >= (size_t)0xFFFFFFFFUL)
+        {
+            doc->Error = "JSON input is too large.";
+        }
+        else
+        {
+            /*
+             * Reserve for a typical density of about one node for every 8 bytes.
+             */
+            if (SUTLVectorCapacity(doc->Index) < json.Size / 4 + 64)
+                SUTLVectorReserve(doc->Index, json.Size / 4 + 64);
+
+            if (SUTLVectorCapacity(doc->Nodes) < json.Size / 8 + 16)
+                SUTLVectorReserve(doc->Nodes, json.Size / 8 + 16);
+
+            doc->Error = SUTL_InternalJsonIndex(json, &doc->Index, &doc->ErrorOffset);
+
+            if (!doc->Error)
+                doc->Error = SUTL_InternalJsonTape(json, doc->Index, &doc->Nodes, &doc->ErrorOffset);
+        }
+
+        if (doc->Error)
+        {
+            SUTLErrorHandler(doc->Error);
+            SUTLVectorResize(doc->Nodes, 0);
+
+            return 0;
+        }
+
+        return 1;
+    }
+
+    size_t SUTL_InternalJsonGet(const SUTLJsonDocument * doc, size_t i, const char * ptr, size_t size)
+    {
+        const SUTLJsonNode * nodes = doc->Nodes;
+        size_t key;
+
+        if (i >= SUTLVectorSize(nodes) || nodes[i].Type != SUTL_JSON_OBJECT)
+            return SUTL_JSON_NONE;
+
+        for (key = i + 1; key < nodes[i].End; key = nodes[key + 1].End)
+        {
+            if (nodes[key].Value.String.Size == size && SHRN_MEMCMP(nodes[key].Value.String.Data, ptr, size) == 0)
+                return key + 1;
+        }
+
+        return SUTL_JSON_NONE;
+    }
+
+    size_t SUTL_InternalJsonAt(const SUTLJsonDocument * doc, size_t i, size_t at)
+    {
+        const SUTLJsonNode * nodes = doc->Nodes;
+        size_t elem;
+
+        if (i >= SUTLVectorSize(nodes) || nodes[i].Type != SUTL_JSON_ARRAY || at >= nodes[i].Size)
+            return SUTL_JSON_NONE;
+
+        /*
+         * The elements of an array of scalars are consecutive nodes.
+         */
+        if (nodes[i].End - i - 1 == nodes[i].Size)
+            return i + 1 + at;
+
+        for (elem = i + 1; at; at--)
+            elem = nodes[elem].End;
+
+        return elem;
+    }
+
+    int SUTL_InternalJsonHex(const char * p, unsigned long * out)
+    {
+        int k;
+
+        *out = 0;
+
+        for (k = 0; k < 4; k++)
+        {
+            char c = p[k];
+
+            if (c >= '0' && c <= '9')
+                *out = *out * 16 + (unsigned long)(c - '0');
+            else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+                *out = *out * 16 + (unsigned long)((c | 0x20) - 'a' + 10);
+            else
+                return 0;
+        }
+
+        return 1;
+    }
+
+    int SUTL_InternalJsonUnescape(SUTLStringView view, SUTLString * str)
+    {
+        const char * p = view.Data;
+        const char * end = view.Data + view.Size;
+        const char * backslash;
+        unsigned long code, low;
+        int valid = 1;
+        char utf8[4];
+        char c;
+
+        while (p != end)
+        {
+            /*
+             * Copy everything up to the next escape sequence at once.
+             */
+            backslash = (const char *)SHRN_MEMCHR(p, '\\', (size_t)(end - p));
+
+            if (!backslash)
+            {
+                SUTLStringAppendN(*str, p, (size_t)(end - p));
+                break;
+            }
+
+            SUTLStringAppendN(*str, p, (size_t)(backslash - p));
+            p = backslash + 1;
+
+            if (p == end)
+            {
+                valid = 0;
+                break;
+            }
+
+            switch (*p++)
+            {
+                case '"':  c = '"';  break;
+                case '\\': c = '\\'; break;
+                case '/':  c = '/';  break;
+                case 'b':  c = '\b'; break;
+                case 'f':  c = '\f'; break;
+                case 'n':  c = '\n'; break;
+                case 'r':  c = '\r'; break;
+                case 't':  c = '\t'; break;
+
+                case 'u':
+                    if (end - p < 4 || !SUTL_InternalJsonHex(p, &code))
+                    {
+                        valid = 0;
+                        break;
+                    }
+
+                    p += 4;
+
+                    /*
+                     * Characters outside the basic plane are written as a pair of surrogates.
+                     */
+                    if (code >= 0xD800 && code <= 0xDBFF)
+                    {
+                        if (end - p < 6 || p[0] != '\\' || p[1] != 'u' || !SUTL_InternalJsonHex(p + 2, &low) ||
+                            low < 0xDC00 || low > 0xDFFF)
+                        {
+                            valid = 0;
+                            break;
+                        }
+
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        p += 6;
+                    }
+                    else if (code >= 0xDC00 && code <= 0xDFFF)
+                    {
+                        valid = 0;
+                        break;
+                    }
+
+                    if (code < 0x80)
+                    {
+                        utf8[0] = (char)code;
+                        SUTLStringAppendN(*str, utf8, 1);
+                    }
+                    else if (code < 0x800)
+                    {
+                        utf8[0] = (char)(0xC0 | (code >> 6));
+                        utf8[1] = (char)(0x80 | (code & 0x3F));
+                        SUTLStringAppendN(*str, utf8, 2);
+                    }
+                    else if (code < 0x10000)
+                    {
+                        utf8[0] = (char)(0xE0 | (code >> 12));
+                        utf8[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+                        utf8[2] = (char)(0x80 | (code & 0x3F));
+                        SUTLStringAppendN(*str, utf8, 3);
+                    }
+                    else
+                    {
+                        utf8[0] = (char)(0xF0 | (code >> 18));
+                        utf8[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+                        utf8[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+                        utf8[3] = (char)(0x80 | (code & 0x3F));
+                        SUTLStringAppendN(*str, utf8, 4);
+                    }
+
+                    continue;
+
+                default:
+                    valid = 0;
+                    break;
+            }
+
+            if (!valid)
+                break;
+
+            SUTLStringAppendC(*str, c);
+        }
+
+        if (!valid)
+        {
+            SUTLErrorHandler("Invalid escape sequence in JSON string.");
+            return 0;
+        }
+
+        return 1;
+    }
+
+    SUTLHashmap SUTL_InternalJsonToHashmap(const SUTLJsonDocument * doc, size_t i)
+    {
+        SUTLHashmap hm = SUTLHashmapNew(SUTLStringView, size_t, SUTL_HASHFN(strview), SUTL_CMPFN(strview));
+        const SUTLJsonNode * nodes = doc->Nodes;
+        size_t key;
+
+        if (i >= SUTLVectorSize(nodes) || nodes[i].Type != SUTL_JSON_OBJECT)
+        {
+            SUTLErrorHandler("JSON value is not an object.");
+            return hm;
+        }
+
+        /*
+         * For duplicate names the last member wins, like in most JSON libraries.
+         */
+        for (key = i + 1; key < nodes[i].End; key = nodes[key + 1].End)
+            SUTLHashmapInsert(SUTLStringView, size_t, hm, nodes[key].Value.String, key + 1);
+
+        return hm;
+    }
+
+    int64_t * SUTL_InternalJsonToInts(const SUTLJsonDocument * doc, size_t i)
+    {
+        const SUTLJsonNode * nodes = doc->Nodes;
+        int64_t * v;
+        size_t k;
+
+        if (i >= SUTLVectorSize(nodes) || nodes[i].Type != SUTL_JSON_ARRAY || nodes[i].End - i - 1 != nodes[i].Size)
+        {
+            SUTLErrorHandler("JSON value is not an array of integers.");
+            return NULL;
+        }
+
+        for (k = i + 1; k < nodes[i].End; k++)
+        {
+            if (nodes[k].Type != SUTL_JSON_INT)
+            {
+                SUTLErrorHandler("JSON value is not an array of integers.");
+                return NULL;
+            }
+        }
+
+        v = SUTLVectorNew(int64_t);
+        SUTLVectorResize(v, nodes[i].Size);
+
+        for (k = 0; k < nodes[i].Size; k++)
+            v[k] = nodes[i + 1 + k].Value.Int;
+
+        return v;
+    }
+
+    double * SUTL_InternalJsonToDoubles(const SUTLJsonDocument * doc, size_t i)
+    {
+        const SUTLJsonNode * nodes = doc->Nodes;
+        double * v;
+        size_t k;
+
+        if (i >= SUTLVectorSize(nodes) || nodes[i].Type != SUTL_JSON_ARRAY || nodes[i].End - i - 1 != nodes[i].Size)
+        {
+            SUTLErrorHandler("JSON value is not an array of numbers.");
+            return NULL;
+        }
+
+        for (k = i + 1; k < nodes[i].End; k++)
+        {
+            if (nodes[k].Type != SUTL_JSON_INT && nodes[k].Type != SUTL_JSON_DOUBLE)
+            {
+                SUTLErrorHandler("JSON value is not an array of numbers.");
+                return NULL;
+            }
+        }
+
+        v = SUTLVectorNew(double);
+        SUTLVectorResize(v, nodes[i].Size);
+
+        for (k = 0; k < nodes[i].Size; k++)
+        {
+            const SUTLJsonNode * elem = &nodes[i + 1 + k];
+            v[k] = elem->Type == SUTL_JSON_INT ? (double)elem->Value.Int : elem->Value.Double;
+        }
+
+        return v;
+    }
+
+    SUTLString * SUTL_InternalJsonToStrings(const SUTLJsonDocument * doc, size_t i)
+    {
+        const SUTLJsonNode * nodes = doc->Nodes;
+        SUTLString * v;
+        SUTLString str;
+        size_t k;
+
+        if (i >= SUTLVectorSize(nodes) || nodes[i].Type != SUTL_JSON_ARRAY || nodes[i].End - i - 1 != nodes[i].Size)
+        {
+            SUTLErrorHandler("JSON value is not an array of strings.");
+            return NULL;
+        }
+
+        for (k = i + 1; k < nodes[i].End; k++)
+        {
+            if (nodes[k].Type != SUTL_JSON_STRING)
+            {
+                SUTLErrorHandler("JSON value is not an array of strings.");
+                return NULL;
+            }
+        }
+
+        v = SUTLVectorNew(SUTLString);
+        SUTLVectorReserve(v, nodes[i].Size);
+
+        for (k = i + 1; k < nodes[i].End; k++)
+        {
+            str = SUTLStringNew();
+
+            if (nodes[k].Escaped)
+                SUTL_InternalJsonUnescape(nodes[k].Value.String, &str);
+            else
+                SUTLStringAppendN(str, nodes[k].Value.String.Data, nodes[k].Value.String.Size);
+
+            SUTLVectorPush(v, str);
+        }
+
+        return v;
+    }
+#endif
+
+#endif
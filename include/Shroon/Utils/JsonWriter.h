@@ -0,0 +1,586 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_JSON_WRITER_H
+#define SUTL_JSON_WRITER_H
+
+#include "Common.h"
+#include "Vector.h"
+#include "String.h"
+#include "Writer.h"
+#include "Swar.h"
+
+/**
+ * @defgroup JsonWriter
+ * A streaming JSON writer which builds output in a \p SUTLString and hands it to a \p SUTLWriter
+ * in chunks, so a document never has to be held in memory at once.
+ *
+ * Separators are inserted automatically from a stack of open arrays and objects. Strings are
+ * scanned 8 bytes at a time for characters which need escaping and copied in runs, and numbers are
+ * formatted directly into the buffer. Several values written at the top level are separated by
+ * newlines, which produces JSON Lines.
+ * @{
+ */
+
+/**
+ * @brief The default number of buffered bytes after which a \p SUTLJsonWriter hands its buffer to
+ * its \p SUTLWriter.
+ */
+#ifndef SUTL_JSON_WRITER_FLUSH_SIZE
+    #define SUTL_JSON_WRITER_FLUSH_SIZE (16 << 10)
+#endif
+
+/**
+ * @brief It contains the state of a particular JSON writer instance.
+ */
+typedef struct SUTLJsonWriter
+{
+    /**
+     * @brief The \p SUTLWriter which receives the output, or \p NULL to keep the whole output in
+     * \p Buffer.
+     */
+    SUTLWriter * Out;
+
+    /**
+     * @brief The output which wasn't handed to \p Out yet.
+     */
+    SUTLString Buffer;
+
+    /**
+     * @brief The number of buffered bytes after which the buffer is handed to \p Out.
+     */
+    size_t FlushSize;
+
+    /**
+     * @brief 1 if the writer was misused or writing to \p Out failed. Everything written after an
+     * error is ignored.
+     */
+    int Error;
+
+    /**
+     * @brief Don't access this directly. 1 if a key was written and its value wasn't.
+     */
+    int AfterKey;
+
+    /**
+     * @brief Don't access this directly. The character to write before the next key or value, or
+     * 0.
+     */
+    char Separator;
+
+    /**
+     * @brief Don't access this directly. A vector with one \p uint8_t for each open container, 1
+     * for objects and 0 for arrays.
+     */
+    uint8_t * Stack;
+} SUTLJsonWriter;
+
+/**
+ * @brief Creates a new \p SUTLJsonWriter.
+ *
+ * @param out A <tt>SUTLWriter *</tt> to write to, or \p NULL to keep the output in \p Buffer.
+ *
+ * @return A \p SUTLJsonWriter created according to the parameters given.
+ */
+#define SUTLJsonWriterNew(out)                  SUTL_InternalJsonWriterNew(out)
+
+/**
+ * @brief Frees a \p SUTLJsonWriter which was created using \p SUTLJsonWriterNew. Data which
+ * wasn't flushed is discarded, and the \p SUTLWriter isn't freed.
+ *
+ * @param jw The \p SUTLJsonWriter to free.
+ */
+#define SUTLJsonWriterFree(jw)                  (SUTLVectorFree((jw).Stack), SUTLStringFree((jw).Buffer))
+
+/**
+ * @brief Opens an object.
+ *
+ * @param jw The \p SUTLJsonWriter to write to.
+ *
+ * @return 1 on success, otherwise 0.
+ */
+#define SUTLJsonWriterBeginObject(jw)           SUTL_InternalJsonWriterBegin(&jw, 1)
+
+/**
+ * @brief Closes the innermost object.
+ *
+ * @param jw The \p SUTLJsonWriter to write to.
+ *
+ * @return 1 on success, otherwise 0.
+ */
+#define SUTLJsonWriterEndObject(jw)             SUTL_InternalJsonWriterEnd(&jw, 1)
+
+/**
+ * @brief Opens an array.
+ *
+ * @param jw The \p SUTLJsonWriter to write to.
+ *
+ * @return 1 on success, otherwise 0.
+ */
+#define SUTLJsonWriterBeginArray(jw)            SUTL_InternalJsonWriterBegin(&jw, 0)
+
+/**
+ * @brief Closes the innermost array.
+ *
+ * @param jw The \p SUTLJsonWriter to write to.
+ *
+ * @return 1 on success, otherwise 0.
+ */
+#define SUTLJsonWriterEndArray(jw)              SUTL_InternalJsonWriterEnd(&jw, 0)
+
+/**
+ * @brief Writes the key of the next member of the innermost object.
+ *
+ * @param jw The \p SUTLJsonWriter to write to.
+ * @param key The \p SUTLStringView of the key. It is escaped as needed.
+ *
+ * @return 1 on success, otherwise 0.
+ */
+#define SUTLJsonWriterKey(jw, key)              SUTL_InternalJsonWriterKey(&jw, (key).Data, (key).Size)
+
+/**
+ * @brief Writes the key of the next member of the innermost object.
+ *
+ * @param jw The \p SUTLJsonWriter to write to.
+ * @param ptr The null-terminated key. It is escaped as needed.
+ *
+ * @return 1 on success, otherwise 0.
+ */
+#define SUTLJsonWriterKeyP(jw, ptr)             SUTL_InternalJsonWriterKey(&jw, ptr, SHRN_STRLEN(ptr))
+
+/**
+ * @brief Writes a string value.
+ *
+ * @param jw The \p SUTLJsonWriter to write to.
+ * @param view The \p SUTLStringView to write. It is escaped as needed.
+ *
+ * @return 1 on success, otherwise 0.
+ */
+#define SUTLJsonWriterString(jw, view)          SUTL_InternalJsonWriterString(&jw, (view).Data, (view).Size)
+
+/**
+ * @brief Writes a string value.
+ *
+ * @param jw The \p SUTLJsonWriter to write to.
+ * @param ptr The null-terminated string to write. It is escaped as needed.
+ *
+ * @return 1 on success, otherwise 0.
+ */
+#define SUTLJsonWriterStringP(jw, ptr)          SUTL_InternalJsonWriterString(&jw, ptr, SHRN_STRLEN(ptr))
+
+/**
+ * @brief Writes an integer value.
+ *
+ * @param jw The \p SUTLJsonWriter to write to.
+ * @param value The \p int64_t to write.
+ *
+ * @return 1 on success, otherwise 0.
+ */
+#define SUTLJsonWriterInt(jw, value)            SUTL_InternalJsonWriterInt(&jw, value)
+
+/**
+ * @brief Writes a number value in its shortest form which reads back as the same \p double.
+ * Infinities and NaN, which JSON can't represent, are written as \p null.
+ *
+ * @param jw The \p SUTLJsonWriter to write to.
+ * @param value The \p double to write.
+ *
+ * @return 1 on success, otherwise 0.
+ */
+#define SUTLJsonWriterDouble(jw, value)         SUTL_InternalJsonWriterDouble(&jw, value)
+
+/**
+ * @brief Writes \p true or \p false.
+ *
+ * @param jw The \p SUTLJsonWriter to write to.
+ * @param value The value to write. Any value other than 0 is \p true.
+ *
+ * @return 1 on success, otherwise 0.
+ */
+#define SUTLJsonWriterBool(jw, value)           SUTL_InternalJsonWriterRaw(&jw, (value) ? "true" : "false", (value) ? 4 : 5)
+
+/**
+ * @brief Writes \p null.
+ *
+ * @param jw The \p SUTLJsonWriter to write to.
+ *
+ * @return 1 on success, otherwise 0.
+ */
+#define SUTLJsonWriterNull(jw)                  SUTL_InternalJsonWriterRaw(&jw, "null", 4)
+
+/**
+ * @brief Hands all buffered output to the \p SUTLWriter. It doesn't flush the \p SUTLWriter
+ * itself. Does nothing if the writer has no \p SUTLWriter.
+ *
+ * @param jw The \p SUTLJsonWriter to flush.
+ *
+ * @return 1 on success, otherwise 0.
+ */
+#define SUTLJsonWriterFlush(jw)                 SUTL_InternalJsonWriterFlush(&jw)
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+SUTLJsonWriter SUTL_InternalJsonWriterNew(SUTLWriter * out);
+int SUTL_InternalJsonWriterBegin(SUTLJsonWriter * jw, int object);
+int SUTL_InternalJsonWriterEnd(SUTLJsonWriter * jw, int object);
+int SUTL_InternalJsonWriterKey(SUTLJsonWriter * jw, const char * ptr, size_t size);
+int SUTL_InternalJsonWriterString(SUTLJsonWriter * jw, const char * ptr, size_t size);
+int SUTL_InternalJsonWriterInt(SUTLJsonWriter * jw, int64_t value);
+int SUTL_InternalJsonWriterDouble(SUTLJsonWriter * jw, double value);
+int SUTL_InternalJsonWriterRaw(SUTLJsonWriter * jw, const char * ptr, size_t size);
+int SUTL_InternalJsonWriterFlush(SUTLJsonWriter * jw);
+
+int SUTL_InternalJsonWriterFail(SUTLJsonWriter * jw, const char * msg);
+int SUTL_InternalJsonWriterValue(SUTLJsonWriter * jw);
+void SUTL_InternalJsonWriterDone(SUTLJsonWriter * jw);
+char * SUTL_InternalJsonWriterRoom(SUTLJsonWriter * jw, size_t size);
+void SUTL_InternalJsonWriterEscape(SUTLJsonWriter * jw, const char * ptr, size_t size);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    SUTLJsonWriter SUTL_InternalJsonWriterNew(SUTLWriter * out)
+    {
+        SUTLJsonWriter jw;
+
+        /*
+         * Initialize the members of `jw`.
+         */
+        jw.Out = out;
+        jw.Buffer = SUTLStringNew();
+        jw.FlushSize = SUTL_JSON_WRITER_FLUSH_SIZE;
+        jw.Error = 0;
+        jw.AfterKey = 0;
+        jw.Separator = 0;
+        jw.Stack = SUTLVectorNew(uint8_t);
+
+        SUTLVectorReserve(jw.Buffer, SUTL_JSON_WRITER_FLUSH_SIZE);
+
+        return jw;
+    }
+
+    int SUTL_InternalJsonWriterFail(SUTLJsonWriter * jw, const char * msg)
+    {
+        SUTLErrorHandler(msg);
+
+        jw->Error = 1;
+
+        return 0;
+    }
+
+    int SUTL_InternalJsonWriterFlush(SUTLJsonWriter * jw)
+    {
+        if (jw->Error)
+            return 0;
+
+        if (!jw->Out || !SUTLStringSize(jw->Buffer))
+            return 1;
+
+        if (!SUTLWriterAppendN(*jw->Out, jw->Buffer, SUTLStringSize(jw->Buffer)))
+        {
+            jw->Error = 1;
+            return 0;
+        }
+
+        SUTLStringSize(jw->Buffer) = 0;
+
+        return 1;
+    }
+
+    char * SUTL_InternalJsonWriterRoom(SUTLJsonWriter * jw, size_t size)
+    {
+        size_t used = SUTLStringSize(jw->Buffer);
+
+        /*
+         * Hand the buffer over once it is full enough, so it is reused instead of growing. Without
+         * a `SUTLWriter` it grows geometrically.
+         */
+        if (jw->Out && used && used + size > jw->FlushSize)
+        {
+            SUTL_InternalJsonWriterFlush(jw);
+            used = SUTLStringSize(jw->Buffer);
+        }
+
+        if (used + size > SUTLVectorCapacity(jw->Buffer))
+            SUTLVectorReserve(jw->Buffer, (used + size) * 2);
+
+        return jw->Buffer + used;
+    }
+
+    int SUTL_InternalJsonWriterValue(SUTLJsonWriter * jw)
+    {
+        size_t depth = SUTLVectorSize(jw->Stack);
+
+        if (jw->Error)
+            return 0;
+
+        if (jw->AfterKey)
+        {
+            jw->AfterKey = 0;
+            return 1;
+        }
+
+        if (depth && jw->Stack[depth - 1])
+            return SUTL_InternalJsonWriterFail(jw, "Expected a key before a value in JSON object.");
+
+        if (jw->Separator)
+        {
+            *SUTL_InternalJsonWriterRoom(jw, 1) = jw->Separator;
+            SUTLStringSize(jw->Buffer)++;
+        }
+
+        return 1;
+    }
+
+    void SUTL_InternalJsonWriterDone(SUTLJsonWriter * jw)
+    {
+        jw->Separator = SUTLVectorSize(jw->Stack) ? ',' : '\n';
+    }
+
+    int SUTL_InternalJsonWriterBegin(SUTLJsonWriter * jw, int object)
+    {
+        uint8_t kind = (uint8_t)object;
+
+        if (!SUTL_InternalJsonWriterValue(jw))
+            return 0;
+
+        SUTLVectorPush(jw->Stack, kind);
+
+        *SUTL_InternalJsonWriterRoom(jw, 1) = object ? '{' : '[';
+        SUTLStringSize(jw->Buffer)++;
+
+        jw->Separator = 0;
+
+        return 1;
+    }
+
+    int SUTL_InternalJsonWriterEnd(SUTLJsonWriter * jw, int object)
+    {
+        size_t depth = SUTLVectorSize(jw->Stack);
+
+        if (jw->Error)
+            return 0;
+
+        if (!depth || jw->Stack[depth - 1] != (uint8_t)object)
+            return SUTL_InternalJsonWriterFail(jw, object ? "No JSON object to end." : "No JSON array to end.");
+
+        if (jw->AfterKey)
+            return SUTL_InternalJsonWriterFail(jw, "Expected a value after key in JSON object.");
+
+        SUTLVectorSize(jw->Stack)--;
+
+        *SUTL_InternalJsonWriterRoom(jw, 1) = object ? '}' : ']';
+        SUTLStringSize(jw->Buffer)++;
+
+        SUTL_InternalJsonWriterDone(jw);
+
+        return 1;
+    }
+
+    void SUTL_InternalJsonWriterEscape(SUTLJsonWriter * jw, const char * ptr, size_t size)
+    {
+        static const char hex[] = "0123456789abcdef";
+
+        const unsigned char * p = (const unsigned char *)ptr;
+        const unsigned char * end = p + size;
+        const unsigned char * stop;
+        char * out;
+        uint64_t w;
+        unsigned mask, n;
+
+        out = SUTL_InternalJsonWriterRoom(jw, 1);
+        *out = '"';
+        SUTLStringSize(jw->Buffer)++;
+
+        while (p < end)
+        {
+            /*
+             * Work in chunks whose worst case, every byte becoming a 6 byte \u escape, fits in the
+             * room made for them.
+             */
+            stop = end - p > 4096 ? p + 4096 : end;
+            out = SUTL_InternalJsonWriterRoom(jw, (size_t)(stop - p) * 6 + 1);
+
+            while (p < stop)
+            {
+                /*
+                 * Copy 8 bytes at once while none of them is a quote, a backslash or a control
+                 * character, then copy up to the first one which is.
+                 */
+                if (stop - p >= 8)
+                {
+                    SUTL_SWAR_LOAD(w, p);
+
+                    mask = SUTL_SWAR_EQ(w, '"') | SUTL_SWAR_EQ(w, '\\') | SUTL_SWAR_LESS(w, 0x20);
+
+                    if (!mask)
+                    {
+                        SHRN_MEMCPY(out, p, 8);
+                        out += 8;
+                        p += 8;
+                        continue;
+                    }
+
+                    n = SUTL_CTZ64(mask);
+
+                    SHRN_MEMCPY(out, p, n);
+                    out += n;
+                    p += n;
+                }
+                else if (*p != '"' && *p != '\\' && *p >= 0x20)
+                {
+                    *out++ = (char)*p++;
+                    continue;
+                }
+
+                *out++ = '\\';
+
+                switch (*p)
+                {
+                    case '"':
+                    case '\\':
+                        *out++ = (char)*p;
+                        break;
+
+                    case '\b':
+                        *out++ = 'b';
+                        break;
+
+                    case '\f':
+                        *out++ = 'f';
+                        break;
+
+                    case '\n':
+                        *out++ = 'n';
+                        break;
+
+                    case '\r':
+                        *out++ = 'r';
+                        break;
+
+                    case '\t':
+                        *out++ = 't';
+                        break;
+
+                    default:
+                        *out++ = 'u';
+                        *out++ = '0';
+                        *out++ = '0';
+                        *out++ = hex[*p >> 4];
+                        *out++ = hex[*p & 15];
+                }
+
+                p++;
+            }
+
+            SUTLStringSize(jw->Buffer) = (size_t)(out - jw->Buffer);
+        }
+
+        out = SUTL_InternalJsonWriterRoom(jw, 1);
+        *out = '"';
+        SUTLStringSize(jw->Buffer)++;
+    }
+
+    int SUTL_InternalJsonWriterKey(SUTLJsonWriter * jw, const char * ptr, size_t size)
+    {
+        size_t depth = SUTLVectorSize(jw->Stack);
+
+        if (jw->Error)
+            return 0;
+
+        if (!depth || !jw->Stack[depth - 1] || jw->AfterKey)
+            return SUTL_InternalJsonWriterFail(jw, "Unexpected key outside of JSON object.");
+
+        if (jw->Separator)
+        {
+            *SUTL_InternalJsonWriterRoom(jw, 1) = jw->Separator;
+            SUTLStringSize(jw->Buffer)++;
+        }
+
+        SUTL_InternalJsonWriterEscape(jw, ptr, size);
+
+        *SUTL_InternalJsonWriterRoom(jw, 1) = ':';
+        SUTLStringSize(jw->Buffer)++;
+
+        jw->AfterKey = 1;
+
+        return 1;
+    }
+
+    int SUTL_InternalJsonWriterString(SUTLJsonWriter * jw, const char * ptr, size_t size)
+    {
+        if (!SUTL_InternalJsonWriterValue(jw))
+            return 0;
+
+        SUTL_InternalJsonWriterEscape(jw, ptr, size);
+        SUTL_InternalJsonWriterDone(jw);
+
+        return 1;
+    }
+
+    int SUTL_InternalJsonWriterInt(SUTLJsonWriter * jw, int64_t value)
+    {
+        char * out;
+
+        if (!SUTL_InternalJsonWriterValue(jw))
+            return 0;
+
+        out = SUTL_InternalJsonWriterRoom(jw, SUTL_STRING_NUMBER_MAX);
+        SUTLStringSize(jw->Buffer) += SUTL_InternalFormatInt(out, value);
+
+        SUTL_InternalJsonWriterDone(jw);
+
+        return 1;
+    }
+
+    int SUTL_InternalJsonWriterDouble(SUTLJsonWriter * jw, double value)
+    {
+        char * out;
+
+        if (value != value || value > 1.7976931348623157e308 || value < -1.7976931348623157e308)
+            return SUTL_InternalJsonWriterRaw(jw, "null", 4);
+
+        if (!SUTL_InternalJsonWriterValue(jw))
+            return 0;
+
+        out = SUTL_InternalJsonWriterRoom(jw, SUTL_STRING_NUMBER_MAX);
+        SUTLStringSize(jw->Buffer) += SUTL_InternalFormatDouble(out, value);
+
+        SUTL_InternalJsonWriterDone(jw);
+
+        return 1;
+    }
+
+    int SUTL_InternalJsonWriterRaw(SUTLJsonWriter * jw, const char * ptr, size_t size)
+    {
+        if (!SUTL_InternalJsonWriterValue(jw))
+            return 0;
+
+        SHRN_MEMCPY(SUTL_InternalJsonWriterRoom(jw, size), ptr, size);
+        SUTLStringSize(jw->Buffer) += size;
+
+        SUTL_InternalJsonWriterDone(jw);
+
+        return 1;
+    }
+#endif
+
+#endif
@@ -0,0 +1,290 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_LINE_READER_H
+#define SUTL_LINE_READER_H
+
+#include "Common.h"
+#include "Vector.h"
+#include "String.h"
+#include "System.h"
+
+/**
+ * @defgroup LineReader
+ * A streaming reader which splits the data of a file descriptor into lines.
+ *
+ * Data is read into one large buffer, and lines are returned as \p SUTLStringView s pointing into
+ * it, so no line is copied. When a line spans the end of the buffer only that partial line is
+ * moved to the start before refilling, and the buffer only grows for lines longer than itself.
+ * Newlines are found with \p SHRN_MEMCHR, which is vectorized by most C libraries.
+ * @{
+ */
+
+/**
+ * @brief The default size of the buffer of a \p SUTLLineReader in bytes.
+ */
+#ifndef SUTL_LINE_READER_BUFFER_SIZE
+    #define SUTL_LINE_READER_BUFFER_SIZE (1 << 20)
+#endif
+
+/**
+ * @brief It contains the state of a particular line reader instance.
+ */
+typedef struct SUTLLineReader
+{
+    /**
+     * @brief The file descriptor to read from.
+     */
+    int Fd;
+
+    /**
+     * @brief 1 if reading failed. The lines read so far are still valid.
+     */
+    int Error;
+
+    /**
+     * @brief 1 once the end of the file has been reached.
+     */
+    int Eof;
+
+    /**
+     * @brief The number of bytes read from \p Fd.
+     */
+    uint64_t BytesRead;
+
+    /**
+     * @brief The number of lines returned.
+     */
+    uint64_t LineCount;
+
+    /**
+     * @brief The time at which the reader was created, in seconds.
+     */
+    double StartTime;
+
+    /**
+     * @brief Don't access this directly. The offset of the first unread byte in \p Buffer.
+     */
+    size_t Begin;
+
+    /**
+     * @brief Don't access this directly. The offset after the last byte read into \p Buffer.
+     */
+    size_t End;
+
+    /**
+     * @brief Don't access this directly. A vector of \p char whose size is the buffer size.
+     */
+    char * Buffer;
+} SUTLLineReader;
+
+/**
+ * @brief Creates a new \p SUTLLineReader which reads from \p fd.
+ *
+ * @param fd The file descriptor to read from. It isn't closed by the reader.
+ * @param size The size of the buffer in bytes. If it is 0, \p SUTL_LINE_READER_BUFFER_SIZE is used.
+ *
+ * @return A \p SUTLLineReader created according to the parameters given.
+ */
+#define SUTLLineReaderNew(fd, size)             SUTL_InternalLineReaderNew(fd, size)
+
+/**
+ * @brief Frees a \p SUTLLineReader which was created using \p SUTLLineReaderNew.
+ *
+ * @param lr The \p SUTLLineReader to free.
+ */
+#define SUTLLineReaderFree(lr)                  SUTLVectorFree((lr).Buffer)
+
+/**
+ * @brief Reads the next line from \p lr.
+ *
+ * The line doesn't include the newline character. A last line without a newline at the end of the
+ * file is returned as well.
+ *
+ * @param lr The \p SUTLLineReader to read from.
+ * @param line The \p SUTLStringView to store the line in. It is valid until the next call.
+ *
+ * @return 1 if a line was read. 0 at the end of the file or if reading failed, in which case an
+ * error is reported and \p Error is set.
+ */
+#define SUTLLineReaderNext(lr, line)            SUTL_InternalLineReaderNext(&lr, &line)
+
+/**
+ * @brief Executes \p expr for each remaining line of \p lr.
+ *
+ * @param lr The \p SUTLLineReader to read from.
+ * @param name The name of the \p SUTLStringView in which the current line will be stored.
+ * @param expr The code block to execute for each line.
+ */
+#define SUTLLineReaderEach(lr, name, expr) \
+    {\
+        SUTLStringView name;\
+        while (SUTL_InternalLineReaderNext(&lr, &name))\
+        {\
+            expr\
+        }\
+    }
+
+/**
+ * @brief Gets the read throughput of \p lr since it was created.
+ *
+ * @param lr The \p SUTLLineReader.
+ *
+ * @return The throughput in gigabytes (10^9 bytes) per second.
+ */
+#define SUTLLineReaderThroughput(lr)            SUTL_InternalLineReaderThroughput(&lr)
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+SUTLLineReader SUTL_InternalLineReaderNew(int fd, size_t size);
+int SUTL_InternalLineReaderNext(SUTLLineReader * lr, SUTLStringView * line);
+double SUTL_InternalLineReaderThroughput(const SUTLLineReader * lr);
+
+int SUTL_InternalLineReaderFill(SUTLLineReader * lr);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    SUTLLineReader SUTL_InternalLineReaderNew(int fd, size_t size)
+    {
+        SUTLLineReader lr;
+
+        /*
+         * Initialize the members of `lr`.
+         */
+        lr.Fd = fd;
+        lr.Error = 0;
+        lr.Eof = 0;
+        lr.BytesRead = 0;
+        lr.LineCount = 0;
+        lr.StartTime = SHRN_NOW();
+        lr.Begin = 0;
+        lr.End = 0;
+        lr.Buffer = SUTLVectorNew(char);
+
+        SUTLVectorResize(lr.Buffer, size ? size : SUTL_LINE_READER_BUFFER_SIZE);
+
+        return lr;
+    }
+
+    int SUTL_InternalLineReaderFill(SUTLLineReader * lr)
+    {
+        size_t size = SUTLVectorSize(lr->Buffer);
+        long count;
+
+        /*
+         * Move the partial line to the start of the buffer, or grow the buffer if the partial line
+         * already fills it.
+         */
+        if (lr->Begin)
+        {
+            SHRN_MEMMOVE(lr->Buffer, lr->Buffer + lr->Begin, lr->End - lr->Begin);
+
+            lr->End -= lr->Begin;
+            lr->Begin = 0;
+        }
+        else if (lr->End == size)
+        {
+            SUTLVectorResize(lr->Buffer, size * 2);
+            size *= 2;
+        }
+
+        do
+        {
+            count = (long)SHRN_READ(lr->Fd, lr->Buffer + lr->End, size - lr->End);
+        } while (SUTL_INTERRUPTED(count));
+
+        if (count < 0)
+        {
+            SUTLErrorHandler("Failed to read from file descriptor.");
+
+            lr->Error = 1;
+            lr->Eof = 1;
+
+            return 0;
+        }
+
+        if (!count)
+        {
+            lr->Eof = 1;
+            return 0;
+        }
+
+        lr->End += (size_t)count;
+        lr->BytesRead += (uint64_t)count;
+
+        return 1;
+    }
+
+    int SUTL_InternalLineReaderNext(SUTLLineReader * lr, SUTLStringView * line)
+    {
+        size_t scan = lr->Begin;
+        const char * newline;
+
+        for (;;)
+        {
+            /*
+             * Only the bytes which weren't searched before are searched after a refill.
+             */
+            newline = (const char *)SHRN_MEMCHR(lr->Buffer + scan, '\n', lr->End - scan);
+
+            if (newline)
+            {
+                line->Data = lr->Buffer + lr->Begin;
+                line->Size = (size_t)(newline - line->Data);
+
+                lr->Begin += line->Size + 1;
+                lr->LineCount++;
+
+                return 1;
+            }
+
+            scan = lr->End - lr->Begin;
+
+            if (lr->Eof || !SUTL_InternalLineReaderFill(lr))
+                break;
+        }
+
+        /*
+         * The last line may not end with a newline, but a partial line is only complete at the
+         * end of the file, not when reading failed.
+         */
+        if (lr->Error || lr->Begin == lr->End)
+            return 0;
+
+        line->Data = lr->Buffer + lr->Begin;
+        line->Size = lr->End - lr->Begin;
+
+        lr->Begin = lr->End;
+        lr->LineCount++;
+
+        return 1;
+    }
+
+    double SUTL_InternalLineReaderThroughput(const SUTLLineReader * lr)
+    {
+        double elapsed = SHRN_NOW() - lr->StartTime;
+
+        return elapsed > 0.0 ? (double)lr->BytesRead / elapsed * 1e-9 : 0.0;
+    }
+#endif
+
+#endif
@@ -0,0 +1,645 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_LZ_H
+#define SUTL_LZ_H
+
+#include "Common.h"
+#include "Vector.h"
+#include "String.h"
+#include "Swar.h"
+#include "Crc32c.h"
+
+/**
+ * @defgroup Lz
+ * A fast LZ77 compressor for byte buffers which writes the LZ4 block format.
+ *
+ * A block is a series of sequences. Each sequence is a token byte holding the literal length and
+ * the match length in its two halves, any extra length bytes, the literals, and a 2 byte little
+ * endian offset back to the match. Matches are found through a single hash table of positions
+ * with no chains, and positions without a match are skipped faster the longer no match is found,
+ * so incompressible data passes through quickly. Decompression is a plain loop of copies.
+ *
+ * A raw block doesn't record its own sizes. Frames do, and split large data into independent
+ * blocks of at most \p SUTL_LZ_BLOCK_SIZE bytes which can be written and read one at a time:
+ *
+ *             Part    |   Layout
+ *     ----------------+------------------------------------------------------------------------
+ *      Frame          |   magic \p SUTL_LZ_MAGIC, blocks, end mark
+ *      Block          |   stored size, raw size, CRC-32C of the raw data, data
+ *      End mark       |   a stored size of 0
+ *
+ * Sizes are 4 byte little endian integers. The high bit of the stored size is set when the data is
+ * stored uncompressed because compressing it didn't make it smaller. The checksum is verified when
+ * the block is decompressed.
+ * @{
+ */
+
+/**
+ * @brief The maximum number of bytes in each block of a frame.
+ */
+#ifndef SUTL_LZ_BLOCK_SIZE
+    #define SUTL_LZ_BLOCK_SIZE (4 << 20)
+#endif
+
+/**
+ * @brief The base 2 logarithm of the number of entries in the match finding hash table. The table
+ * lives on the stack and takes 4 bytes per entry.
+ */
+#ifndef SUTL_LZ_HASH_LOG
+    #define SUTL_LZ_HASH_LOG 12
+#endif
+
+/**
+ * @brief The first 4 bytes of a frame, "SLZ1" when read as little endian.
+ */
+#define SUTL_LZ_MAGIC 0x315A4C53UL
+
+/**
+ * @brief The largest number of bytes \p SUTLLzCompress can produce for \p size bytes of input.
+ *
+ * @param size The size of the input in bytes.
+ */
+#define SUTLLzBound(size)                       ((size) + (size) / 255 + 16)
+
+/**
+ * @brief Compresses \p size bytes at \p ptr into one raw block appended to \p out.
+ *
+ * @param ptr Pointer to the data.
+ * @param size The size of the data in bytes. It must be less than 2 GiB.
+ * @param out The \p SUTLString to append to.
+ *
+ * @return The number of bytes appended.
+ */
+#define SUTLLzCompress(ptr, size, out)          SUTL_InternalLzCompress(ptr, size, &out)
+
+/**
+ * @brief Decompresses a raw block of \p size bytes at \p ptr and appends the result to \p out.
+ *
+ * @param ptr Pointer to the block.
+ * @param size The size of the block in bytes.
+ * @param out The \p SUTLString to append to.
+ * @param rawsize The exact size of the decompressed data in bytes.
+ *
+ * @return 1 on success. If the block is corrupted or doesn't decompress to \p rawsize bytes, an
+ * error is reported, \p out is left unchanged and 0 is returned.
+ */
+#define SUTLLzDecompress(ptr, size, out, rawsize) SUTL_InternalLzDecompress(ptr, size, &out, rawsize)
+
+/**
+ * @brief Appends the start of a frame to \p out.
+ *
+ * @param out The \p SUTLString to append to.
+ */
+#define SUTLLzFrameBegin(out)                   SUTL_InternalLzPut32(&out, SUTL_LZ_MAGIC)
+
+/**
+ * @brief Appends the data at \p ptr to the frame in \p out, as one block or several if it is bigger
+ * than \p SUTL_LZ_BLOCK_SIZE. \p out may be handed to a writer and cleared between calls.
+ *
+ * @param out The \p SUTLString to append to.
+ * @param ptr Pointer to the data.
+ * @param size The size of the data in bytes.
+ */
+#define SUTLLzFrameBlock(out, ptr, size)        SUTL_InternalLzFrameBlock(&out, ptr, size)
+
+/**
+ * @brief Appends the end mark of a frame to \p out.
+ *
+ * @param out The \p SUTLString to append to.
+ */
+#define SUTLLzFrameEnd(out)                     SUTL_InternalLzPut32(&out, 0)
+
+/**
+ * @brief Appends a complete frame holding \p size bytes at \p ptr to \p out. For a vector \p v
+ * pass <tt>v, SUTLVectorSize(v) * sizeof(*v)</tt>.
+ *
+ * @param ptr Pointer to the data.
+ * @param size The size of the data in bytes.
+ * @param out The \p SUTLString to append to.
+ */
+#define SUTLLzFrameCompress(ptr, size, out) \
+    (SUTLLzFrameBegin(out), SUTLLzFrameBlock(out, ptr, size), SUTLLzFrameEnd(out))
+
+/**
+ * @brief Checks the magic of the frame in \p view and sets \p at to the offset of its first block.
+ *
+ * @param view The \p SUTLStringView of the frame.
+ * @param at A \p size_t variable to hold the read offset.
+ *
+ * @return 1 if \p view starts with a frame, otherwise an error is reported and 0 is returned.
+ */
+#define SUTLLzFrameOpen(view, at)               SUTL_InternalLzFrameOpen(view, &at)
+
+/**
+ * @brief Decompresses the block at offset \p at of the frame in \p view, appends it to \p out and
+ * advances \p at past it.
+ *
+ * @param view The \p SUTLStringView of the frame.
+ * @param at A \p size_t variable holding the read offset, set by \p SUTLLzFrameOpen.
+ * @param out The \p SUTLString to append to.
+ *
+ * @return 1 if a block was decompressed, 0 if the end mark was reached, or -1 if the frame is
+ * corrupted, in which case an error is reported.
+ */
+#define SUTLLzFrameNext(view, at, out)          SUTL_InternalLzFrameNext(view, &at, &out)
+
+/**
+ * @brief Decompresses the whole frame in \p view and appends the data to \p out.
+ *
+ * @param view The \p SUTLStringView of the frame.
+ * @param out The \p SUTLString to append to.
+ *
+ * @return 1 on success. If the frame is corrupted, an error is reported and 0 is returned. \p out
+ * then holds the blocks which were decompressed before the error.
+ */
+#define SUTLLzFrameDecompress(view, out)        SUTL_InternalLzFrameDecompress(view, &out)
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+size_t SUTL_InternalLzCompress(const void * ptr, size_t size, SUTLString * out);
+int SUTL_InternalLzDecompress(const void * ptr, size_t size, SUTLString * out, size_t rawsize);
+void SUTL_InternalLzFrameBlock(SUTLString * out, const void * ptr, size_t size);
+int SUTL_InternalLzFrameOpen(SUTLStringView view, size_t * at);
+int SUTL_InternalLzFrameNext(SUTLStringView view, size_t * at, SUTLString * out);
+int SUTL_InternalLzFrameDecompress(SUTLStringView view, SUTLString * out);
+
+void SUTL_InternalLzPut32(SUTLString * out, uint32_t value);
+uint32_t SUTL_InternalLzGet32(const char * ptr);
+size_t SUTL_InternalLzMatchLength(const uint8_t * p, const uint8_t * ref, const uint8_t * limit);
+uint8_t * SUTL_InternalLzPutLength(uint8_t * op, size_t length);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    #define SUTL_LZ_MIN_MATCH   4
+    #define SUTL_LZ_MAX_OFFSET  65535
+
+    /*
+     * A match must start at least this many bytes before the end of the input, and the last this
+     * many bytes are always literals. Both rules come from the LZ4 format.
+     */
+    #define SUTL_LZ_MF_LIMIT    12
+    #define SUTL_LZ_LAST_LITERALS 5
+
+    #define SUTL_LZ_HASH(v)     ((uint32_t)((v) * 2654435761UL) >> (32 - SUTL_LZ_HASH_LOG))
+
+    void SUTL_InternalLzPut32(SUTLString * out, uint32_t value)
+    {
+        char bytes[4];
+
+        bytes[0] = (char)(value & 0xFF);
+        bytes[1] = (char)(value >> 8 & 0xFF);
+        bytes[2] = (char)(value >> 16 & 0xFF);
+        bytes[3] = (char)(value >> 24 & 0xFF);
+
+        SUTLStringAppendN(*out, bytes, 4);
+    }
+
+    uint32_t SUTL_InternalLzGet32(const char * ptr)
+    {
+        const uint8_t * p = (const uint8_t *)ptr;
+
+        return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    }
+
+    size_t SUTL_InternalLzMatchLength(const uint8_t * p, const uint8_t * ref, const uint8_t * limit)
+    {
+        const uint8_t * start = p;
+        uint64_t a, b;
+
+        /*
+         * Compare 8 bytes at a time. Words are little endian, so the lowest differing bit is in the
+         * first differing byte.
+         */
+        while (limit - p >= 8)
+        {
+            SUTL_SWAR_LOAD(a, p);
+            SUTL_SWAR_LOAD(b, ref);
+
+            if (a != b)
+                return (size_t)(p - start) + SUTL_CTZ64(a ^ b) / 8;
+
+            p += 8;
+            ref += 8;
+        }
+
+        while (p < limit && *p == *ref)
+        {
+            p++;
+            ref++;
+        }
+
+        return (size_t)(p - start);
+    }
+
+    uint8_t * SUTL_InternalLzPutLength(uint8_t * op, size_t length)
+    {
+        while (length >= 255)
+        {
+            *op++ = 255;
+            length -= 255;
+        }
+
+        *op++ = (uint8_t)length;
+
+        return op;
+    }
+
+    size_t SUTL_InternalLzCompress(const void * ptr, size_t size, SUTLString * out)
+    {
+        uint32_t table[1 << SUTL_LZ_HASH_LOG];
+
+        const uint8_t * base = (const uint8_t *)ptr;
+        const uint8_t * ip = base;
+        const uint8_t * anchor = base;
+        const uint8_t * end = base + size;
+        const uint8_t * mflimit = size > SUTL_LZ_MF_LIMIT ? end - SUTL_LZ_MF_LIMIT : base;
+        const uint8_t * matchlimit = size > SUTL_LZ_LAST_LITERALS ? end - SUTL_LZ_LAST_LITERALS : base;
+        const uint8_t * ref;
+        uint8_t * start;
+        uint8_t * op;
+        uint8_t * token;
+        size_t used = SUTLStringSize(*out);
+        size_t literals, length, misses = 0;
+        uint32_t v, w, h;
+
+        /*
+         * The output is written directly, so it must not be shared.
+         */
+        SUTLStringMakeUnique(*out);
+
+        if (SUTLVectorCapacity(*out) < used + SUTLLzBound(size))
+            SUTLVectorReserve(*out, used + SUTLLzBound(size));
+
+        start = (uint8_t *)*out + used;
+        op = start;
+
+        SHRN_MEMSET(table, 0, sizeof(table));
+
+        while (ip < mflimit)
+        {
+            SHRN_MEMCPY(&v, ip, 4);
+
+            h = SUTL_LZ_HASH(v);
+            ref = base + table[h];
+            table[h] = (uint32_t)(ip - base);
+
+            SHRN_MEMCPY(&w, ref, 4);
+
+            if (ref >= ip || ip - ref > SUTL_LZ_MAX_OFFSET || v != w)
+            {
+                /*
+                 * Step further after every 64 misses in a row.
+                 */
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+
+            /*
+             * Extend the match backwards over literals and forwards as far as allowed.
+             */
+            while (ip > anchor && ref > base && ip[-1] == ref[-1])
+            {
+                ip--;
+                ref--;
+            }
+
+            length = SUTL_LZ_MIN_MATCH + SUTL_InternalLzMatchLength(ip + SUTL_LZ_MIN_MATCH, ref + SUTL_LZ_MIN_MATCH, matchlimit);
+            literals = (size_t)(ip - anchor);
+
+            /*
+             * Write the token, the literals, the offset and the rest of the match length.
+             */
+            token = op++;
+
+            if (literals >= 15)
+            {
+                *token = 15 << 4;
+                op = SUTL_InternalLzPutLength(op, literals - 15);
+            }
+            else
+            {
+                *token = (uint8_t)(literals << 4);
+            }
+
+            SHRN_MEMCPY(op, anchor, literals);
+            op += literals;
+
+            *op++ = (uint8_t)((ip - ref) & 0xFF);
+            *op++ = (uint8_t)((ip - ref) >> 8);
+
+            if (length - SUTL_LZ_MIN_MATCH >= 15)
+            {
+                *token |= 15;
+                op = SUTL_InternalLzPutLength(op, length - SUTL_LZ_MIN_MATCH - 15);
+            }
+            else
+            {
+                *token |= (uint8_t)(length - SUTL_LZ_MIN_MATCH);
+            }
+
+            ip += length;
+            anchor = ip;
+            misses = 0;
+
+            /*
+             * Record a position inside the match, which often starts the next one.
+             */
+            if (ip < mflimit)
+            {
+                SHRN_MEMCPY(&v, ip - 2, 4);
+                table[SUTL_LZ_HASH(v)] = (uint32_t)(ip - 2 - base);
+            }
+        }
+
+        /*
+         * The rest of the input becomes the literals of the last sequence, which has no match.
+         */
+        literals = (size_t)(end - anchor);
+        token = op++;
+
+        if (literals >= 15)
+        {
+            *token = 15 << 4;
+            op = SUTL_InternalLzPutLength(op, literals - 15);
+        }
+        else
+        {
+            *token = (uint8_t)(literals << 4);
+        }
+
+        SHRN_MEMCPY(op, anchor, literals);
+        op += literals;
+
+        SUTLStringSize(*out) = used + (size_t)(op - start);
+
+        return (size_t)(op - start);
+    }
+
+    int SUTL_InternalLzDecompress(const void * ptr, size_t size, SUTLString * out, size_t rawsize)
+    {
+        const uint8_t * ip = (const uint8_t *)ptr;
+        const uint8_t * end = ip + size;
+        const uint8_t * match;
+        uint8_t * start;
+        uint8_t * op;
+        uint8_t * oend;
+        size_t used = SUTLStringSize(*out);
+        size_t literals, length, offset;
+        unsigned byte;
+
+        SUTLStringMakeUnique(*out);
+
+        /*
+         * Leave slack behind the output, so short copies can be done with a fixed size.
+         */
+        if (SUTLVectorCapacity(*out) < used + rawsize + 16)
+            SUTLVectorReserve(*out, used + rawsize + 16);
+
+        start = (uint8_t *)*out + used;
+        op = start;
+        oend = start + rawsize;
+
+        while (ip < end)
+        {
+            byte = *ip++;
+
+            /*
+             * Copy the literals.
+             */
+            literals = byte >> 4;
+
+            if (literals == 15)
+            {
+                do
+                {
+                    if (ip == end)
+                        goto corrupted;
+
+                    literals += *ip;
+                } while (*ip++ == 255);
+            }
+
+            if (literals > (size_t)(end - ip) || literals > (size_t)(oend - op))
+                goto corrupted;
+
+            /*
+             * Most literal runs are short, and copying a fixed 16 bytes avoids a call. It may read
+             * past the literals while still inside the input, and write into the slack.
+             */
+            if (literals <= 16 && end - ip >= 16)
+                SHRN_MEMCPY(op, ip, 16);
+            else
+                SHRN_MEMCPY(op, ip, literals);
+
+            op += literals;
+            ip += literals;
+
+            /*
+             * The last sequence has no match.
+             */
+            if (ip == end)
+                break;
+
+            if (end - ip < 2)
+                goto corrupted;
+
+            offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+            ip += 2;
+
+            length = byte & 15;
+
+            if (length == 15)
+            {
+                do
+                {
+                    if (ip == end)
+                        goto corrupted;
+
+                    length += *ip;
+                } while (*ip++ == 255);
+            }
+
+            length += SUTL_LZ_MIN_MATCH;
+
+            if (!offset || offset > (size_t)(op - start) || length > (size_t)(oend - op))
+                goto corrupted;
+
+            /*
+             * Copy the match. Distant matches are copied 8 bytes at a time, which may write past
+             * the match into the slack. Close matches overlap the bytes being written and repeat
+             * them, so they are copied one byte at a time.
+             */
+            match = op - offset;
+
+            if (offset >= 8)
+            {
+                uint8_t * stop = op + length;
+
+                do
+                {
+                    SHRN_MEMCPY(op, match, 8);
+                    op += 8;
+                    match += 8;
+                } while (op < stop);
+
+                op = stop;
+            }
+            else
+            {
+                while (length--)
+                    *op++ = *match++;
+            }
+        }
+
+        if (op != oend)
+            goto corrupted;
+
+        SUTLStringSize(*out) = used + rawsize;
+
+        return 1;
+
+    corrupted:
+        SUTLErrorHandler("Corrupted compressed data.");
+
+        return 0;
+    }
+
+    void SUTL_InternalLzFrameBlock(SUTLString * out, const void * ptr, size_t size)
+    {
+        const char * data = (const char *)ptr;
+        size_t block, header, stored;
+
+        while (size)
+        {
+            block = size < SUTL_LZ_BLOCK_SIZE ? size : SUTL_LZ_BLOCK_SIZE;
+
+            /*
+             * Write the header with room for the stored size, which is known only afterwards.
+             */
+            header = SUTLStringSize(*out);
+
+            SUTL_InternalLzPut32(out, 0);
+            SUTL_InternalLzPut32(out, (uint32_t)block);
+            SUTL_InternalLzPut32(out, SUTLCrc32c(0, data, block));
+
+            stored = SUTL_InternalLzCompress(data, block, out);
+
+            if (stored >= block)
+            {
+                SUTLStringSize(*out) = header + 12;
+                SUTLStringAppendN(*out, data, block);
+
+                stored = block | 0x80000000UL;
+            }
+
+            (*out)[header] = (char)(stored & 0xFF);
+            (*out)[header + 1] = (char)(stored >> 8 & 0xFF);
+            (*out)[header + 2] = (char)(stored >> 16 & 0xFF);
+            (*out)[header + 3] = (char)(stored >> 24 & 0xFF);
+
+            data += block;
+            size -= block;
+        }
+    }
+
+    int SUTL_InternalLzFrameOpen(SUTLStringView view, size_t * at)
+    {
+        if (view.Size < 4 || SUTL_InternalLzGet32(view.Data) != SUTL_LZ_MAGIC)
+        {
+            SUTLErrorHandler("Not a compressed frame.");
+            return 0;
+        }
+
+        *at = 4;
+
+        return 1;
+    }
+
+    int SUTL_InternalLzFrameNext(SUTLStringView view, size_t * at, SUTLString * out)
+    {
+        uint32_t stored, rawsize, crc;
+        size_t size, used = SUTLStringSize(*out);
+
+        if (view.Size - *at < 4)
+        {
+            SUTLErrorHandler("Corrupted compressed data.");
+            return -1;
+        }
+
+        stored = SUTL_InternalLzGet32(view.Data + *at);
+
+        if (!stored)
+        {
+            *at += 4;
+            return 0;
+        }
+
+        if (view.Size - *at < 12)
+        {
+            SUTLErrorHandler("Corrupted compressed data.");
+            return -1;
+        }
+
+        rawsize = SUTL_InternalLzGet32(view.Data + *at + 4);
+        crc = SUTL_InternalLzGet32(view.Data + *at + 8);
+        size = stored & 0x7FFFFFFFUL;
+
+        if (size > view.Size - *at - 12 || rawsize > SUTL_LZ_BLOCK_SIZE || ((stored & 0x80000000UL) && size != rawsize))
+        {
+            SUTLErrorHandler("Corrupted compressed data.");
+            return -1;
+        }
+
+        if (stored & 0x80000000UL)
+            SUTLStringAppendN(*out, view.Data + *at + 12, size);
+        else if (!SUTL_InternalLzDecompress(view.Data + *at + 12, size, out, rawsize))
+            return -1;
+
+        if (SUTLCrc32c(0, *out + used, rawsize) != crc)
+        {
+            SUTLErrorHandler("Compressed data checksum mismatch.");
+
+            SUTLStringSize(*out) = used;
+            return -1;
+        }
+
+        *at += 12 + size;
+
+        return 1;
+    }
+
+    int SUTL_InternalLzFrameDecompress(SUTLStringView view, SUTLString * out)
+    {
+        size_t at;
+        int result;
+
+        if (!SUTL_InternalLzFrameOpen(view, &at))
+            return 0;
+
+        while ((result = SUTL_InternalLzFrameNext(view, &at, out)) == 1);
+
+        return result == 0;
+    }
+#endif
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_MAPPED_FILE_H
+#define SUTL_MAPPED_FILE_H
+
+#include "Common.h"
+#include "String.h"
+#include "System.h"
+
+/**
+ * @defgroup MappedFile
+ * A read-only file mapped into memory with \p SHRN_MMAP_READ, which is POSIX \p mmap by default.
+ *
+ * The content is accessed as a \p SUTLStringView, so records can be found with the
+ * \p SUTLStringView search and split macros without any copying or system calls. Pages are read
+ * in by the kernel as they are touched, and the hints given when opening let it read ahead.
+ * @{
+ */
+
+/**
+ * @brief Files at least this large get the huge page hint with \p SUTL_MAPPED_FILE_HUGE_PAGES.
+ */
+#ifndef SUTL_MAPPED_FILE_HUGE_PAGE_MIN
+    #define SUTL_MAPPED_FILE_HUGE_PAGE_MIN (2 << 20)
+#endif
+
+/**
+ * @brief Flags that give the kernel hints about how a \p SUTLMappedFile is accessed. Hints which
+ * aren't supported by the platform are ignored.
+ */
+typedef enum SUTLMappedFileFlags
+{
+    /**
+     * @brief The content is read from start to end, so read ahead aggressively.
+     */
+    SUTL_MAPPED_FILE_SEQUENTIAL = 1,
+
+    /**
+     * @brief The content is read in random order, so don't read ahead.
+     */
+    SUTL_MAPPED_FILE_RANDOM     = 2,
+
+    /**
+     * @brief Start reading the whole content in right away.
+     */
+    SUTL_MAPPED_FILE_WILL_NEED  = 4,
+
+    /**
+     * @brief Back the mapping with huge pages if the file is at least
+     * \p SUTL_MAPPED_FILE_HUGE_PAGE_MIN bytes, which reduces TLB misses for large files.
+     */
+    SUTL_MAPPED_FILE_HUGE_PAGES = 8
+} SUTLMappedFileFlags;
+
+/**
+ * @brief It contains the state of a particular mapped file instance.
+ */
+typedef struct SUTLMappedFile
+{
+    /**
+     * @brief Pointer to the content of the file. It is \p NULL if the file couldn't be mapped.
+     */
+    const char * Data;
+
+    /**
+     * @brief The size of the file in bytes.
+     */
+    size_t Size;
+} SUTLMappedFile;
+
+/**
+ * @brief Maps the file at \p path into memory.
+ *
+ * @param path The path of the file.
+ * @param flags A combination of \p SUTLMappedFileFlags.
+ *
+ * @return A \p SUTLMappedFile. If the file can't be opened or mapped, an error is reported and its
+ * \p Data is \p NULL.
+ */
+#define SUTLMappedFileOpen(path, flags)         SUTL_InternalMappedFileOpen(path, flags)
+
+/**
+ * @brief Unmaps a \p SUTLMappedFile which was created using \p SUTLMappedFileOpen. Views of it
+ * become invalid.
+ *
+ * @param mf The \p SUTLMappedFile to close.
+ */
+#define SUTLMappedFileClose(mf)                 SUTL_InternalMappedFileClose(&mf)
+
+/**
+ * @brief Gets the content of \p mf.
+ *
+ * @param mf The \p SUTLMappedFile.
+ *
+ * @return A \p SUTLStringView of the whole file, valid until \p mf is closed.
+ */
+#define SUTLMappedFileView(mf)                  SUTL_InternalStringViewNew((mf).Data, (mf).Size)
+
+/**
+ * @brief Gives the kernel new hints about the access pattern of \p mf.
+ *
+ * @param mf The \p SUTLMappedFile.
+ * @param flags A combination of \p SUTLMappedFileFlags.
+ */
+#define SUTLMappedFileAdvise(mf, flags)         SUTL_InternalMappedFileAdvise(&mf, flags)
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+SUTLMappedFile SUTL_InternalMappedFileOpen(const char * path, int flags);
+void SUTL_InternalMappedFileClose(SUTLMappedFile * mf);
+void SUTL_InternalMappedFileAdvise(SUTLMappedFile * mf, int flags);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    SUTLMappedFile SUTL_InternalMappedFileOpen(const char * path, int flags)
+    {
+        SUTLMappedFile mf;
+        size_t size;
+        void * data;
+        int fd;
+
+        mf.Data = NULL;
+        mf.Size = 0;
+
+        fd = SHRN_OPEN_READ(path);
+
+        if (fd < 0)
+        {
+            SUTLErrorHandler("Failed to open file.");
+            return mf;
+        }
+
+        if (SHRN_FILE_SIZE(fd, size) != 0)
+        {
+            SUTLErrorHandler("Failed to open file.");
+            SHRN_CLOSE(fd);
+
+            return mf;
+        }
+
+        /*
+         * Empty files can't be mapped, so point to an empty string instead.
+         */
+        if (!size)
+        {
+            SHRN_CLOSE(fd);
+
+            mf.Data = "";
+            return mf;
+        }
+
+        data = SHRN_MMAP_READ(fd, size);
+
+        /*
+         * The mapping keeps the file alive on its own.
+         */
+        SHRN_CLOSE(fd);
+
+        if (!data)
+        {
+            SUTLErrorHandler("Failed to map file.");
+            return mf;
+        }
+
+        mf.Data = (const char *)data;
+        mf.Size = size;
+
+        SUTL_InternalMappedFileAdvise(&mf, flags);
+
+        return mf;
+    }
+
+    void SUTL_InternalMappedFileClose(SUTLMappedFile * mf)
+    {
+        if (mf->Size)
+            SHRN_MUNMAP((void *)mf->Data, mf->Size);
+
+        mf->Data = NULL;
+        mf->Size = 0;
+    }
+
+    void SUTL_InternalMappedFileAdvise(SUTLMappedFile * mf, int flags)
+    {
+    #ifdef SHRN_MADVISE
+        void * data = (void *)mf->Data;
+
+        if (!mf->Size)
+            return;
+
+        /*
+         * The hints only affect performance, so failures and hints which the platform lacks are
+         * ignored.
+         */
+    #ifdef SHRN_MADV_SEQUENTIAL
+        if (flags & SUTL_MAPPED_FILE_SEQUENTIAL)
+            SHRN_MADVISE(data, mf->Size, SHRN_MADV_SEQUENTIAL);
+    #endif
+
+    #ifdef SHRN_MADV_RANDOM
+        if (flags & SUTL_MAPPED_FILE_RANDOM)
+            SHRN_MADVISE(data, mf->Size, SHRN_MADV_RANDOM);
+    #endif
+
+    #ifdef SHRN_MADV_WILLNEED
+        if (flags & SUTL_MAPPED_FILE_WILL_NEED)
+            SHRN_MADVISE(data, mf->Size, SHRN_MADV_WILLNEED);
+    #endif
+
+    #ifdef SHRN_MADV_HUGEPAGE
+        if ((flags & SUTL_MAPPED_FILE_HUGE_PAGES) && mf->Size >= SUTL_MAPPED_FILE_HUGE_PAGE_MIN)
+            SHRN_MADVISE(data, mf->Size, SHRN_MADV_HUGEPAGE);
+    #endif
+
+        (void)data;
+        (void)flags;
+    #else
+        (void)mf;
+        (void)flags;
+    #endif
+    }
+#endif
+
+#endif
@@ -0,0 +1,391 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_METRICS_H
+#define SUTL_METRICS_H
+
+#include "Common.h"
+
+/**
+ * @defgroup Metrics
+ * Counters and latency histograms which many threads can update without contending with each
+ * other, cheap enough to leave in hot paths.
+ *
+ * A \p SUTLCounter is split into shards, each on its own cache line. Every thread adds to the
+ * shard with its own number, so threads with different numbers never write the same cache line,
+ * and reading the counter sums the shards. Threads which share a shard are still counted correctly,
+ * as adds are atomic.
+ *
+ * A \p SUTLHistogram counts values in log-linear buckets: values below
+ * 2 ^ \p SUTL_HISTOGRAM_SUB_BITS have a bucket each, and every power of two above is split into
+ * 2 ^ \p SUTL_HISTOGRAM_SUB_BITS buckets of equal width, so a value is known to within
+ * 1 / 2 ^ \p SUTL_HISTOGRAM_SUB_BITS of itself. A histogram belongs to one thread. Every thread
+ * records into its own one, and they are merged to read them.
+ * @{
+ */
+
+/**
+ * @brief The number of bits of precision of histogram buckets. Values are recorded with a relative
+ * error of at most 1 / 2 ^ \p SUTL_HISTOGRAM_SUB_BITS.
+ */
+#ifndef SUTL_HISTOGRAM_SUB_BITS
+    #define SUTL_HISTOGRAM_SUB_BITS 5
+#endif
+
+/**
+ * @brief The number of buckets of a histogram.
+ */
+#define SUTL_HISTOGRAM_BUCKETS ((65 - SUTL_HISTOGRAM_SUB_BITS) << SUTL_HISTOGRAM_SUB_BITS)
+
+/**
+ * @brief One shard of a counter, filling a cache line.
+ */
+typedef struct SUTLCounterShard
+{
+    /**
+     * @brief The sum of the values added to this shard.
+     */
+    SHRN_ATOMIC(uint64_t) Value;
+
+    /**
+     * @brief Keeps other shards off this cache line.
+     */
+    char Padding[SHRN_CACHE_LINE - sizeof(uint64_t)];
+} SUTLCounterShard;
+
+/**
+ * @brief It contains the shards of a counter.
+ */
+typedef struct SUTLCounter
+{
+    /**
+     * @brief The number of shards, a power of two.
+     */
+    size_t Shards;
+
+    /**
+     * @brief The shards.
+     */
+    SUTLCounterShard * Values;
+} SUTLCounter;
+
+/**
+ * @brief It contains the buckets of a histogram and a summary of the recorded values.
+ */
+typedef struct SUTLHistogram
+{
+    /**
+     * @brief The number of recorded values.
+     */
+    uint64_t Count;
+
+    /**
+     * @brief The sum of the recorded values.
+     */
+    uint64_t Sum;
+
+    /**
+     * @brief The smallest recorded value, or \p UINT64_MAX if none is recorded.
+     */
+    uint64_t Min;
+
+    /**
+     * @brief The largest recorded value.
+     */
+    uint64_t Max;
+
+    /**
+     * @brief The number of values in each of the \p SUTL_HISTOGRAM_BUCKETS buckets.
+     */
+    uint64_t * Buckets;
+} SUTLHistogram;
+
+/**
+ * @brief Creates a new \p SUTLCounter with a value of 0.
+ *
+ * @param shards The number of shards, which is rounded up to a power of two. Using the number of
+ * threads which update the counter avoids all contention.
+ *
+ * @return A \p SUTLCounter.
+ */
+#define SUTLCounterNew(shards)                  SUTL_InternalCounterNew(shards)
+
+/**
+ * @brief Frees \p c.
+ *
+ * @param c The \p SUTLCounter to free.
+ */
+#define SUTLCounterFree(c)                      SUTL_InternalCounterFree(&c)
+
+/**
+ * @brief Adds \p n to \p c from the thread with number \p thread.
+ *
+ * @param c The \p SUTLCounter to add to.
+ * @param thread The number of the thread, which selects the shard.
+ * @param n The \p uint64_t to add.
+ */
+#define SUTLCounterAdd(c, thread, n) \
+    ((void)SHRN_ATOMIC_FETCH_ADD(&(c).Values[(size_t)(thread) & ((c).Shards - 1)].Value, (uint64_t)(n), SHRN_ORDER_RELAXED))
+
+/**
+ * @brief Gets the value of \p c, summing its shards. Adds which happen meanwhile may or may not be
+ * included.
+ *
+ * @param c The \p SUTLCounter to read.
+ *
+ * @return The value as a \p uint64_t.
+ */
+#define SUTLCounterRead(c)                      SUTL_InternalCounterRead(&c)
+
+/**
+ * @brief Creates a new empty \p SUTLHistogram.
+ *
+ * @return A \p SUTLHistogram.
+ */
+#define SUTLHistogramNew()                      SUTL_InternalHistogramNew()
+
+/**
+ * @brief Frees \p h.
+ *
+ * @param h The \p SUTLHistogram to free.
+ */
+#define SUTLHistogramFree(h)                    SUTL_InternalHistogramFree(&h)
+
+/**
+ * @brief Records \p value in \p h.
+ *
+ * @param h The \p SUTLHistogram to record in.
+ * @param value The \p uint64_t to record, like a latency in nanoseconds.
+ */
+#define SUTLHistogramRecord(h, value)           SUTL_InternalHistogramRecord(&h, value)
+
+/**
+ * @brief Adds the values recorded in \p src to \p dst.
+ *
+ * @param dst The \p SUTLHistogram to merge into.
+ * @param src The \p SUTLHistogram to merge from, which is not changed.
+ */
+#define SUTLHistogramMerge(dst, src)            SUTL_InternalHistogramMerge(&dst, &src)
+
+/**
+ * @brief Removes all recorded values from \p h.
+ *
+ * @param h The \p SUTLHistogram to reset.
+ */
+#define SUTLHistogramReset(h)                   SUTL_InternalHistogramReset(&h)
+
+/**
+ * @brief Gets the value below or at which \p percentile percent of the recorded values are.
+ *
+ * @param h The \p SUTLHistogram to read.
+ * @param percentile A \p double from 0 to 100.
+ *
+ * @return The largest value in the bucket of that value as a \p uint64_t, but not more than the
+ * largest recorded value, or 0 if no value is recorded.
+ */
+#define SUTLHistogramPercentile(h, percentile)  SUTL_InternalHistogramPercentile(&h, percentile)
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+SUTLCounter SUTL_InternalCounterNew(size_t shards);
+void SUTL_InternalCounterFree(SUTLCounter * c);
+uint64_t SUTL_InternalCounterRead(SUTLCounter * c);
+
+SUTLHistogram SUTL_InternalHistogramNew(void);
+void SUTL_InternalHistogramFree(SUTLHistogram * h);
+void SUTL_InternalHistogramRecord(SUTLHistogram * h, uint64_t value);
+void SUTL_InternalHistogramMerge(SUTLHistogram * dst, const SUTLHistogram * src);
+void SUTL_InternalHistogramReset(SUTLHistogram * h);
+uint64_t SUTL_InternalHistogramPercentile(const SUTLHistogram * h, double percentile);
+size_t SUTL_InternalHistogramBucket(uint64_t value);
+uint64_t SUTL_InternalHistogramUpper(size_t bucket);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    #ifndef SHRN_HAS_ATOMICS
+        #error "Metrics.h needs the atomic macros of Common.h."
+    #endif
+
+    SUTLCounter SUTL_InternalCounterNew(size_t shards)
+    {
+        SUTLCounter c;
+        size_t i;
+
+        /*
+         * Round the shards up to a power of two, so that a thread number selects one with a mask.
+         */
+        for (c.Shards = 1; c.Shards < shards; c.Shards <<= 1);
+
+        c.Values = (SUTLCounterShard *)SHRN_MALLOC(c.Shards * sizeof(SUTLCounterShard));
+
+        if (!c.Values)
+        {
+            SUTLErrorHandler("Memory allocation failed.");
+            c.Shards = 0;
+
+            return c;
+        }
+
+        for (i = 0; i < c.Shards; i++)
+            SHRN_ATOMIC_STORE(&c.Values[i].Value, 0, SHRN_ORDER_RELAXED);
+
+        return c;
+    }
+
+    void SUTL_InternalCounterFree(SUTLCounter * c)
+    {
+        SHRN_FREE(c->Values);
+
+        c->Values = NULL;
+        c->Shards = 0;
+    }
+
+    uint64_t SUTL_InternalCounterRead(SUTLCounter * c)
+    {
+        uint64_t sum = 0;
+        size_t i;
+
+        for (i = 0; i < c->Shards; i++)
+            sum += SHRN_ATOMIC_LOAD(&c->Values[i].Value, SHRN_ORDER_RELAXED);
+
+        return sum;
+    }
+
+    SUTLHistogram SUTL_InternalHistogramNew(void)
+    {
+        SUTLHistogram h;
+
+        h.Buckets = (uint64_t *)SHRN_MALLOC(SUTL_HISTOGRAM_BUCKETS * sizeof(uint64_t));
+
+        if (!h.Buckets)
+            SUTLErrorHandler("Memory allocation failed.");
+
+        SUTL_InternalHistogramReset(&h);
+
+        return h;
+    }
+
+    void SUTL_InternalHistogramFree(SUTLHistogram * h)
+    {
+        SHRN_FREE(h->Buckets);
+        h->Buckets = NULL;
+    }
+
+    size_t SUTL_InternalHistogramBucket(uint64_t value)
+    {
+        size_t bit;
+
+        if (value < ((uint64_t)1 << SUTL_HISTOGRAM_SUB_BITS))
+            return (size_t)value;
+
+        #if defined(__GNUC__)
+            bit = 63 - (size_t)__builtin_clzll((unsigned long long)value);
+        #else
+            for (bit = SUTL_HISTOGRAM_SUB_BITS; value >> bit > 1; bit++);
+        #endif
+
+        /*
+         * The bits below the highest one select the bucket within its power of two.
+         */
+        return ((bit - SUTL_HISTOGRAM_SUB_BITS + 1) << SUTL_HISTOGRAM_SUB_BITS) + (size_t)(value >> (bit - SUTL_HISTOGRAM_SUB_BITS)) - ((size_t)1 << SUTL_HISTOGRAM_SUB_BITS);
+    }
+
+    uint64_t SUTL_InternalHistogramUpper(size_t bucket)
+    {
+        size_t group = bucket >> SUTL_HISTOGRAM_SUB_BITS;
+        uint64_t sub = bucket & (((size_t)1 << SUTL_HISTOGRAM_SUB_BITS) - 1);
+
+        if (!group)
+            return sub;
+
+        return (((((uint64_t)1 << SUTL_HISTOGRAM_SUB_BITS) + sub + 1) << (group - 1))) - 1;
+    }
+
+    void SUTL_InternalHistogramRecord(SUTLHistogram * h, uint64_t value)
+    {
+        h->Buckets[SUTL_InternalHistogramBucket(value)]++;
+        h->Count++;
+        h->Sum += value;
+
+        if (value < h->Min)
+            h->Min = value;
+
+        if (value > h->Max)
+            h->Max = value;
+    }
+
+    void SUTL_InternalHistogramMerge(SUTLHistogram * dst, const SUTLHistogram * src)
+    {
+        size_t i;
+
+        for (i = 0; i < SUTL_HISTOGRAM_BUCKETS; i++)
+            dst->Buckets[i] += src->Buckets[i];
+
+        dst->Count += src->Count;
+        dst->Sum += src->Sum;
+
+        if (src->Min < dst->Min)
+            dst->Min = src->Min;
+
+        if (src->Max > dst->Max)
+            dst->Max = src->Max;
+    }
+
+    void SUTL_InternalHistogramReset(SUTLHistogram * h)
+    {
+        if (h->Buckets)
+            SHRN_MEMSET(h->Buckets, 0, SUTL_HISTOGRAM_BUCKETS * sizeof(uint64_t));
+
+        h->Count = 0;
+        h->Sum = 0;
+        h->Min = UINT64_MAX;
+        h->Max = 0;
+    }
+
+    uint64_t SUTL_InternalHistogramPercentile(const SUTLHistogram * h, double percentile)
+    {
+        uint64_t rank, seen = 0;
+        size_t i;
+
+        if (!h->Count)
+            return 0;
+
+        /*
+         * Find the bucket of the value with the rank of the percentile, counting from 1.
+         */
+        rank = (uint64_t)(percentile / 100 * (double)h->Count + 0.5);
+
+        if (rank < 1)
+            rank = 1;
+
+        if (rank > h->Count)
+            rank = h->Count;
+
+        for (i = 0; i < SUTL_HISTOGRAM_BUCKETS; i++)
+            if ((seen += h->Buckets[i]) >= rank)
+                break;
+
+        return SUTL_InternalHistogramUpper(i) < h->Max ? SUTL_InternalHistogramUpper(i) : h->Max;
+    }
+#endif
+
+#endif
@@ -0,0 +1,943 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_PERFECT_HASH_H
+#define SUTL_PERFECT_HASH_H
+
+#include "Common.h"
+#include "Vector.h"
+#include "String.h"
+#include "HashUtils.h"
+#include "Flatmap.h"
+
+/**
+ * @defgroup PerfectHash
+ * A minimal perfect hash function for a static set of keys and a read-only hashmap built on it.
+ *
+ * The function maps each of the \p n keys it was built from to a distinct index in <tt>[0, n)</tt>
+ * using the hash-and-displace method of PTHash. Keys are distributed into buckets, and each bucket
+ * stores a pilot value which is mixed into the hash of its keys so that they land on free slots of
+ * a table slightly larger than \p n. Buckets are placed largest first, when the most slots are
+ * still free. The few keys which land on slots past \p n are remapped to the unused indices.
+ *
+ * A lookup computes one hash, reads one pilot and computes one index. Keys which weren't part of
+ * the set also map to some index, so \p SUTLPerfectHashmap compares the key stored at that index.
+ * @{
+ */
+
+/**
+ * @brief The average number of keys in a bucket. Larger values make the function smaller but
+ * slower to build.
+ */
+#ifndef SUTL_PERFECT_HASH_BUCKET_SIZE
+    #define SUTL_PERFECT_HASH_BUCKET_SIZE 4
+#endif
+
+/**
+ * @brief The percentage of table slots filled by keys. The last buckets only have to find one of
+ * the remaining free slots, so lower values make building faster but the function larger.
+ */
+#ifndef SUTL_PERFECT_HASH_LOAD_FACTOR
+    #define SUTL_PERFECT_HASH_LOAD_FACTOR 98
+#endif
+
+/**
+ * @brief It contains the state of a built perfect hash function.
+ */
+typedef struct SUTLPerfectHash
+{
+    /**
+     * @brief The number of keys the function was built from. Indices are less than this.
+     */
+    size_t KeyCount;
+
+    /**
+     * @brief The number of slots keys are placed in before remapping.
+     */
+    size_t TableSize;
+
+    /**
+     * @brief The number of buckets.
+     */
+    size_t BucketCount;
+
+    /**
+     * @brief The seed which was used for a successful build.
+     */
+    uint64_t Seed;
+
+    /**
+     * @brief Don't access this directly. A vector of \p uint32_t which stores the pilot of every
+     * bucket.
+     */
+    uint32_t * Pilots;
+
+    /**
+     * @brief Don't access this directly. A vector of \p uint32_t which stores the index of every
+     * slot past \p KeyCount.
+     */
+    uint32_t * Remap;
+} SUTLPerfectHash;
+
+/**
+ * @brief It contains the state of a particular perfect hashmap instance.
+ */
+typedef struct SUTLPerfectHashmap
+{
+    /**
+     * @brief The number of entries in the perfect hashmap.
+     */
+    size_t Size;
+
+    /**
+     * @brief The size of the key type of the perfect hashmap.
+     */
+    size_t KeySize;
+
+    /**
+     * @brief The size of the value type of the perfect hashmap.
+     */
+    size_t ValueSize;
+
+    /**
+     * @brief The perfect hash function of the keys.
+     */
+    SUTLPerfectHash Function;
+
+    /**
+     * @brief Don't access this directly. A pointer to key type. This is used to pass parameters to
+     * internal functions which allows passing rvalues to them.
+     */
+    void * ParamK;
+
+    /**
+     * @brief Don't access this directly. A vector of \p char which stores the key at every index.
+     */
+    char * Keys;
+
+    /**
+     * @brief Don't access this directly. A vector of \p char which stores the value at every index.
+     */
+    char * Values;
+
+    /**
+     * @brief The function pointer which hashes the key type of the perfect hashmap.
+     */
+    size_t( * Hash)(const void *);
+
+    /**
+     * @brief The function pointer which compares two keys.
+     */
+    int( * KeyComp)(const void *, const void *);
+} SUTLPerfectHashmap;
+
+/**
+ * @brief Builds a minimal perfect hash function for \p count distinct hashes.
+ *
+ * @param ph The \p SUTLPerfectHash to store the result in. It must not be initialized.
+ * @param hashes Pointer to \p count \p uint64_t hashes of the keys.
+ * @param count The number of hashes.
+ *
+ * @return 1 on success. If two hashes are equal or there are 2^32 or more of them, an error is
+ * reported, \p ph is empty and 0 is returned.
+ */
+#define SUTLPerfectHashBuild(ph, hashes, count)     SUTL_InternalPerfectHashBuild(&ph, hashes, count)
+
+/**
+ * @brief Frees a \p SUTLPerfectHash.
+ *
+ * @param ph The \p SUTLPerfectHash to free.
+ */
+#define SUTLPerfectHashFree(ph)                     (SUTLVectorFree((ph).Remap), SUTLVectorFree((ph).Pilots))
+
+/**
+ * @brief Gets the index of the key with hash \p hash.
+ *
+ * @param ph The perfect hash function.
+ * @param hash The \p uint64_t hash of the key.
+ *
+ * @return The index of the key. It is only meaningful for keys the function was built from.
+ */
+#define SUTLPerfectHashIndex(ph, hash)              SUTL_InternalPerfectHashIndex(&ph, hash)
+
+/**
+ * @brief Appends the serialized form of \p ph to \p str.
+ *
+ * @param ph The perfect hash function to serialize.
+ * @param str The \p SUTLString to append to.
+ */
+#define SUTLPerfectHashSerialize(ph, str)           SUTL_InternalPerfectHashSerialize(&ph, &str)
+
+/**
+ * @brief Creates a \p SUTLPerfectHash from data written by \p SUTLPerfectHashSerialize.
+ *
+ * @param ptr Pointer to the serialized data.
+ * @param size The size of the serialized data in bytes.
+ * @param ph The \p SUTLPerfectHash to store the result in. It must not be initialized.
+ *
+ * @return 1 on success. If the data is invalid, an error is reported, \p ph is empty and 0 is
+ * returned.
+ */
+#define SUTLPerfectHashDeserialize(ptr, size, ph)   SUTL_InternalPerfectHashDeserialize(ptr, size, &ph)
+
+/**
+ * @brief Creates a new \p SUTLPerfectHashmap with the entries \p keys and \p values.
+ *
+ * @param tk The key type for the perfect hashmap.
+ * @param tv The value type for the perfect hashmap.
+ * @param keys A vector of \p tk with distinct keys.
+ * @param values A vector of \p tv parallel to \p keys.
+ * @param hash A function of the signature <tt>size_t(const void *)</tt> that hashes \p tk.
+ * @param cmp A function of signature <tt>int(const void *, const void *)</tt> that compares two
+ * \p tk s for equality. (Similar to the \p == operator)
+ *
+ * @return A \p SUTLPerfectHashmap created according to the parameters given. If it can't be built,
+ * an error is reported and it is empty.
+ */
+#define SUTLPerfectHashmapNew(tk, tv, keys, values, hash, cmp) \
+    SUTL_InternalPerfectHashmapNew(sizeof(tk), sizeof(tv), keys, values, hash, cmp)
+
+/**
+ * @brief Frees a \p SUTLPerfectHashmap which was created using \p SUTLPerfectHashmapNew.
+ *
+ * @param phm The \p SUTLPerfectHashmap to free.
+ */
+#define SUTLPerfectHashmapFree(phm)                 SUTL_InternalPerfectHashmapFree(&phm)
+
+/**
+ * @brief Gets a value assigned to \p k in \p phm.
+ *
+ * @param tk The key type of \p phm.
+ * @param tv The value type of \p phm.
+ * @param phm The perfect hashmap to get from.
+ * @param k The key to search for.
+ *
+ * @return A <tt>tv *</tt> that points to the required value. If \p k doesn't exist in \p phm then
+ * it is \p NULL.
+ */
+#define SUTLPerfectHashmapGet(tk, tv, phm, k)       (*(tk *)phm.ParamK = k, (tv *)SUTL_InternalPerfectHashmapGetWith(&phm, phm.ParamK, phm.Hash, phm.KeyComp))
+
+/**
+ * @brief Gets a value whose key matches \p probe in \p phm. See \p SUTLHashmapGetWith.
+ *
+ * @param tv The value type of \p phm.
+ * @param phm The perfect hashmap to get from.
+ * @param probe A pointer to the probe to search for.
+ * @param hash A function that hashes the probe like the key hash function of \p phm.
+ * @param cmp A function that compares the probe (first parameter) with a key (second parameter).
+ *
+ * @return A <tt>tv *</tt> that points to the required value. If no key matches \p probe then it is
+ * \p NULL.
+ */
+#define SUTLPerfectHashmapGetWith(tv, phm, probe, hash, cmp) ((tv *)SUTL_InternalPerfectHashmapGetWith(&phm, probe, hash, cmp))
+
+/**
+ * @brief Gets a value assigned to the string of \p size characters at \p ptr in \p phm, which
+ * must be keyed by \p SUTLString and use \p SUTL_HASHFN(string).
+ *
+ * @param tv The value type of \p phm.
+ * @param phm The perfect hashmap to get from.
+ * @param ptr Pointer to the characters to search for.
+ * @param size The number of characters.
+ *
+ * @return A <tt>tv *</tt> that points to the required value. If the string doesn't exist in
+ * \p phm then it is \p NULL.
+ */
+#define SUTLPerfectHashmapGetN(tv, phm, ptr, size)  ((tv *)SUTL_InternalPerfectHashmapGetN(&phm, ptr, size))
+
+/**
+ * @brief Appends C source for a constant lookup table of the strings \p keys to \p str.
+ *
+ * The source defines <tt>static const</tt> tables and the function
+ * <tt>static int <name>Lookup(const char * ptr, size_t size)</tt>, which returns the position of
+ * the string in \p keys or -1 if it isn't one of them. It only depends on the C standard library
+ * headers, needs no initialization and never allocates, so keyword tables known at build time
+ * can be compiled in. See \p tools/PerfectHashGen.c for a command line generator.
+ *
+ * @param keys A vector of distinct \p SUTLString s.
+ * @param name The prefix of every generated identifier. It must be a valid C identifier.
+ * @param str The \p SUTLString to append to.
+ *
+ * @return 1 on success. If \p keys is empty or has duplicates, an error is reported, nothing is
+ * appended and 0 is returned.
+ */
+#define SUTLPerfectHashGenerate(keys, name, str)    SUTL_InternalPerfectHashGenerate(keys, name, &str)
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+int SUTL_InternalPerfectHashBuild(SUTLPerfectHash * ph, const uint64_t * hashes, size_t count);
+size_t SUTL_InternalPerfectHashIndex(const SUTLPerfectHash * ph, uint64_t hash);
+void SUTL_InternalPerfectHashSerialize(const SUTLPerfectHash * ph, SUTLString * str);
+int SUTL_InternalPerfectHashDeserialize(const void * ptr, size_t size, SUTLPerfectHash * ph);
+SUTLPerfectHashmap SUTL_InternalPerfectHashmapNew(size_t keysize, size_t valuesize, const void * keys, const void * values, size_t( * hash)(const void *), int ( * keycomp)(const void *, const void *));
+void SUTL_InternalPerfectHashmapFree(SUTLPerfectHashmap * phm);
+void * SUTL_InternalPerfectHashmapGetWith(SUTLPerfectHashmap * phm, const void * probe, size_t( * hash)(const void *), int ( * cmp)(const void *, const void *));
+void * SUTL_InternalPerfectHashmapGetN(SUTLPerfectHashmap * phm, const char * ptr, size_t size);
+int SUTL_InternalPerfectHashGenerate(const SUTLString * keys, const char * name, SUTLString * str);
+
+uint64_t SUTL_InternalMix64(uint64_t x);
+int SUTL_InternalPerfectHashTryBuild(SUTLPerfectHash * ph, const uint64_t * hashes, size_t count);
+void SUTL_InternalPerfectHashEmitArray(SUTLString * str, const char * name, const char * suffix, const char * type, const uint32_t * values, size_t count);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    /*
+     * The largest pilot tried for a bucket before the build is retried with another seed.
+     */
+    #define SUTLPerfectHashMaxPilot 100000
+
+    #define SUTLPerfectHashBucket(ph, hash) \
+        (size_t)(SUTL_InternalMix64((hash) ^ (ph)->Seed) % (ph)->BucketCount)
+
+    #define SUTLPerfectHashPosition(ph, hash, pilot) \
+        (size_t)(SUTL_InternalMix64((hash) ^ SUTL_InternalMix64((ph)->Seed + (pilot))) % (ph)->TableSize)
+
+    uint64_t SUTL_InternalMix64(uint64_t x)
+    {
+        /*
+         * The finalizer of splitmix64.
+         */
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+
+        return x;
+    }
+
+    int SUTL_InternalPerfectHashTryBuild(SUTLPerfectHash * ph, const uint64_t * hashes, size_t count)
+    {
+        size_t * bucketOf = (size_t *)SHRN_MALLOC(count * sizeof(size_t));
+        size_t * starts = (size_t *)SHRN_MALLOC((ph->BucketCount + 1) * sizeof(size_t));
+        size_t * members = (size_t *)SHRN_MALLOC(count * sizeof(size_t));
+        size_t * order = (size_t *)SHRN_MALLOC(ph->BucketCount * sizeof(size_t));
+        size_t * bySize;
+        uint8_t * taken = (uint8_t *)SHRN_MALLOC(ph->TableSize);
+        size_t positions[64];
+        size_t maxSize = 0;
+        size_t i, j, k;
+        int result = 1;
+
+        if (!bucketOf || !starts || !members || !order || !taken)
+        {
+            SUTLErrorHandler("Memory allocation failed.");
+            result = 0;
+            goto end;
+        }
+
+        SHRN_MEMSET(starts, 0, (ph->BucketCount + 1) * sizeof(size_t));
+        SHRN_MEMSET(taken, 0, ph->TableSize);
+
+        /*
+         * Group the keys by bucket using a counting sort.
+         */
+        for (i = 0; i < count; i++)
+        {
+            bucketOf[i] = SUTLPerfectHashBucket(ph, hashes[i]);
+            starts[bucketOf[i] + 1]++;
+        }
+
+        for (i = 0; i < ph->BucketCount; i++)
+        {
+            maxSize = starts[i + 1] > maxSize ? starts[i + 1] : maxSize;
+            starts[i + 1] += starts[i];
+        }
+
+        /*
+         * Too many keys in one bucket means a bad seed, try another one.
+         */
+        if (maxSize > sizeof(positions) / sizeof(positions[0]))
+        {
+            result = 0;
+            goto end;
+        }
+
+        {
+            size_t * fill = order;
+
+            SHRN_MEMCPY(fill, starts, ph->BucketCount * sizeof(size_t));
+
+            for (i = 0; i < count; i++)
+                members[fill[bucketOf[i]]++] = i;
+        }
+
+        /*
+         * Order the buckets from largest to smallest, again using a counting sort.
+         */
+        bySize = (size_t *)SHRN_MALLOC((maxSize + 2) * sizeof(size_t));
+
+        if (!bySize)
+        {
+            SUTLErrorHandler("Memory allocation failed.");
+            result = 0;
+            goto end;
+        }
+
+        SHRN_MEMSET(bySize, 0, (maxSize + 2) * sizeof(size_t));
+
+        for (i = 0; i < ph->BucketCount; i++)
+            bySize[maxSize - (starts[i + 1] - starts[i]) + 1]++;
+
+        for (i = 0; i <= maxSize; i++)
+            bySize[i + 1] += bySize[i];
+
+        for (i = 0; i < ph->BucketCount; i++)
+            order[bySize[maxSize - (starts[i + 1] - starts[i])]++] = i;
+
+        SHRN_FREE(bySize);
+
+        /*
+         * Find a pilot for every bucket which moves all of its keys to free, distinct slots.
+         */
+        for (i = 0; i < ph->BucketCount && result; i++)
+        {
+            size_t bucket = order[i];
+            size_t size = starts[bucket + 1] - starts[bucket];
+            const size_t * keys = members + starts[bucket];
+            uint32_t pilot;
+
+            if (!size)
+                break;
+
+            for (pilot = 0; pilot < SUTLPerfectHashMaxPilot; pilot++)
+            {
+                for (j = 0; j < size; j++)
+                {
+                    positions[j] = SUTLPerfectHashPosition(ph, hashes[keys[j]], pilot);
+
+                    if (taken[positions[j]])
+                        break;
+
+                    for (k = 0; k < j; k++)
+                        if (positions[k] == positions[j])
+                            break;
+
+                    if (k != j)
+                        break;
+                }
+
+                if (j == size)
+                    break;
+            }
+
+            if (pilot == SUTLPerfectHashMaxPilot)
+            {
+                result = 0;
+                break;
+            }
+
+            for (j = 0; j < size; j++)
+                taken[positions[j]] = 1;
+
+            ph->Pilots[bucket] = pilot;
+        }
+
+        /*
+         * Give every key in a slot past `count` one of the free indices below it.
+         */
+        if (result)
+        {
+            size_t unused = 0;
+
+            for (i = count; i < ph->TableSize; i++)
+            {
+                if (!taken[i])
+                    continue;
+
+                while (taken[unused])
+                    unused++;
+
+                ph->Remap[i - count] = (uint32_t)unused++;
+            }
+        }
+
+    end:
+        SHRN_FREE(taken);
+        SHRN_FREE(order);
+        SHRN_FREE(members);
+        SHRN_FREE(starts);
+        SHRN_FREE(bucketOf);
+
+        return result;
+    }
+
+    int SUTL_InternalPerfectHashBuild(SUTLPerfectHash * ph, const uint64_t * hashes, size_t count)
+    {
+        uint64_t attempt;
+        size_t i;
+
+        ph->KeyCount = count;
+        ph->TableSize = count + count * (100 - SUTL_PERFECT_HASH_LOAD_FACTOR) / 100 + 1;
+        ph->BucketCount = count / SUTL_PERFECT_HASH_BUCKET_SIZE + 1;
+        ph->Seed = 0;
+        ph->Pilots = SUTLVectorNew(uint32_t);
+        ph->Remap = SUTLVectorNew(uint32_t);
+
+        if (count > 0xFFFFFFFFUL)
+        {
+            SUTLErrorHandler("Too many keys for a perfect hash function.");
+
+            ph->KeyCount = 0;
+            return 0;
+        }
+
+        SUTLVectorResize(ph->Pilots, ph->BucketCount);
+        SUTLVectorResize(ph->Remap, ph->TableSize - count);
+        SHRN_MEMSET(ph->Pilots, 0, ph->BucketCount * sizeof(uint32_t));
+        SHRN_MEMSET(ph->Remap, 0, (ph->TableSize - count) * sizeof(uint32_t));
+
+        if (!count)
+            return 1;
+
+        /*
+         * Equal hashes would make every seed fail, so reject them up front.
+         */
+        {
+            SUTLFlatmap seen = SUTLFlatmapNew(uint64_t, char, SUTL_HASHFN(u64), SUTL_CMPFN(u64), SUTL_FLATMAP_LAYOUT_AOS);
+            int duplicate = 0;
+
+            for (i = 0; i < count && !duplicate; i++)
+            {
+                duplicate = SUTLFlatmapGet(uint64_t, char, seen, hashes[i]) != NULL;
+                SUTLFlatmapInsert(uint64_t, char, seen, hashes[i], 0);
+            }
+
+            SUTLFlatmapFree(seen);
+
+            if (duplicate)
+            {
+                SUTLErrorHandler("Perfect hash keys must have distinct hashes.");
+
+                ph->KeyCount = 0;
+                return 0;
+            }
+        }
+
+        for (attempt = 0; attempt < 64; attempt++)
+        {
+            ph->Seed = SUTL_InternalMix64(attempt + 1);
+
+            if (SUTL_InternalPerfectHashTryBuild(ph, hashes, count))
+                return 1;
+
+            SHRN_MEMSET(ph->Pilots, 0, ph->BucketCount * sizeof(uint32_t));
+        }
+
+        SUTLErrorHandler("Failed to build perfect hash function.");
+
+        ph->KeyCount = 0;
+
+        return 0;
+    }
+
+    size_t SUTL_InternalPerfectHashIndex(const SUTLPerfectHash * ph, uint64_t hash)
+    {
+        size_t position;
+
+        if (!ph->KeyCount)
+            return 0;
+
+        position = SUTLPerfectHashPosition(ph, hash, ph->Pilots[SUTLPerfectHashBucket(ph, hash)]);
+
+        return position < ph->KeyCount ? position : ph->Remap[position - ph->KeyCount];
+    }
+
+    void SUTL_InternalPerfectHashSerialize(const SUTLPerfectHash * ph, SUTLString * str)
+    {
+        size_t i;
+
+        SUTLStringReserve(*str, SUTLStringSize(*str) + 36 + (ph->BucketCount + ph->TableSize - ph->KeyCount) * 4);
+
+        SUTLStringAppendN(*str, "SPH1", 4);
+        SUTL_InternalStringAppendLE(str, ph->Seed, 8);
+        SUTL_InternalStringAppendLE(str, ph->KeyCount, 8);
+        SUTL_InternalStringAppendLE(str, ph->TableSize, 8);
+        SUTL_InternalStringAppendLE(str, ph->BucketCount, 8);
+
+        for (i = 0; i < ph->BucketCount; i++)
+            SUTL_InternalStringAppendLE(str, ph->Pilots[i], 4);
+
+        for (i = 0; i < ph->TableSize - ph->KeyCount; i++)
+            SUTL_InternalStringAppendLE(str, ph->Remap[i], 4);
+    }
+
+    int SUTL_InternalPerfectHashDeserialize(const void * ptr, size_t size, SUTLPerfectHash * ph)
+    {
+        const uint8_t * in = (const uint8_t *)ptr;
+        uint64_t keyCount, tableSize, bucketCount;
+        size_t i;
+
+        ph->Pilots = SUTLVectorNew(uint32_t);
+        ph->Remap = SUTLVectorNew(uint32_t);
+        ph->KeyCount = 0;
+        ph->TableSize = 0;
+        ph->BucketCount = 0;
+        ph->Seed = 0;
+
+        if (size < 36 || SHRN_MEMCMP(in, "SPH1", 4) != 0)
+        {
+            SUTLErrorHandler("Invalid serialized perfect hash function.");
+            return 0;
+        }
+
+        keyCount = SUTL_InternalStringReadLE(in + 12, 8);
+        tableSize = SUTL_InternalStringReadLE(in + 20, 8);
+        bucketCount = SUTL_InternalStringReadLE(in + 28, 8);
+
+        /*
+         * Check the counts before multiplying them so that huge values can't wrap around.
+         */
+        if (!bucketCount || tableSize <= keyCount || keyCount > 0xFFFFFFFFUL ||
+            bucketCount > (size - 36) / 4 || tableSize - keyCount != (size - 36) / 4 - bucketCount ||
+            (size - 36) % 4)
+        {
+            SUTLErrorHandler("Invalid serialized perfect hash function.");
+            return 0;
+        }
+
+        ph->Seed = SUTL_InternalStringReadLE(in + 4, 8);
+        ph->KeyCount = (size_t)keyCount;
+        ph->TableSize = (size_t)tableSize;
+        ph->BucketCount = (size_t)bucketCount;
+
+        SUTLVectorResize(ph->Pilots, ph->BucketCount);
+        SUTLVectorResize(ph->Remap, ph->TableSize - ph->KeyCount);
+
+        in += 36;
+
+        for (i = 0; i < ph->BucketCount; i++, in += 4)
+            ph->Pilots[i] = (uint32_t)SUTL_InternalStringReadLE(in, 4);
+
+        for (i = 0; i < ph->TableSize - ph->KeyCount; i++, in += 4)
+        {
+            ph->Remap[i] = (uint32_t)SUTL_InternalStringReadLE(in, 4);
+
+            /*
+             * Lookups return remapped slots as they are, so each must be a valid index.
+             */
+            if (ph->Remap[i] >= ph->KeyCount)
+            {
+                SUTLVectorResize(ph->Pilots, 0);
+                SUTLVectorResize(ph->Remap, 0);
+                ph->KeyCount = 0;
+                ph->TableSize = 0;
+                ph->BucketCount = 0;
+                ph->Seed = 0;
+
+                SUTLErrorHandler("Invalid serialized perfect hash function.");
+                return 0;
+            }
+        }
+
+        return 1;
+    }
+
+    SUTLPerfectHashmap SUTL_InternalPerfectHashmapNew(size_t keysize, size_t valuesize, const void * keys, const void * values, size_t( * hash)(const void *), int ( * keycomp)(const void *, const void *))
+    {
+        SUTLPerfectHashmap phm;
+        size_t count = SUTLVectorSize(keys);
+        uint64_t * hashes = SUTLVectorNew(uint64_t);
+        size_t i;
+
+        /*
+         * Initialize the members of `phm`.
+         */
+        phm.Size = 0;
+        phm.KeySize = keysize;
+        phm.ValueSize = valuesize;
+        phm.ParamK = SUTLVectorNew(char);
+        phm.Keys = SUTLVectorNew(char);
+        phm.Values = SUTLVectorNew(char);
+        phm.Hash = hash;
+        phm.KeyComp = keycomp;
+
+        SUTLVectorResize(phm.ParamK, keysize);
+
+        if (count != SUTLVectorSize(values))
+        {
+            SUTLErrorHandler("Perfect hashmap keys and values must have the same size.");
+            SUTL_InternalPerfectHashBuild(&phm.Function, hashes, 0);
+            SUTLVectorFree(hashes);
+
+            return phm;
+        }
+
+        SUTLVectorResize(hashes, count);
+
+        for (i = 0; i < count; i++)
+            hashes[i] = hash((const char *)keys + i * keysize);
+
+        if (!SUTL_InternalPerfectHashBuild(&phm.Function, hashes, count))
+        {
+            SUTLVectorFree(hashes);
+            return phm;
+        }
+
+        /*
+         * Store every entry at the index the function gives its key.
+         */
+        SUTLVectorResize(phm.Keys, count * keysize);
+        SUTLVectorResize(phm.Values, count * valuesize);
+
+        for (i = 0; i < count; i++)
+        {
+            size_t index = SUTL_InternalPerfectHashIndex(&phm.Function, hashes[i]);
+
+            SHRN_MEMCPY(phm.Keys + index * keysize, (const char *)keys + i * keysize, keysize);
+            SHRN_MEMCPY(phm.Values + index * valuesize, (const char *)values + i * valuesize, valuesize);
+        }
+
+        phm.Size = count;
+
+        SUTLVectorFree(hashes);
+
+        return phm;
+    }
+
+    void SUTL_InternalPerfectHashmapFree(SUTLPerfectHashmap * phm)
+    {
+        SUTLPerfectHashFree(phm->Function);
+
+        SUTLVectorFree(phm->Values);
+        SUTLVectorFree(phm->Keys);
+        SUTLVectorFree(phm->ParamK);
+    }
+
+    void * SUTL_InternalPerfectHashmapGetWith(SUTLPerfectHashmap * phm, const void * probe, size_t( * hash)(const void *), int ( * cmp)(const void *, const void *))
+    {
+        size_t index;
+
+        if (!phm->Size)
+            return NULL;
+
+        /*
+         * Exactly one slot can hold the key, so one comparison decides the lookup.
+         */
+        index = SUTL_InternalPerfectHashIndex(&phm->Function, hash(probe));
+
+        if (!cmp(probe, phm->Keys + index * phm->KeySize))
+            return NULL;
+
+        return phm->Values + index * phm->ValueSize;
+    }
+
+    void * SUTL_InternalPerfectHashmapGetN(SUTLPerfectHashmap * phm, const char * ptr, size_t size)
+    {
+        SUTLStringView probe = SUTLStringViewNew(ptr, size);
+
+        return SUTL_InternalPerfectHashmapGetWith(phm, &probe, SUTL_HASHFN(strview), SUTL_PROBECMPFN(string));
+    }
+
+    void SUTL_InternalPerfectHashEmitArray(SUTLString * str, const char * name, const char * suffix, const char * type, const uint32_t * values, size_t count)
+    {
+        size_t i;
+
+        SUTLStringAppendP(*str, "static const ");
+        SUTLStringAppendP(*str, type);
+        SUTLStringAppendP(*str, " ");
+        SUTLStringAppendP(*str, name);
+        SUTLStringAppendP(*str, suffix);
+        SUTLStringAppendP(*str, "[");
+        SUTL_InternalStringAppendUInt(str, count, 10);
+        SUTLStringAppendP(*str, "] =\n{");
+
+        /*
+         * Twelve values on every line.
+         */
+        for (i = 0; i < count; i++)
+        {
+            SUTLStringAppendP(*str, i % 12 ? " " : "\n    ");
+            SUTL_InternalStringAppendUInt(str, values[i], 10);
+
+            if (i + 1 < count)
+                SUTLStringAppendP(*str, ",");
+        }
+
+        SUTLStringAppendP(*str, "\n};\n\n");
+    }
+
+    int SUTL_InternalPerfectHashGenerate(const SUTLString * keys, const char * name, SUTLString * str)
+    {
+        SUTLPerfectHash ph;
+        uint64_t * hashes = SUTLVectorNew(uint64_t);
+        uint32_t * slots = SUTLVectorNew(uint32_t);
+        uint32_t * sizes = SUTLVectorNew(uint32_t);
+        size_t count = SUTLVectorSize(keys);
+        size_t i, j;
+
+        if (!count)
+        {
+            SUTLErrorHandler("Perfect hash tables need at least one key.");
+            SUTLVectorFree(sizes);
+            SUTLVectorFree(slots);
+            SUTLVectorFree(hashes);
+
+            return 0;
+        }
+
+        SUTLVectorResize(hashes, count);
+
+        for (i = 0; i < count; i++)
+            hashes[i] = SUTL_InternalHashBytes(keys[i], SUTLStringSize(keys[i]));
+
+        if (!SUTL_InternalPerfectHashBuild(&ph, hashes, count))
+        {
+            SUTLPerfectHashFree(ph);
+            SUTLVectorFree(sizes);
+            SUTLVectorFree(slots);
+            SUTLVectorFree(hashes);
+
+            return 0;
+        }
+
+        /*
+         * `slots` maps every index to the position of its key in `keys`.
+         */
+        SUTLVectorResize(slots, count);
+
+        for (i = 0; i < count; i++)
+            slots[SUTL_InternalPerfectHashIndex(&ph, hashes[i])] = (uint32_t)i;
+
+        SUTLStringAppendP(*str, "/*\n * Generated from ");
+        SUTL_InternalStringAppendUInt(str, count, 10);
+        SUTLStringAppendP(*str, " keys by SUTLPerfectHashGenerate. Don't edit.\n */\n"
+                                "#include <stddef.h>\n#include <stdint.h>\n#include <string.h>\n\n");
+
+        SUTL_InternalPerfectHashEmitArray(str, name, "Pilots", "uint32_t", ph.Pilots, ph.BucketCount);
+        SUTL_InternalPerfectHashEmitArray(str, name, "Remap", "uint32_t", ph.Remap, ph.TableSize - ph.KeyCount);
+        SUTL_InternalPerfectHashEmitArray(str, name, "Ids", "int", slots, count);
+
+        SUTLVectorResize(sizes, count);
+
+        for (i = 0; i < count; i++)
+            sizes[i] = (uint32_t)SUTLStringSize(keys[slots[i]]);
+
+        SUTL_InternalPerfectHashEmitArray(str, name, "Sizes", "uint32_t", sizes, count);
+
+        /*
+         * Emit the keys as string literals, escaping everything but printable ASCII with octal
+         * escapes which always have three digits.
+         */
+        SUTLStringAppendP(*str, "static const char * const ");
+        SUTLStringAppendP(*str, name);
+        SUTLStringAppendP(*str, "Keys[");
+        SUTL_InternalStringAppendUInt(str, count, 10);
+        SUTLStringAppendP(*str, "] =\n{\n");
+
+        for (i = 0; i < count; i++)
+        {
+            SUTLString key = keys[slots[i]];
+
+            SUTLStringAppendP(*str, "    \"");
+
+            for (j = 0; j < SUTLStringSize(key); j++)
+            {
+                unsigned char c = (unsigned char)key[j];
+                char escape[4];
+
+                if (c >= ' ' && c <= '~' && c != '"' && c != '\\' && c != '?')
+                {
+                    SUTLStringAppendN(*str, key + j, 1);
+                }
+                else
+                {
+                    escape[0] = '\\';
+                    escape[1] = (char)('0' + (c >> 6));
+                    escape[2] = (char)('0' + ((c >> 3) & 7));
+                    escape[3] = (char)('0' + (c & 7));
+
+                    SUTLStringAppendN(*str, escape, 4);
+                }
+            }
+
+            SUTLStringAppendP(*str, i + 1 < count ? "\",\n" : "\"\n");
+        }
+
+        SUTLStringAppendP(*str, "};\n\n");
+
+        /*
+         * The mixing function and the index computation mirror SUTL_InternalMix64 and
+         * SUTL_InternalPerfectHashIndex, and the hash is SUTL_InternalHashBytes.
+         */
+        SUTLStringAppendP(*str, "static uint64_t ");
+        SUTLStringAppendP(*str, name);
+        SUTLStringAppendP(*str, "Mix(uint64_t x)\n{\n"
+                                "    x ^= x >> 30;\n    x *= (uint64_t)0xBF58476D1CE4E5B9;\n"
+                                "    x ^= x >> 27;\n    x *= (uint64_t)0x94D049BB133111EB;\n"
+                                "    x ^= x >> 31;\n\n    return x;\n}\n\n");
+
+        SUTLStringAppendP(*str, "static int ");
+        SUTLStringAppendP(*str, name);
+        SUTLStringAppendP(*str, "Lookup(const char * ptr, size_t size)\n{\n"
+                                "    uint64_t hash = (uint64_t)0xCBF29CE484222325;\n"
+                                "    uint64_t slot;\n"
+                                "    size_t i;\n\n"
+                                "    for (i = 0; i < size; i++)\n"
+                                "    {\n"
+                                "        hash ^= (unsigned char)ptr[i];\n"
+                                "        hash *= (uint64_t)0x100000001B3;\n"
+                                "    }\n\n"
+                                "    slot = ");
+        SUTLStringAppendP(*str, name);
+        SUTLStringAppendP(*str, "Mix(hash ^ (uint64_t)0x");
+        SUTL_InternalStringAppendUInt(str, ph.Seed, 16);
+        SUTLStringAppendP(*str, ") % ");
+        SUTL_InternalStringAppendUInt(str, ph.BucketCount, 10);
+        SUTLStringAppendP(*str, "u;\n    slot = ");
+        SUTLStringAppendP(*str, name);
+        SUTLStringAppendP(*str, "Mix(hash ^ ");
+        SUTLStringAppendP(*str, name);
+        SUTLStringAppendP(*str, "Mix((uint64_t)0x");
+        SUTL_InternalStringAppendUInt(str, ph.Seed, 16);
+        SUTLStringAppendP(*str, " + ");
+        SUTLStringAppendP(*str, name);
+        SUTLStringAppendP(*str, "Pilots[slot])) % ");
+        SUTL_InternalStringAppendUInt(str, ph.TableSize, 10);
+        SUTLStringAppendP(*str, "u;\n\n    if (slot >= ");
+        SUTL_InternalStringAppendUInt(str, count, 10);
+        SUTLStringAppendP(*str, "u)\n        slot = ");
+        SUTLStringAppendP(*str, name);
+        SUTLStringAppendP(*str, "Remap[slot - ");
+        SUTL_InternalStringAppendUInt(str, count, 10);
+        SUTLStringAppendP(*str, "u];\n\n    if (");
+        SUTLStringAppendP(*str, name);
+        SUTLStringAppendP(*str, "Sizes[slot] != size || memcmp(");
+        SUTLStringAppendP(*str, name);
+        SUTLStringAppendP(*str, "Keys[slot], ptr, size) != 0)\n        return -1;\n\n    return ");
+        SUTLStringAppendP(*str, name);
+        SUTLStringAppendP(*str, "Ids[slot];\n}\n");
+
+        SUTLPerfectHashFree(ph);
+        SUTLVectorFree(sizes);
+        SUTLVectorFree(slots);
+        SUTLVectorFree(hashes);
+
+        return 1;
+    }
+
+    #undef SUTLPerfectHashPosition
+    #undef SUTLPerfectHashBucket
+    #undef SUTLPerfectHashMaxPilot
+#endif
+
+#endif
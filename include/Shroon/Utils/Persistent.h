@@ -0,0 +1,1135 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_PERSISTENT_H
+#define SUTL_PERSISTENT_H
+
+#include "Common.h"
+#include "HashUtils.h"
+
+/**
+ * @defgroup Persistent
+ * A persistent vector and a persistent hash map, whose versions share structure.
+ *
+ * Both are trees of reference counted nodes with 32 slots. Taking a copy of a version only adds a
+ * reference to its root, and changing a version copies just the nodes on the path to the change
+ * which are shared with other versions; nodes owned by that version alone are changed in place.
+ * Updates therefore take O(log32 n) time and memory, and old versions stay valid and unchanged.
+ *
+ * \p SUTLPersistentVector is a bit-partitioned trie: bits 5 at a time of the index select the
+ * slot on each level, and the last leaf is kept aside as a tail so pushes rarely touch the tree.
+ * \p SUTLPersistentMap is a hash array mapped trie: bits 5 at a time of the hash select the slot,
+ * and each node keeps bitmaps of which slots hold entries and which hold child nodes, and stores
+ * only those. Keys whose hashes are fully equal share a collision node at the bottom.
+ *
+ * One version must not be changed while it is being used by another thread, but different
+ * versions can be read and changed from different threads at the same time, as nodes shared
+ * between versions are never changed and their reference counts are atomic. Elements, keys and
+ * values are copied bytewise and never freed by the containers.
+ * @{
+ */
+
+/**
+ * @brief It contains one version of a persistent vector.
+ */
+typedef struct SUTLPersistentVector
+{
+    /**
+     * @brief The number of elements.
+     */
+    size_t Size;
+
+    /**
+     * @brief The size of the element type.
+     */
+    size_t Elemsize;
+
+    /**
+     * @brief Don't access this directly. The level of \p Root, counted in bits of the index.
+     */
+    unsigned Shift;
+
+    /**
+     * @brief Don't access this directly. The root of the trie, or \p NULL if all elements are in
+     * \p Tail.
+     */
+    void * Root;
+
+    /**
+     * @brief Don't access this directly. The leaf with the last 1 to 32 elements, or \p NULL if
+     * the vector is empty.
+     */
+    void * Tail;
+} SUTLPersistentVector;
+
+/**
+ * @brief It contains one version of a persistent hash map.
+ */
+typedef struct SUTLPersistentMap
+{
+    /**
+     * @brief The number of entries.
+     */
+    size_t Size;
+
+    /**
+     * @brief The size of the key type.
+     */
+    size_t KeySize;
+
+    /**
+     * @brief The size of the value type.
+     */
+    size_t ValueSize;
+
+    /**
+     * @brief Don't access this directly. The root of the trie, or \p NULL if the map is empty.
+     */
+    void * Root;
+
+    /**
+     * @brief The function pointer which hashes the key type of the map.
+     */
+    size_t( * Hash)(const void *);
+
+    /**
+     * @brief The function pointer which compares two keys.
+     */
+    int( * KeyComp)(const void *, const void *);
+} SUTLPersistentMap;
+
+/**
+ * @brief Creates a new empty \p SUTLPersistentVector of type \p t.
+ *
+ * @param t The type of element which the vector will store.
+ *
+ * @return A \p SUTLPersistentVector.
+ */
+#define SUTLPersistentVectorNew(t)              SUTL_InternalPersistentVectorNew(sizeof(t))
+
+/**
+ * @brief Frees a version of a persistent vector. Nodes shared with other versions are kept.
+ *
+ * @param pv The \p SUTLPersistentVector to free.
+ */
+#define SUTLPersistentVectorFree(pv)            SUTL_InternalPersistentVectorFree(&pv)
+
+/**
+ * @brief Takes a copy of a version of a persistent vector in O(1). The copy must be freed
+ * separately.
+ *
+ * @param pv The \p SUTLPersistentVector to copy.
+ *
+ * @return The \p SUTLPersistentVector copy.
+ */
+#define SUTLPersistentVectorCopy(pv)            SUTL_InternalPersistentVectorCopy(&pv)
+
+/**
+ * @brief Gets a pointer to the element at index \p i of \p pv.
+ *
+ * @param t The type of element stored in \p pv.
+ * @param pv The \p SUTLPersistentVector to get from.
+ * @param i The index of the element. It must be less than the size of \p pv.
+ *
+ * @return A <tt>const t *</tt> to the element, valid until \p pv is changed or freed. If \p i is out
+ * of range, an error is reported and \p NULL is returned.
+ */
+#define SUTLPersistentVectorAt(t, pv, i)        ((const t *)SUTL_InternalPersistentVectorAt(&pv, i))
+
+/**
+ * @brief Replaces the element at index \p i of \p pv with \p elem.
+ *
+ * @param pv The \p SUTLPersistentVector to change.
+ * @param i The index of the element. It must be less than the size of \p pv.
+ * @param elem The new element. Must be an lvalue.
+ */
+#define SUTLPersistentVectorSet(pv, i, elem)    SUTL_InternalPersistentVectorSet(&pv, i, &elem)
+
+/**
+ * @brief Pushes \p elem at the end of \p pv.
+ *
+ * @param pv The \p SUTLPersistentVector to push to.
+ * @param elem The element to push. Must be an lvalue.
+ */
+#define SUTLPersistentVectorPush(pv, elem)      SUTL_InternalPersistentVectorPush(&pv, &elem)
+
+/**
+ * @brief Pops the last element of \p pv.
+ *
+ * @param pv The \p SUTLPersistentVector to pop from.
+ */
+#define SUTLPersistentVectorPop(pv)             SUTL_InternalPersistentVectorPop(&pv)
+
+/**
+ * @brief Creates a new empty \p SUTLPersistentMap with key type \p tk and value type \p tv.
+ *
+ * @param tk The key type for the map.
+ * @param tv The value type for the map.
+ * @param hash A function of the signature <tt>size_t(const void *)</tt> that hashes \p tk.
+ * @param cmp A function of signature <tt>int(const void *, const void *)</tt> that compares two
+ * \p tk s for equality. (Similar to the \p == operator)
+ *
+ * @return A \p SUTLPersistentMap.
+ */
+#define SUTLPersistentMapNew(tk, tv, hash, cmp) SUTL_InternalPersistentMapNew(sizeof(tk), sizeof(tv), hash, cmp)
+
+/**
+ * @brief Frees a version of a persistent map. Nodes shared with other versions are kept.
+ *
+ * @param pm The \p SUTLPersistentMap to free.
+ */
+#define SUTLPersistentMapFree(pm)               SUTL_InternalPersistentMapFree(&pm)
+
+/**
+ * @brief Takes a copy of a version of a persistent map in O(1). The copy must be freed separately.
+ *
+ * @param pm The \p SUTLPersistentMap to copy.
+ *
+ * @return The \p SUTLPersistentMap copy.
+ */
+#define SUTLPersistentMapCopy(pm)               SUTL_InternalPersistentMapCopy(&pm)
+
+/**
+ * @brief Gets the value assigned to the key at \p kptr in \p pm. Keys are passed by pointer, so
+ * that a version can be searched from several threads at once.
+ *
+ * @param tv The value type of \p pm.
+ * @param pm The \p SUTLPersistentMap to get from.
+ * @param kptr A pointer to the key to search for.
+ *
+ * @return A <tt>const tv *</tt> to the value, valid until \p pm is changed or freed. If the key
+ * doesn't exist in \p pm then it is \p NULL.
+ */
+#define SUTLPersistentMapGet(tv, pm, kptr)      ((const tv *)SUTL_InternalPersistentMapGet(&pm, kptr))
+
+/**
+ * @brief Assigns the value at \p vptr to the key at \p kptr in \p pm, adding the entry or
+ * replacing the value of an existing one.
+ *
+ * @param pm The \p SUTLPersistentMap to change.
+ * @param kptr A pointer to the key.
+ * @param vptr A pointer to the value.
+ */
+#define SUTLPersistentMapSet(pm, kptr, vptr)    SUTL_InternalPersistentMapSet(&pm, kptr, vptr)
+
+/**
+ * @brief Erases the entry with the key at \p kptr from \p pm, if it exists.
+ *
+ * @param pm The \p SUTLPersistentMap to change.
+ * @param kptr A pointer to the key.
+ */
+#define SUTLPersistentMapErase(pm, kptr)        SUTL_InternalPersistentMapErase(&pm, kptr)
+
+/**
+ * @brief Executes \p expr for every entry in \p pm, which must not be changed meanwhile.
+ *
+ * @param tk The key type of \p pm.
+ * @param tv The value type of \p pm.
+ * @param pm The \p SUTLPersistentMap to iterate.
+ * @param name The prefix for current entry. Key will have suffix \p _k and value will have suffix
+ * \p _v.
+ * @param expr The code block to execute for every entry.
+ */
+#define SUTLPersistentMapEach(tk, tv, pm, name, expr) \
+    {\
+        SUTLPersistentMapIter name##_it = SUTL_InternalPersistentMapIterNew(&pm);\
+        char * name##_e;\
+        while ((name##_e = SUTL_InternalPersistentMapIterNext(&pm, &name##_it)) != NULL)\
+        {\
+            const tk * name##_k = (const tk *)name##_e;\
+            const tv * name##_v = (const tv *)(name##_e + SUTL_PERSISTENT_MAP_VALUE_OFFSET(&pm));\
+            expr\
+        }\
+    }
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+
+/*
+ * Every node starts with this header, followed by its slots at an 8 byte aligned offset.
+ */
+typedef struct SUTLPersistentNode
+{
+    SHRN_ATOMIC(size_t) Refs;
+    uint32_t DataMap;
+    uint32_t NodeMap;
+} SUTLPersistentNode;
+
+#define SUTL_PERSISTENT_HEADER              ((sizeof(SUTLPersistentNode) + 7) & ~(size_t)7)
+#define SUTL_PERSISTENT_HASH_BITS           (sizeof(size_t) * 8)
+#define SUTL_PERSISTENT_MAP_MAX_DEPTH       (sizeof(size_t) * 8 / 5 + 2)
+#define SUTL_PERSISTENT_MAP_VALUE_OFFSET(pm) (((pm)->KeySize + 7) & ~(size_t)7)
+#define SUTL_PERSISTENT_MAP_ENTRY_SIZE(pm)  ((SUTL_PERSISTENT_MAP_VALUE_OFFSET(pm) + (pm)->ValueSize + 7) & ~(size_t)7)
+
+typedef struct SUTLPersistentMapIter
+{
+    size_t Depth;
+    void * Nodes[SUTL_PERSISTENT_MAP_MAX_DEPTH];
+    uint32_t Index[SUTL_PERSISTENT_MAP_MAX_DEPTH];
+} SUTLPersistentMapIter;
+
+SUTLPersistentVector SUTL_InternalPersistentVectorNew(size_t elemsize);
+void SUTL_InternalPersistentVectorFree(SUTLPersistentVector * pv);
+SUTLPersistentVector SUTL_InternalPersistentVectorCopy(const SUTLPersistentVector * pv);
+const void * SUTL_InternalPersistentVectorAt(const SUTLPersistentVector * pv, size_t i);
+void SUTL_InternalPersistentVectorSet(SUTLPersistentVector * pv, size_t i, const void * elem);
+void SUTL_InternalPersistentVectorPush(SUTLPersistentVector * pv, const void * elem);
+void SUTL_InternalPersistentVectorPop(SUTLPersistentVector * pv);
+
+SUTLPersistentMap SUTL_InternalPersistentMapNew(size_t keysize, size_t valuesize, size_t( * hash)(const void *), int ( * keycomp)(const void *, const void *));
+void SUTL_InternalPersistentMapFree(SUTLPersistentMap * pm);
+SUTLPersistentMap SUTL_InternalPersistentMapCopy(const SUTLPersistentMap * pm);
+const void * SUTL_InternalPersistentMapGet(const SUTLPersistentMap * pm, const void * key);
+void SUTL_InternalPersistentMapSet(SUTLPersistentMap * pm, const void * key, const void * value);
+void SUTL_InternalPersistentMapErase(SUTLPersistentMap * pm, const void * key);
+SUTLPersistentMapIter SUTL_InternalPersistentMapIterNew(const SUTLPersistentMap * pm);
+char * SUTL_InternalPersistentMapIterNext(const SUTLPersistentMap * pm, SUTLPersistentMapIter * it);
+
+unsigned SUTL_InternalPersistentPopcount(uint32_t x);
+void * SUTL_InternalPersistentNodeNew(size_t size);
+void SUTL_InternalPersistentRetain(void * node);
+void SUTL_InternalPersistentVectorRelease(void * node, unsigned level);
+void * SUTL_InternalPersistentVectorUnique(void * node, unsigned level, size_t elemsize);
+void * SUTL_InternalPersistentVectorPath(unsigned level, void * leaf);
+void * SUTL_InternalPersistentVectorPopTail(void * node, unsigned level, size_t i, size_t elemsize);
+void SUTL_InternalPersistentMapCounts(const void * node, size_t shift, size_t * entries, size_t * children);
+void SUTL_InternalPersistentMapRelease(const SUTLPersistentMap * pm, void * node, size_t shift);
+void * SUTL_InternalPersistentMapUnique(const SUTLPersistentMap * pm, void * node, size_t shift);
+void * SUTL_InternalPersistentMapResize(const SUTLPersistentMap * pm, void * node, size_t shift, uint32_t datamap, uint32_t nodemap, size_t skip, size_t insert);
+void * SUTL_InternalPersistentMapMerge(const SUTLPersistentMap * pm, const char * entry, size_t entryhash, const void * key, const void * value, size_t hash, size_t shift);
+void * SUTL_InternalPersistentMapSetNode(const SUTLPersistentMap * pm, void * node, size_t shift, size_t hash, const void * key, const void * value, int * added);
+void * SUTL_InternalPersistentMapEraseNode(const SUTLPersistentMap * pm, void * node, size_t shift, size_t hash, const void * key);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    #define SUTLPersistentData(node)        ((char *)(node) + SUTL_PERSISTENT_HEADER)
+    #define SUTLPersistentChildren(node)    ((void **)SUTLPersistentData(node))
+    #define SUTLPersistentNode(node)        ((SUTLPersistentNode *)(node))
+
+    /*
+     * Map nodes hold their entries first, each a key and a value at 8 byte aligned offsets,
+     * followed by the pointers to their children.
+     */
+    #define SUTLPersistentMapChildren(pm, node, entries) \
+        ((void **)(SUTLPersistentData(node) + (entries) * SUTL_PERSISTENT_MAP_ENTRY_SIZE(pm)))
+
+    #define SUTLPersistentMapWrite(pm, e, key, value) \
+        (SHRN_MEMCPY(e, key, (pm)->KeySize), SHRN_MEMCPY((char *)(e) + SUTL_PERSISTENT_MAP_VALUE_OFFSET(pm), value, (pm)->ValueSize))
+
+    /*
+     * Adding a reference needs no ordering, as it is taken from a version which already holds one.
+     * Dropping one orders the accesses of its owner before the free by the last owner.
+     */
+    #ifdef SHRN_HAS_ATOMICS
+        #define SUTLPersistentRefsLoad(node)    SHRN_ATOMIC_LOAD(&SUTLPersistentNode(node)->Refs, SHRN_ORDER_ACQUIRE)
+        #define SUTLPersistentRefsAdd(node)     ((void)SHRN_ATOMIC_FETCH_ADD(&SUTLPersistentNode(node)->Refs, 1, SHRN_ORDER_RELAXED))
+        #define SUTLPersistentRefsSub(node)     (SHRN_ATOMIC_FETCH_SUB(&SUTLPersistentNode(node)->Refs, 1, SHRN_ORDER_ACQ_REL) - 1)
+    #else
+        #define SUTLPersistentRefsLoad(node)    (SUTLPersistentNode(node)->Refs)
+        #define SUTLPersistentRefsAdd(node)     ((void)++SUTLPersistentNode(node)->Refs)
+        #define SUTLPersistentRefsSub(node)     (--SUTLPersistentNode(node)->Refs)
+    #endif
+
+    unsigned SUTL_InternalPersistentPopcount(uint32_t x)
+    {
+        #if defined(__GNUC__)
+            return (unsigned)__builtin_popcount(x);
+        #else
+            x = x - ((x >> 1) & 0x55555555UL);
+            x = (x & 0x33333333UL) + ((x >> 2) & 0x33333333UL);
+            x = (x + (x >> 4)) & 0x0F0F0F0FUL;
+
+            return (unsigned)((x * 0x01010101UL) >> 24) & 0xFF;
+        #endif
+    }
+
+    void * SUTL_InternalPersistentNodeNew(size_t size)
+    {
+        SUTLPersistentNode * node = (SUTLPersistentNode *)SHRN_MALLOC(SUTL_PERSISTENT_HEADER + size);
+
+        if (!node)
+        {
+            SUTLErrorHandler("Memory allocation failed.");
+            return NULL;
+        }
+
+        node->Refs = 1;
+        node->DataMap = 0;
+        node->NodeMap = 0;
+
+        return node;
+    }
+
+    void SUTL_InternalPersistentRetain(void * node)
+    {
+        SUTLPersistentRefsAdd(node);
+    }
+
+    /*
+     * Vector
+     */
+    SUTLPersistentVector SUTL_InternalPersistentVectorNew(size_t elemsize)
+    {
+        SUTLPersistentVector pv;
+
+        /*
+         * Initialize the members of `pv`.
+         */
+        pv.Size = 0;
+        pv.Elemsize = elemsize;
+        pv.Shift = 5;
+        pv.Root = NULL;
+        pv.Tail = NULL;
+
+        return pv;
+    }
+
+    void SUTL_InternalPersistentVectorRelease(void * node, unsigned level)
+    {
+        size_t i;
+
+        if (!node || SUTLPersistentRefsSub(node))
+            return;
+
+        if (level)
+            for (i = 0; i < 32; i++)
+                SUTL_InternalPersistentVectorRelease(SUTLPersistentChildren(node)[i], level - 5);
+
+        SHRN_FREE(node);
+    }
+
+    void SUTL_InternalPersistentVectorFree(SUTLPersistentVector * pv)
+    {
+        SUTL_InternalPersistentVectorRelease(pv->Root, pv->Shift);
+        SUTL_InternalPersistentVectorRelease(pv->Tail, 0);
+
+        pv->Size = 0;
+        pv->Shift = 5;
+        pv->Root = NULL;
+        pv->Tail = NULL;
+    }
+
+    SUTLPersistentVector SUTL_InternalPersistentVectorCopy(const SUTLPersistentVector * pv)
+    {
+        if (pv->Root)
+            SUTLPersistentRefsAdd(pv->Root);
+
+        if (pv->Tail)
+            SUTLPersistentRefsAdd(pv->Tail);
+
+        return *pv;
+    }
+
+    void * SUTL_InternalPersistentVectorUnique(void * node, unsigned level, size_t elemsize)
+    {
+        size_t size = level ? 32 * sizeof(void *) : 32 * elemsize;
+        void * copy;
+        size_t i;
+
+        /*
+         * A node with a single reference belongs only to the version being changed.
+         */
+        if (SUTLPersistentRefsLoad(node) == 1)
+            return node;
+
+        copy = SUTL_InternalPersistentNodeNew(size);
+        SHRN_MEMCPY(SUTLPersistentData(copy), SUTLPersistentData(node), size);
+
+        if (level)
+            for (i = 0; i < 32; i++)
+                if (SUTLPersistentChildren(copy)[i])
+                    SUTLPersistentRefsAdd(SUTLPersistentChildren(copy)[i]);
+
+        SUTL_InternalPersistentVectorRelease(node, level);
+
+        return copy;
+    }
+
+    void * SUTL_InternalPersistentVectorPath(unsigned level, void * leaf)
+    {
+        void * node;
+
+        if (!level)
+            return leaf;
+
+        node = SUTL_InternalPersistentNodeNew(32 * sizeof(void *));
+        SHRN_MEMSET(SUTLPersistentData(node), 0, 32 * sizeof(void *));
+
+        SUTLPersistentChildren(node)[0] = SUTL_InternalPersistentVectorPath(level - 5, leaf);
+
+        return node;
+    }
+
+    const void * SUTL_InternalPersistentVectorAt(const SUTLPersistentVector * pv, size_t i)
+    {
+        size_t tail = (pv->Size - 1) & ~(size_t)31;
+        const void * node = pv->Root;
+        unsigned level;
+
+        if (i >= pv->Size)
+        {
+            SUTLErrorHandler("Index out of range.");
+            return NULL;
+        }
+
+        if (i >= tail)
+            return SUTLPersistentData(pv->Tail) + (i - tail) * pv->Elemsize;
+
+        for (level = pv->Shift; level; level -= 5)
+            node = SUTLPersistentChildren(node)[(i >> level) & 31];
+
+        return SUTLPersistentData(node) + (i & 31) * pv->Elemsize;
+    }
+
+    void SUTL_InternalPersistentVectorSet(SUTLPersistentVector * pv, size_t i, const void * elem)
+    {
+        size_t tail = (pv->Size - 1) & ~(size_t)31;
+        void ** slot = &pv->Root;
+        unsigned level;
+
+        if (i >= pv->Size)
+        {
+            SUTLErrorHandler("Index out of range.");
+            return;
+        }
+
+        if (i >= tail)
+        {
+            pv->Tail = SUTL_InternalPersistentVectorUnique(pv->Tail, 0, pv->Elemsize);
+            SHRN_MEMCPY(SUTLPersistentData(pv->Tail) + (i - tail) * pv->Elemsize, elem, pv->Elemsize);
+
+            return;
+        }
+
+        /*
+         * Make every node on the path unique to this version, then change the leaf in place.
+         */
+        for (level = pv->Shift; ; level -= 5)
+        {
+            *slot = SUTL_InternalPersistentVectorUnique(*slot, level, pv->Elemsize);
+
+            if (!level)
+                break;
+
+            slot = &SUTLPersistentChildren(*slot)[(i >> level) & 31];
+        }
+
+        SHRN_MEMCPY(SUTLPersistentData(*slot) + (i & 31) * pv->Elemsize, elem, pv->Elemsize);
+    }
+
+    void SUTL_InternalPersistentVectorPush(SUTLPersistentVector * pv, const void * elem)
+    {
+        size_t tail = (pv->Size - 1) & ~(size_t)31;
+        void ** slot;
+        void * root;
+        unsigned level;
+
+        if (!pv->Size)
+        {
+            pv->Tail = SUTL_InternalPersistentNodeNew(32 * pv->Elemsize);
+            SHRN_MEMCPY(SUTLPersistentData(pv->Tail), elem, pv->Elemsize);
+            pv->Size = 1;
+
+            return;
+        }
+
+        /*
+         * Append to the tail while it has room.
+         */
+        if (pv->Size - tail < 32)
+        {
+            pv->Tail = SUTL_InternalPersistentVectorUnique(pv->Tail, 0, pv->Elemsize);
+            SHRN_MEMCPY(SUTLPersistentData(pv->Tail) + (pv->Size - tail) * pv->Elemsize, elem, pv->Elemsize);
+            pv->Size++;
+
+            return;
+        }
+
+        /*
+         * Move the full tail into the trie, adding a level on top when the trie is full.
+         */
+        if (!pv->Root)
+        {
+            pv->Root = SUTL_InternalPersistentVectorPath(5, pv->Tail);
+            pv->Shift = 5;
+        }
+        else if ((pv->Size >> 5) > ((size_t)1 << pv->Shift))
+        {
+            root = SUTL_InternalPersistentNodeNew(32 * sizeof(void *));
+            SHRN_MEMSET(SUTLPersistentData(root), 0, 32 * sizeof(void *));
+
+            SUTLPersistentChildren(root)[0] = pv->Root;
+            SUTLPersistentChildren(root)[1] = SUTL_InternalPersistentVectorPath(pv->Shift, pv->Tail);
+
+            pv->Root = root;
+            pv->Shift += 5;
+        }
+        else
+        {
+            slot = &pv->Root;
+
+            for (level = pv->Shift; ; level -= 5)
+            {
+                *slot = SUTL_InternalPersistentVectorUnique(*slot, level, pv->Elemsize);
+                slot = &SUTLPersistentChildren(*slot)[(tail >> level) & 31];
+
+                if (!*slot || level == 5)
+                    break;
+            }
+
+            *slot = SUTL_InternalPersistentVectorPath(level - 5, pv->Tail);
+        }
+
+        pv->Tail = SUTL_InternalPersistentNodeNew(32 * pv->Elemsize);
+        SHRN_MEMCPY(SUTLPersistentData(pv->Tail), elem, pv->Elemsize);
+        pv->Size++;
+    }
+
+    void * SUTL_InternalPersistentVectorPopTail(void * node, unsigned level, size_t i, size_t elemsize)
+    {
+        size_t sub = (i >> level) & 31;
+        void ** children;
+
+        node = SUTL_InternalPersistentVectorUnique(node, level, elemsize);
+        children = SUTLPersistentChildren(node);
+
+        /*
+         * Remove the path to the last leaf, and the nodes which become empty on the way.
+         */
+        if (level > 5)
+            children[sub] = SUTL_InternalPersistentVectorPopTail(children[sub], level - 5, i, elemsize);
+        else
+        {
+            SUTL_InternalPersistentVectorRelease(children[sub], 0);
+            children[sub] = NULL;
+        }
+
+        if (!sub && !children[0])
+        {
+            SHRN_FREE(node);
+            return NULL;
+        }
+
+        return node;
+    }
+
+    void SUTL_InternalPersistentVectorPop(SUTLPersistentVector * pv)
+    {
+        size_t tail = (pv->Size - 1) & ~(size_t)31;
+        const void * last;
+        void * root;
+        unsigned level;
+
+        if (!pv->Size)
+        {
+            SUTLErrorHandler("Can't pop from an empty persistent vector.");
+            return;
+        }
+
+        /*
+         * Elements past the size are ignored, so the tail doesn't have to be copied.
+         */
+        if (pv->Size - tail > 1 || pv->Size == 1)
+        {
+            if (--pv->Size == 0)
+                SUTL_InternalPersistentVectorFree(pv);
+
+            return;
+        }
+
+        /*
+         * The last leaf of the trie becomes the tail.
+         */
+        last = pv->Root;
+
+        for (level = pv->Shift; level; level -= 5)
+            last = SUTLPersistentChildren(last)[((pv->Size - 2) >> level) & 31];
+
+        SUTLPersistentRefsAdd(last);
+        SUTL_InternalPersistentVectorRelease(pv->Tail, 0);
+        pv->Tail = (void *)last;
+
+        pv->Root = SUTL_InternalPersistentVectorPopTail(pv->Root, pv->Shift, pv->Size - 2, pv->Elemsize);
+        pv->Size--;
+
+        /*
+         * Remove a level from the top when only its first child is left.
+         */
+        if (!pv->Root)
+            pv->Shift = 5;
+        else if (pv->Shift > 5 && !SUTLPersistentChildren(pv->Root)[1])
+        {
+            root = SUTLPersistentChildren(pv->Root)[0];
+            SHRN_FREE(pv->Root);
+
+            pv->Root = root;
+            pv->Shift -= 5;
+        }
+    }
+
+    /*
+     * Map
+     */
+    SUTLPersistentMap SUTL_InternalPersistentMapNew(size_t keysize, size_t valuesize, size_t( * hash)(const void *), int ( * keycomp)(const void *, const void *))
+    {
+        SUTLPersistentMap pm;
+
+        /*
+         * Initialize the members of `pm`.
+         */
+        pm.Size = 0;
+        pm.KeySize = keysize;
+        pm.ValueSize = valuesize;
+        pm.Root = NULL;
+        pm.Hash = hash;
+        pm.KeyComp = keycomp;
+
+        return pm;
+    }
+
+    void SUTL_InternalPersistentMapCounts(const void * node, size_t shift, size_t * entries, size_t * children)
+    {
+        /*
+         * Below the last level of hash bits, nodes hold colliding entries and `DataMap` counts them.
+         */
+        if (shift >= SUTL_PERSISTENT_HASH_BITS)
+        {
+            *entries = SUTLPersistentNode(node)->DataMap;
+            *children = 0;
+        }
+        else
+        {
+            *entries = SUTL_InternalPersistentPopcount(SUTLPersistentNode(node)->DataMap);
+            *children = SUTL_InternalPersistentPopcount(SUTLPersistentNode(node)->NodeMap);
+        }
+    }
+
+    void SUTL_InternalPersistentMapRelease(const SUTLPersistentMap * pm, void * node, size_t shift)
+    {
+        size_t entries, children, i;
+
+        if (!node || SUTLPersistentRefsSub(node))
+            return;
+
+        SUTL_InternalPersistentMapCounts(node, shift, &entries, &children);
+
+        for (i = 0; i < children; i++)
+            SUTL_InternalPersistentMapRelease(pm, SUTLPersistentMapChildren(pm, node, entries)[i], shift + 5);
+
+        SHRN_FREE(node);
+    }
+
+    void SUTL_InternalPersistentMapFree(SUTLPersistentMap * pm)
+    {
+        SUTL_InternalPersistentMapRelease(pm, pm->Root, 0);
+
+        pm->Root = NULL;
+        pm->Size = 0;
+    }
+
+    SUTLPersistentMap SUTL_InternalPersistentMapCopy(const SUTLPersistentMap * pm)
+    {
+        if (pm->Root)
+            SUTLPersistentRefsAdd(pm->Root);
+
+        return *pm;
+    }
+
+    void * SUTL_InternalPersistentMapUnique(const SUTLPersistentMap * pm, void * node, size_t shift)
+    {
+        size_t entries, children, size, i;
+        void * copy;
+
+        if (SUTLPersistentRefsLoad(node) == 1)
+            return node;
+
+        SUTL_InternalPersistentMapCounts(node, shift, &entries, &children);
+        size = entries * SUTL_PERSISTENT_MAP_ENTRY_SIZE(pm) + children * sizeof(void *);
+
+        copy = SUTL_InternalPersistentNodeNew(size);
+        SUTLPersistentNode(copy)->DataMap = SUTLPersistentNode(node)->DataMap;
+        SUTLPersistentNode(copy)->NodeMap = SUTLPersistentNode(node)->NodeMap;
+        SHRN_MEMCPY(SUTLPersistentData(copy), SUTLPersistentData(node), size);
+
+        for (i = 0; i < children; i++)
+            SUTLPersistentRefsAdd(SUTLPersistentMapChildren(pm, copy, entries)[i]);
+
+        SUTL_InternalPersistentMapRelease(pm, node, shift);
+
+        return copy;
+    }
+
+    void * SUTL_InternalPersistentMapResize(const SUTLPersistentMap * pm, void * node, size_t shift, uint32_t datamap, uint32_t nodemap, size_t skip, size_t insert)
+    {
+        size_t esize = SUTL_PERSISTENT_MAP_ENTRY_SIZE(pm);
+        size_t entries, children, newentries, newchildren;
+        void * resized;
+
+        /*
+         * Moves the slots of a uniquely owned `node` into a node for the new bitmaps, leaving out
+         * entry `skip` and a gap for entry `insert` (either can be `(size_t)-1` for none). The
+         * children are copied in order, and the caller fills in the changed one.
+         */
+        SUTL_InternalPersistentMapCounts(node, shift, &entries, &children);
+
+        if (shift >= SUTL_PERSISTENT_HASH_BITS)
+        {
+            newentries = datamap;
+            newchildren = 0;
+        }
+        else
+        {
+            newentries = SUTL_InternalPersistentPopcount(datamap);
+            newchildren = SUTL_InternalPersistentPopcount(nodemap);
+        }
+
+        if (!newentries && !newchildren)
+        {
+            SHRN_FREE(node);
+            return NULL;
+        }
+
+        resized = SUTL_InternalPersistentNodeNew(newentries * esize + newchildren * sizeof(void *));
+        SUTLPersistentNode(resized)->DataMap = datamap;
+        SUTLPersistentNode(resized)->NodeMap = nodemap;
+
+        if (skip != (size_t)-1)
+        {
+            SHRN_MEMCPY(SUTLPersistentData(resized), SUTLPersistentData(node), skip * esize);
+            SHRN_MEMCPY(SUTLPersistentData(resized) + skip * esize, SUTLPersistentData(node) + (skip + 1) * esize, (entries - skip - 1) * esize);
+        }
+        else if (insert != (size_t)-1)
+        {
+            SHRN_MEMCPY(SUTLPersistentData(resized), SUTLPersistentData(node), insert * esize);
+            SHRN_MEMCPY(SUTLPersistentData(resized) + (insert + 1) * esize, SUTLPersistentData(node) + insert * esize, (entries - insert) * esize);
+        }
+        else
+            SHRN_MEMCPY(SUTLPersistentData(resized), SUTLPersistentData(node), entries * esize);
+
+        if (newchildren)
+            SHRN_MEMCPY(SUTLPersistentMapChildren(pm, resized, newentries), SUTLPersistentMapChildren(pm, node, entries), (children < newchildren ? children : newchildren) * sizeof(void *));
+
+        SHRN_FREE(node);
+
+        return resized;
+    }
+
+    void * SUTL_InternalPersistentMapMerge(const SUTLPersistentMap * pm, const char * entry, size_t entryhash, const void * key, const void * value, size_t hash, size_t shift)
+    {
+        size_t esize = SUTL_PERSISTENT_MAP_ENTRY_SIZE(pm);
+        uint32_t a, b;
+        char * e;
+        void * node;
+
+        /*
+         * Two entries whose hashes are fully equal go into a collision node.
+         */
+        if (shift >= SUTL_PERSISTENT_HASH_BITS)
+        {
+            node = SUTL_InternalPersistentNodeNew(2 * esize);
+            SUTLPersistentNode(node)->DataMap = 2;
+            SHRN_MEMCPY(SUTLPersistentData(node), entry, esize);
+            SUTLPersistentMapWrite(pm, SUTLPersistentData(node) + esize, key, value);
+
+            return node;
+        }
+
+        a = (uint32_t)(entryhash >> shift) & 31;
+        b = (uint32_t)(hash >> shift) & 31;
+
+        /*
+         * While the hash bits are equal the entries share a chain of single child nodes.
+         */
+        if (a == b)
+        {
+            node = SUTL_InternalPersistentNodeNew(sizeof(void *));
+            SUTLPersistentNode(node)->NodeMap = (uint32_t)1 << a;
+            SUTLPersistentChildren(node)[0] = SUTL_InternalPersistentMapMerge(pm, entry, entryhash, key, value, hash, shift + 5);
+
+            return node;
+        }
+
+        node = SUTL_InternalPersistentNodeNew(2 * esize);
+        SUTLPersistentNode(node)->DataMap = ((uint32_t)1 << a) | ((uint32_t)1 << b);
+
+        e = SUTLPersistentData(node);
+        SHRN_MEMCPY(a < b ? e : e + esize, entry, esize);
+        SUTLPersistentMapWrite(pm, a < b ? e + esize : e, key, value);
+
+        return node;
+    }
+
+    const void * SUTL_InternalPersistentMapGet(const SUTLPersistentMap * pm, const void * key)
+    {
+        size_t esize = SUTL_PERSISTENT_MAP_ENTRY_SIZE(pm);
+        size_t hash, shift, entries, children, i;
+        const void * node = pm->Root;
+        uint32_t bit;
+        char * e;
+
+        if (!node)
+            return NULL;
+
+        hash = pm->Hash(key);
+
+        for (shift = 0; node; shift += 5)
+        {
+            SUTL_InternalPersistentMapCounts(node, shift, &entries, &children);
+
+            if (shift >= SUTL_PERSISTENT_HASH_BITS)
+            {
+                for (i = 0, e = SUTLPersistentData(node); i < entries; i++, e += esize)
+                    if (pm->KeyComp(key, e))
+                        return e + SUTL_PERSISTENT_MAP_VALUE_OFFSET(pm);
+
+                return NULL;
+            }
+
+            bit = (uint32_t)1 << ((hash >> shift) & 31);
+
+            if (SUTLPersistentNode(node)->DataMap & bit)
+            {
+                e = SUTLPersistentData(node) + SUTL_InternalPersistentPopcount(SUTLPersistentNode(node)->DataMap & (bit - 1)) * esize;
+
+                return pm->KeyComp(key, e) ? e + SUTL_PERSISTENT_MAP_VALUE_OFFSET(pm) : NULL;
+            }
+
+            if (!(SUTLPersistentNode(node)->NodeMap & bit))
+                return NULL;
+
+            node = SUTLPersistentMapChildren(pm, node, entries)[SUTL_InternalPersistentPopcount(SUTLPersistentNode(node)->NodeMap & (bit - 1))];
+        }
+
+        return NULL;
+    }
+
+    void * SUTL_InternalPersistentMapSetNode(const SUTLPersistentMap * pm, void * node, size_t shift, size_t hash, const void * key, const void * value, int * added)
+    {
+        size_t esize = SUTL_PERSISTENT_MAP_ENTRY_SIZE(pm);
+        size_t entries, children, i;
+        uint32_t datamap, nodemap, bit;
+        void ** slot;
+        void * child;
+        char * e;
+
+        node = SUTL_InternalPersistentMapUnique(pm, node, shift);
+        SUTL_InternalPersistentMapCounts(node, shift, &entries, &children);
+        datamap = SUTLPersistentNode(node)->DataMap;
+        nodemap = SUTLPersistentNode(node)->NodeMap;
+
+        if (shift >= SUTL_PERSISTENT_HASH_BITS)
+        {
+            for (i = 0, e = SUTLPersistentData(node); i < entries; i++, e += esize)
+                if (pm->KeyComp(key, e))
+                {
+                    SHRN_MEMCPY(e + SUTL_PERSISTENT_MAP_VALUE_OFFSET(pm), value, pm->ValueSize);
+                    return node;
+                }
+
+            node = SUTL_InternalPersistentMapResize(pm, node, shift, datamap + 1, 0, (size_t)-1, entries);
+            SUTLPersistentMapWrite(pm, SUTLPersistentData(node) + entries * esize, key, value);
+            *added = 1;
+
+            return node;
+        }
+
+        bit = (uint32_t)1 << ((hash >> shift) & 31);
+        i = SUTL_InternalPersistentPopcount(datamap & (bit - 1));
+        e = SUTLPersistentData(node) + i * esize;
+
+        /*
+         * An entry in the slot is either replaced, or moved together with the new entry into a
+         * child node.
+         */
+        if (datamap & bit)
+        {
+            if (pm->KeyComp(key, e))
+            {
+                SHRN_MEMCPY(e + SUTL_PERSISTENT_MAP_VALUE_OFFSET(pm), value, pm->ValueSize);
+                return node;
+            }
+
+            child = SUTL_InternalPersistentMapMerge(pm, e, pm->Hash(e), key, value, hash, shift + 5);
+            node = SUTL_InternalPersistentMapResize(pm, node, shift, datamap & ~bit, nodemap | bit, i, (size_t)-1);
+
+            slot = SUTLPersistentMapChildren(pm, node, entries - 1);
+            i = SUTL_InternalPersistentPopcount(nodemap & (bit - 1));
+            SHRN_MEMMOVE(slot + i + 1, slot + i, (children - i) * sizeof(void *));
+            slot[i] = child;
+            *added = 1;
+
+            return node;
+        }
+
+        if (nodemap & bit)
+        {
+            slot = &SUTLPersistentMapChildren(pm, node, entries)[SUTL_InternalPersistentPopcount(nodemap & (bit - 1))];
+            *slot = SUTL_InternalPersistentMapSetNode(pm, *slot, shift + 5, hash, key, value, added);
+
+            return node;
+        }
+
+        node = SUTL_InternalPersistentMapResize(pm, node, shift, datamap | bit, nodemap, (size_t)-1, i);
+        SUTLPersistentMapWrite(pm, SUTLPersistentData(node) + i * esize, key, value);
+        *added = 1;
+
+        return node;
+    }
+
+    void SUTL_InternalPersistentMapSet(SUTLPersistentMap * pm, const void * key, const void * value)
+    {
+        size_t hash = pm->Hash(key);
+        int added = 0;
+
+        if (!pm->Root)
+        {
+            pm->Root = SUTL_InternalPersistentNodeNew(SUTL_PERSISTENT_MAP_ENTRY_SIZE(pm));
+            SUTLPersistentNode(pm->Root)->DataMap = (uint32_t)1 << (hash & 31);
+            SUTLPersistentMapWrite(pm, SUTLPersistentData(pm->Root), key, value);
+            pm->Size = 1;
+
+            return;
+        }
+
+        pm->Root = SUTL_InternalPersistentMapSetNode(pm, pm->Root, 0, hash, key, value, &added);
+        pm->Size += added;
+    }
+
+    void * SUTL_InternalPersistentMapEraseNode(const SUTLPersistentMap * pm, void * node, size_t shift, size_t hash, const void * key)
+    {
+        size_t esize = SUTL_PERSISTENT_MAP_ENTRY_SIZE(pm);
+        size_t entries, children, childentries, childchildren, i, j;
+        uint32_t datamap, nodemap, bit;
+        void ** slot;
+        void * child;
+        char * e;
+
+        node = SUTL_InternalPersistentMapUnique(pm, node, shift);
+        SUTL_InternalPersistentMapCounts(node, shift, &entries, &children);
+        datamap = SUTLPersistentNode(node)->DataMap;
+        nodemap = SUTLPersistentNode(node)->NodeMap;
+
+        if (shift >= SUTL_PERSISTENT_HASH_BITS)
+        {
+            for (i = 0, e = SUTLPersistentData(node); !pm->KeyComp(key, e); i++, e += esize);
+
+            return SUTL_InternalPersistentMapResize(pm, node, shift, datamap - 1, 0, i, (size_t)-1);
+        }
+
+        bit = (uint32_t)1 << ((hash >> shift) & 31);
+
+        if (datamap & bit)
+            return SUTL_InternalPersistentMapResize(pm, node, shift, datamap & ~bit, nodemap, SUTL_InternalPersistentPopcount(datamap & (bit - 1)), (size_t)-1);
+
+        /*
+         * The key is in a child. A child left with a single entry is pulled up into this node, so
+         * that a trie has the same shape whatever order its entries were added and erased in.
+         */
+        j = SUTL_InternalPersistentPopcount(nodemap & (bit - 1));
+        slot = SUTLPersistentMapChildren(pm, node, entries);
+        child = SUTL_InternalPersistentMapEraseNode(pm, slot[j], shift + 5, hash, key);
+
+        if (child)
+        {
+            SUTL_InternalPersistentMapCounts(child, shift + 5, &childentries, &childchildren);
+
+            if (childentries != 1 || childchildren)
+            {
+                slot[j] = child;
+                return node;
+            }
+        }
+
+        SHRN_MEMMOVE(slot + j, slot + j + 1, (children - j - 1) * sizeof(void *));
+
+        if (!child)
+            return SUTL_InternalPersistentMapResize(pm, node, shift, datamap, nodemap & ~bit, (size_t)-1, (size_t)-1);
+
+        i = SUTL_InternalPersistentPopcount(datamap & (bit - 1));
+        node = SUTL_InternalPersistentMapResize(pm, node, shift, datamap | bit, nodemap & ~bit, (size_t)-1, i);
+        SHRN_MEMCPY(SUTLPersistentData(node) + i * esize, SUTLPersistentData(child), esize);
+        SHRN_FREE(child);
+
+        return node;
+    }
+
+    void SUTL_InternalPersistentMapErase(SUTLPersistentMap * pm, const void * key)
+    {
+        if (!SUTL_InternalPersistentMapGet(pm, key))
+            return;
+
+        pm->Root = SUTL_InternalPersistentMapEraseNode(pm, pm->Root, 0, pm->Hash(key), key);
+        pm->Size--;
+    }
+
+    SUTLPersistentMapIter SUTL_InternalPersistentMapIterNew(const SUTLPersistentMap * pm)
+    {
+        SUTLPersistentMapIter it;
+
+        it.Depth = pm->Root ? 1 : 0;
+        it.Nodes[0] = pm->Root;
+        it.Index[0] = 0;
+
+        return it;
+    }
+
+    char * SUTL_InternalPersistentMapIterNext(const SUTLPersistentMap * pm, SUTLPersistentMapIter * it)
+    {
+        size_t entries, children, i;
+        void * node;
+
+        /*
+         * Visit the entries of a node, then descend into its children one by one.
+         */
+        while (it->Depth)
+        {
+            node = it->Nodes[it->Depth - 1];
+            SUTL_InternalPersistentMapCounts(node, (it->Depth - 1) * 5, &entries, &children);
+            i = it->Index[it->Depth - 1]++;
+
+            if (i < entries)
+                return SUTLPersistentData(node) + i * SUTL_PERSISTENT_MAP_ENTRY_SIZE(pm);
+
+            if (i < entries + children)
+            {
+                it->Nodes[it->Depth] = SUTLPersistentMapChildren(pm, node, entries)[i - entries];
+                it->Index[it->Depth] = 0;
+                it->Depth++;
+            }
+            else
+                it->Depth--;
+        }
+
+        return NULL;
+    }
+
+    #undef SUTLPersistentData
+    #undef SUTLPersistentChildren
+    #undef SUTLPersistentNode
+    #undef SUTLPersistentMapChildren
+    #undef SUTLPersistentMapWrite
+    #undef SUTLPersistentRefsLoad
+    #undef SUTLPersistentRefsAdd
+    #undef SUTLPersistentRefsSub
+#endif
+
+#endif
@@ -0,0 +1,337 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_RCU_H
+#define SUTL_RCU_H
+
+#include "Common.h"
+#include "System.h"
+
+/**
+ * @defgroup Rcu
+ * Read-copy-update of a shared data structure, for data which is read much more often than it is
+ * changed.
+ *
+ * A \p SUTLRcu holds a pointer to the current version of the data. Readers get it in a read-side
+ * section, which costs a few stores and a fence and never waits. Writers don't change the version
+ * readers see: they build a new one and publish it with an atomic swap of the pointer. The old
+ * version is freed after a grace period, once every reader which might still use it has left its
+ * read-side section.
+ *
+ * Every reader thread registers once to get a slot, and passes the slot to its read-side sections.
+ * Read-side sections must not be nested, and must not wait for a grace period, which includes
+ * ending a write. Writers are serialized by a mutex.
+ *
+ * Readers must not change the data either, so for a \p SUTLHashmap they must search with
+ * \p SUTLHashmapGetWith or \p SUTLHashmapGetN, as \p SUTLHashmapGet writes to the map:
+ * @code
+ * SUTLRcu routes = SUTLRcuNew(table, 64, FreeRoutes);
+ *
+ * // Each reader thread:
+ * size_t slot = SUTLRcuRegister(routes);
+ * SUTLHashmap * hm = SUTLRcuReadLock(SUTLHashmap, routes, slot);
+ * int * port = SUTLHashmapGetWith(int, *hm, &key, SUTLHash_int, SUTLCmp_int);
+ * SUTLRcuReadUnlock(routes, slot);
+ *
+ * // A writer:
+ * SUTLHashmap * old = SUTLRcuWriteLock(SUTLHashmap, routes);
+ * SUTLRcuWriteUnlock(routes, RebuildRoutes(old));
+ * @endcode
+ * @{
+ */
+
+/**
+ * @brief It holds the shared data. Copies of it refer to the same data, so it can be passed to
+ * threads by value.
+ */
+typedef struct SUTLRcu
+{
+    /**
+     * @brief Don't access this directly. The state shared by all threads.
+     */
+    void * State;
+} SUTLRcu;
+
+/**
+ * @brief Creates a new \p SUTLRcu.
+ *
+ * @param ptr A pointer to the first version of the data.
+ * @param readers The maximum number of reader threads which will register.
+ * @param freefn A function of the signature <tt>void(void *)</tt> which frees a version of the data,
+ * or \p NULL if versions are freed by the caller.
+ *
+ * @return A \p SUTLRcu.
+ */
+#define SUTLRcuNew(ptr, readers, freefn) SUTL_InternalRcuNew(ptr, readers, freefn)
+
+/**
+ * @brief Frees \p rcu and its current version. No thread may use it anymore.
+ *
+ * @param rcu The \p SUTLRcu to free.
+ */
+#define SUTLRcuFree(rcu)                SUTL_InternalRcuFree(&rcu)
+
+/**
+ * @brief Registers a reader thread.
+ *
+ * @param rcu The \p SUTLRcu to read.
+ *
+ * @return The slot of the reader, for its read-side sections. If all slots are taken, an error is
+ * reported and <tt>(size_t)-1</tt> is returned.
+ */
+#define SUTLRcuRegister(rcu)            SUTL_InternalRcuRegister(rcu)
+
+/**
+ * @brief Starts a read-side section and gets the current version of the data.
+ *
+ * @param t The type of the data.
+ * @param rcu The \p SUTLRcu to read.
+ * @param slot The slot returned by \p SUTLRcuRegister for this thread.
+ *
+ * @return A <tt>t *</tt> to the current version, valid until \p SUTLRcuReadUnlock.
+ */
+#define SUTLRcuReadLock(t, rcu, slot)   ((t *)SUTL_InternalRcuReadLock(rcu, slot))
+
+/**
+ * @brief Ends a read-side section.
+ *
+ * @param rcu The \p SUTLRcu being read.
+ * @param slot The slot returned by \p SUTLRcuRegister for this thread.
+ */
+#define SUTLRcuReadUnlock(rcu, slot)    SUTL_InternalRcuReadUnlock(rcu, slot)
+
+/**
+ * @brief Starts a write, waiting for other writers to finish, and gets the current version of the
+ * data. The version must not be changed, but it can be copied to make the next one.
+ *
+ * @param t The type of the data.
+ * @param rcu The \p SUTLRcu to write.
+ *
+ * @return A <tt>t *</tt> to the current version.
+ */
+#define SUTLRcuWriteLock(t, rcu)        ((t *)SUTL_InternalRcuWriteLock(rcu))
+
+/**
+ * @brief Ends a write by publishing \p ptr as the current version. Then it waits for a grace period
+ * and frees the replaced version. If \p ptr is the current version, nothing is published.
+ *
+ * @param rcu The \p SUTLRcu being written.
+ * @param ptr A pointer to the new version.
+ */
+#define SUTLRcuWriteUnlock(rcu, ptr)    SUTL_InternalRcuWriteUnlock(rcu, ptr)
+
+/**
+ * @brief Waits for a grace period: every read-side section which started before the call has
+ * ended when it returns.
+ *
+ * @param rcu The \p SUTLRcu.
+ */
+#define SUTLRcuSynchronize(rcu)         SUTL_InternalRcuSynchronize(rcu)
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+
+/*
+ * Each reader publishes the epoch in which its read-side section started, or 0 outside of one.
+ */
+typedef struct SUTLRcuReader
+{
+    SHRN_ATOMIC(size_t) Epoch;
+    char Padding[SHRN_CACHE_LINE - sizeof(size_t)];
+} SUTLRcuReader;
+
+typedef struct SUTLRcuState
+{
+    SHRN_ATOMIC(void *) Current;
+    SHRN_ATOMIC(size_t) Epoch;
+    SHRN_ATOMIC(size_t) ReaderCount;
+    size_t MaxReaders;
+    SUTLRcuReader * Readers;
+    void( * Free)(void *);
+    SHRN_MUTEX Mutex;
+} SUTLRcuState;
+
+SUTLRcu SUTL_InternalRcuNew(void * ptr, size_t readers, void( * freefn)(void *));
+void SUTL_InternalRcuFree(SUTLRcu * rcu);
+size_t SUTL_InternalRcuRegister(SUTLRcu rcu);
+void * SUTL_InternalRcuReadLock(SUTLRcu rcu, size_t slot);
+void SUTL_InternalRcuReadUnlock(SUTLRcu rcu, size_t slot);
+void * SUTL_InternalRcuWriteLock(SUTLRcu rcu);
+void SUTL_InternalRcuWriteUnlock(SUTLRcu rcu, void * ptr);
+void SUTL_InternalRcuSynchronize(SUTLRcu rcu);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    #ifndef SHRN_HAS_ATOMICS
+        #error "Rcu.h needs the atomic macros of Common.h."
+    #endif
+
+    #define SUTLRcuState(rcu) ((SUTLRcuState *)(rcu).State)
+
+    SUTLRcu SUTL_InternalRcuNew(void * ptr, size_t readers, void( * freefn)(void *))
+    {
+        SUTLRcu rcu;
+        SUTLRcuState * state = (SUTLRcuState *)SHRN_MALLOC(sizeof(SUTLRcuState));
+
+        rcu.State = state;
+
+        if (!state)
+        {
+            SUTLErrorHandler("Memory allocation failed.");
+            return rcu;
+        }
+
+        /*
+         * Initialize the members of `state`. Epochs start at 1, as 0 marks an idle reader.
+         */
+        state->Current = ptr;
+        state->Epoch = 1;
+        state->ReaderCount = 0;
+        state->MaxReaders = readers;
+        state->Readers = (SUTLRcuReader *)SHRN_MALLOC((readers ? readers : 1) * sizeof(SUTLRcuReader));
+        state->Free = freefn;
+
+        if (!state->Readers)
+        {
+            SUTLErrorHandler("Memory allocation failed.");
+            SHRN_FREE(state);
+            rcu.State = NULL;
+
+            return rcu;
+        }
+
+        SHRN_MEMSET(state->Readers, 0, (readers ? readers : 1) * sizeof(SUTLRcuReader));
+        SHRN_MUTEX_INIT(state->Mutex);
+
+        return rcu;
+    }
+
+    void SUTL_InternalRcuFree(SUTLRcu * rcu)
+    {
+        SUTLRcuState * state = SUTLRcuState(*rcu);
+
+        if (!state)
+            return;
+
+        if (state->Free)
+            state->Free(state->Current);
+
+        SHRN_MUTEX_DESTROY(state->Mutex);
+        SHRN_FREE(state->Readers);
+        SHRN_FREE(state);
+
+        rcu->State = NULL;
+    }
+
+    size_t SUTL_InternalRcuRegister(SUTLRcu rcu)
+    {
+        size_t slot = SHRN_ATOMIC_FETCH_ADD(&SUTLRcuState(rcu)->ReaderCount, 1, SHRN_ORDER_RELAXED);
+
+        if (slot >= SUTLRcuState(rcu)->MaxReaders)
+        {
+            SUTLErrorHandler("Too many RCU readers.");
+            return (size_t)-1;
+        }
+
+        return slot;
+    }
+
+    void * SUTL_InternalRcuReadLock(SUTLRcu rcu, size_t slot)
+    {
+        SUTLRcuState * state = SUTLRcuState(rcu);
+
+        /*
+         * The fence orders the store of the epoch before the load of the pointer. Together with
+         * the fence in `SUTL_InternalRcuSynchronize`, either the writer sees this reader, or this
+         * reader sees the new version.
+         */
+        SHRN_ATOMIC_STORE(&state->Readers[slot].Epoch, SHRN_ATOMIC_LOAD(&state->Epoch, SHRN_ORDER_SEQ_CST), SHRN_ORDER_RELAXED);
+        SHRN_ATOMIC_FENCE(SHRN_ORDER_SEQ_CST);
+
+        return SHRN_ATOMIC_LOAD(&state->Current, SHRN_ORDER_ACQUIRE);
+    }
+
+    void SUTL_InternalRcuReadUnlock(SUTLRcu rcu, size_t slot)
+    {
+        /*
+         * Orders the reads of the version before the writer frees it.
+         */
+        SHRN_ATOMIC_STORE(&SUTLRcuState(rcu)->Readers[slot].Epoch, 0, SHRN_ORDER_RELEASE);
+    }
+
+    void * SUTL_InternalRcuWriteLock(SUTLRcu rcu)
+    {
+        SHRN_MUTEX_LOCK(SUTLRcuState(rcu)->Mutex);
+
+        return SUTLRcuState(rcu)->Current;
+    }
+
+    void SUTL_InternalRcuWriteUnlock(SUTLRcu rcu, void * ptr)
+    {
+        SUTLRcuState * state = SUTLRcuState(rcu);
+        void * old = state->Current;
+
+        if (ptr == old)
+        {
+            SHRN_MUTEX_UNLOCK(state->Mutex);
+            return;
+        }
+
+        /*
+         * Publish the new version, and let other writers start while waiting for the readers of
+         * the old one.
+         */
+        SHRN_ATOMIC_STORE(&state->Current, ptr, SHRN_ORDER_SEQ_CST);
+        SHRN_MUTEX_UNLOCK(state->Mutex);
+
+        SUTL_InternalRcuSynchronize(rcu);
+
+        if (state->Free)
+            state->Free(old);
+    }
+
+    void SUTL_InternalRcuSynchronize(SUTLRcu rcu)
+    {
+        SUTLRcuState * state = SUTLRcuState(rcu);
+        size_t readers, epoch, seen, i;
+
+        /*
+         * Readers which start after the new epoch see the versions published before it, so only
+         * readers inside sections started in an older epoch are waited for.
+         */
+        epoch = SHRN_ATOMIC_FETCH_ADD(&state->Epoch, 1, SHRN_ORDER_SEQ_CST) + 1;
+        SHRN_ATOMIC_FENCE(SHRN_ORDER_SEQ_CST);
+
+        readers = SHRN_ATOMIC_LOAD(&state->ReaderCount, SHRN_ORDER_RELAXED);
+
+        if (readers > state->MaxReaders)
+            readers = state->MaxReaders;
+
+        for (i = 0; i < readers; i++)
+            while ((seen = SHRN_ATOMIC_LOAD(&state->Readers[i].Epoch, SHRN_ORDER_ACQUIRE)) != 0 && seen < epoch)
+                SHRN_THREAD_YIELD();
+    }
+
+    #undef SUTLRcuState
+#endif
+
+#endif
@@ -0,0 +1,1218 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_ROARING_H
+#define SUTL_ROARING_H
+
+#include "Common.h"
+#include "Vector.h"
+#include "String.h"
+
+/**
+ * @defgroup Roaring
+ * A compressed bitmap for sets of \p uint32_t (also called roaring bitmap).
+ *
+ * The 32-bit space is split into chunks of 65536 values which share their upper 16 bits. Every
+ * non-empty chunk is stored in a container that holds the lower 16 bits of its values in one of the
+ * following forms:
+ *
+ *        Type      |   Storage
+ *     -------------+----------------------------------------------------------------------------
+ *        Array     |   Sorted \p uint16_t values, used for up to \p SUTL_ROARING_ARRAY_MAX values.
+ *        Bitmap    |   1024 \p uint64_t words, used for more than \p SUTL_ROARING_ARRAY_MAX values.
+ *        Run       |   Sorted (start, length - 1) pairs, only created by \p SUTLRoaringRunOptimize.
+ *
+ * Run containers are converted back to array or bitmap containers when they are modified.
+ * @{
+ */
+
+/**
+ * @brief The maximum number of values in an array container.
+ */
+#define SUTL_ROARING_ARRAY_MAX 4096
+
+/**
+ * @brief The type of a \p SUTLRoaringContainer.
+ */
+typedef enum SUTLRoaringContainerType
+{
+    SUTL_ROARING_ARRAY,
+    SUTL_ROARING_BITMAP,
+    SUTL_ROARING_RUN
+} SUTLRoaringContainerType;
+
+/**
+ * @brief Don't access this directly. It contains the lower 16 bits of the values in a chunk.
+ */
+typedef struct SUTLRoaringContainer
+{
+    /**
+     * @brief The type of the container.
+     */
+    SUTLRoaringContainerType Type;
+
+    /**
+     * @brief The number of values in the container.
+     */
+    uint32_t Cardinality;
+
+    /**
+     * @brief A vector of \p uint16_t for array and run containers and a vector of 1024 \p uint64_t
+     * for bitmap containers.
+     */
+    void * Data;
+} SUTLRoaringContainer;
+
+/**
+ * @brief It contains the state of a particular roaring bitmap instance.
+ */
+typedef struct SUTLRoaring
+{
+    /**
+     * @brief The number of values in the roaring bitmap.
+     */
+    size_t Size;
+
+    /**
+     * @brief Don't access this directly. A sorted vector of \p uint16_t which stores the upper 16
+     * bits of every chunk. This is parallel to \p Containers.
+     */
+    uint16_t * Keys;
+
+    /**
+     * @brief Don't access this directly. A vector of \p SUTLRoaringContainer. This is parallel to
+     * \p Keys.
+     */
+    SUTLRoaringContainer * Containers;
+} SUTLRoaring;
+
+/**
+ * @brief It contains the state of an iteration over a \p SUTLRoaring.
+ */
+typedef struct SUTLRoaringIterator
+{
+    /**
+     * @brief The roaring bitmap being iterated.
+     */
+    const SUTLRoaring * Roaring;
+
+    /**
+     * @brief The index of the current container.
+     */
+    size_t Container;
+
+    /**
+     * @brief The position inside the current container. It is an array index, a word index or a
+     * run index depending on the type of the container.
+     */
+    size_t Pos;
+
+    /**
+     * @brief The remaining bits of the current word of a bitmap container or the offset inside
+     * the current run of a run container.
+     */
+    uint64_t Word;
+} SUTLRoaringIterator;
+
+/**
+ * @brief Creates a new empty \p SUTLRoaring.
+ *
+ * @return An empty \p SUTLRoaring.
+ */
+#define SUTLRoaringNew()                        SUTL_InternalRoaringNew()
+
+/**
+ * @brief Frees a \p SUTLRoaring which was created using \p SUTLRoaringNew or any of the functions
+ * which return a new \p SUTLRoaring.
+ *
+ * @param r The \p SUTLRoaring to free.
+ */
+#define SUTLRoaringFree(r)                      SUTL_InternalRoaringFree(&r)
+
+/**
+ * @brief Adds \p x to \p r.
+ *
+ * @param r The roaring bitmap to add to.
+ * @param x The \p uint32_t to add.
+ *
+ * @return 1 if \p x was added, 0 if it already existed.
+ */
+#define SUTLRoaringAdd(r, x)                    SUTL_InternalRoaringAdd(&r, x)
+
+/**
+ * @brief Removes \p x from \p r.
+ *
+ * @param r The roaring bitmap to remove from.
+ * @param x The \p uint32_t to remove.
+ *
+ * @return 1 if \p x was removed, 0 if it didn't exist.
+ */
+#define SUTLRoaringRemove(r, x)                 SUTL_InternalRoaringRemove(&r, x)
+
+/**
+ * @brief Checks if \p x exists in \p r.
+ *
+ * @param r The roaring bitmap to search in.
+ * @param x The \p uint32_t to search for.
+ *
+ * @return 1 if \p x exists, otherwise 0.
+ */
+#define SUTLRoaringContains(r, x)               SUTL_InternalRoaringContains(&r, x)
+
+/**
+ * @brief Creates a new \p SUTLRoaring that contains the values of both \p a and \p b.
+ *
+ * @param a The first roaring bitmap.
+ * @param b The second roaring bitmap.
+ *
+ * @return A new \p SUTLRoaring which must be freed using \p SUTLRoaringFree.
+ */
+#define SUTLRoaringUnion(a, b)                  SUTL_InternalRoaringUnion(&a, &b)
+
+/**
+ * @brief Creates a new \p SUTLRoaring that contains the values that exist in both \p a and \p b.
+ *
+ * @param a The first roaring bitmap.
+ * @param b The second roaring bitmap.
+ *
+ * @return A new \p SUTLRoaring which must be freed using \p SUTLRoaringFree.
+ */
+#define SUTLRoaringIntersect(a, b)              SUTL_InternalRoaringIntersect(&a, &b)
+
+/**
+ * @brief Converts the containers of \p r to run containers wherever it takes less memory.
+ *
+ * @param r The roaring bitmap to optimize.
+ */
+#define SUTLRoaringRunOptimize(r)               SUTL_InternalRoaringRunOptimize(&r)
+
+/**
+ * @brief Gets the number of bytes used by the containers of \p r.
+ *
+ * @param r The roaring bitmap to get the byte size of.
+ */
+#define SUTLRoaringByteSize(r)                  SUTL_InternalRoaringByteSize(&r)
+
+/**
+ * @brief Creates an iterator over the values of \p r in ascending order.
+ *
+ * @param r The roaring bitmap to iterate. It must not be modified while the iterator is used.
+ *
+ * @return A \p SUTLRoaringIterator.
+ */
+#define SUTLRoaringIteratorNew(r)               SUTL_InternalRoaringIteratorNew(&r)
+
+/**
+ * @brief Advances \p it to the next value.
+ *
+ * @param it The iterator to advance.
+ * @param x A \p uint32_t in which the next value will be stored.
+ *
+ * @return 1 if a value was stored in \p x, 0 if the iteration is over.
+ */
+#define SUTLRoaringIteratorNext(it, x)          SUTL_InternalRoaringIteratorNext(&it, &x)
+
+/**
+ * @brief Executes \p expr for each value of \p r in ascending order.
+ *
+ * @param r The roaring bitmap to iterate.
+ * @param name The name of the variable in which current value will be stored.
+ * @param expr The code block to execute for each value.
+ */
+#define SUTLRoaringEach(r, name, expr) \
+    {\
+        SUTLRoaringIterator sutlIt = SUTLRoaringIteratorNew(r);\
+        uint32_t name;\
+        while (SUTLRoaringIteratorNext(sutlIt, name))\
+        {\
+            expr\
+        }\
+    }
+
+/**
+ * @brief Appends the serialized form of \p r to \p str.
+ *
+ * The format stores every container with its key, type and cardinality followed by its data in
+ * little endian byte order.
+ *
+ * @param r The roaring bitmap to serialize.
+ * @param str The \p SUTLString to append to.
+ */
+#define SUTLRoaringSerialize(r, str)            SUTL_InternalRoaringSerialize(&r, &str)
+
+/**
+ * @brief Creates a new \p SUTLRoaring from data written by \p SUTLRoaringSerialize.
+ *
+ * @param ptr Pointer to the serialized data.
+ * @param size The size of the serialized data in bytes.
+ * @param r The \p SUTLRoaring to store the result in. It must not be initialized.
+ *
+ * @return 1 on success. If the data is invalid, an error is reported, \p r is empty and 0 is
+ * returned.
+ */
+#define SUTLRoaringDeserialize(ptr, size, r)    SUTL_InternalRoaringDeserialize(ptr, size, &r)
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+SUTLRoaring SUTL_InternalRoaringNew(void);
+void SUTL_InternalRoaringFree(SUTLRoaring * r);
+int SUTL_InternalRoaringAdd(SUTLRoaring * r, uint32_t x);
+int SUTL_InternalRoaringRemove(SUTLRoaring * r, uint32_t x);
+int SUTL_InternalRoaringContains(const SUTLRoaring * r, uint32_t x);
+SUTLRoaring SUTL_InternalRoaringUnion(const SUTLRoaring * a, const SUTLRoaring * b);
+SUTLRoaring SUTL_InternalRoaringIntersect(const SUTLRoaring * a, const SUTLRoaring * b);
+void SUTL_InternalRoaringRunOptimize(SUTLRoaring * r);
+size_t SUTL_InternalRoaringByteSize(const SUTLRoaring * r);
+SUTLRoaringIterator SUTL_InternalRoaringIteratorNew(const SUTLRoaring * r);
+int SUTL_InternalRoaringIteratorNext(SUTLRoaringIterator * it, uint32_t * x);
+void SUTL_InternalRoaringSerialize(const SUTLRoaring * r, SUTLString * str);
+int SUTL_InternalRoaringDeserialize(const void * ptr, size_t size, SUTLRoaring * r);
+
+unsigned SUTL_InternalPopcount64(uint64_t x);
+size_t SUTL_InternalRoaringFindU16(const uint16_t * v, size_t size, uint16_t x, int * found);
+size_t SUTL_InternalRoaringFindKey(const SUTLRoaring * r, uint16_t key, int * found);
+SUTLRoaringContainer SUTL_InternalRoaringContainerCopy(const SUTLRoaringContainer * c);
+void SUTL_InternalRoaringContainerToBitmap(const SUTLRoaringContainer * c, uint64_t * words);
+void SUTL_InternalRoaringContainerFromBitmap(SUTLRoaringContainer * c, uint64_t * words);
+int SUTL_InternalRoaringContainerContains(const SUTLRoaringContainer * c, uint16_t x);
+void SUTL_InternalRoaringContainerFree(SUTLRoaringContainer * c);
+int SUTL_InternalRoaringContainerValid(const SUTLRoaringContainer * c);
+SUTLRoaringContainer SUTL_InternalRoaringContainerUnion(const SUTLRoaringContainer * a, const SUTLRoaringContainer * b);
+SUTLRoaringContainer SUTL_InternalRoaringContainerIntersect(const SUTLRoaringContainer * a, const SUTLRoaringContainer * b);
+uint64_t * SUTL_InternalRoaringNewWords(void);
+void SUTL_InternalRoaringPushContainer(SUTLRoaring * r, uint16_t key, SUTLRoaringContainer * c);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    #define SUTLRoaringBitmapWords 1024
+
+    unsigned SUTL_InternalPopcount64(uint64_t x)
+    {
+        #if defined(__GNUC__)
+            return (unsigned)__builtin_popcountll(x);
+        #else
+            x = x - ((x >> 1) & 0x5555555555555555ULL);
+            x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+            x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+
+            return (unsigned)((x * 0x0101010101010101ULL) >> 56);
+        #endif
+    }
+
+    size_t SUTL_InternalRoaringFindU16(const uint16_t * v, size_t size, uint16_t x, int * found)
+    {
+        size_t low = 0;
+        size_t high = size;
+
+        /*
+         * Find the first element which is not less than `x`.
+         */
+        while (low < high)
+        {
+            size_t mid = low + (high - low) / 2;
+
+            if (v[mid] < x)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+
+        *found = low < size && v[low] == x;
+
+        return low;
+    }
+
+    size_t SUTL_InternalRoaringFindKey(const SUTLRoaring * r, uint16_t key, int * found)
+    {
+        return SUTL_InternalRoaringFindU16(r->Keys, SUTLVectorSize(r->Keys), key, found);
+    }
+
+    SUTLRoaringContainer SUTL_InternalRoaringContainerCopy(const SUTLRoaringContainer * c)
+    {
+        SUTLRoaringContainer copy = *c;
+        size_t size = SUTLVectorSize(c->Data);
+
+        if (c->Type == SUTL_ROARING_BITMAP)
+        {
+            copy.Data = SUTLVectorNew(uint64_t);
+            SUTLVectorPushN(copy.Data, c->Data, size);
+        }
+        else
+        {
+            copy.Data = SUTLVectorNew(uint16_t);
+            SUTLVectorPushN(copy.Data, c->Data, size);
+        }
+
+        return copy;
+    }
+
+    void SUTL_InternalRoaringContainerToBitmap(const SUTLRoaringContainer * c, uint64_t * words)
+    {
+        const uint16_t * values = (const uint16_t *)c->Data;
+        size_t size = SUTLVectorSize(c->Data);
+        size_t i;
+
+        switch (c->Type)
+        {
+            case SUTL_ROARING_ARRAY:
+                for (i = 0; i < size; i++)
+                    words[values[i] >> 6] |= (uint64_t)1 << (values[i] & 63);
+
+                break;
+
+            case SUTL_ROARING_BITMAP:
+                for (i = 0; i < SUTLRoaringBitmapWords; i++)
+                    words[i] |= ((const uint64_t *)c->Data)[i];
+
+                break;
+
+            case SUTL_ROARING_RUN:
+                for (i = 0; i < size; i += 2)
+                {
+                    uint32_t x = values[i];
+                    uint32_t end = x + values[i + 1];
+
+                    for (; x <= end; x++)
+                        words[x >> 6] |= (uint64_t)1 << (x & 63);
+                }
+
+                break;
+        }
+    }
+
+    void SUTL_InternalRoaringContainerFromBitmap(SUTLRoaringContainer * c, uint64_t * words)
+    {
+        uint32_t cardinality = 0;
+        size_t i;
+
+        for (i = 0; i < SUTLRoaringBitmapWords; i++)
+            cardinality += SUTL_InternalPopcount64(words[i]);
+
+        c->Cardinality = cardinality;
+
+        /*
+         * Large containers keep the words, small ones are converted to a sorted array.
+         */
+        if (cardinality > SUTL_ROARING_ARRAY_MAX)
+        {
+            c->Type = SUTL_ROARING_BITMAP;
+            c->Data = words;
+
+            return;
+        }
+
+        c->Type = SUTL_ROARING_ARRAY;
+        c->Data = SUTLVectorNew(uint16_t);
+
+        SUTLVectorReserve(c->Data, cardinality);
+
+        for (i = 0; i < SUTLRoaringBitmapWords; i++)
+        {
+            uint64_t word = words[i];
+
+            while (word)
+            {
+                uint16_t x = (uint16_t)(i * 64 + SUTL_InternalPopcount64((word & (0 - word)) - 1));
+
+                SUTLVectorPush(c->Data, x);
+                word &= word - 1;
+            }
+        }
+
+        SUTLVectorFree(words);
+    }
+
+    int SUTL_InternalRoaringContainerContains(const SUTLRoaringContainer * c, uint16_t x)
+    {
+        const uint16_t * values = (const uint16_t *)c->Data;
+        size_t size = SUTLVectorSize(c->Data);
+        int found;
+        size_t pos;
+
+        switch (c->Type)
+        {
+            case SUTL_ROARING_ARRAY:
+                SUTL_InternalRoaringFindU16(values, size, x, &found);
+                return found;
+
+            case SUTL_ROARING_BITMAP:
+                return (((const uint64_t *)c->Data)[x >> 6] >> (x & 63)) & 1;
+
+            case SUTL_ROARING_RUN:
+                /*
+                 * Binary search over the run starts, which are at even indices.
+                 */
+                {
+                    size_t low = 0;
+                    size_t high = size / 2;
+
+                    while (low < high)
+                    {
+                        size_t mid = low + (high - low) / 2;
+
+                        if (values[mid * 2] <= x)
+                            low = mid + 1;
+                        else
+                            high = mid;
+                    }
+
+                    if (!low)
+                        return 0;
+
+                    pos = (low - 1) * 2;
+
+                    return (uint32_t)x - values[pos] <= values[pos + 1];
+                }
+        }
+
+        return 0;
+    }
+
+    void SUTL_InternalRoaringContainerFree(SUTLRoaringContainer * c)
+    {
+        SUTLVectorFree(c->Data);
+    }
+
+    uint64_t * SUTL_InternalRoaringNewWords(void)
+    {
+        uint64_t * words = SUTLVectorNew(uint64_t);
+
+        SUTLVectorResize(words, SUTLRoaringBitmapWords);
+        SHRN_MEMSET(words, 0, SUTLRoaringBitmapWords * sizeof(uint64_t));
+
+        return words;
+    }
+
+    SUTLRoaring SUTL_InternalRoaringNew(void)
+    {
+        SUTLRoaring r;
+
+        r.Size = 0;
+        r.Keys = SUTLVectorNew(uint16_t);
+        r.Containers = SUTLVectorNew(SUTLRoaringContainer);
+
+        return r;
+    }
+
+    void SUTL_InternalRoaringFree(SUTLRoaring * r)
+    {
+        size_t i;
+
+        for (i = 0; i < SUTLVectorSize(r->Containers); i++)
+            SUTL_InternalRoaringContainerFree(r->Containers + i);
+
+        SUTLVectorFree(r->Containers);
+        SUTLVectorFree(r->Keys);
+    }
+
+    void SUTL_InternalRoaringPushContainer(SUTLRoaring * r, uint16_t key, SUTLRoaringContainer * c)
+    {
+        SUTLVectorPush(r->Keys, key);
+        SUTLVectorPush(r->Containers, *c);
+
+        r->Size += c->Cardinality;
+    }
+
+    int SUTL_InternalRoaringAdd(SUTLRoaring * r, uint32_t x)
+    {
+        uint16_t key = (uint16_t)(x >> 16);
+        uint16_t low = (uint16_t)x;
+        SUTLRoaringContainer * c;
+        size_t index;
+        int found;
+
+        index = SUTL_InternalRoaringFindKey(r, key, &found);
+
+        /*
+         * Create an empty array container if the chunk doesn't exist yet.
+         */
+        if (!found)
+        {
+            SUTLRoaringContainer empty;
+
+            empty.Type = SUTL_ROARING_ARRAY;
+            empty.Cardinality = 0;
+            empty.Data = SUTLVectorNew(uint16_t);
+
+            SUTLVectorInsert(r->Keys, index, key);
+            SUTLVectorInsert(r->Containers, index, empty);
+        }
+
+        c = r->Containers + index;
+
+        if (SUTL_InternalRoaringContainerContains(c, low))
+            return 0;
+
+        /*
+         * Run containers are only kept while they aren't modified.
+         */
+        if (c->Type == SUTL_ROARING_RUN)
+        {
+            uint64_t * words = SUTL_InternalRoaringNewWords();
+
+            SUTL_InternalRoaringContainerToBitmap(c, words);
+            SUTL_InternalRoaringContainerFree(c);
+            SUTL_InternalRoaringContainerFromBitmap(c, words);
+        }
+
+        if (c->Type == SUTL_ROARING_ARRAY && c->Cardinality == SUTL_ROARING_ARRAY_MAX)
+        {
+            uint64_t * words = SUTL_InternalRoaringNewWords();
+
+            SUTL_InternalRoaringContainerToBitmap(c, words);
+            SUTL_InternalRoaringContainerFree(c);
+
+            c->Type = SUTL_ROARING_BITMAP;
+            c->Data = words;
+        }
+
+        if (c->Type == SUTL_ROARING_ARRAY)
+        {
+            size_t pos = SUTL_InternalRoaringFindU16((uint16_t *)c->Data, c->Cardinality, low, &found);
+
+            SUTLVectorInsert(c->Data, pos, low);
+        }
+        else
+        {
+            ((uint64_t *)c->Data)[low >> 6] |= (uint64_t)1 << (low & 63);
+        }
+
+        c->Cardinality++;
+        r->Size++;
+
+        return 1;
+    }
+
+    int SUTL_InternalRoaringRemove(SUTLRoaring * r, uint32_t x)
+    {
+        uint16_t key = (uint16_t)(x >> 16);
+        uint16_t low = (uint16_t)x;
+        SUTLRoaringContainer * c;
+        size_t index;
+        int found;
+
+        index = SUTL_InternalRoaringFindKey(r, key, &found);
+
+        if (!found || !SUTL_InternalRoaringContainerContains(r->Containers + index, low))
+            return 0;
+
+        c = r->Containers + index;
+
+        if (c->Type == SUTL_ROARING_RUN)
+        {
+            uint64_t * words = SUTL_InternalRoaringNewWords();
+
+            SUTL_InternalRoaringContainerToBitmap(c, words);
+            SUTL_InternalRoaringContainerFree(c);
+            SUTL_InternalRoaringContainerFromBitmap(c, words);
+        }
+
+        if (c->Type == SUTL_ROARING_ARRAY)
+        {
+            size_t pos = SUTL_InternalRoaringFindU16((uint16_t *)c->Data, c->Cardinality, low, &found);
+
+            SUTLVectorErase(c->Data, pos);
+            c->Cardinality--;
+        }
+        else
+        {
+            uint64_t * words = (uint64_t *)c->Data;
+
+            words[low >> 6] &= ~((uint64_t)1 << (low & 63));
+
+            /*
+             * Convert back to an array once the bitmap no longer pays for itself.
+             */
+            if (--c->Cardinality <= SUTL_ROARING_ARRAY_MAX)
+                SUTL_InternalRoaringContainerFromBitmap(c, words);
+        }
+
+        r->Size--;
+
+        /*
+         * Empty chunks are removed entirely.
+         */
+        if (!c->Cardinality)
+        {
+            SUTL_InternalRoaringContainerFree(c);
+            SUTLVectorErase(r->Containers, index);
+            SUTLVectorErase(r->Keys, index);
+        }
+
+        return 1;
+    }
+
+    int SUTL_InternalRoaringContains(const SUTLRoaring * r, uint32_t x)
+    {
+        int found;
+        size_t index = SUTL_InternalRoaringFindKey(r, (uint16_t)(x >> 16), &found);
+
+        return found && SUTL_InternalRoaringContainerContains(r->Containers + index, (uint16_t)x);
+    }
+
+    SUTLRoaringContainer SUTL_InternalRoaringContainerUnion(const SUTLRoaringContainer * a, const SUTLRoaringContainer * b)
+    {
+        SUTLRoaringContainer c;
+
+        /*
+         * Two small arrays are merged directly.
+         */
+        if (a->Type == SUTL_ROARING_ARRAY && b->Type == SUTL_ROARING_ARRAY && a->Cardinality + b->Cardinality <= SUTL_ROARING_ARRAY_MAX)
+        {
+            const uint16_t * va = (const uint16_t *)a->Data;
+            const uint16_t * vb = (const uint16_t *)b->Data;
+            uint16_t * out = SUTLVectorNew(uint16_t);
+            size_t i = 0, j = 0, n = 0;
+
+            SUTLVectorResize(out, a->Cardinality + b->Cardinality);
+
+            while (i < a->Cardinality && j < b->Cardinality)
+            {
+                if (va[i] < vb[j])
+                    out[n++] = va[i++];
+                else if (vb[j] < va[i])
+                    out[n++] = vb[j++];
+                else
+                    out[n++] = va[i++], j++;
+            }
+
+            while (i < a->Cardinality)
+                out[n++] = va[i++];
+
+            while (j < b->Cardinality)
+                out[n++] = vb[j++];
+
+            SUTLVectorSize(out) = n;
+
+            c.Type = SUTL_ROARING_ARRAY;
+            c.Cardinality = (uint32_t)n;
+            c.Data = out;
+
+            return c;
+        }
+
+        {
+            uint64_t * words = SUTL_InternalRoaringNewWords();
+
+            SUTL_InternalRoaringContainerToBitmap(a, words);
+            SUTL_InternalRoaringContainerToBitmap(b, words);
+            SUTL_InternalRoaringContainerFromBitmap(&c, words);
+        }
+
+        return c;
+    }
+
+    SUTLRoaringContainer SUTL_InternalRoaringContainerIntersect(const SUTLRoaringContainer * a, const SUTLRoaringContainer * b)
+    {
+        SUTLRoaringContainer c;
+
+        /*
+         * Make sure that if there is an array, it is `a`.
+         */
+        if (b->Type == SUTL_ROARING_ARRAY && a->Type != SUTL_ROARING_ARRAY)
+        {
+            const SUTLRoaringContainer * tmp = a;
+            a = b;
+            b = tmp;
+        }
+
+        if (a->Type == SUTL_ROARING_ARRAY)
+        {
+            const uint16_t * va = (const uint16_t *)a->Data;
+            uint16_t * out = SUTLVectorNew(uint16_t);
+            size_t i, n = 0;
+
+            SUTLVectorResize(out, a->Cardinality);
+
+            if (b->Type == SUTL_ROARING_ARRAY)
+            {
+                const uint16_t * vb = (const uint16_t *)b->Data;
+                size_t j = 0;
+
+                i = 0;
+
+                while (i < a->Cardinality && j < b->Cardinality)
+                {
+                    if (va[i] < vb[j])
+                        i++;
+                    else if (vb[j] < va[i])
+                        j++;
+                    else
+                        out[n++] = va[i++], j++;
+                }
+            }
+            else
+            {
+                /*
+                 * Probe every array value in the other container.
+                 */
+                for (i = 0; i < a->Cardinality; i++)
+                    if (SUTL_InternalRoaringContainerContains(b, va[i]))
+                        out[n++] = va[i];
+            }
+
+            SUTLVectorSize(out) = n;
+
+            c.Type = SUTL_ROARING_ARRAY;
+            c.Cardinality = (uint32_t)n;
+            c.Data = out;
+
+            return c;
+        }
+
+        {
+            uint64_t * wa = SUTL_InternalRoaringNewWords();
+            uint64_t * wb = SUTL_InternalRoaringNewWords();
+            size_t i;
+
+            SUTL_InternalRoaringContainerToBitmap(a, wa);
+            SUTL_InternalRoaringContainerToBitmap(b, wb);
+
+            for (i = 0; i < SUTLRoaringBitmapWords; i++)
+                wa[i] &= wb[i];
+
+            SUTLVectorFree(wb);
+            SUTL_InternalRoaringContainerFromBitmap(&c, wa);
+        }
+
+        return c;
+    }
+
+    SUTLRoaring SUTL_InternalRoaringUnion(const SUTLRoaring * a, const SUTLRoaring * b)
+    {
+        SUTLRoaring r = SUTL_InternalRoaringNew();
+        size_t sizeA = SUTLVectorSize(a->Keys);
+        size_t sizeB = SUTLVectorSize(b->Keys);
+        size_t i = 0, j = 0;
+
+        /*
+         * Merge the sorted key lists, combining the containers of keys present in both.
+         */
+        while (i < sizeA || j < sizeB)
+        {
+            SUTLRoaringContainer c;
+            uint16_t key;
+
+            if (j == sizeB || (i < sizeA && a->Keys[i] < b->Keys[j]))
+            {
+                key = a->Keys[i];
+                c = SUTL_InternalRoaringContainerCopy(a->Containers + i++);
+            }
+            else if (i == sizeA || b->Keys[j] < a->Keys[i])
+            {
+                key = b->Keys[j];
+                c = SUTL_InternalRoaringContainerCopy(b->Containers + j++);
+            }
+            else
+            {
+                key = a->Keys[i];
+                c = SUTL_InternalRoaringContainerUnion(a->Containers + i++, b->Containers + j++);
+            }
+
+            SUTL_InternalRoaringPushContainer(&r, key, &c);
+        }
+
+        return r;
+    }
+
+    SUTLRoaring SUTL_InternalRoaringIntersect(const SUTLRoaring * a, const SUTLRoaring * b)
+    {
+        SUTLRoaring r = SUTL_InternalRoaringNew();
+        size_t sizeA = SUTLVectorSize(a->Keys);
+        size_t sizeB = SUTLVectorSize(b->Keys);
+        size_t i = 0, j = 0;
+
+        while (i < sizeA && j < sizeB)
+        {
+            if (a->Keys[i] < b->Keys[j])
+            {
+                i++;
+            }
+            else if (b->Keys[j] < a->Keys[i])
+            {
+                j++;
+            }
+            else
+            {
+                uint16_t key = a->Keys[i];
+                SUTLRoaringContainer c = SUTL_InternalRoaringContainerIntersect(a->Containers + i++, b->Containers + j++);
+
+                if (c.Cardinality)
+                    SUTL_InternalRoaringPushContainer(&r, key, &c);
+                else
+                    SUTL_InternalRoaringContainerFree(&c);
+            }
+        }
+
+        return r;
+    }
+
+    void SUTL_InternalRoaringRunOptimize(SUTLRoaring * r)
+    {
+        size_t i;
+
+        for (i = 0; i < SUTLVectorSize(r->Containers); i++)
+        {
+            SUTLRoaringContainer * c = r->Containers + i;
+            uint64_t * words;
+            uint16_t * runs;
+            size_t runCount = 0, currentSize, w;
+            uint64_t carry = 0;
+
+            if (c->Type == SUTL_ROARING_RUN)
+                continue;
+
+            words = SUTL_InternalRoaringNewWords();
+            SUTL_InternalRoaringContainerToBitmap(c, words);
+
+            /*
+             * A run starts at every set bit whose preceding bit is clear.
+             */
+            for (w = 0; w < SUTLRoaringBitmapWords; w++)
+            {
+                runCount += SUTL_InternalPopcount64(words[w] & ~((words[w] << 1) | carry));
+                carry = words[w] >> 63;
+            }
+
+            currentSize = c->Type == SUTL_ROARING_ARRAY ? c->Cardinality * 2 : SUTLRoaringBitmapWords * 8;
+
+            if (runCount * 4 >= currentSize)
+            {
+                SUTLVectorFree(words);
+                continue;
+            }
+
+            runs = SUTLVectorNew(uint16_t);
+            SUTLVectorReserve(runs, runCount * 2);
+
+            {
+                uint32_t x = 0;
+
+                while (x < 65536)
+                {
+                    uint32_t start;
+                    uint16_t value;
+
+                    while (x < 65536 && !((words[x >> 6] >> (x & 63)) & 1))
+                        x++;
+
+                    if (x == 65536)
+                        break;
+
+                    start = x;
+
+                    while (x < 65536 && ((words[x >> 6] >> (x & 63)) & 1))
+                        x++;
+
+                    value = (uint16_t)start;
+                    SUTLVectorPush(runs, value);
+                    value = (uint16_t)(x - start - 1);
+                    SUTLVectorPush(runs, value);
+                }
+            }
+
+            SUTLVectorFree(words);
+            SUTL_InternalRoaringContainerFree(c);
+
+            c->Type = SUTL_ROARING_RUN;
+            c->Data = runs;
+        }
+    }
+
+    size_t SUTL_InternalRoaringByteSize(const SUTLRoaring * r)
+    {
+        size_t size = SUTLVectorSize(r->Keys) * (sizeof(uint16_t) + sizeof(SUTLRoaringContainer));
+        size_t i;
+
+        for (i = 0; i < SUTLVectorSize(r->Containers); i++)
+        {
+            const SUTLRoaringContainer * c = r->Containers + i;
+
+            size += SUTLVectorSize(c->Data) * (c->Type == SUTL_ROARING_BITMAP ? sizeof(uint64_t) : sizeof(uint16_t));
+        }
+
+        return size;
+    }
+
+    SUTLRoaringIterator SUTL_InternalRoaringIteratorNew(const SUTLRoaring * r)
+    {
+        SUTLRoaringIterator it;
+
+        it.Roaring = r;
+        it.Container = 0;
+        it.Pos = 0;
+        it.Word = SUTLVectorSize(r->Containers) && r->Containers[0].Type == SUTL_ROARING_BITMAP
+            ? ((const uint64_t *)r->Containers[0].Data)[0]
+            : 0;
+
+        return it;
+    }
+
+    int SUTL_InternalRoaringIteratorNext(SUTLRoaringIterator * it, uint32_t * x)
+    {
+        const SUTLRoaring * r = it->Roaring;
+
+        while (it->Container < SUTLVectorSize(r->Containers))
+        {
+            const SUTLRoaringContainer * c = r->Containers + it->Container;
+            uint32_t high = (uint32_t)r->Keys[it->Container] << 16;
+            const uint16_t * values = (const uint16_t *)c->Data;
+            size_t size = SUTLVectorSize(c->Data);
+
+            switch (c->Type)
+            {
+                case SUTL_ROARING_ARRAY:
+                    if (it->Pos < size)
+                    {
+                        *x = high | values[it->Pos++];
+                        return 1;
+                    }
+
+                    break;
+
+                case SUTL_ROARING_BITMAP:
+                    while (!it->Word && ++it->Pos < SUTLRoaringBitmapWords)
+                        it->Word = ((const uint64_t *)c->Data)[it->Pos];
+
+                    if (it->Word)
+                    {
+                        *x = high | (uint32_t)(it->Pos * 64 + SUTL_InternalPopcount64((it->Word & (0 - it->Word)) - 1));
+                        it->Word &= it->Word - 1;
+                        return 1;
+                    }
+
+                    break;
+
+                case SUTL_ROARING_RUN:
+                    if (it->Pos < size)
+                    {
+                        *x = high | (uint32_t)(values[it->Pos] + it->Word);
+
+                        /*
+                         * Move to the next run once the current one is exhausted.
+                         */
+                        if (it->Word++ == values[it->Pos + 1])
+                        {
+                            it->Word = 0;
+                            it->Pos += 2;
+                        }
+
+                        return 1;
+                    }
+
+                    break;
+            }
+
+            /*
+             * The current container is exhausted, move to the next one.
+             */
+            it->Container++;
+            it->Pos = 0;
+            it->Word = it->Container < SUTLVectorSize(r->Containers) && r->Containers[it->Container].Type == SUTL_ROARING_BITMAP
+                ? ((const uint64_t *)r->Containers[it->Container].Data)[0]
+                : 0;
+        }
+
+        return 0;
+    }
+
+    void SUTL_InternalRoaringSerialize(const SUTLRoaring * r, SUTLString * str)
+    {
+        size_t total = 8;
+        size_t i, j;
+
+        /*
+         * Reserve the whole output up front instead of growing it byte by byte.
+         */
+        for (i = 0; i < SUTLVectorSize(r->Keys); i++)
+            total += 11 + SUTLVectorSize(r->Containers[i].Data) * (r->Containers[i].Type == SUTL_ROARING_BITMAP ? 8 : 2);
+
+        if (SUTLStringCapacity(*str) < SUTLStringSize(*str) + total)
+            SUTLStringReserve(*str, SUTLStringSize(*str) + total);
+
+        SUTLStringAppendN(*str, "SRB1", 4);
+        SUTL_InternalStringAppendLE(str, SUTLVectorSize(r->Keys), 4);
+
+        for (i = 0; i < SUTLVectorSize(r->Keys); i++)
+        {
+            const SUTLRoaringContainer * c = r->Containers + i;
+            size_t count = SUTLVectorSize(c->Data);
+
+            SUTL_InternalStringAppendLE(str, r->Keys[i], 2);
+            SUTL_InternalStringAppendLE(str, c->Type, 1);
+            SUTL_InternalStringAppendLE(str, c->Cardinality, 4);
+            SUTL_InternalStringAppendLE(str, count, 4);
+
+            if (c->Type == SUTL_ROARING_BITMAP)
+                for (j = 0; j < count; j++)
+                    SUTL_InternalStringAppendLE(str, ((const uint64_t *)c->Data)[j], 8);
+            else
+                for (j = 0; j < count; j++)
+                    SUTL_InternalStringAppendLE(str, ((const uint16_t *)c->Data)[j], 2);
+        }
+    }
+
+    int SUTL_InternalRoaringContainerValid(const SUTLRoaringContainer * c)
+    {
+        const uint16_t * values = (const uint16_t *)c->Data;
+        size_t size = SUTLVectorSize(c->Data);
+        uint32_t total = 0;
+        uint32_t next = 0;
+        size_t i;
+
+        switch (c->Type)
+        {
+            case SUTL_ROARING_ARRAY:
+                /*
+                 * Updates convert between arrays and bitmaps at SUTL_ROARING_ARRAY_MAX, so each
+                 * must be on its own side of it.
+                 */
+                if (c->Cardinality > SUTL_ROARING_ARRAY_MAX)
+                    return 0;
+
+                for (i = 1; i < size; i++)
+                    if (values[i] <= values[i - 1])
+                        return 0;
+
+                return 1;
+
+            case SUTL_ROARING_BITMAP:
+                if (c->Cardinality <= SUTL_ROARING_ARRAY_MAX)
+                    return 0;
+
+                for (i = 0; i < size; i++)
+                    total += SUTL_InternalPopcount64(((const uint64_t *)c->Data)[i]);
+
+                return total == c->Cardinality;
+
+            default:
+                /*
+                 * Runs must be sorted, must not overlap and must stay within the container.
+                 */
+                for (i = 0; i < size; i += 2)
+                {
+                    if (values[i] < next || (uint32_t)values[i] + values[i + 1] > 65535)
+                        return 0;
+
+                    next = (uint32_t)values[i] + values[i + 1] + 1;
+                    total += (uint32_t)values[i + 1] + 1;
+                }
+
+                return total == c->Cardinality;
+        }
+    }
+
+    int SUTL_InternalRoaringDeserialize(const void * ptr, size_t size, SUTLRoaring * r)
+    {
+        const uint8_t * in = (const uint8_t *)ptr;
+        const uint8_t * end = in + size;
+        size_t containerCount, i, j;
+
+        *r = SUTL_InternalRoaringNew();
+
+        if (size < 8 || SHRN_MEMCMP(in, "SRB1", 4) != 0)
+            goto invalid;
+
+        containerCount = (size_t)SUTL_InternalStringReadLE(in + 4, 4);
+        in += 8;
+
+        for (i = 0; i < containerCount; i++)
+        {
+            SUTLRoaringContainer c;
+            uint16_t key;
+            size_t count, elemsize;
+
+            if (end - in < 11)
+                goto invalid;
+
+            key = (uint16_t)SUTL_InternalStringReadLE(in, 2);
+            c.Type = (SUTLRoaringContainerType)in[2];
+            c.Cardinality = (uint32_t)SUTL_InternalStringReadLE(in + 3, 4);
+            count = (size_t)SUTL_InternalStringReadLE(in + 7, 4);
+            in += 11;
+
+            /*
+             * Reject anything which doesn't describe a valid container or breaks key order.
+             */
+            if (c.Type > SUTL_ROARING_RUN || !c.Cardinality || c.Cardinality > 65536
+                || (c.Type == SUTL_ROARING_BITMAP && count != SUTLRoaringBitmapWords)
+                || (c.Type == SUTL_ROARING_ARRAY && count != c.Cardinality)
+                || (c.Type == SUTL_ROARING_RUN && count % 2)
+                || (i && key <= r->Keys[i - 1]))
+                goto invalid;
+
+            elemsize = c.Type == SUTL_ROARING_BITMAP ? 8 : 2;
+
+            if ((size_t)(end - in) / elemsize < count)
+                goto invalid;
+
+            if (c.Type == SUTL_ROARING_BITMAP)
+            {
+                uint64_t * words = SUTL_InternalRoaringNewWords();
+
+                for (j = 0; j < count; j++)
+                    words[j] = SUTL_InternalStringReadLE(in + j * 8, 8);
+
+                c.Data = words;
+            }
+            else
+            {
+                uint16_t * values = SUTLVectorNew(uint16_t);
+
+                SUTLVectorResize(values, count);
+
+                for (j = 0; j < count; j++)
+                    values[j] = (uint16_t)SUTL_InternalStringReadLE(in + j * 2, 2);
+
+                c.Data = values;
+            }
+
+            in += count * elemsize;
+
+            /*
+             * Searches rely on sorted arrays and runs, and sizes on the stored cardinality, so
+             * check both against the data.
+             */
+            if (!SUTL_InternalRoaringContainerValid(&c))
+            {
+                SUTL_InternalRoaringContainerFree(&c);
+                goto invalid;
+            }
+
+            SUTL_InternalRoaringPushContainer(r, key, &c);
+        }
+
+        return 1;
+
+    invalid:
+        SUTLErrorHandler("Invalid serialized roaring bitmap.");
+
+        SUTL_InternalRoaringFree(r);
+        *r = SUTL_InternalRoaringNew();
+
+        return 0;
+    }
+
+    #undef SUTLRoaringBitmapWords
+#endif
+
+#endif
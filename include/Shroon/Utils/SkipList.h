@@ -0,0 +1,451 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_SKIP_LIST_H
+#define SUTL_SKIP_LIST_H
+
+#include "Common.h"
+
+/**
+ * @defgroup SkipList
+ * A sorted map which can be read by any number of threads while one thread inserts into it, like
+ * the memtable of a log-structured store.
+ *
+ * Entries are kept in a skip list ordered by one of the \p SUTL_ORDFN functions, or any function
+ * which orders keys the same way. Nodes are allocated from an arena of large blocks, and are only
+ * freed all at once with the skip list, so entries can't be erased. A new node is linked in from
+ * the bottom level up with release stores, and readers follow links with acquire loads, so they
+ * never wait and never see a half linked node.
+ *
+ * Inserts must not run at the same time as each other; serialize them with a mutex if several
+ * threads insert. Keys are passed by pointer, so that they can be searched for from several threads.
+ * @{
+ */
+
+/**
+ * @brief The maximum number of levels of the skip list. Each level has a quarter of the nodes of the
+ * one below it.
+ */
+#define SUTL_SKIP_LIST_MAX_HEIGHT 20
+
+/**
+ * @brief The size of the blocks of the arena which holds the nodes.
+ */
+#define SUTL_SKIP_LIST_BLOCK_SIZE 65536
+
+/**
+ * @brief It contains a skip list.
+ */
+typedef struct SUTLSkipList
+{
+    /**
+     * @brief The number of entries.
+     */
+    SHRN_ATOMIC(size_t) Size;
+
+    /**
+     * @brief The size of the key type.
+     */
+    size_t KeySize;
+
+    /**
+     * @brief The size of the value type.
+     */
+    size_t ValueSize;
+
+    /**
+     * @brief The function pointer which orders two keys.
+     */
+    int( * KeyOrder)(const void *, const void *);
+
+    /**
+     * @brief Don't access this directly. The number of levels in use.
+     */
+    SHRN_ATOMIC(size_t) Height;
+
+    /**
+     * @brief Don't access this directly. The state of the random generator for node heights.
+     */
+    uint64_t Random;
+
+    /**
+     * @brief Don't access this directly. The node before the first one on every level.
+     */
+    char * Head;
+
+    /**
+     * @brief Don't access this directly. The current block of the arena. It starts with a pointer
+     * to the previous block.
+     */
+    char * Block;
+
+    /**
+     * @brief Don't access this directly. The number of used bytes in \p Block.
+     */
+    size_t BlockUsed;
+
+    /**
+     * @brief Don't access this directly. The size of \p Block.
+     */
+    size_t BlockSize;
+} SUTLSkipList;
+
+/**
+ * @brief It points to an entry of a skip list.
+ */
+typedef struct SUTLSkipListIter
+{
+    /**
+     * @brief The skip list.
+     */
+    const SUTLSkipList * List;
+
+    /**
+     * @brief Don't access this directly. The node of the entry, or \p NULL past the last entry.
+     */
+    char * Node;
+} SUTLSkipListIter;
+
+/**
+ * @brief Creates a new empty \p SUTLSkipList with key type \p tk and value type \p tv.
+ *
+ * @param tk The key type for the skip list.
+ * @param tv The value type for the skip list.
+ * @param order A function of the signature <tt>int(const void *, const void *)</tt> which returns a
+ * negative number, 0 or a positive number if the first \p tk is less than, equal to or greater than
+ * the second one, like \p SUTL_ORDFN(suffix).
+ *
+ * @return A \p SUTLSkipList.
+ */
+#define SUTLSkipListNew(tk, tv, order)          SUTL_InternalSkipListNew(sizeof(tk), sizeof(tv), order)
+
+/**
+ * @brief Frees \p sl and all of its nodes. No thread may use it anymore.
+ *
+ * @param sl The \p SUTLSkipList to free.
+ */
+#define SUTLSkipListFree(sl)                    SUTL_InternalSkipListFree(&sl)
+
+/**
+ * @brief Gets the number of entries of \p sl.
+ *
+ * @param sl The \p SUTLSkipList.
+ *
+ * @return The size as a \p size_t.
+ */
+#define SUTLSkipListSize(sl)                    SHRN_ATOMIC_LOAD(&(sl).Size, SHRN_ORDER_RELAXED)
+
+/**
+ * @brief Inserts the key at \p kptr with the value at \p vptr into \p sl, if the key isn't in it.
+ * Only one thread may insert at a time.
+ *
+ * @param sl The \p SUTLSkipList to insert into.
+ * @param kptr A pointer to the key.
+ * @param vptr A pointer to the value.
+ *
+ * @return 1 if the entry was inserted, or 0 if the key was already in \p sl, whose value is kept.
+ */
+#define SUTLSkipListInsert(sl, kptr, vptr)      SUTL_InternalSkipListInsert(&sl, kptr, vptr)
+
+/**
+ * @brief Gets the value assigned to the key at \p kptr in \p sl.
+ *
+ * @param tv The value type of \p sl.
+ * @param sl The \p SUTLSkipList to get from.
+ * @param kptr A pointer to the key to search for.
+ *
+ * @return A <tt>const tv *</tt> to the value, valid until \p sl is freed. If the key isn't in \p sl
+ * then it is \p NULL.
+ */
+#define SUTLSkipListGet(tv, sl, kptr)           ((const tv *)SUTL_InternalSkipListGet(&sl, kptr))
+
+/**
+ * @brief Gets an iterator to the first entry of \p sl whose key is not less than the key at
+ * \p kptr.
+ *
+ * @param sl The \p SUTLSkipList to iterate.
+ * @param kptr A pointer to the key, or \p NULL for the first entry.
+ *
+ * @return A \p SUTLSkipListIter.
+ */
+#define SUTLSkipListSeek(sl, kptr)              SUTL_InternalSkipListSeek(&sl, kptr)
+
+/**
+ * @brief Checks if \p it points to an entry, and isn't past the last one.
+ */
+#define SUTLSkipListIterValid(it)               ((it).Node != NULL)
+
+/**
+ * @brief Moves \p it to the next entry. Entries inserted meanwhile may or may not be visited.
+ */
+#define SUTLSkipListIterNext(it)                SUTL_InternalSkipListIterNext(&it)
+
+/**
+ * @brief Gets a <tt>const tk *</tt> to the key of the entry \p it points to.
+ */
+#define SUTLSkipListIterKey(tk, it)             ((const tk *)(it).Node)
+
+/**
+ * @brief Gets a <tt>const tv *</tt> to the value of the entry \p it points to.
+ */
+#define SUTLSkipListIterValue(tv, it)           ((const tv *)((it).Node + SUTL_SKIP_LIST_VALUE_OFFSET((it).List)))
+
+/**
+ * @brief Executes \p expr for every entry of \p sl with a key from the one at \p lo up to, but not
+ * including, the one at \p hi, in order.
+ *
+ * @param tk The key type of \p sl.
+ * @param tv The value type of \p sl.
+ * @param sl The \p SUTLSkipList to iterate.
+ * @param lo A pointer to the first key of the range, or \p NULL to start at the first entry.
+ * @param hi A pointer to the key after the range, or \p NULL to end after the last entry.
+ * @param name The prefix for current entry. Key will have suffix \p _k and value will have suffix
+ * \p _v.
+ * @param expr The code block to execute for every entry.
+ */
+#define SUTLSkipListRange(tk, tv, sl, lo, hi, name, expr) \
+    {\
+        SUTLSkipListIter name##_it = SUTLSkipListSeek(sl, lo);\
+        const void * name##_hi = (hi);\
+        for (; SUTLSkipListIterValid(name##_it); SUTLSkipListIterNext(name##_it))\
+        {\
+            const tk * name##_k = SUTLSkipListIterKey(tk, name##_it);\
+            const tv * name##_v = SUTLSkipListIterValue(tv, name##_it);\
+            if (name##_hi && (sl).KeyOrder(name##_k, name##_hi) >= 0)\
+                break;\
+            expr\
+        }\
+    }
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+#define SUTL_SKIP_LIST_VALUE_OFFSET(sl)         (((sl)->KeySize + 7) & ~(size_t)7)
+#define SUTL_SKIP_LIST_ENTRY_SIZE(sl)           ((SUTL_SKIP_LIST_VALUE_OFFSET(sl) + (sl)->ValueSize + 7) & ~(size_t)7)
+
+SUTLSkipList SUTL_InternalSkipListNew(size_t keysize, size_t valuesize, int( * order)(const void *, const void *));
+void SUTL_InternalSkipListFree(SUTLSkipList * sl);
+int SUTL_InternalSkipListInsert(SUTLSkipList * sl, const void * key, const void * value);
+const void * SUTL_InternalSkipListGet(SUTLSkipList * sl, const void * key);
+SUTLSkipListIter SUTL_InternalSkipListSeek(SUTLSkipList * sl, const void * key);
+void SUTL_InternalSkipListIterNext(SUTLSkipListIter * it);
+char * SUTL_InternalSkipListAlloc(SUTLSkipList * sl, size_t size);
+char * SUTL_InternalSkipListFind(SUTLSkipList * sl, const void * key, char ** preds);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    #ifndef SHRN_HAS_ATOMICS
+        #error "SkipList.h needs the atomic macros of Common.h."
+    #endif
+
+    /*
+     * Nodes hold their key and value at 8 byte aligned offsets, followed by one link per level.
+     */
+    #define SUTLSkipListNext(sl, node) ((SHRN_ATOMIC(char *) *)((node) + SUTL_SKIP_LIST_ENTRY_SIZE(sl)))
+
+    char * SUTL_InternalSkipListAlloc(SUTLSkipList * sl, size_t size)
+    {
+        size_t blocksize;
+        char * block;
+
+        size = (size + 7) & ~(size_t)7;
+
+        /*
+         * Start a new block when the node doesn't fit, big enough for the node if it is large.
+         */
+        if (!sl->Block || sl->BlockUsed + size > sl->BlockSize)
+        {
+            blocksize = size + 8 > SUTL_SKIP_LIST_BLOCK_SIZE ? size + 8 : SUTL_SKIP_LIST_BLOCK_SIZE;
+            block = (char *)SHRN_MALLOC(blocksize);
+
+            if (!block)
+            {
+                SUTLErrorHandler("Memory allocation failed.");
+                return NULL;
+            }
+
+            *(char **)block = sl->Block;
+
+            sl->Block = block;
+            sl->BlockUsed = 8;
+            sl->BlockSize = blocksize;
+        }
+
+        sl->BlockUsed += size;
+
+        return sl->Block + sl->BlockUsed - size;
+    }
+
+    SUTLSkipList SUTL_InternalSkipListNew(size_t keysize, size_t valuesize, int( * order)(const void *, const void *))
+    {
+        SUTLSkipList sl;
+        size_t i;
+
+        /*
+         * Initialize the members of `sl`.
+         */
+        sl.Size = 0;
+        sl.KeySize = keysize;
+        sl.ValueSize = valuesize;
+        sl.KeyOrder = order;
+        sl.Height = 1;
+        sl.Random = 0x9E3779B97F4A7C15ULL;
+        sl.Block = NULL;
+        sl.BlockUsed = 0;
+        sl.BlockSize = 0;
+
+        /*
+         * The head is a node with links on every level, whose key is never compared.
+         */
+        sl.Head = SUTL_InternalSkipListAlloc(&sl, SUTL_SKIP_LIST_ENTRY_SIZE(&sl) + SUTL_SKIP_LIST_MAX_HEIGHT * sizeof(char *));
+
+        if (sl.Head)
+            for (i = 0; i < SUTL_SKIP_LIST_MAX_HEIGHT; i++)
+                SHRN_ATOMIC_STORE(&SUTLSkipListNext(&sl, sl.Head)[i], NULL, SHRN_ORDER_RELAXED);
+
+        return sl;
+    }
+
+    void SUTL_InternalSkipListFree(SUTLSkipList * sl)
+    {
+        char * block;
+
+        while ((block = sl->Block) != NULL)
+        {
+            sl->Block = *(char **)block;
+            SHRN_FREE(block);
+        }
+
+        sl->Head = NULL;
+        sl->BlockUsed = 0;
+        sl->BlockSize = 0;
+        SHRN_ATOMIC_STORE(&sl->Size, 0, SHRN_ORDER_RELAXED);
+    }
+
+    char * SUTL_InternalSkipListFind(SUTLSkipList * sl, const void * key, char ** preds)
+    {
+        size_t level = SHRN_ATOMIC_LOAD(&sl->Height, SHRN_ORDER_RELAXED);
+        char * node = sl->Head;
+        char * next = NULL;
+
+        /*
+         * Move right while the next key is less than `key`, then down, remembering the last node
+         * before `key` on every level.
+         */
+        while (level--)
+        {
+            while ((next = SHRN_ATOMIC_LOAD(&SUTLSkipListNext(sl, node)[level], SHRN_ORDER_ACQUIRE)) != NULL && sl->KeyOrder(next, key) < 0)
+                node = next;
+
+            if (preds)
+                preds[level] = node;
+        }
+
+        return next;
+    }
+
+    int SUTL_InternalSkipListInsert(SUTLSkipList * sl, const void * key, const void * value)
+    {
+        char * preds[SUTL_SKIP_LIST_MAX_HEIGHT];
+        size_t height = SHRN_ATOMIC_LOAD(&sl->Height, SHRN_ORDER_RELAXED);
+        size_t level = 1;
+        char * node;
+        size_t i;
+
+        node = SUTL_InternalSkipListFind(sl, key, preds);
+
+        if (node && sl->KeyOrder(node, key) == 0)
+            return 0;
+
+        /*
+         * Every level above the first is used with a chance of 1/4.
+         */
+        sl->Random ^= sl->Random << 13;
+        sl->Random ^= sl->Random >> 7;
+        sl->Random ^= sl->Random << 17;
+
+        while (level < SUTL_SKIP_LIST_MAX_HEIGHT && ((sl->Random >> (2 * level)) & 3) == 0)
+            level++;
+
+        if (level > height)
+        {
+            for (i = height; i < level; i++)
+                preds[i] = sl->Head;
+
+            SHRN_ATOMIC_STORE(&sl->Height, level, SHRN_ORDER_RELAXED);
+        }
+
+        node = SUTL_InternalSkipListAlloc(sl, SUTL_SKIP_LIST_ENTRY_SIZE(sl) + level * sizeof(char *));
+
+        if (!node)
+            return 0;
+
+        SHRN_MEMCPY(node, key, sl->KeySize);
+        SHRN_MEMCPY(node + SUTL_SKIP_LIST_VALUE_OFFSET(sl), value, sl->ValueSize);
+
+        /*
+         * Link the node in from the bottom up. The release store publishes the node with its key,
+         * value and links to readers which reach it.
+         */
+        for (i = 0; i < level; i++)
+        {
+            SHRN_ATOMIC_STORE(&SUTLSkipListNext(sl, node)[i], SHRN_ATOMIC_LOAD(&SUTLSkipListNext(sl, preds[i])[i], SHRN_ORDER_RELAXED), SHRN_ORDER_RELAXED);
+            SHRN_ATOMIC_STORE(&SUTLSkipListNext(sl, preds[i])[i], node, SHRN_ORDER_RELEASE);
+        }
+
+        SHRN_ATOMIC_FETCH_ADD(&sl->Size, 1, SHRN_ORDER_RELAXED);
+
+        return 1;
+    }
+
+    const void * SUTL_InternalSkipListGet(SUTLSkipList * sl, const void * key)
+    {
+        char * node = SUTL_InternalSkipListFind(sl, key, NULL);
+
+        if (!node || sl->KeyOrder(node, key) != 0)
+            return NULL;
+
+        return node + SUTL_SKIP_LIST_VALUE_OFFSET(sl);
+    }
+
+    SUTLSkipListIter SUTL_InternalSkipListSeek(SUTLSkipList * sl, const void * key)
+    {
+        SUTLSkipListIter it;
+
+        it.List = sl;
+
+        if (key)
+            it.Node = SUTL_InternalSkipListFind(sl, key, NULL);
+        else
+            it.Node = SHRN_ATOMIC_LOAD(&SUTLSkipListNext(sl, sl->Head)[0], SHRN_ORDER_ACQUIRE);
+
+        return it;
+    }
+
+    void SUTL_InternalSkipListIterNext(SUTLSkipListIter * it)
+    {
+        it->Node = SHRN_ATOMIC_LOAD(&SUTLSkipListNext(it->List, it->Node)[0], SHRN_ORDER_ACQUIRE);
+    }
+
+    #undef SUTLSkipListNext
+#endif
+
+#endif
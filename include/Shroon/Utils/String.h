@@ -30,6 +30,23 @@
  */
 typedef char * SUTLString;
 
+/**
+ * @brief A non-owning reference to \p Size characters starting at \p Data. It can refer to a
+ * \p SUTLString or to any other character buffer, which must outlive the view.
+ */
+typedef struct SUTLStringView
+{
+    /**
+     * @brief Pointer to the first character.
+     */
+    const char * Data;
+
+    /**
+     * @brief The number of characters.
+     */
+    size_t Size;
+} SUTLStringView;
+
 /**
  * @brief Gets the size of \p str.
  *
@@ -58,6 +75,25 @@ typedef char * SUTLString;
  */
 #define SUTLStringFree(str)                     SUTLVectorFree(str)
 
+/**
+ * @brief Adds an owner to \p str without copying it. See \p SUTLVectorShare.
+ *
+ * @param str The string to share.
+ *
+ * @return \p str for the new owner, which must free it separately.
+ */
+#define SUTLStringShare(str)                    SUTLVectorShare(str)
+
+/**
+ * @brief Gives \p str its own copy of the characters if it is shared with other owners, so that it
+ * can be changed directly. See \p SUTLVectorMakeUnique.
+ *
+ * @param str The string to make unique.
+ *
+ * @return The new \p str.
+ */
+#define SUTLStringMakeUnique(str)               SUTLVectorMakeUnique(str)
+
 /**
  * @brief Reserves memory for \p size characters in \p str.
  *
@@ -212,6 +248,155 @@ typedef char * SUTLString;
         }\
     }
 
+/**
+ * @brief Creates a \p SUTLStringView of \p size characters starting at \p ptr.
+ *
+ * @param ptr Pointer to the first character.
+ * @param size The number of characters.
+ *
+ * @return A \p SUTLStringView.
+ */
+#define SUTLStringViewNew(ptr, size)            SUTL_InternalStringViewNew(ptr, size)
+
+/**
+ * @brief Creates a \p SUTLStringView of null-terminated string \p ptr.
+ *
+ * @param ptr Null-terminated string.
+ *
+ * @return A \p SUTLStringView.
+ */
+#define SUTLStringViewP(ptr)                    SUTL_InternalStringViewNew(ptr, SHRN_STRLEN(ptr))
+
+/**
+ * @brief Creates a \p SUTLStringView of all characters of \p str.
+ *
+ * @param str The string to view.
+ *
+ * @return A \p SUTLStringView.
+ */
+#define SUTLStringViewOf(str)                   SUTL_InternalStringViewNew(str, SUTLStringSize(str))
+
+/**
+ * @brief The index returned by the \p SUTLStringViewFind macros when nothing is found.
+ */
+#define SUTL_STRING_NPOS                        ((size_t)-1)
+
+/**
+ * @brief Creates a \p SUTLStringView of at most \p size characters of \p view starting at \p at.
+ *
+ * @param view The view to slice.
+ * @param at The index of the first character. If it is past the end, the slice is empty.
+ * @param size The maximum number of characters.
+ *
+ * @return A \p SUTLStringView.
+ */
+#define SUTLStringViewSlice(view, at, size)     SUTL_InternalStringViewSlice(view, at, size)
+
+/**
+ * @brief Finds the first occurrence of character \p c in \p view.
+ *
+ * @param view The view to search.
+ * @param c The character to search for.
+ *
+ * @return The index of \p c, or \p SUTL_STRING_NPOS if \p view doesn't contain it.
+ */
+#define SUTLStringViewFindC(view, c)            SUTL_InternalStringViewFindC(view, c)
+
+/**
+ * @brief Finds the first occurrence of \p needle in \p view.
+ *
+ * @param view The view to search.
+ * @param needle The \p SUTLStringView to search for.
+ *
+ * @return The index of \p needle, or \p SUTL_STRING_NPOS if \p view doesn't contain it.
+ */
+#define SUTLStringViewFind(view, needle)        SUTL_InternalStringViewFind(view, needle)
+
+/**
+ * @brief Removes the characters up to the next \p sep from \p view and stores them in \p token.
+ *
+ * Splitting <tt>"a,,b"</tt> at \p ',' gives \p "a", \p "" and \p "b". The separator isn't part of
+ * any token.
+ *
+ * @param view The \p SUTLStringView to split. It is advanced past the separator.
+ * @param sep The separator character.
+ * @param token The \p SUTLStringView to store the token in.
+ *
+ * @return 1 if a token was stored, 0 once \p view has no tokens left.
+ */
+#define SUTLStringViewSplit(view, sep, token)   SUTL_InternalStringViewSplit(&view, sep, &token)
+
+/**
+ * @brief Executes \p expr for each token of \p view separated by \p sep. See \p SUTLStringViewSplit.
+ *
+ * @param view The \p SUTLStringView to split. It is left with no tokens.
+ * @param sep The separator character.
+ * @param name The name of the \p SUTLStringView in which the current token will be stored.
+ * @param expr The code block to execute for each token.
+ */
+#define SUTLStringViewEachSplit(view, sep, name, expr) \
+    {\
+        SUTLStringView name;\
+        while (SUTL_InternalStringViewSplit(&view, sep, &name))\
+        {\
+            expr\
+        }\
+    }
+
+/**
+ * @brief Parses all of \p view as a decimal integer with an optional sign.
+ *
+ * @param view The \p SUTLStringView to parse.
+ * @param out Pointer to the \p int64_t to store the result in.
+ *
+ * @return 1 on success. 0 if \p view isn't an integer or doesn't fit, in which case \p out isn't
+ * changed.
+ */
+#define SUTLStringViewToInt(view, out)          SUTL_InternalStringViewToInt(view, out)
+
+/**
+ * @brief Parses all of \p view as a decimal floating point number, like \p strtod.
+ *
+ * Numbers with at most 15 significant digits and small exponents, which covers most data, are
+ * converted exactly without calling \p strtod.
+ *
+ * @param view The \p SUTLStringView to parse.
+ * @param out Pointer to the \p double to store the result in.
+ *
+ * @return 1 on success. 0 if \p view isn't a number, in which case \p out isn't changed.
+ */
+#define SUTLStringViewToDouble(view, out)       SUTL_InternalStringViewToDouble(view, out)
+
+/**
+ * @brief The maximum number of characters written by \p SUTLStringAppendInt and
+ * \p SUTLStringAppendDouble.
+ */
+#define SUTL_STRING_NUMBER_MAX 32
+
+/**
+ * @brief Appends the decimal representation of \p value to \p str.
+ *
+ * @param str The \p SUTLString to append to.
+ * @param value The \p int64_t to append.
+ */
+#define SUTLStringAppendInt(str, value)         SUTL_InternalStringAppendInt(&str, value)
+
+/**
+ * @brief Appends the shortest decimal representation of \p value which reads back as the same
+ * \p double to \p str.
+ *
+ * Values with at most 15 significant digits which are written without exponent, which covers most
+ * data, are formatted without calling the C library. Other values use \p SHRN_FORMAT_DOUBLE with the
+ * fewest significant digits which read back through \p SHRN_STRTOD. Without \p SHRN_STRTOD they
+ * get 17 digits, which read back but may not be the shortest, and without \p SHRN_FORMAT_DOUBLE an
+ * approximation with 17 digits, which may not read back exactly. Infinities and NaN are written as
+ * \p inf, \p -inf and \p nan.
+ *
+ * @param str The \p SUTLString to append to.
+ * @param value The \p double to append.
+ */
+#define SUTLStringAppendDouble(str, value)      SUTL_InternalStringAppendDouble(&str, value)
+
 /**
  * @}
  *
@@ -220,6 +405,21 @@ typedef char * SUTLString;
  * @{
  */
 SUTLString SUTL_InternalStringSlice(SUTLString str, size_t at, size_t size);
+SUTLStringView SUTL_InternalStringViewNew(const char * ptr, size_t size);
+SUTLStringView SUTL_InternalStringViewSlice(SUTLStringView view, size_t at, size_t size);
+size_t SUTL_InternalStringViewFindC(SUTLStringView view, char c);
+size_t SUTL_InternalStringViewFind(SUTLStringView view, SUTLStringView needle);
+int SUTL_InternalStringViewSplit(SUTLStringView * view, char sep, SUTLStringView * token);
+int SUTL_InternalStringViewToInt(SUTLStringView view, int64_t * out);
+int SUTL_InternalStringViewToDouble(SUTLStringView view, double * out);
+void SUTL_InternalStringAppendLE(SUTLString * str, uint64_t value, size_t bytes);
+uint64_t SUTL_InternalStringReadLE(const void * ptr, size_t bytes);
+void SUTL_InternalStringAppendUInt(SUTLString * str, uint64_t value, unsigned base);
+void SUTL_InternalStringAppendInt(SUTLString * str, int64_t value);
+void SUTL_InternalStringAppendDouble(SUTLString * str, double value);
+size_t SUTL_InternalFormatUInt(char * out, uint64_t value);
+size_t SUTL_InternalFormatInt(char * out, int64_t value);
+size_t SUTL_InternalFormatDouble(char * out, double value);
 /**
  * @}
  */
@@ -247,6 +447,498 @@ SUTLString SUTL_InternalStringSlice(SUTLString str, size_t at, size_t size);
 
         return slice;
     }
+
+    SUTLStringView SUTL_InternalStringViewNew(const char * ptr, size_t size)
+    {
+        SUTLStringView view;
+
+        view.Data = ptr;
+        view.Size = size;
+
+        return view;
+    }
+
+    SUTLStringView SUTL_InternalStringViewSlice(SUTLStringView view, size_t at, size_t size)
+    {
+        at = at < view.Size ? at : view.Size;
+        size = size < view.Size - at ? size : view.Size - at;
+
+        return SUTL_InternalStringViewNew(view.Data + at, size);
+    }
+
+    size_t SUTL_InternalStringViewFindC(SUTLStringView view, char c)
+    {
+        const char * found = view.Size ? (const char *)SHRN_MEMCHR(view.Data, c, view.Size) : NULL;
+
+        return found ? (size_t)(found - view.Data) : SUTL_STRING_NPOS;
+    }
+
+    size_t SUTL_InternalStringViewFind(SUTLStringView view, SUTLStringView needle)
+    {
+        size_t at = 0;
+        const char * candidate;
+
+        if (!needle.Size)
+            return 0;
+
+        /*
+         * Jump between occurrences of the first character with `SHRN_MEMCHR` and only compare the
+         * rest at those.
+         */
+        while (view.Size - at >= needle.Size)
+        {
+            candidate = (const char *)SHRN_MEMCHR(view.Data + at, needle.Data[0], view.Size - at - needle.Size + 1);
+
+            if (!candidate)
+                break;
+
+            at = (size_t)(candidate - view.Data);
+
+            if (SHRN_MEMCMP(candidate + 1, needle.Data + 1, needle.Size - 1) == 0)
+                return at;
+
+            at++;
+        }
+
+        return SUTL_STRING_NPOS;
+    }
+
+    int SUTL_InternalStringViewSplit(SUTLStringView * view, char sep, SUTLStringView * token)
+    {
+        size_t at;
+
+        /*
+         * A `NULL` view marks that the last token was already returned.
+         */
+        if (!view->Data)
+            return 0;
+
+        at = SUTL_InternalStringViewFindC(*view, sep);
+
+        if (at == SUTL_STRING_NPOS)
+        {
+            *token = *view;
+
+            view->Data = NULL;
+            view->Size = 0;
+
+            return 1;
+        }
+
+        *token = SUTL_InternalStringViewNew(view->Data, at);
+
+        view->Data += at + 1;
+        view->Size -= at + 1;
+
+        return 1;
+    }
+
+    int SUTL_InternalStringViewToInt(SUTLStringView view, int64_t * out)
+    {
+        const char * p = view.Data;
+        const char * end = view.Data + view.Size;
+        uint64_t value = 0;
+        uint64_t limit;
+        int negative = 0;
+
+        if (p != end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+
+        if (p == end)
+            return 0;
+
+        /*
+         * The magnitude of the smallest `int64_t` is one more than that of the largest.
+         */
+        limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+
+        for (; p != end; p++)
+        {
+            unsigned digit = (unsigned)(*p - '0');
+
+            if (digit > 9 || value > (limit - digit) / 10)
+                return 0;
+
+            value = value * 10 + digit;
+        }
+
+        *out = negative ? (int64_t)(0 - value) : (int64_t)value;
+
+        return 1;
+    }
+
+    int SUTL_InternalStringViewToDouble(SUTLStringView view, double * out)
+    {
+        static const double powers[] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        const char * p = view.Data;
+        const char * end = view.Data + view.Size;
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        int negative = 0;
+        int any = 0;
+
+        if (p != end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+
+        /*
+         * Collect the significant digits into `mantissa`, and the position of the decimal point
+         * into `exponent`.
+         */
+        for (; p != end && (unsigned)(*p - '0') <= 9; p++, any = 1)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                digits += mantissa != 0;
+            }
+            else
+            {
+                exponent++;
+                digits++;
+            }
+        }
+
+        if (p != end && *p == '.')
+        {
+            for (p++; p != end && (unsigned)(*p - '0') <= 9; p++, any = 1)
+            {
+                if (digits < 19)
+                {
+                    mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                    digits += mantissa != 0;
+                    exponent--;
+                }
+                else
+                {
+                    digits++;
+                }
+            }
+        }
+
+        if (any && p != end && (*p == 'e' || *p == 'E'))
+        {
+            int expNegative = 0;
+            int value = 0;
+
+            p++;
+
+            if (p != end && (*p == '-' || *p == '+'))
+                expNegative = *p++ == '-';
+
+            if (p == end)
+                return 0;
+
+            for (; p != end && (unsigned)(*p - '0') <= 9; p++)
+                value = value < 100000 ? value * 10 + (*p - '0') : value;
+
+            exponent += expNegative ? -value : value;
+        }
+
+        /*
+         * Clinger's fast path: both the mantissa and the power of 10 are exact doubles, so one
+         * correctly rounded operation gives the correctly rounded result.
+         */
+        if (any && p == end && digits <= 15 && exponent >= -22 && exponent <= 22)
+        {
+            double value = (double)mantissa;
+
+            value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+            *out = negative ? -value : value;
+
+            return 1;
+        }
+
+    #ifdef SHRN_STRTOD
+        {
+            char buffer[64];
+            char * copy = view.Size < sizeof(buffer) ? buffer : (char *)SHRN_MALLOC(view.Size + 1);
+            char * stop;
+            double value;
+
+            if (!copy || !view.Size)
+                return 0;
+
+            SHRN_MEMCPY(copy, view.Data, view.Size);
+            copy[view.Size] = 0;
+
+            value = SHRN_STRTOD(copy, &stop);
+            any = stop == copy + view.Size;
+
+            if (copy != buffer)
+                SHRN_FREE(copy);
+
+            if (any)
+                *out = value;
+
+            return any;
+        }
+    #else
+        if (!any || p != end)
+            return 0;
+
+        *out = (negative ? -(double)mantissa : (double)mantissa);
+
+        for (; exponent > 0; exponent--)
+            *out *= 10.0;
+
+        for (; exponent < 0; exponent++)
+            *out /= 10.0;
+
+        return 1;
+    #endif
+    }
+
+    void SUTL_InternalStringAppendLE(SUTLString * str, uint64_t value, size_t bytes)
+    {
+        size_t size = SUTLStringSize(*str);
+        size_t i;
+
+        SUTLStringResize(*str, size + bytes);
+
+        /*
+         * Write the lowest `bytes` bytes of `value` in little endian byte order.
+         */
+        for (i = 0; i < bytes; i++)
+            (*str)[size + i] = (char)(value >> (8 * i));
+    }
+
+    uint64_t SUTL_InternalStringReadLE(const void * ptr, size_t bytes)
+    {
+        uint64_t value = 0;
+        size_t i;
+
+        for (i = 0; i < bytes; i++)
+            value |= (uint64_t)((const uint8_t *)ptr)[i] << (8 * i);
+
+        return value;
+    }
+
+    void SUTL_InternalStringAppendUInt(SUTLString * str, uint64_t value, unsigned base)
+    {
+        char digits[64];
+        size_t at = sizeof(digits);
+
+        /*
+         * Generate the digits from the least significant one at the end of `digits`.
+         */
+        do
+        {
+            digits[--at] = "0123456789ABCDEF"[value % base];
+            value /= base;
+        } while (value);
+
+        SUTLStringAppendN(*str, digits + at, sizeof(digits) - at);
+    }
+
+    size_t SUTL_InternalFormatUInt(char * out, uint64_t value)
+    {
+        static const char pairs[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+
+        char digits[20];
+        size_t at = sizeof(digits);
+
+        /*
+         * Two digits at a time halves the number of divisions.
+         */
+        while (value >= 100)
+        {
+            unsigned pair = (unsigned)(value % 100) * 2;
+
+            value /= 100;
+            digits[--at] = pairs[pair + 1];
+            digits[--at] = pairs[pair];
+        }
+
+        if (value >= 10)
+        {
+            digits[--at] = pairs[value * 2 + 1];
+            digits[--at] = pairs[value * 2];
+        }
+        else
+        {
+            digits[--at] = (char)('0' + value);
+        }
+
+        SHRN_MEMCPY(out, digits + at, sizeof(digits) - at);
+
+        return sizeof(digits) - at;
+    }
+
+    size_t SUTL_InternalFormatInt(char * out, int64_t value)
+    {
+        if (value >= 0)
+            return SUTL_InternalFormatUInt(out, (uint64_t)value);
+
+        *out = '-';
+
+        return SUTL_InternalFormatUInt(out + 1, (uint64_t)0 - (uint64_t)value) + 1;
+    }
+
+    size_t SUTL_InternalFormatDouble(char * out, double value)
+    {
+        static const double powers[] =
+        {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+        };
+
+        char * p = out;
+        double scaled;
+        uint64_t mantissa;
+        size_t size, k;
+
+        if (value != value)
+        {
+            SHRN_MEMCPY(out, "nan", 3);
+            return 3;
+        }
+
+        if (value < 0 || (value == 0 && 1 / value < 0))
+        {
+            *p++ = '-';
+            value = -value;
+        }
+
+        if (value > 1.7976931348623157e308)
+        {
+            SHRN_MEMCPY(p, "inf", 3);
+            return (size_t)(p - out) + 3;
+        }
+
+        /*
+         * Find the fewest decimals `k` for which `value * 10^k` is an integer `mantissa` below 2^53
+         * that gives back `value` when divided by `10^k`. Both operands of that division are exact,
+         * so it is correctly rounded, just like reading the printed number.
+         */
+        for (k = 0; k < sizeof(powers) / sizeof(powers[0]) && value < 9007199254740992.0; k++)
+        {
+            scaled = value * powers[k];
+
+            if (scaled >= 9007199254740992.0)
+                break;
+
+            mantissa = (uint64_t)scaled;
+
+            if ((double)mantissa == scaled && (double)mantissa / powers[k] == value)
+            {
+                char digits[20];
+
+                size = SUTL_InternalFormatUInt(digits, mantissa);
+
+                if (!k)
+                {
+                    SHRN_MEMCPY(p, digits, size);
+                    return (size_t)(p - out) + size;
+                }
+
+                /*
+                 * Place the decimal point `k` digits from the end, padding with zeros in front.
+                 */
+                if (size <= k)
+                {
+                    *p++ = '0';
+                    *p++ = '.';
+
+                    SHRN_MEMSET(p, '0', k - size);
+                    p += k - size;
+
+                    SHRN_MEMCPY(p, digits, size);
+                    return (size_t)(p - out) + size;
+                }
+
+                SHRN_MEMCPY(p, digits, size - k);
+                p += size - k;
+                *p++ = '.';
+                SHRN_MEMCPY(p, digits + size - k, k);
+
+                return (size_t)(p - out) + k;
+            }
+        }
+
+    #ifdef SHRN_FORMAT_DOUBLE
+        #ifdef SHRN_STRTOD
+        {
+            /*
+             * A normal double is 15 digits apart from its neighbours at most, so if a shorter
+             * representation reads back, the 15 digit one does too and `%g` drops its trailing
+             * zeros. Subnormals have less precision and are tried from 1 digit.
+             */
+            int precision = value < 2.2250738585072014e-308 ? 1 : 15;
+
+            for (;; precision++)
+            {
+                size = (size_t)SHRN_FORMAT_DOUBLE(p, precision, value);
+
+                if (precision == 17 || SHRN_STRTOD(p, NULL) == value)
+                    break;
+            }
+        }
+        #else
+            size = (size_t)SHRN_FORMAT_DOUBLE(p, 17, value);
+        #endif
+
+        return (size_t)(p - out) + size;
+    #else
+        {
+            int exponent = 0;
+            int digit;
+
+            /*
+             * Scale into [1, 10) and write 17 digits in scientific notation. This isn't exact, as
+             * the scaling rounds.
+             */
+            while (value >= 10.0)
+            {
+                value /= 10.0;
+                exponent++;
+            }
+
+            while (value < 1.0)
+            {
+                value *= 10.0;
+                exponent--;
+            }
+
+            for (k = 0; k < 17; k++)
+            {
+                digit = (int)value;
+                value = (value - digit) * 10.0;
+
+                *p++ = (char)('0' + digit);
+
+                if (!k)
+                    *p++ = '.';
+            }
+
+            *p++ = 'e';
+            p += SUTL_InternalFormatInt(p, exponent);
+
+            return (size_t)(p - out);
+        }
+    #endif
+    }
+
+    void SUTL_InternalStringAppendInt(SUTLString * str, int64_t value)
+    {
+        char buffer[SUTL_STRING_NUMBER_MAX];
+
+        SUTLStringAppendN(*str, buffer, SUTL_InternalFormatInt(buffer, value));
+    }
+
+    void SUTL_InternalStringAppendDouble(SUTLString * str, double value)
+    {
+        char buffer[SUTL_STRING_NUMBER_MAX];
+
+        SUTLStringAppendN(*str, buffer, SUTL_InternalFormatDouble(buffer, value));
+    }
 #endif
 
 #endif
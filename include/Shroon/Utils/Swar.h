@@ -0,0 +1,144 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_SWAR_H
+#define SUTL_SWAR_H
+
+#include "Common.h"
+
+/**
+ * @defgroup Swar
+ * Byte classification of 8 bytes at a time with ordinary 64-bit integer operations ("SIMD within a
+ * register"), used by the text parsers to build bitmasks of interesting characters.
+ *
+ * A word is loaded as little endian, so bit \p i of a mask always describes byte \p i of the input
+ * on every platform. The helpers are macros so that they are always inlined into scanning loops,
+ * and they evaluate their arguments more than once, so they must be given plain variables.
+ * @{
+ */
+
+/**
+ * @brief A 64-bit word with every byte set to 1. Multiplying a byte by it repeats the byte.
+ */
+#define SUTL_SWAR_ONES 0x0101010101010101ULL
+
+/**
+ * @brief Loads the 8 bytes at \p ptr into \p w as a little endian \p uint64_t, without alignment
+ * requirements. On little endian targets this is a single unaligned load.
+ *
+ * @param w The \p uint64_t variable to load into.
+ * @param ptr An <tt>unsigned char *</tt> to the bytes.
+ */
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    #define SUTL_SWAR_LOAD(w, ptr)  SHRN_MEMCPY(&(w), ptr, 8)
+#else
+    #define SUTL_SWAR_LOAD(w, ptr) \
+        ((w) = (uint64_t)(ptr)[0]       | (uint64_t)(ptr)[1] << 8  |\
+               (uint64_t)(ptr)[2] << 16 | (uint64_t)(ptr)[3] << 24 |\
+               (uint64_t)(ptr)[4] << 32 | (uint64_t)(ptr)[5] << 40 |\
+               (uint64_t)(ptr)[6] << 48 | (uint64_t)(ptr)[7] << 56)
+#endif
+
+/**
+ * @brief Sets the high bit of each byte of \p x which is zero, and clears all other bits. Unlike the
+ * usual <tt>(x - ONES) & ~x</tt> test no carry crosses a byte, so there are no false matches.
+ *
+ * @param x A \p uint64_t.
+ */
+#define SUTL_SWAR_ZEROS(x) \
+    (~((((x) & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | (x)) & 0x8080808080808080ULL)
+
+/**
+ * @brief Moves the high bit of byte \p i of \p m to bit \p i of an 8-bit mask.
+ *
+ * @param m A \p uint64_t in which only the high bits of bytes may be set.
+ */
+#define SUTL_SWAR_GATHER(m)     ((unsigned)((((m) >> 7) * 0x0102040810204080ULL) >> 56))
+
+/**
+ * @brief Gets the 8-bit mask of the bytes of \p w which are equal to \p c.
+ *
+ * @param w A \p uint64_t.
+ * @param c The byte to compare with.
+ */
+#define SUTL_SWAR_EQ(w, c)      SUTL_SWAR_GATHER(SUTL_SWAR_ZEROS((w) ^ (SUTL_SWAR_ONES * (unsigned char)(c))))
+
+/**
+ * @brief Gets the 8-bit mask of the bytes of \p w which are less than \p n, where \p n is at most
+ * 0x80. Adding <tt>0x80 - n</tt> to the low 7 bits of a byte sets its high bit if they are at
+ * least \p n.
+ *
+ * @param w A \p uint64_t.
+ * @param n The limit.
+ */
+#define SUTL_SWAR_LESS(w, n) \
+    SUTL_SWAR_GATHER(~((((w) & 0x7F7F7F7F7F7F7F7FULL) + SUTL_SWAR_ONES * (unsigned char)(0x80 - (n))) | (w)) & 0x8080808080808080ULL)
+
+/**
+ * @brief Gets the index of the lowest set bit of \p x, which must not be 0.
+ *
+ * @param x A \p uint64_t.
+ */
+#if defined(__GNUC__)
+    #define SUTL_CTZ64(x)       ((unsigned)__builtin_ctzll(x))
+#else
+    #define SUTL_CTZ64(x)       SUTL_InternalCtz64(x)
+#endif
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+unsigned SUTL_InternalCtz64(uint64_t x);
+uint64_t SUTL_InternalPrefixXor64(uint64_t x);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    unsigned SUTL_InternalCtz64(uint64_t x)
+    {
+        unsigned n = 0;
+
+        while (!(x & 1))
+        {
+            x >>= 1;
+            n++;
+        }
+
+        return n;
+    }
+
+    uint64_t SUTL_InternalPrefixXor64(uint64_t x)
+    {
+        /*
+         * Bit `i` of the result is the XOR of bits 0 to `i`, so given a mask of quotes it is set
+         * from an opening quote up to, but not including, the closing quote.
+         */
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+
+        return x;
+    }
+#endif
+
+#endif
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_SYSTEM_H
+#define SUTL_SYSTEM_H
+
+#include "Common.h"
+
+/**
+ * @file System.h
+ * This file defines macros for the operating system functions used by the I/O utilities, in the
+ * same way as Common.h does for the standard library.
+ *
+ * By default they use POSIX. Define \p SHRN_NO_USE_UNISTD_H along with all of the file and mapping macros (and
+ * a <tt>struct iovec</tt> with \p iov_base and \p iov_len members), or \p SHRN_NO_USE_PTHREAD_H
+ * along with all of the thread macros, to use them on other platforms.
+ */
+
+#ifdef SHRN_NO_USE_UNISTD_H
+    #ifndef SHRN_READ
+        #error "`SHRN_READ` must be defined if `SHRN_NO_USE_UNISTD_H` is defined."
+    #endif
+
+    #ifndef SHRN_PREAD
+        #error "`SHRN_PREAD` must be defined if `SHRN_NO_USE_UNISTD_H` is defined."
+    #endif
+
+    #ifndef SHRN_WRITE
+        #error "`SHRN_WRITE` must be defined if `SHRN_NO_USE_UNISTD_H` is defined."
+    #endif
+
+    #ifndef SHRN_WRITEV
+        #error "`SHRN_WRITEV` must be defined if `SHRN_NO_USE_UNISTD_H` is defined."
+    #endif
+
+    #ifndef SHRN_NOW
+        #error "`SHRN_NOW` must be defined if `SHRN_NO_USE_UNISTD_H` is defined."
+    #endif
+
+    #if !defined(SHRN_OPEN_READ) || !defined(SHRN_CLOSE) || !defined(SHRN_FILE_SIZE)
+        #error "`SHRN_OPEN_READ`, `SHRN_CLOSE` and `SHRN_FILE_SIZE` must be defined if `SHRN_NO_USE_UNISTD_H` is defined."
+    #endif
+
+    #if !defined(SHRN_MMAP_READ) || !defined(SHRN_MUNMAP)
+        #error "`SHRN_MMAP_READ` and `SHRN_MUNMAP` must be defined if `SHRN_NO_USE_UNISTD_H` is defined."
+    #endif
+#else
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <time.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+
+    #define SHRN_WRITE(fd, buf, size)       write(fd, buf, size)
+    #define SHRN_NOW()                      SUTL_InternalNow()
+
+    /*
+     * `SHRN_READ` and `SHRN_WRITEV` may be defined beforehand to use other sources and sinks, for
+     * example in tests.
+     */
+    #ifndef SHRN_READ
+        #define SHRN_READ(fd, buf, size)    read(fd, buf, size)
+    #endif
+
+    #ifndef SHRN_WRITEV
+        #define SHRN_WRITEV(fd, iov, count) writev(fd, iov, count)
+    #endif
+
+    /*
+     * `pread` needs X/Open or POSIX.1-2008, which strict `-std` modes of glibc hide. Without it,
+     * `SHRN_PREAD` seeks and then reads, which moves the file offset and must not race with other
+     * reads of the same descriptor, so `SUTL_SYSTEM_PREAD_SEEKS` is defined.
+     */
+    #if (_XOPEN_SOURCE - 0) >= 500 || (_POSIX_C_SOURCE - 0) >= 200809L || (!defined(__GLIBC__) && !defined(__STRICT_ANSI__))
+        #define SHRN_PREAD(fd, buf, size, at)   pread(fd, buf, size, at)
+    #else
+        #define SHRN_PREAD(fd, buf, size, at)   SUTL_InternalPread(fd, buf, size, at)
+        #define SUTL_SYSTEM_PREAD_SEEKS
+    #endif
+
+    /*
+     * `SHRN_OPEN_READ` evaluates to a negative number on failure. `SHRN_FILE_SIZE` stores the size
+     * of the file in the `size_t` lvalue `size` and evaluates to 0 on success. `SHRN_MMAP_READ`
+     * maps `size` bytes of the file privately and read-only, and evaluates to `NULL` on failure.
+     * `SHRN_MADVISE` takes one of the `SHRN_MADV` hints. It and each of the hints are optional, as
+     * strict `-std` modes hide `madvise` and its hints.
+     */
+    #define SHRN_OPEN_READ(path)            open(path, O_RDONLY)
+    #define SHRN_CLOSE(fd)                  close(fd)
+    #define SHRN_FILE_SIZE(fd, size)        SUTL_InternalFileSize(fd, &(size))
+    #define SHRN_MMAP_READ(fd, size)        SUTL_InternalMmapRead(fd, size)
+    #define SHRN_MUNMAP(ptr, size)          munmap(ptr, size)
+
+    #ifdef MADV_NORMAL
+        #define SHRN_MADVISE(ptr, size, advice) madvise(ptr, size, advice)
+    #endif
+
+    #ifdef MADV_SEQUENTIAL
+        #define SHRN_MADV_SEQUENTIAL        MADV_SEQUENTIAL
+    #endif
+
+    #ifdef MADV_RANDOM
+        #define SHRN_MADV_RANDOM            MADV_RANDOM
+    #endif
+
+    #ifdef MADV_WILLNEED
+        #define SHRN_MADV_WILLNEED          MADV_WILLNEED
+    #endif
+
+    #ifdef MADV_HUGEPAGE
+        #define SHRN_MADV_HUGEPAGE          MADV_HUGEPAGE
+    #endif
+
+    double SUTL_InternalNow(void);
+    int SUTL_InternalFileSize(int fd, size_t * size);
+    void * SUTL_InternalMmapRead(int fd, size_t size);
+    ssize_t SUTL_InternalPread(int fd, void * buf, size_t size, off_t at);
+
+    #ifdef SUTL_IMPLEMENTATION
+        double SUTL_InternalNow(void)
+        {
+        /*
+         * Strict `-std` modes of glibc hide `clock_gettime`, so processor time is used there.
+         */
+        #if defined(CLOCK_MONOTONIC) && ((_POSIX_C_SOURCE - 0) >= 199309L || (_XOPEN_SOURCE - 0) >= 500 || (!defined(__GLIBC__) && !defined(__STRICT_ANSI__)))
+            struct timespec ts;
+
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+
+            return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+        #else
+            return (double)clock() / CLOCKS_PER_SEC;
+        #endif
+        }
+
+        int SUTL_InternalFileSize(int fd, size_t * size)
+        {
+            struct stat st;
+
+            if (fstat(fd, &st) != 0)
+                return -1;
+
+            *size = (size_t)st.st_size;
+
+            return 0;
+        }
+
+        void * SUTL_InternalMmapRead(int fd, size_t size)
+        {
+            void * data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            return data == MAP_FAILED ? NULL : data;
+        }
+
+        ssize_t SUTL_InternalPread(int fd, void * buf, size_t size, off_t at)
+        {
+            if (lseek(fd, at, SEEK_SET) < 0)
+                return -1;
+
+            return read(fd, buf, size);
+        }
+    #endif
+#endif
+
+#ifdef SHRN_NO_USE_PTHREAD_H
+    #if !defined(SHRN_THREAD) || !defined(SHRN_THREAD_CREATE) || !defined(SHRN_THREAD_JOIN) || !defined(SHRN_THREAD_YIELD)
+        #error "`SHRN_THREAD`, `SHRN_THREAD_CREATE`, `SHRN_THREAD_JOIN` and `SHRN_THREAD_YIELD` must be defined if `SHRN_NO_USE_PTHREAD_H` is defined."
+    #endif
+
+    #if !defined(SHRN_MUTEX) || !defined(SHRN_MUTEX_INIT) || !defined(SHRN_MUTEX_LOCK) || !defined(SHRN_MUTEX_UNLOCK) || !defined(SHRN_MUTEX_DESTROY)
+        #error "`SHRN_MUTEX` and its `INIT`, `LOCK`, `UNLOCK` and `DESTROY` macros must be defined if `SHRN_NO_USE_PTHREAD_H` is defined."
+    #endif
+
+    #if !defined(SHRN_COND) || !defined(SHRN_COND_INIT) || !defined(SHRN_COND_WAIT) || !defined(SHRN_COND_SIGNAL) || !defined(SHRN_COND_BROADCAST) || !defined(SHRN_COND_DESTROY)
+        #error "`SHRN_COND` and its `INIT`, `WAIT`, `SIGNAL`, `BROADCAST` and `DESTROY` macros must be defined if `SHRN_NO_USE_PTHREAD_H` is defined."
+    #endif
+#else
+    #include <pthread.h>
+    #include <sched.h>
+
+    /*
+     * Thread functions have the signature `void * (void *)`. `SHRN_THREAD_CREATE` evaluates to 1
+     * on success.
+     */
+    #define SHRN_THREAD                         pthread_t
+    #define SHRN_THREAD_CREATE(thread, fn, arg) (pthread_create(&(thread), NULL, fn, arg) == 0)
+    #define SHRN_THREAD_JOIN(thread)            pthread_join(thread, NULL)
+    #define SHRN_THREAD_YIELD()                 sched_yield()
+
+    #define SHRN_MUTEX                          pthread_mutex_t
+    #define SHRN_MUTEX_INIT(mutex)              pthread_mutex_init(&(mutex), NULL)
+    #define SHRN_MUTEX_LOCK(mutex)              pthread_mutex_lock(&(mutex))
+    #define SHRN_MUTEX_UNLOCK(mutex)            pthread_mutex_unlock(&(mutex))
+    #define SHRN_MUTEX_DESTROY(mutex)           pthread_mutex_destroy(&(mutex))
+
+    #define SHRN_COND                           pthread_cond_t
+    #define SHRN_COND_INIT(cond)                pthread_cond_init(&(cond), NULL)
+    #define SHRN_COND_WAIT(cond, mutex)         pthread_cond_wait(&(cond), &(mutex))
+    #define SHRN_COND_SIGNAL(cond)              pthread_cond_signal(&(cond))
+    #define SHRN_COND_BROADCAST(cond)           pthread_cond_broadcast(&(cond))
+    #define SHRN_COND_DESTROY(cond)             pthread_cond_destroy(&(cond))
+#endif
+
+/*
+ * Interrupted system calls are retried, on platforms which have them.
+ */
+#ifdef EINTR
+    #define SUTL_INTERRUPTED(result) ((result) < 0 && errno == EINTR)
+#else
+    #define SUTL_INTERRUPTED(result) 0
+#endif
+
+#endif
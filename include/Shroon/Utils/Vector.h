@@ -35,6 +35,13 @@
  * The whole struct is dynamically allocated and the pointer to \p Data is returned to the user so
  * the subscript operator works properly.
  *
+ * A vector can be shared by several owners without copying. A shared vector has one more member,
+ * an atomic reference count, before \p Size, and the highest bit of \p Elemsize marks it. Every
+ * function which changes a shared vector first gives it its own copy if it has other owners
+ * (copy-on-write), and \p SUTLVectorFree frees it only when its last owner does. Elements and the
+ * size written directly through the pointer aren't noticed, so call \p SUTLVectorMakeUnique
+ * before doing that to a shared vector.
+ *
  * This implementation is inspired from stretchy_buffer in stb.
  * @{
  */
@@ -63,11 +70,49 @@
 #define SUTLVectorNew(t)                        ((t *)SUTL_InternalVectorNew(sizeof(t)))
 
 /**
- * @brief Frees a vector.
+ * @brief Creates a new vector of type \p t which can be shared without copying it first.
+ *
+ * @param t The type of element which the vector will store.
  *
- * @param v The vector to free. This must be a pointer returned from \p SUTLVectorNew.
+ * @return A <tt>t *</tt> which points to index 0 in the vector.
  */
-#define SUTLVectorFree(v)                       SHRN_FREE((size_t *)v - 3)
+#define SUTLVectorNewShared(t)                  ((t *)SUTL_InternalVectorNewShared(sizeof(t)))
+
+/**
+ * @brief Frees a vector. A shared vector is only released by this owner, and freed when it has no
+ * other owners.
+ *
+ * @param v The vector to free. This must be a pointer returned from \p SUTLVectorNew,
+ * \p SUTLVectorNewShared or \p SUTLVectorShare.
+ */
+#define SUTLVectorFree(v)                       SUTL_InternalVectorFree(v)
+
+/**
+ * @brief Adds an owner to \p v in O(1). A vector which wasn't created with
+ * \p SUTLVectorNewShared is moved into a shareable allocation the first time, which changes \p v.
+ *
+ * @param v The vector to share.
+ *
+ * @return \p v for the new owner, which must free it separately.
+ */
+#define SUTLVectorShare(v)                      SUTL_InternalVectorShare((void **)&v)
+
+/**
+ * @brief Gets the number of owners of \p v. It is 1 for vectors which aren't shared.
+ *
+ * @param v The vector to get the number of owners of.
+ */
+#define SUTLVectorRefCount(v)                   SUTL_InternalVectorRefCount(v)
+
+/**
+ * @brief Gives \p v its own copy of the elements if it is shared with other owners, so that it can
+ * be changed directly. The other owners keep the old elements.
+ *
+ * @param v The vector to make unique.
+ *
+ * @return The new \p v.
+ */
+#define SUTLVectorMakeUnique(v)                 SUTL_InternalVectorMakeUnique((void **)&v)
 
 /**
  * @brief Reserves memory for \p size elements in \p v.
@@ -197,6 +242,11 @@
  * @{
  */
 void * SUTL_InternalVectorNew(size_t elemsize);
+void * SUTL_InternalVectorNewShared(size_t elemsize);
+void SUTL_InternalVectorFree(void * v);
+void * SUTL_InternalVectorShare(void ** v);
+size_t SUTL_InternalVectorRefCount(const void * v);
+void * SUTL_InternalVectorMakeUnique(void ** v);
 void SUTL_InternalVectorReserve(void ** v, size_t size);
 void SUTL_InternalVectorResize(void ** v, size_t size);
 void * SUTL_InternalVectorInsertN(void ** v, size_t at, const void * ptr, size_t count);
@@ -206,9 +256,29 @@ void SUTL_InternalVectorEraseN(void ** v, size_t at, size_t count);
  */
 
 #ifdef SUTL_IMPLEMENTATION
-    #define SUTLVectorElemsize(v)   (*((size_t *)v - 1))
+    #define SUTL_VECTOR_SHARED      ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
+    #define SUTLVectorShared(v)     (*((size_t *)v - 1) & SUTL_VECTOR_SHARED)
+    #define SUTLVectorElemsize(v)   (*((size_t *)v - 1) & ~SUTL_VECTOR_SHARED)
+    #define SUTLVectorHeader(v)     (SUTLVectorShared(v) ? 4 : 3)
+    #define SUTLVectorRefs(v)       ((SHRN_ATOMIC(size_t) *)((size_t *)v - 4))
     #define SUTLVectorOffset(v, i)  (void *)((uint8_t *)v + SUTLVectorElemsize(v) * (i))
 
+    /*
+     * The reference count is changed atomically so owners in different threads can share a
+     * vector. Adding an owner needs no ordering, as the new owner gets the vector from an existing
+     * one. Removing one orders its accesses before the free by the last owner.
+     */
+    #ifdef SHRN_HAS_ATOMICS
+        #define SUTLVectorRefsLoad(v)       SHRN_ATOMIC_LOAD(SUTLVectorRefs(v), SHRN_ORDER_ACQUIRE)
+        #define SUTLVectorRefsAdd(v)        ((void)SHRN_ATOMIC_FETCH_ADD(SUTLVectorRefs(v), 1, SHRN_ORDER_RELAXED))
+        #define SUTLVectorRefsSub(v)        (SHRN_ATOMIC_FETCH_SUB(SUTLVectorRefs(v), 1, SHRN_ORDER_ACQ_REL) - 1)
+    #else
+        #define SUTLVectorRefsLoad(v)       (*SUTLVectorRefs(v))
+        #define SUTLVectorRefsAdd(v)        ((void)++*SUTLVectorRefs(v))
+        #define SUTLVectorRefsSub(v)        (--*SUTLVectorRefs(v))
+    #endif
+
     void * SUTL_InternalVectorNew(size_t elemsize)
     {
         /*
@@ -232,11 +302,99 @@ void SUTL_InternalVectorEraseN(void ** v, size_t at, size_t count);
          */
         SUTLVectorSize(mem) = 0;
         SUTLVectorCapacity(mem) = 0;
-        SUTLVectorElemsize(mem) = elemsize;
+        *((size_t *)mem - 1) = elemsize;
+
+        return mem;
+    }
+
+    void * SUTL_InternalVectorNewShared(size_t elemsize)
+    {
+        /*
+         * Allocate memory for the reference count and the other internal variables.
+         */
+        void * mem = SHRN_MALLOC(sizeof(size_t) * 4);
+
+        if (!mem)
+        {
+            SUTLErrorHandler("Memory allocation failed.");
+            return mem;
+        }
+
+        mem = (size_t *)mem + 4;
+
+        *SUTLVectorRefs(mem) = 1;
+        SUTLVectorSize(mem) = 0;
+        SUTLVectorCapacity(mem) = 0;
+        *((size_t *)mem - 1) = elemsize | SUTL_VECTOR_SHARED;
 
         return mem;
     }
 
+    void SUTL_InternalVectorFree(void * v)
+    {
+        if (!SUTLVectorShared(v))
+            SHRN_FREE((size_t *)v - 3);
+        else if (!SUTLVectorRefsSub(v))
+            SHRN_FREE(SUTLVectorRefs(v));
+    }
+
+    size_t SUTL_InternalVectorRefCount(const void * v)
+    {
+        return SUTLVectorShared(v) ? SUTLVectorRefsLoad(v) : 1;
+    }
+
+    void * SUTL_InternalVectorShare(void ** v)
+    {
+        void * shared;
+
+        /*
+         * Move a plain vector into a new allocation which has room for the reference count.
+         */
+        if (!SUTLVectorShared(*v))
+        {
+            shared = SUTL_InternalVectorNewShared(SUTLVectorElemsize(*v));
+
+            if (!shared)
+                return NULL;
+
+            SUTL_InternalVectorReserve(&shared, SUTLVectorCapacity(*v));
+            SHRN_MEMCPY(shared, *v, SUTLVectorSize(*v) * SUTLVectorElemsize(*v));
+            SUTLVectorSize(shared) = SUTLVectorSize(*v);
+
+            SHRN_FREE((size_t *)*v - 3);
+            *v = shared;
+        }
+
+        SUTLVectorRefsAdd(*v);
+
+        return *v;
+    }
+
+    void * SUTL_InternalVectorMakeUnique(void ** v)
+    {
+        void * copy;
+
+        /*
+         * With a single owner no other thread can add one, so the vector can be changed in place.
+         */
+        if (!SUTLVectorShared(*v) || SUTLVectorRefsLoad(*v) == 1)
+            return *v;
+
+        copy = SUTL_InternalVectorNewShared(SUTLVectorElemsize(*v));
+
+        if (!copy)
+            return NULL;
+
+        SUTL_InternalVectorReserve(&copy, SUTLVectorCapacity(*v));
+        SHRN_MEMCPY(copy, *v, SUTLVectorSize(*v) * SUTLVectorElemsize(*v));
+        SUTLVectorSize(copy) = SUTLVectorSize(*v);
+
+        SUTL_InternalVectorFree(*v);
+        *v = copy;
+
+        return copy;
+    }
+
     void SUTL_InternalVectorReserve(void ** v, size_t size)
     {
         /*
@@ -253,15 +411,20 @@ void SUTL_InternalVectorEraseN(void ** v, size_t at, size_t count);
             return;
         }
 
+        if (SUTLVectorShared(*v) && !SUTL_InternalVectorMakeUnique(v))
+            return;
+
+        size_t header = SUTLVectorHeader(*v);
+
         size_t requiredSize =
-            sizeof(size_t) * 3              /* For variables size, capacity and element size. */
+            sizeof(size_t) * header         /* For the internal variables. */
             + size * SUTLVectorElemsize(*v) /* For elements allocated in the vector. */
         ;
 
         /*
          * Resize the memory of vector (including the internal variables) to the `requiredSize`.
          */
-        *v = SHRN_REALLOC((size_t *)*v - 3, requiredSize);
+        *v = SHRN_REALLOC((size_t *)*v - header, requiredSize);
 
         if (!*v)
         {
@@ -272,13 +435,16 @@ void SUTL_InternalVectorEraseN(void ** v, size_t at, size_t count);
         /*
          * Make sure `v` points to the start of the array instead of internal variables.:
          */
-        *v = (size_t *)*v + 3;
+        *v = (size_t *)*v + header;
 
         SUTLVectorCapacity(*v) = size;
     }
 
     void SUTL_InternalVectorResize(void ** v, size_t size)
     {
+        if (SUTLVectorShared(*v) && !SUTL_InternalVectorMakeUnique(v))
+            return;
+
         /*
          * Reserve memory only if current memory is not more than required memory.
          */
@@ -313,6 +479,9 @@ void SUTL_InternalVectorEraseN(void ** v, size_t at, size_t count);
             return NULL;
         }
 
+        if (SUTLVectorShared(*v) && !SUTL_InternalVectorMakeUnique(v))
+            return NULL;
+
         size_t originalSize = SUTLVectorSize(*v);
 
         /*
@@ -357,6 +526,9 @@ void SUTL_InternalVectorEraseN(void ** v, size_t at, size_t count);
             count = SUTLVectorSize(*v) - at;
         }
 
+        if (SUTLVectorShared(*v) && !SUTL_InternalVectorMakeUnique(v))
+            return;
+
         /*
          * No need to shift elements if the elements to be removed are at the end of vector.
          */
@@ -380,8 +552,15 @@ void SUTL_InternalVectorEraseN(void ** v, size_t at, size_t count);
         SUTLVectorSize(*v) -= count;
     }
 
+    #undef SUTLVectorRefsSub
+    #undef SUTLVectorRefsAdd
+    #undef SUTLVectorRefsLoad
     #undef SUTLVectorOffset
+    #undef SUTLVectorRefs
+    #undef SUTLVectorHeader
     #undef SUTLVectorElemsize
+    #undef SUTLVectorShared
+    #undef SUTL_VECTOR_SHARED
 #endif
 
 #endif
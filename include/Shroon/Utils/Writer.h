@@ -0,0 +1,340 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SUTL_WRITER_H
+#define SUTL_WRITER_H
+
+#include "Common.h"
+#include "Vector.h"
+#include "String.h"
+#include "System.h"
+
+/**
+ * @defgroup Writer
+ * A buffered writer to a file descriptor which batches many small writes into few system calls.
+ *
+ * Small data is copied into a reusable buffer, and large data is referenced in place. Both are
+ * kept as a list of segments which are written together with one \p writev call when the buffer
+ * or the segment list is full, or when \p SUTLWriterFlush is called.
+ * @{
+ */
+
+/**
+ * @brief The default size of the buffer of a \p SUTLWriter in bytes.
+ */
+#ifndef SUTL_WRITER_BUFFER_SIZE
+    #define SUTL_WRITER_BUFFER_SIZE (64 << 10)
+#endif
+
+/**
+ * @brief The maximum number of segments written with one \p writev call. It must not be more than
+ * the \p IOV_MAX of the platform.
+ */
+#ifndef SUTL_WRITER_IOV_MAX
+    #define SUTL_WRITER_IOV_MAX 256
+#endif
+
+/**
+ * @brief \p SUTLString s of at least this many bytes are referenced instead of copied by
+ * \p SUTLWriterAppendS.
+ */
+#ifndef SUTL_WRITER_REF_MIN
+    #define SUTL_WRITER_REF_MIN 4096
+#endif
+
+/**
+ * @brief It contains the state of a particular writer instance.
+ */
+typedef struct SUTLWriter
+{
+    /**
+     * @brief The file descriptor to write to.
+     */
+    int Fd;
+
+    /**
+     * @brief 1 if writing failed. Data appended after a failure is discarded.
+     */
+    int Error;
+
+    /**
+     * @brief The number of bytes written to \p Fd.
+     */
+    uint64_t BytesWritten;
+
+    /**
+     * @brief The number of write system calls made.
+     */
+    uint64_t WriteCount;
+
+    /**
+     * @brief Don't access this directly. The number of bytes used in \p Buffer.
+     */
+    size_t Used;
+
+    /**
+     * @brief Don't access this directly. A vector of \p char whose size is the buffer size.
+     */
+    char * Buffer;
+
+    /**
+     * @brief Don't access this directly. A vector of <tt>struct iovec</tt> with the segments
+     * waiting to be written.
+     */
+    struct iovec * Parts;
+} SUTLWriter;
+
+/**
+ * @brief Creates a new \p SUTLWriter which writes to \p fd.
+ *
+ * @param fd The file descriptor to write to. It isn't closed by the writer.
+ * @param size The size of the buffer in bytes. If it is 0, \p SUTL_WRITER_BUFFER_SIZE is used.
+ *
+ * @return A \p SUTLWriter created according to the parameters given.
+ */
+#define SUTLWriterNew(fd, size)                 SUTL_InternalWriterNew(fd, size)
+
+/**
+ * @brief Frees a \p SUTLWriter which was created using \p SUTLWriterNew. Data which wasn't
+ * flushed is discarded.
+ *
+ * @param w The \p SUTLWriter to free.
+ */
+#define SUTLWriterFree(w)                       (SUTLVectorFree((w).Parts), SUTLVectorFree((w).Buffer))
+
+/**
+ * @brief Appends a copy of \p size bytes at \p ptr to \p w.
+ *
+ * @param w The \p SUTLWriter to append to.
+ * @param ptr Pointer to the data.
+ * @param size The size of the data in bytes.
+ */
+#define SUTLWriterAppendN(w, ptr, size)         SUTL_InternalWriterAppendN(&w, ptr, size)
+
+/**
+ * @brief Appends a copy of null-terminated string \p ptr to \p w.
+ *
+ * @param w The \p SUTLWriter to append to.
+ * @param ptr Null-terminated string.
+ */
+#define SUTLWriterAppendP(w, ptr)               SUTL_InternalWriterAppendN(&w, ptr, SHRN_STRLEN(ptr))
+
+/**
+ * @brief Appends \p size bytes at \p ptr to \p w by reference, without copying them.
+ *
+ * @param w The \p SUTLWriter to append to.
+ * @param ptr Pointer to the data. It must stay unchanged until the next flush.
+ * @param size The size of the data in bytes.
+ */
+#define SUTLWriterAppendRef(w, ptr, size)       SUTL_InternalWriterAppendRef(&w, ptr, size)
+
+/**
+ * @brief Appends \p str to \p w. It is referenced if it is at least \p SUTL_WRITER_REF_MIN bytes,
+ * otherwise it is copied.
+ *
+ * @param w The \p SUTLWriter to append to.
+ * @param str The \p SUTLString to append. It must stay unchanged until the next flush.
+ */
+#define SUTLWriterAppendS(w, str) \
+    (SUTLStringSize(str) >= SUTL_WRITER_REF_MIN ?\
+        SUTL_InternalWriterAppendRef(&w, str, SUTLStringSize(str)) :\
+        SUTL_InternalWriterAppendN(&w, str, SUTLStringSize(str)))
+
+/**
+ * @brief Writes all appended data to the file descriptor.
+ *
+ * @param w The \p SUTLWriter to flush.
+ *
+ * @return 1 on success. If writing fails, an error is reported, \p Error is set and 0 is returned.
+ */
+#define SUTLWriterFlush(w)                      SUTL_InternalWriterFlush(&w)
+
+/**
+ * @}
+ *
+ * @defgroup Internal
+ * For internal use of the library. Don't use these directly.
+ * @{
+ */
+SUTLWriter SUTL_InternalWriterNew(int fd, size_t size);
+int SUTL_InternalWriterAppendN(SUTLWriter * w, const void * ptr, size_t size);
+int SUTL_InternalWriterAppendRef(SUTLWriter * w, const void * ptr, size_t size);
+int SUTL_InternalWriterFlush(SUTLWriter * w);
+
+int SUTL_InternalWriterWriteAll(SUTLWriter * w, struct iovec * parts, size_t count);
+/**
+ * @}
+ */
+
+#ifdef SUTL_IMPLEMENTATION
+    SUTLWriter SUTL_InternalWriterNew(int fd, size_t size)
+    {
+        SUTLWriter w;
+
+        /*
+         * Initialize the members of `w`.
+         */
+        w.Fd = fd;
+        w.Error = 0;
+        w.BytesWritten = 0;
+        w.WriteCount = 0;
+        w.Used = 0;
+        w.Buffer = SUTLVectorNew(char);
+        w.Parts = SUTLVectorNew(struct iovec);
+
+        SUTLVectorResize(w.Buffer, size ? size : SUTL_WRITER_BUFFER_SIZE);
+        SUTLVectorReserve(w.Parts, SUTL_WRITER_IOV_MAX);
+
+        return w;
+    }
+
+    int SUTL_InternalWriterAppendN(SUTLWriter * w, const void * ptr, size_t size)
+    {
+        size_t parts = SUTLVectorSize(w->Parts);
+        struct iovec part;
+        int extend;
+
+        if (w->Error)
+            return 0;
+
+        if (w->Used + size > SUTLVectorSize(w->Buffer))
+        {
+            if (!SUTL_InternalWriterFlush(w))
+                return 0;
+
+            parts = 0;
+        }
+
+        /*
+         * Data which doesn't fit even in an empty buffer is written directly.
+         */
+        if (size > SUTLVectorSize(w->Buffer))
+        {
+            part.iov_base = (void *)ptr;
+            part.iov_len = size;
+
+            return SUTL_InternalWriterWriteAll(w, &part, 1);
+        }
+
+        /*
+         * Consecutive copies extend the same segment, so they don't count towards the limit.
+         */
+        extend = parts && (char *)w->Parts[parts - 1].iov_base + w->Parts[parts - 1].iov_len == w->Buffer + w->Used;
+
+        if (!extend && parts == SUTL_WRITER_IOV_MAX && !SUTL_InternalWriterFlush(w))
+            return 0;
+
+        SHRN_MEMCPY(w->Buffer + w->Used, ptr, size);
+
+        if (extend)
+        {
+            w->Parts[parts - 1].iov_len += size;
+        }
+        else
+        {
+            part.iov_base = w->Buffer + w->Used;
+            part.iov_len = size;
+
+            SUTLVectorPush(w->Parts, part);
+        }
+
+        w->Used += size;
+
+        return 1;
+    }
+
+    int SUTL_InternalWriterAppendRef(SUTLWriter * w, const void * ptr, size_t size)
+    {
+        struct iovec part;
+
+        if (w->Error)
+            return 0;
+
+        if (SUTLVectorSize(w->Parts) == SUTL_WRITER_IOV_MAX && !SUTL_InternalWriterFlush(w))
+            return 0;
+
+        part.iov_base = (void *)ptr;
+        part.iov_len = size;
+
+        SUTLVectorPush(w->Parts, part);
+
+        return 1;
+    }
+
+    int SUTL_InternalWriterWriteAll(SUTLWriter * w, struct iovec * parts, size_t count)
+    {
+        long written;
+
+        while (count)
+        {
+            do
+            {
+                written = (long)SHRN_WRITEV(w->Fd, parts, (int)count);
+            } while (SUTL_INTERRUPTED(written));
+
+            w->WriteCount++;
+
+            /*
+             * Writing nothing while bytes are pending would repeat forever, so it fails as well.
+             */
+            while (!written && count && !parts->iov_len)
+            {
+                parts++;
+                count--;
+            }
+
+            if (written < 0 || (!written && count))
+            {
+                SUTLErrorHandler("Failed to write to file descriptor.");
+
+                w->Error = 1;
+                return 0;
+            }
+
+            w->BytesWritten += (uint64_t)written;
+
+            /*
+             * Skip the segments which were written completely and advance into a partially
+             * written one.
+             */
+            while (count && (size_t)written >= parts->iov_len)
+            {
+                written -= (long)parts->iov_len;
+                parts++;
+                count--;
+            }
+
+            if (count)
+            {
+                parts->iov_base = (char *)parts->iov_base + written;
+                parts->iov_len -= (size_t)written;
+            }
+        }
+
+        return 1;
+    }
+
+    int SUTL_InternalWriterFlush(SUTLWriter * w)
+    {
+        int result = w->Error ? 0 : SUTL_InternalWriterWriteAll(w, w->Parts, SUTLVectorSize(w->Parts));
+
+        SUTLVectorResize(w->Parts, 0);
+        w->Used = 0;
+
+        return result;
+    }
+#endif
+
+#endif
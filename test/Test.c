@@ -1,12 +1,38 @@
 #include <stdio.h>
+#include <sys/uio.h>
+
+long TestRead(int fd, void * buf, size_t size);
+long TestWritev(int fd, const struct iovec * iov, int count);
 
 #define SUTL_IMPLEMENTATION
+#define SHRN_READ(fd, buf, size)    TestRead(fd, buf, size)
+#define SHRN_WRITEV(fd, iov, count) TestWritev(fd, iov, count)
 #define SUTL_ERROR_HANDLER_CUSTOM 1
 #include "../include/Shroon/Utils/Vector.h"
 #include "../include/Shroon/Utils/String.h"
 #include "../include/Shroon/Utils/Hashmap.h"
 #include "../include/Shroon/Utils/Hashset.h"
 #include "../include/Shroon/Utils/HashUtils.h"
+#include "../include/Shroon/Utils/CompressedVector.h"
+#include "../include/Shroon/Utils/Roaring.h"
+#include "../include/Shroon/Utils/Flatmap.h"
+#include "../include/Shroon/Utils/PerfectHash.h"
+#include "../include/Shroon/Utils/LineReader.h"
+#include "../include/Shroon/Utils/MappedFile.h"
+#include "../include/Shroon/Utils/Writer.h"
+#include "../include/Shroon/Utils/AsyncIO.h"
+#include "../include/Shroon/Utils/Csv.h"
+#include "../include/Shroon/Utils/Json.h"
+#include "../include/Shroon/Utils/JsonWriter.h"
+#include "../include/Shroon/Utils/Lz.h"
+#include "../include/Shroon/Utils/Crc32c.h"
+#include "../include/Shroon/Utils/Persistent.h"
+#include "../include/Shroon/Utils/Rcu.h"
+#include "../include/Shroon/Utils/ConcurrentVector.h"
+#include "../include/Shroon/Utils/Metrics.h"
+#include "../include/Shroon/Utils/Intrusive.h"
+#include "../include/Shroon/Utils/SkipList.h"
+#include "../include/Shroon/Utils/Graph.h"
 
 #include "Test.h"
 
@@ -16,6 +42,39 @@ int tmparr[] = {13, 33, 47};
 char * ExpectedMsg = NULL;
 int ExpectationFulfilled = 0;
 
+/*
+ * Descriptor -3 gives a line and a half, then fails.
+ */
+long TestRead(int fd, void * buf, size_t size)
+{
+    static int calls = 0;
+
+    if (fd != -3)
+        return (long)read(fd, buf, size);
+
+    if (calls++)
+    {
+        errno = EIO;
+        return -1;
+    }
+
+    size = size < 12 ? size : 12;
+    memcpy(buf, "full\npartial", size);
+
+    return (long)size;
+}
+
+/*
+ * Descriptor -2 is a sink which accepts nothing without failing.
+ */
+long TestWritev(int fd, const struct iovec * iov, int count)
+{
+    if (fd == -2)
+        return 0;
+
+    return (long)writev(fd, iov, count);
+}
+
 void TestErrorHandler(const char * msg)
 {
     if (ExpectedMsg)
@@ -34,6 +93,199 @@ void RestoreVectorDefault(int ** v)
     SUTLVectorReserve(*v, 0);
 }
 
+size_t CollidingHash(const void * key)
+{
+    return (size_t)(*(const int *)key % 4);
+}
+
+/*
+ * Reads the numbers of the emitted array whose declaration contains `name` into a new vector.
+ */
+uint32_t * EmittedArray(const char * src, const char * name)
+{
+    uint32_t * values = SUTLVectorNew(uint32_t);
+    const char * p = strstr(src, name);
+    char * end;
+    uint32_t value;
+
+    for (p = p ? strchr(p, '{') : NULL; p; p = end + 1)
+    {
+        value = (uint32_t)strtoul(p + (*p == '{'), &end, 10);
+
+        if (end == p + (*p == '{'))
+            break;
+
+        SUTLVectorPush(values, value);
+
+        if (*end != ',')
+            break;
+    }
+
+    return values;
+}
+
+/*
+ * Reads the number which follows `prefix` in `src`, in hexadecimal if `prefix` ends with "0x".
+ */
+uint64_t EmittedNumber(const char * src, const char * prefix)
+{
+    const char * p = strstr(src, prefix);
+    unsigned base = SHRN_STRLEN(prefix) > 1 && prefix[SHRN_STRLEN(prefix) - 1] == 'x' ? 16 : 10;
+    uint64_t value = 0;
+    int digit;
+
+    for (p = p ? p + SHRN_STRLEN(prefix) : ""; *p; p++)
+    {
+        digit = *p >= '0' && *p <= '9' ? *p - '0' : *p >= 'A' && *p <= 'F' ? *p - 'A' + 10 : 16;
+
+        if (digit >= (int)base)
+            break;
+
+        value = value * base + (uint64_t)digit;
+    }
+
+    return value;
+}
+
+/*
+ * Versions for the RCU tests hold two fields which writers keep equal, and count their frees.
+ */
+typedef struct RcuVersion
+{
+    int A;
+    int B;
+} RcuVersion;
+
+SHRN_ATOMIC(int) RcuFrees = 0;
+SHRN_ATOMIC(int) RcuTorn = 0;
+SHRN_ATOMIC(int) RcuStop = 0;
+
+void RcuFreeVersion(void * ptr)
+{
+    ((RcuVersion *)ptr)->A = -1;
+    free(ptr);
+    SHRN_ATOMIC_FETCH_ADD(&RcuFrees, 1, SHRN_ORDER_RELAXED);
+}
+
+void * RcuReader(void * arg)
+{
+    SUTLRcu rcu = *(SUTLRcu *)arg;
+    size_t slot = SUTLRcuRegister(rcu);
+    RcuVersion * ver;
+
+    while (!SHRN_ATOMIC_LOAD(&RcuStop, SHRN_ORDER_RELAXED))
+    {
+        ver = SUTLRcuReadLock(RcuVersion, rcu, slot);
+
+        if (ver->A != ver->B || ver->A < 0)
+            SHRN_ATOMIC_STORE(&RcuTorn, 1, SHRN_ORDER_RELAXED);
+
+        SUTLRcuReadUnlock(rcu, slot);
+    }
+
+    return NULL;
+}
+
+/*
+ * Each pusher tags its elements with its number in the high bits.
+ */
+typedef struct CvPusher
+{
+    SUTLConcurrentVector * Vector;
+    unsigned Id;
+} CvPusher;
+
+void * CvPush(void * arg)
+{
+    CvPusher * pusher = arg;
+    unsigned k;
+    unsigned v;
+
+    for (k = 0; k < 20000; k++)
+    {
+        v = pusher->Id << 24 | k;
+        SUTLConcurrentVectorPush(*pusher->Vector, v);
+    }
+
+    return NULL;
+}
+
+/*
+ * Each thread counts into its own shard and records into its own histogram.
+ */
+typedef struct MetricsThread
+{
+    SUTLCounter * Counter;
+    SUTLHistogram Histogram;
+    unsigned Id;
+} MetricsThread;
+
+void * MetricsRecord(void * arg)
+{
+    MetricsThread * thread = arg;
+    uint64_t k;
+
+    for (k = 1; k <= 50000; k++)
+    {
+        SUTLCounterAdd(*thread->Counter, thread->Id, 2);
+        SUTLHistogramRecord(thread->Histogram, k * 4 + thread->Id);
+    }
+
+    return NULL;
+}
+
+/*
+ * Items of the intrusive container tests are in an LRU list and in a hash table by key at once.
+ */
+typedef struct IntrusiveItem
+{
+    int Key;
+    SUTLList Lru;
+    SUTLHListLink Chain;
+    SUTLIntrusiveHashLink ByKey;
+} IntrusiveItem;
+
+int IntrusiveMatch(const SUTLIntrusiveHashLink * link, const void * probe)
+{
+    return SUTL_CONTAINER_OF(link, IntrusiveItem, ByKey)->Key == *(const int *)probe;
+}
+
+/*
+ * The reader scans the skip list while it is being inserted into, checking that entries are sorted
+ * and complete.
+ */
+typedef struct SkipReader
+{
+    SUTLSkipList * List;
+    SHRN_ATOMIC(int) Stop;
+    int Ok;
+} SkipReader;
+
+void * SkipRead(void * arg)
+{
+    SkipReader * reader = arg;
+    int last;
+    int k;
+
+    while (!SHRN_ATOMIC_LOAD(&reader->Stop, SHRN_ORDER_ACQUIRE))
+    {
+        last = -1;
+
+        SUTLSkipListRange(int, int, *reader->List, NULL, NULL, e,
+            if (*e_k <= last || *e_v != *e_k * 2)
+                reader->Ok = 0;
+            last = *e_k;
+        )
+
+        k = last;
+
+        if (k >= 0 && (SUTLSkipListGet(int, *reader->List, &k) == NULL || *SUTLSkipListGet(int, *reader->List, &k) != k * 2))
+            reader->Ok = 0;
+    }
+
+    return NULL;
+}
+
 int main()
 {
     SHRN_TEST_INIT()
@@ -310,5 +562,1968 @@ int main()
 
         )
 
+        SHRN_TEST_GROUP(COMPRESSED_VECTOR,
+
+            uint64_t ids[300];
+            uint64_t * decoded = SUTLVectorNew(uint64_t);
+            size_t k;
+            int codec;
+            int match;
+            int eachMatch;
+
+            for (k = 0; k < 300; k++)
+                ids[k] = 1000000 + k * 7 + (k % 3 ? 1 : 0);
+
+            ids[200] = 5;
+            ids[201] = UINT64_MAX;
+
+            for (codec = SUTL_INT_CODEC_FOR; codec <= SUTL_INT_CODEC_BP128; codec++)
+            {
+                SUTLCompressedVector cv = SUTLCompressedVectorNew((SUTLIntCodec)codec);
+
+                SUTLCompressedVectorPushN(cv, ids, 250);
+                SUTLCompressedVectorPush(cv, ids[250]);
+                SUTLCompressedVectorPushN(cv, ids + 251, 49);
+
+                SHRN_TEST(cv.Size == 300 && SUTLCompressedVectorBlockCount(cv) == 3)
+
+                /* Random access into encoded blocks and the tail */
+                match = 1;
+                for (k = 299; k < 300; k--)
+                    match = match && SUTLCompressedVectorGet(cv, k) == ids[k];
+                SHRN_TEST(match)
+
+                /* Sequential decode */
+                SUTLVectorResize(decoded, 0);
+                SUTLCompressedVectorDecode(cv, decoded);
+                SHRN_TEST(SUTLVectorSize(decoded) == 300 && memcmp(decoded, ids, sizeof(ids)) == 0)
+
+                eachMatch = 1;
+                k = 0;
+                SUTLCompressedVectorEach(cv, id,
+                    eachMatch = eachMatch && id == ids[k++];
+                )
+                SHRN_TEST(eachMatch && k == 300)
+
+                /* Small deltas must compress well below 8 bytes per element */
+                SHRN_TEST(codec == SUTL_INT_CODEC_FOR || SUTLVectorSize(cv.Bytes) < 128 * 8)
+
+                SUTLCompressedVectorFree(cv);
+            }
+
+            SUTLVectorFree(decoded);
+
+        )
+
+        SHRN_TEST_GROUP(ROARING,
+
+            SUTLRoaring a = SUTLRoaringNew();
+            SUTLRoaring b = SUTLRoaringNew();
+            SUTLRoaring u;
+            SUTLRoaring n;
+            SUTLRoaring d;
+            SUTLString bytes = SUTLStringNew();
+            uint32_t x;
+            uint32_t prev;
+            int sorted;
+            size_t count;
+
+            /* Array container, bitmap container and a sparse chunk */
+            for (x = 0; x < 10000; x++)
+                SUTLRoaringAdd(a, x * 2);
+            for (x = 0; x < 100; x++)
+                SUTLRoaringAdd(a, 0x70000000 + x * 1000);
+
+            for (x = 5000; x < 30000; x++)
+                SUTLRoaringAdd(b, x);
+
+            SHRN_TEST(a.Size == 10100 && SUTLRoaringAdd(a, 0) == 0)
+            SHRN_TEST(SUTLRoaringContains(a, 19998) && !SUTLRoaringContains(a, 19999))
+            SHRN_TEST(SUTLRoaringContains(a, 0x70000000 + 99000) && !SUTLRoaringContains(a, 0x70000001))
+
+            u = SUTLRoaringUnion(a, b);
+            n = SUTLRoaringIntersect(a, b);
+
+            /* 0..4999 evens, all of 5000..29999 and the sparse chunk */
+            SHRN_TEST(u.Size == 2500 + 25000 + 100)
+            /* Evens between 5000 and 19998 */
+            SHRN_TEST(n.Size == 7500 && SUTLRoaringContains(n, 5000) && !SUTLRoaringContains(n, 5001))
+
+            /* Iteration is ascending and complete */
+            sorted = 1;
+            count = 0;
+            prev = 0;
+            SUTLRoaringEach(u, value,
+                sorted = sorted && (count == 0 || value > prev);
+                prev = value;
+                count++;
+            )
+            SHRN_TEST(sorted && count == u.Size)
+
+            /* Run containers shrink dense ranges and convert back on modification */
+            SUTLRoaringRunOptimize(b);
+            SHRN_TEST(b.Containers[0].Type == SUTL_ROARING_RUN && SUTLRoaringByteSize(b) < 100)
+            SHRN_TEST(SUTLRoaringContains(b, 29999) && !SUTLRoaringContains(b, 30000))
+            SUTLRoaringRemove(b, 6000);
+            SHRN_TEST(b.Size == 24999 && !SUTLRoaringContains(b, 6000) && b.Containers[0].Type == SUTL_ROARING_BITMAP)
+
+            /* Removing values shrinks bitmaps back into arrays */
+            for (x = 0; x < 10000; x++)
+                SUTLRoaringRemove(a, x * 2);
+            SHRN_TEST(a.Size == 100 && SUTLVectorSize(a.Keys) == 2 && a.Keys[0] == 0x7000)
+
+            /* Serialization round trip */
+            SUTLRoaringRunOptimize(u);
+            SUTLRoaringSerialize(u, bytes);
+            SHRN_TEST(SUTLRoaringDeserialize(bytes, SUTLStringSize(bytes), d) == 1)
+            SHRN_TEST(d.Size == u.Size && SUTLRoaringContains(d, 29999) && SUTLRoaringContains(d, 4998))
+            SUTLRoaringFree(d);
+
+            ExpectedMsg = "Invalid serialized roaring bitmap.";
+            SHRN_TEST(SUTLRoaringDeserialize(bytes, SUTLStringSize(bytes) - 1, d) == 0 && d.Size == 0)
+            SHRN_TEST(ExpectationFulfilled == 1)
+
+            SUTLRoaringFree(d);
+
+            /* Corrupt containers: unsorted array, bitmap and runs not matching their cardinality */
+            SUTLRoaringFree(a);
+            a = SUTLRoaringNew();
+            SUTLRoaringAdd(a, 1);
+            SUTLRoaringAdd(a, 2);
+            SUTLRoaringAdd(a, 3);
+            SUTLStringResize(bytes, 0);
+            SUTLRoaringSerialize(a, bytes);
+            bytes[21] = 0;
+
+            ExpectationFulfilled = 0;
+            SHRN_TEST(SUTLRoaringDeserialize(bytes, SUTLStringSize(bytes), d) == 0 && ExpectationFulfilled == 1)
+            SUTLRoaringFree(d);
+
+            for (x = 0; x < 5000; x++)
+                SUTLRoaringAdd(a, x * 2);
+            SUTLStringResize(bytes, 0);
+            SUTLRoaringSerialize(a, bytes);
+            bytes[19] ^= 2;
+
+            ExpectationFulfilled = 0;
+            SHRN_TEST(a.Containers[0].Type == SUTL_ROARING_BITMAP && SUTLRoaringDeserialize(bytes, SUTLStringSize(bytes), d) == 0 && ExpectationFulfilled == 1)
+            SUTLRoaringFree(d);
+
+            for (x = 0; x < 10000; x++)
+                SUTLRoaringAdd(a, x);
+            SUTLRoaringRunOptimize(a);
+            SUTLStringResize(bytes, 0);
+            SUTLRoaringSerialize(a, bytes);
+            bytes[21] ^= 1;
+
+            ExpectationFulfilled = 0;
+            SHRN_TEST(a.Containers[0].Type == SUTL_ROARING_RUN && SUTLRoaringDeserialize(bytes, SUTLStringSize(bytes), d) == 0 && ExpectationFulfilled == 1)
+            SUTLRoaringFree(d);
+
+            /* Non-canonical containers: an array above the array limit and a bitmap within it */
+            SUTLStringResize(bytes, 0);
+            SUTLStringAppendP(bytes, "SRB1");
+            SUTL_InternalStringAppendLE(&bytes, 1, 4);
+            SUTL_InternalStringAppendLE(&bytes, 0, 2);
+            SUTL_InternalStringAppendLE(&bytes, SUTL_ROARING_ARRAY, 1);
+            SUTL_InternalStringAppendLE(&bytes, SUTL_ROARING_ARRAY_MAX + 1, 4);
+            SUTL_InternalStringAppendLE(&bytes, SUTL_ROARING_ARRAY_MAX + 1, 4);
+
+            for (x = 0; x <= SUTL_ROARING_ARRAY_MAX; x++)
+                SUTL_InternalStringAppendLE(&bytes, x, 2);
+
+            ExpectationFulfilled = 0;
+            SHRN_TEST(SUTLRoaringDeserialize(bytes, SUTLStringSize(bytes), d) == 0 && ExpectationFulfilled == 1)
+            SUTLRoaringFree(d);
+
+            SUTLStringResize(bytes, 0);
+            SUTLStringAppendP(bytes, "SRB1");
+            SUTL_InternalStringAppendLE(&bytes, 1, 4);
+            SUTL_InternalStringAppendLE(&bytes, 0, 2);
+            SUTL_InternalStringAppendLE(&bytes, SUTL_ROARING_BITMAP, 1);
+            SUTL_InternalStringAppendLE(&bytes, 1, 4);
+            SUTL_InternalStringAppendLE(&bytes, 1024, 4);
+
+            for (x = 0; x < 1024; x++)
+                SUTL_InternalStringAppendLE(&bytes, x == 0, 8);
+
+            ExpectationFulfilled = 0;
+            SHRN_TEST(SUTLRoaringDeserialize(bytes, SUTLStringSize(bytes), d) == 0 && ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLRoaringFree(d);
+            SUTLStringFree(bytes);
+            SUTLRoaringFree(n);
+            SUTLRoaringFree(u);
+            SUTLRoaringFree(b);
+            SUTLRoaringFree(a);
+
+        )
+
+        SHRN_TEST_GROUP(FLATMAP,
+
+            int layout;
+            int k;
+            int match;
+            int sum;
+
+            for (layout = SUTL_FLATMAP_LAYOUT_AUTO; layout <= SUTL_FLATMAP_LAYOUT_SOA; layout++)
+            {
+                SUTLFlatmap fm = SUTLFlatmapNew(int, double, SUTLHash_int, SUTLCmp_int, (SUTLFlatmapLayout)layout);
+
+                SHRN_TEST(fm.Layout == (layout == SUTL_FLATMAP_LAYOUT_SOA ? SUTL_FLATMAP_LAYOUT_SOA : SUTL_FLATMAP_LAYOUT_AOS))
+
+                /* Normal use case */
+                SUTLFlatmapInsert(int, double, fm, 25, 625.5);
+                SHRN_TEST(fm.Size == 1);
+                SHRN_TEST(*SUTLFlatmapGet(int, double, fm, 25) == 625.5);
+
+                /* When element already exists */
+                SUTLFlatmapInsert(int, double, fm, 25, 1.0);
+                SHRN_TEST(fm.Size == 1 && *SUTLFlatmapGet(int, double, fm, 25) == 625.5);
+
+                /* When element exists */
+                SUTLFlatmapErase(int, fm, 25);
+                SHRN_TEST(fm.Size == 0 && SUTLFlatmapGet(int, double, fm, 25) == NULL);
+
+                /* When element doesn't exist */
+                SUTLFlatmapErase(int, fm, 25);
+                SHRN_TEST(fm.Size == 0);
+
+                /* Growth, erasure in the middle of probe sequences and iteration */
+                for (k = 0; k < 1000; k++)
+                    SUTLFlatmapInsert(int, double, fm, k * 64, k);
+
+                for (k = 0; k < 1000; k += 2)
+                    SUTLFlatmapErase(int, fm, k * 64);
+
+                match = fm.Size == 500;
+                for (k = 0; k < 1000; k++)
+                    match = match && (k % 2 ? *SUTLFlatmapGet(int, double, fm, k * 64) == k : SUTLFlatmapGet(int, double, fm, k * 64) == NULL);
+                SHRN_TEST(match)
+
+                sum = 0;
+                SUTLFlatmapEach(int, double, fm, entry,
+                    sum += *entry_k / 64 == (int)*entry_v;
+                )
+                SHRN_TEST(sum == 500)
+
+                SUTLFlatmapFree(fm);
+            }
+
+        )
+
+        SHRN_TEST_GROUP(HETEROGENEOUS_LOOKUP,
+
+            const char * input = "GET /index.html HTTP/1.1";
+            SUTLString get = SUTLStringNew();
+            SUTLString post = SUTLStringNew();
+            SUTLStringView view;
+            SUTLHashmap methods = SUTLHashmapNew(SUTLString, int, SUTL_HASHFN(string), SUTL_CMPFN(string));
+            SUTLHashset names = SUTLHashsetNew(SUTLString, SUTL_HASHFN(string), SUTL_CMPFN(string));
+            SUTLFlatmap flat = SUTLFlatmapNew(SUTLString, int, SUTL_HASHFN(string), SUTL_CMPFN(string), SUTL_FLATMAP_LAYOUT_AUTO);
+
+            SUTLStringAppendP(get, "GET");
+            SUTLStringAppendP(post, "POST");
+
+            SUTLHashmapInsert(SUTLString, int, methods, get, 1);
+            SUTLHashmapInsert(SUTLString, int, methods, post, 2);
+            SUTLHashsetInsert(SUTLString, names, post);
+            SUTLFlatmapInsert(SUTLString, int, flat, get, 1);
+
+            /* Strings and views with the same characters hash the same */
+            view = SUTLStringViewNew(input, 3);
+            SHRN_TEST(SUTL_HASHFN(string)(&get) == SUTL_HASHFN(strview)(&view))
+            SHRN_TEST(SUTL_PROBECMPFN(string)(&view, &get) && !SUTL_PROBECMPFN(string)(&view, &post))
+
+            /* Lookups straight from the input buffer */
+            SHRN_TEST(*SUTLHashmapGetN(int, methods, input, 3) == 1)
+            SHRN_TEST(SUTLHashmapGetN(int, methods, input, 4) == NULL)
+            SHRN_TEST(*SUTLHashmapGetWith(int, methods, &view, SUTL_HASHFN(strview), SUTL_PROBECMPFN(string)) == 1)
+            SHRN_TEST(*SUTLHashsetGetN(names, "POST", 4) == post && SUTLHashsetGetN(names, input, 3) == NULL)
+            SHRN_TEST(*SUTLFlatmapGetN(int, flat, input, 3) == 1 && SUTLFlatmapGetN(int, flat, "POST", 4) == NULL)
+
+            /* Regular lookups still work with string keys */
+            SHRN_TEST(*SUTLHashmapGet(SUTLString, int, methods, post) == 2)
+
+            SUTLFlatmapFree(flat);
+            SUTLHashsetFree(names);
+            SUTLHashmapFree(methods);
+            SUTLStringFree(post);
+            SUTLStringFree(get);
+
+        )
+
+        SHRN_TEST_GROUP(PERFECT_HASH,
+
+            uint64_t * hashes = SUTLVectorNew(uint64_t);
+            char * seen = SUTLVectorNew(char);
+            SUTLPerfectHash ph;
+            SUTLPerfectHash loaded;
+            SUTLString bytes = SUTLStringNew();
+            SUTLString * keys = SUTLVectorNew(SUTLString);
+            SUTLString * none = SUTLVectorNew(SUTLString);
+            int * values = SUTLVectorNew(int);
+            const char * words = "if\0else\0while\0for\0do\0switch\0case\0return\0break\0goto\0";
+            SUTLPerfectHashmap phm;
+            SUTLPerfectHash emitted;
+            uint32_t * ids;
+            uint32_t * sizes;
+            size_t slot;
+            int reproduced = 1;
+            int distinct = 1;
+            int index;
+            uint64_t hash;
+            size_t k;
+
+            for (k = 0; k < 1000; k++)
+            {
+                hash = SUTL_InternalMix64(k) & 0xFFFFFFFFFFFFULL;
+                SUTLVectorPush(hashes, hash);
+            }
+
+            /* Every key gets a distinct index below the key count */
+            SHRN_TEST(SUTLPerfectHashBuild(ph, hashes, 1000) == 1)
+            SUTLVectorResize(seen, 1000);
+            SHRN_MEMSET(seen, 0, 1000);
+
+            for (k = 0; k < 1000; k++)
+            {
+                hash = SUTLPerfectHashIndex(ph, hashes[k]);
+
+                if (hash >= 1000 || seen[hash])
+                    distinct = 0;
+                else
+                    seen[hash] = 1;
+            }
+
+            SHRN_TEST(distinct)
+
+            /* Serialization round trip */
+            SUTLPerfectHashSerialize(ph, bytes);
+            SHRN_TEST(SUTLPerfectHashDeserialize(bytes, SUTLStringSize(bytes), loaded) == 1)
+            SHRN_TEST(loaded.KeyCount == 1000 && SUTLPerfectHashIndex(loaded, hashes[7]) == SUTLPerfectHashIndex(ph, hashes[7]))
+            SUTLPerfectHashFree(loaded);
+
+            ExpectedMsg = "Invalid serialized perfect hash function.";
+            SHRN_TEST(SUTLPerfectHashDeserialize(bytes, SUTLStringSize(bytes) - 1, loaded) == 0 && loaded.KeyCount == 0)
+            SHRN_TEST(ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLPerfectHashFree(loaded);
+
+            /* A remapped slot past the key count is rejected */
+            bytes[SUTLStringSize(bytes) - 1] = (char)0xFF;
+            ExpectedMsg = "Invalid serialized perfect hash function.";
+            SHRN_TEST(SUTLPerfectHashDeserialize(bytes, SUTLStringSize(bytes), loaded) == 0 && loaded.KeyCount == 0)
+            SHRN_TEST(ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLPerfectHashFree(loaded);
+            SUTLPerfectHashFree(ph);
+
+            /* Equal hashes can't be separated */
+            hashes[1] = hashes[0];
+            ExpectedMsg = "Perfect hash keys must have distinct hashes.";
+            SHRN_TEST(SUTLPerfectHashBuild(ph, hashes, 1000) == 0)
+            SHRN_TEST(ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLPerfectHashFree(ph);
+
+            /* A read-only map of string keys */
+            for (k = 0; *words; k++)
+            {
+                SUTLString word = SUTLStringNew();
+
+                SUTLStringAppendP(word, words);
+                SUTLVectorPush(keys, word);
+                index = (int)k;
+                SUTLVectorPush(values, index);
+
+                words += SHRN_STRLEN(words) + 1;
+            }
+
+            phm = SUTLPerfectHashmapNew(SUTLString, int, keys, values, SUTL_HASHFN(string), SUTL_CMPFN(string));
+            SHRN_TEST(phm.Size == 10)
+            SHRN_TEST(*SUTLPerfectHashmapGet(SUTLString, int, phm, keys[6]) == 6)
+            SHRN_TEST(*SUTLPerfectHashmapGetN(int, phm, "goto label;", 4) == 9)
+            SHRN_TEST(SUTLPerfectHashmapGetN(int, phm, "until", 5) == NULL)
+
+            SUTLPerfectHashmapFree(phm);
+
+            /* Generated lookup tables */
+            SUTLStringResize(bytes, 0);
+            SHRN_TEST(SUTLPerfectHashGenerate(keys, "Keyword", bytes) == 1)
+            SUTLStringAppendN(bytes, "", 1);
+            SHRN_TEST(strstr(bytes, "static int KeywordLookup(const char * ptr, size_t size)") != NULL)
+            SHRN_TEST(strstr(bytes, "static const char * const KeywordKeys[10] =") != NULL && strstr(bytes, "\"switch\"") != NULL)
+
+            /* The emitted seed and tables send every key to the slot of its own id and size */
+            emitted.Seed = EmittedNumber(bytes, "Mix(hash ^ (uint64_t)0x");
+            emitted.Pilots = EmittedArray(bytes, "KeywordPilots[");
+            emitted.Remap = EmittedArray(bytes, "KeywordRemap[");
+            ids = EmittedArray(bytes, "KeywordIds[");
+            sizes = EmittedArray(bytes, "KeywordSizes[");
+            emitted.KeyCount = SUTLVectorSize(ids);
+            emitted.BucketCount = SUTLVectorSize(emitted.Pilots);
+            emitted.TableSize = emitted.KeyCount + SUTLVectorSize(emitted.Remap);
+
+            SHRN_TEST(emitted.KeyCount == 10 && SUTLVectorSize(sizes) == 10 && emitted.BucketCount && emitted.TableSize > 10)
+            SHRN_TEST(EmittedNumber(bytes, ") % ") == emitted.BucketCount && EmittedNumber(bytes, "Pilots[slot])) % ") == emitted.TableSize)
+            SHRN_TEST(EmittedNumber(bytes, "if (slot >= ") == emitted.KeyCount)
+
+            for (k = 0; k < SUTLVectorSize(keys); k++)
+            {
+                slot = SUTLPerfectHashIndex(emitted, SUTL_InternalHashBytes(keys[k], SUTLStringSize(keys[k])));
+                reproduced &= slot < 10 && ids[slot] == k && sizes[slot] == SUTLStringSize(keys[k]);
+            }
+
+            SHRN_TEST(reproduced)
+
+            SUTLPerfectHashFree(emitted);
+            SUTLVectorFree(sizes);
+            SUTLVectorFree(ids);
+
+            ExpectedMsg = "Perfect hash tables need at least one key.";
+            SHRN_TEST(SUTLPerfectHashGenerate(none, "Empty", bytes) == 0)
+            SHRN_TEST(ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            for (k = 0; k < SUTLVectorSize(keys); k++)
+                SUTLStringFree(keys[k]);
+
+            SUTLVectorFree(values);
+            SUTLVectorFree(none);
+            SUTLVectorFree(keys);
+            SUTLStringFree(bytes);
+            SUTLVectorFree(seen);
+            SUTLVectorFree(hashes);
+
+        )
+
+        SHRN_TEST_GROUP(LINE_READER,
+
+            const char * text = "first\n\na line which is longer than the buffer\nlast";
+            FILE * file = tmpfile();
+            SUTLLineReader lr;
+            SUTLStringView line;
+            size_t total = 0;
+
+            fputs(text, file);
+            fflush(file);
+            rewind(file);
+
+            /* A tiny buffer makes lines span refills and forces it to grow */
+            lr = SUTLLineReaderNew(fileno(file), 8);
+
+            SHRN_TEST(SUTLLineReaderNext(lr, line) == 1 && line.Size == 5 && strncmp(line.Data, "first", 5) == 0)
+            SHRN_TEST(SUTLLineReaderNext(lr, line) == 1 && line.Size == 0)
+            SHRN_TEST(SUTLLineReaderNext(lr, line) == 1 && line.Size == 38 && strncmp(line.Data, "a line which is longer than the buffer", 38) == 0)
+
+            /* The last line doesn't need a newline */
+            SHRN_TEST(SUTLLineReaderNext(lr, line) == 1 && line.Size == 4 && strncmp(line.Data, "last", 4) == 0)
+            SHRN_TEST(SUTLLineReaderNext(lr, line) == 0 && lr.Eof && !lr.Error)
+            SHRN_TEST(lr.LineCount == 4 && lr.BytesRead == strlen(text))
+            SHRN_TEST(SUTLLineReaderThroughput(lr) >= 0.0)
+
+            SUTLLineReaderFree(lr);
+
+            /* Iterating with the default buffer size */
+            rewind(file);
+            lr = SUTLLineReaderNew(fileno(file), 0);
+
+            SUTLLineReaderEach(lr, view,
+                total += view.Size;
+            )
+
+            SHRN_TEST(total == strlen(text) - 3 && lr.LineCount == 4)
+
+            SUTLLineReaderFree(lr);
+
+            /* A failed read doesn't pass the partial line off as the last one */
+            lr = SUTLLineReaderNew(-3, 0);
+            SHRN_TEST(SUTLLineReaderNext(lr, line) == 1 && line.Size == 4 && strncmp(line.Data, "full", 4) == 0)
+            ExpectedMsg = "Failed to read from file descriptor.";
+            SHRN_TEST(SUTLLineReaderNext(lr, line) == 0 && lr.Error && lr.LineCount == 1)
+            SHRN_TEST(ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLLineReaderFree(lr);
+            fclose(file);
+
+        )
+
+        SHRN_TEST_GROUP(STRING_VIEW,
+
+            SUTLStringView text = SUTLStringViewP("key=value; key2=value2;");
+            SUTLStringView fields = text;
+            SUTLStringView token;
+            size_t count = 0;
+
+            /* Searching */
+            SHRN_TEST(SUTLStringViewFindC(text, ';') == 9 && SUTLStringViewFindC(text, '#') == SUTL_STRING_NPOS)
+            SHRN_TEST(SUTLStringViewFind(text, SUTLStringViewP("key2")) == 11)
+            SHRN_TEST(SUTLStringViewFind(text, SUTLStringViewP("value3")) == SUTL_STRING_NPOS)
+            SHRN_TEST(SUTLStringViewFind(text, SUTLStringViewP("")) == 0)
+
+            /* Slicing is clamped to the view */
+            token = SUTLStringViewSlice(text, 4, 5);
+            SHRN_TEST(token.Size == 5 && strncmp(token.Data, "value", 5) == 0)
+            SHRN_TEST(SUTLStringViewSlice(text, 20, 10).Size == 3 && SUTLStringViewSlice(text, 30, 1).Size == 0)
+
+            /* Splitting keeps empty tokens */
+            SHRN_TEST(SUTLStringViewSplit(fields, ';', token) == 1 && token.Size == 9)
+            SHRN_TEST(SUTLStringViewSplit(fields, ';', token) == 1 && token.Size == 12 && token.Data[0] == ' ')
+            SHRN_TEST(SUTLStringViewSplit(fields, ';', token) == 1 && token.Size == 0)
+            SHRN_TEST(SUTLStringViewSplit(fields, ';', token) == 0)
+
+            fields = SUTLStringViewP("a,b,,c");
+            SUTLStringViewEachSplit(fields, ',', field,
+                count++;
+            )
+
+            SHRN_TEST(count == 4)
+
+        )
+
+        SHRN_TEST_GROUP(MAPPED_FILE,
+
+            char path[] = "/tmp/SUTLMappedFileXXXXXX";
+            const char * text = "id;name\n1;one\n2;two\n";
+            int fd = mkstemp(path);
+            SUTLMappedFile mf;
+            SUTLStringView content;
+            SUTLStringView line;
+            size_t lines = 0;
+
+            SHRN_TEST(fd >= 0 && write(fd, text, strlen(text)) == (long)strlen(text))
+            close(fd);
+
+            /* The content can be searched and split in place */
+            mf = SUTLMappedFileOpen(path, SUTL_MAPPED_FILE_SEQUENTIAL | SUTL_MAPPED_FILE_WILL_NEED | SUTL_MAPPED_FILE_HUGE_PAGES);
+            content = SUTLMappedFileView(mf);
+            SHRN_TEST(mf.Data != NULL && mf.Size == strlen(text) && memcmp(mf.Data, text, mf.Size) == 0)
+            SHRN_TEST(SUTLStringViewFind(content, SUTLStringViewP("2;two")) == 14)
+
+            while (SUTLStringViewSplit(content, '\n', line))
+                lines += line.Size != 0;
+
+            SHRN_TEST(lines == 3)
+
+            SUTLMappedFileAdvise(mf, SUTL_MAPPED_FILE_RANDOM);
+            SUTLMappedFileClose(mf);
+            SHRN_TEST(mf.Data == NULL && mf.Size == 0)
+
+            /* Empty files give an empty view */
+            fd = open(path, O_WRONLY | O_TRUNC);
+            close(fd);
+            mf = SUTLMappedFileOpen(path, 0);
+            SHRN_TEST(mf.Data != NULL && mf.Size == 0)
+            SUTLMappedFileClose(mf);
+
+            unlink(path);
+
+            /* Missing files report an error */
+            ExpectedMsg = "Failed to open file.";
+            mf = SUTLMappedFileOpen(path, 0);
+            SHRN_TEST(mf.Data == NULL)
+            SHRN_TEST(ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+        )
+
+        SHRN_TEST_GROUP(WRITER,
+
+            FILE * file = tmpfile();
+            int fd = fileno(file);
+            SUTLString big = SUTLStringNew();
+            SUTLString small = SUTLStringNew();
+            SUTLString expected = SUTLStringNew();
+            char * content = SUTLVectorNew(char);
+            SUTLWriter w = SUTLWriterNew(fd, 0);
+            size_t k;
+
+            SUTLStringResize(big, SUTL_WRITER_REF_MIN);
+            SHRN_MEMSET(big, 'x', SUTL_WRITER_REF_MIN);
+            SUTLStringAppendP(small, "row;");
+
+            /* Small appends are copied and big strings referenced, all written with one call */
+            for (k = 0; k < 100; k++)
+            {
+                SUTLWriterAppendS(w, small);
+                SUTLStringAppendP(expected, "row;");
+            }
+
+            SUTLWriterAppendS(w, big);
+            SUTLWriterAppendP(w, "end\n");
+            SUTLStringAppendN(expected, big, SUTLStringSize(big));
+            SUTLStringAppendP(expected, "end\n");
+
+            SHRN_TEST(w.WriteCount == 0 && SUTLWriterFlush(w) == 1)
+            SHRN_TEST(w.WriteCount == 1 && w.BytesWritten == SUTLStringSize(expected))
+
+            SUTLWriterFree(w);
+
+            /* A tiny buffer flushes when full and writes bigger data directly */
+            w = SUTLWriterNew(fd, 8);
+            SUTLWriterAppendP(w, "abcdef");
+            SUTLWriterAppendP(w, "ghij");
+            SUTLWriterAppendRef(w, "klm", 3);
+            SUTLWriterAppendP(w, "nopqrstuvwxyz");
+            SHRN_TEST(SUTLWriterFlush(w) == 1 && w.BytesWritten == 26 && !w.Error)
+            SUTLStringAppendP(expected, "abcdefghijklmnopqrstuvwxyz");
+
+            SUTLWriterFree(w);
+
+            /* A sink which makes no progress fails instead of being retried forever */
+            w = SUTLWriterNew(-2, 0);
+            SUTLWriterAppendP(w, "stuck");
+            ExpectedMsg = "Failed to write to file descriptor.";
+            SHRN_TEST(SUTLWriterFlush(w) == 0 && w.Error && w.WriteCount == 1 && w.BytesWritten == 0)
+            SHRN_TEST(ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLWriterFree(w);
+
+            /* Everything arrived in order */
+            SUTLVectorResize(content, SUTLStringSize(expected) + 1);
+            lseek(fd, 0, SEEK_SET);
+            SHRN_TEST(read(fd, content, SUTLVectorSize(content)) == (long)SUTLStringSize(expected))
+            SHRN_TEST(memcmp(content, expected, SUTLStringSize(expected)) == 0)
+
+            SUTLVectorFree(content);
+            SUTLStringFree(expected);
+            SUTLStringFree(small);
+            SUTLStringFree(big);
+            fclose(file);
+
+        )
+
+        SHRN_TEST_GROUP(ASYNC_IO,
+
+            FILE * files[3];
+            char * buffers[3];
+            char * part = SUTLVectorNew(char);
+            SUTLAsyncIO aio;
+            size_t ids[3];
+            size_t backend;
+            size_t k;
+            int matches;
+
+            for (k = 0; k < 3; k++)
+            {
+                size_t n;
+
+                files[k] = tmpfile();
+
+                for (n = 0; n < 20000 * k + 10; n++)
+                    fputc('a' + (int)((n + k) % 26), files[k]);
+
+                fflush(files[k]);
+            }
+
+            /* Both backends, with fewer slots than reads */
+            for (backend = SUTL_ASYNC_IO_URING; backend <= SUTL_ASYNC_IO_POOL; backend++)
+            {
+                aio = SUTLAsyncIONew(2, (SUTLAsyncIOBackend)backend);
+                matches = 1;
+
+                for (k = 0; k < 3; k++)
+                {
+                    buffers[k] = SUTLVectorNew(char);
+                    ids[k] = SUTLAsyncIOReadFile(aio, fileno(files[k]), buffers[k]);
+                }
+
+                SHRN_TEST(aio.Depth == 2 && aio.Pending <= 2)
+                SUTLAsyncIOWaitAll(aio);
+                SHRN_TEST(aio.Pending == 0)
+
+                for (k = 0; k < 3; k++)
+                {
+                    size_t n;
+
+                    matches &= SUTLAsyncIORequestOf(aio, ids[k])->Done;
+                    matches &= SUTLAsyncIORequestOf(aio, ids[k])->Result == (long)(20000 * k + 10);
+                    matches &= SUTLVectorSize(buffers[k]) == 20000 * k + 10;
+
+                    for (n = 0; n < SUTLVectorSize(buffers[k]); n++)
+                        matches &= buffers[k][n] == 'a' + (int)((n + k) % 26);
+
+                    SUTLVectorFree(buffers[k]);
+                }
+
+                SHRN_TEST(matches)
+
+                /* Reads at an offset append, and stop at the end of the file */
+                SUTLVectorResize(part, 0);
+                SUTLVectorPush(part, tmp);
+                ids[0] = SUTLAsyncIORead(aio, fileno(files[1]), part, 19995, 100);
+                SHRN_TEST(SUTLAsyncIOWait(aio, 1) == 1)
+                SHRN_TEST(SUTLAsyncIORequestOf(aio, ids[0])->Result == 15 && SUTLVectorSize(part) == 16 && part[1] == 'a' + (19995 + 1) % 26)
+
+                /* Errors are reported per read */
+                ids[0] = SUTLAsyncIORead(aio, -1, part, 0, 10);
+                SUTLAsyncIOWaitAll(aio);
+                SHRN_TEST(SUTLAsyncIORequestOf(aio, ids[0])->Result < 0 && SUTLVectorSize(part) == 16)
+
+                /* Whole file reads report a failure to get the size */
+                ids[0] = SUTLAsyncIOReadFile(aio, -1, part);
+                SHRN_TEST(SUTLAsyncIORequestOf(aio, ids[0])->Done && SUTLAsyncIORequestOf(aio, ids[0])->Result == -EBADF && aio.Pending == 0)
+
+                SUTLAsyncIOFree(aio);
+            }
+
+            /* Without a backend, reads complete right away and failures carry errno */
+            aio.Backend = SUTL_ASYNC_IO_POOL;
+            aio.Depth = 0;
+            aio.Pending = 0;
+            aio.Requests = SUTLVectorNew(SUTLAsyncIORequest);
+            aio.Queue = SUTLVectorNew(size_t);
+            aio.State = NULL;
+
+            SUTLVectorResize(part, 0);
+            ids[0] = SUTLAsyncIORead(aio, fileno(files[1]), part, 19995, 100);
+            SHRN_TEST(aio.Pending == 0 && SUTLAsyncIORequestOf(aio, ids[0])->Done)
+            SHRN_TEST(SUTLAsyncIORequestOf(aio, ids[0])->Result == 15 && SUTLVectorSize(part) == 15 && part[0] == 'a' + (19995 + 1) % 26)
+
+            ids[0] = SUTLAsyncIORead(aio, -1, part, 0, 10);
+            SHRN_TEST(SUTLAsyncIORequestOf(aio, ids[0])->Result == -EBADF && SUTLVectorSize(part) == 15)
+
+            SUTLAsyncIOFree(aio);
+
+            for (k = 0; k < 3; k++)
+                fclose(files[k]);
+
+            SUTLVectorFree(part);
+
+        )
+
+        SHRN_TEST_GROUP(CSV,
+
+            const char * text = "id,name,score\r\n1,\"Doe, Jane\",3.5\r\n\r\n2,\"multi\nline \"\"quoted\"\"\",-2e3\r\nx,short\n3,extra,7,8";
+            SUTLCsvType * types = SUTLVectorNew(SUTLCsvType);
+            SUTLCsvType type = SUTL_CSV_INT;
+            SUTLString big = SUTLStringNew();
+            SUTLString unquoted = SUTLStringNew();
+            SUTLCsvTable t;
+            SUTLCsvTable single;
+            char row[64];
+            int64_t value;
+            double real;
+            size_t k;
+            int same = 1;
+
+            /* Numbers */
+            SHRN_TEST(SUTLStringViewToInt(SUTLStringViewP("-9223372036854775808"), &value) && value == INT64_MIN)
+            SHRN_TEST(!SUTLStringViewToInt(SUTLStringViewP("9223372036854775808"), &value))
+            SHRN_TEST(!SUTLStringViewToInt(SUTLStringViewP("12a"), &value) && !SUTLStringViewToInt(SUTLStringViewP("-"), &value))
+            SHRN_TEST(SUTLStringViewToDouble(SUTLStringViewP("0.1"), &real) && real == 0.1)
+            SHRN_TEST(SUTLStringViewToDouble(SUTLStringViewP("-1.25e-3"), &real) && real == -1.25e-3)
+            SHRN_TEST(SUTLStringViewToDouble(SUTLStringViewP("12345678901234567890.5e200"), &real) && real == 12345678901234567890.5e200)
+            SHRN_TEST(!SUTLStringViewToDouble(SUTLStringViewP("1.5x"), &real) && !SUTLStringViewToDouble(SUTLStringViewP(""), &real))
+
+            /* Typed columns with a header, quotes, CRLF and bad rows */
+            SUTLVectorPush(types, type);
+            type = SUTL_CSV_STRING;
+            SUTLVectorPush(types, type);
+            type = SUTL_CSV_DOUBLE;
+            SUTLVectorPush(types, type);
+
+            t = SUTLCsvParse(SUTLStringViewP(text), ',', 1, types, 1);
+            SHRN_TEST(SUTLCsvColumnCount(t) == 3 && t.RowCount == 4 && t.BadRowCount == 2)
+            SHRN_TEST(t.Columns[1].Name.Size == 4 && strncmp(t.Columns[1].Name.Data, "name", 4) == 0)
+            SHRN_TEST(SUTLCsvInts(t, 0)[0] == 1 && SUTLCsvInts(t, 0)[1] == 2 && SUTLCsvInts(t, 0)[3] == 3)
+            SHRN_TEST(t.Columns[0].InvalidCount == 1 && t.Columns[2].InvalidCount == 1)
+            SHRN_TEST(SUTLCsvDoubles(t, 2)[0] == 3.5 && SUTLCsvDoubles(t, 2)[1] == -2000.0 && SUTLCsvDoubles(t, 2)[3] == 7.0)
+            SHRN_TEST(SUTLCsvStrings(t, 1)[0].Size == 9 && strncmp(SUTLCsvStrings(t, 1)[0].Data, "Doe, Jane", 9) == 0)
+
+            SUTLCsvUnquote(SUTLCsvStrings(t, 1)[1], unquoted);
+            SHRN_TEST(SUTLStringSize(unquoted) == 19 && strncmp(unquoted, "multi\nline \"quoted\"", 19) == 0)
+            SUTLCsvTableFree(t);
+
+            /* Untyped TSV without a header */
+            t = SUTLCsvParse(SUTLStringViewP("a\tb\n\tc"), '\t', 0, NULL, 1);
+            SHRN_TEST(SUTLCsvColumnCount(t) == 2 && t.RowCount == 2 && t.BadRowCount == 0)
+            SHRN_TEST(SUTLCsvStrings(t, 0)[1].Size == 0 && SUTLCsvStrings(t, 1)[1].Data[0] == 'c')
+            SUTLCsvTableFree(t);
+
+            /* Parsing with threads gives the same result */
+            SUTLStringReserve(big, 6 * SUTL_CSV_MIN_CHUNK);
+
+            for (k = 0; SUTLStringSize(big) < 5 * SUTL_CSV_MIN_CHUNK; k++)
+            {
+                sprintf(row, "%lu,\"text\n%lu, \"\"x\"\"\",%lu.25\n", (unsigned long)k, (unsigned long)k, (unsigned long)k);
+                SUTLStringAppendP(big, row);
+            }
+
+            type = SUTL_CSV_INT;
+            SUTLVectorResize(types, 0);
+            SUTLVectorPush(types, type);
+
+            t = SUTLCsvParse(SUTLStringViewOf(big), ',', 0, types, 4);
+            single = SUTLCsvParse(SUTLStringViewOf(big), ',', 0, types, 1);
+            SHRN_TEST(t.RowCount == k && single.RowCount == k && t.BadRowCount == k)
+
+            for (k = 0; k < t.RowCount; k++)
+                same = same && SUTLCsvInts(t, 0)[k] == (int64_t)k && SUTLCsvInts(single, 0)[k] == (int64_t)k;
+
+            SHRN_TEST(same)
+
+            SUTLCsvTableFree(t);
+            SUTLCsvTableFree(single);
+            SUTLStringFree(unquoted);
+            SUTLStringFree(big);
+            SUTLVectorFree(types);
+
+        )
+
+        SHRN_TEST_GROUP(JSON,
+
+            const char * text = "{\"name\": \"caf\\u00e9 \\\"x\\\" \\ud83d\\ude00\", \"ids\": [1, -2, 30000000000], \"ratio\": -0.5e1,"
+                " \"nested\": {\"deep\": [[], {}, [true, false, null]]}, \"big\": 12345678901234567890, \"tags\": [\"a\", \"b\\\\\"]}";
+            SUTLJsonDocument doc = SUTLJsonParse(SUTLStringViewP(text));
+            SUTLString unescaped = SUTLStringNew();
+            SUTLString * tags;
+            int64_t * ids;
+            double * ratios;
+            SUTLHashmap members;
+            size_t deep;
+            size_t count = 0;
+
+            /* Navigation */
+            SHRN_TEST(doc.Error == NULL && doc.Nodes[0].Type == SUTL_JSON_OBJECT && doc.Nodes[0].Size == 6)
+            SHRN_TEST(doc.Nodes[0].End == SUTLVectorSize(doc.Nodes))
+            SHRN_TEST(doc.Nodes[SUTLJsonGet(doc, 0, "ratio")].Type == SUTL_JSON_DOUBLE && doc.Nodes[SUTLJsonGet(doc, 0, "ratio")].Value.Double == -5.0)
+            SHRN_TEST(doc.Nodes[SUTLJsonGet(doc, 0, "big")].Type == SUTL_JSON_DOUBLE && SUTLJsonGet(doc, 0, "missing") == SUTL_JSON_NONE)
+
+            deep = SUTLJsonGet(doc, SUTLJsonGet(doc, 0, "nested"), "deep");
+            SHRN_TEST(doc.Nodes[deep].Type == SUTL_JSON_ARRAY && doc.Nodes[deep].Size == 3)
+            SHRN_TEST(doc.Nodes[SUTLJsonAt(doc, deep, 1)].Type == SUTL_JSON_OBJECT && SUTLJsonAt(doc, deep, 3) == SUTL_JSON_NONE)
+            SHRN_TEST(doc.Nodes[SUTLJsonAt(doc, SUTLJsonAt(doc, deep, 2), 2)].Type == SUTL_JSON_NULL)
+
+            SUTLJsonEach(doc, 0, key,
+                count += doc.Nodes[key].Type == SUTL_JSON_STRING;
+            )
+
+            SHRN_TEST(count == 6)
+
+            /* Strings are views and are unescaped on demand */
+            SHRN_TEST(doc.Nodes[1].Escaped == 0 && doc.Nodes[2].Escaped == 1)
+            SHRN_TEST(SUTLJsonUnescape(doc.Nodes[2].Value.String, unescaped) == 1)
+            SHRN_TEST(SUTLStringSize(unescaped) == 14 && memcmp(unescaped, "caf\xc3\xa9 \"x\" \xf0\x9f\x98\x80", 14) == 0)
+
+            /* Conversion into containers */
+            ids = SUTLJsonToInts(doc, SUTLJsonGet(doc, 0, "ids"));
+            SHRN_TEST(SUTLVectorSize(ids) == 3 && ids[1] == -2 && ids[2] == 30000000000LL)
+            ratios = SUTLJsonToDoubles(doc, SUTLJsonGet(doc, 0, "ids"));
+            SHRN_TEST(SUTLVectorSize(ratios) == 3 && ratios[2] == 3e10)
+            tags = SUTLJsonToStrings(doc, SUTLJsonGet(doc, 0, "tags"));
+            SHRN_TEST(SUTLVectorSize(tags) == 2 && SUTLStringSize(tags[1]) == 2 && tags[1][1] == '\\')
+
+            members = SUTLJsonToHashmap(doc, 0);
+            SHRN_TEST(*SUTLHashmapGet(SUTLStringView, size_t, members, SUTLStringViewP("nested")) == SUTLJsonGet(doc, 0, "nested"))
+
+            ExpectedMsg = "JSON value is not an array of integers.";
+            SHRN_TEST(SUTLJsonToInts(doc, SUTLJsonGet(doc, 0, "tags")) == NULL)
+            SHRN_TEST(ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLHashmapFree(members);
+            SUTLStringFree(tags[0]);
+            SUTLStringFree(tags[1]);
+            SUTLVectorFree(tags);
+            SUTLVectorFree(ratios);
+            SUTLVectorFree(ids);
+            SUTLStringFree(unescaped);
+            SUTLJsonDocumentFree(doc);
+
+            /* Scalar documents and whitespace */
+            doc = SUTLJsonParse(SUTLStringViewP(" \n42 "));
+            SHRN_TEST(doc.Error == NULL && SUTLVectorSize(doc.Nodes) == 1 && doc.Nodes[0].Value.Int == 42)
+
+            /* Reparsing reuses the document */
+            SHRN_TEST(SUTLJsonReparse(doc, SUTLStringViewP("[\"x\", 1.5]")) == 1 && SUTLVectorSize(doc.Nodes) == 3)
+            SHRN_TEST(doc.Nodes[0].Size == 2 && doc.Nodes[2].Value.Double == 1.5)
+            SUTLJsonDocumentFree(doc);
+
+            /* Invalid documents */
+            ExpectedMsg = "Expected ',' or ']' in JSON array.";
+            doc = SUTLJsonParse(SUTLStringViewP("[1 2]"));
+            SHRN_TEST(ExpectationFulfilled == 1 && doc.ErrorOffset == 3 && SUTLVectorSize(doc.Nodes) == 0)
+            SUTLJsonDocumentFree(doc);
+
+            ExpectedMsg = "Unterminated JSON string.";
+            ExpectationFulfilled = 0;
+            doc = SUTLJsonParse(SUTLStringViewP("[\"abc\\\"]"));
+            SHRN_TEST(ExpectationFulfilled == 1)
+            SUTLJsonDocumentFree(doc);
+
+            ExpectedMsg = "Invalid JSON number.";
+            ExpectationFulfilled = 0;
+            doc = SUTLJsonParse(SUTLStringViewP("{\"a\": 01}"));
+            SHRN_TEST(ExpectationFulfilled == 1)
+            SUTLJsonDocumentFree(doc);
+
+            ExpectedMsg = "Invalid JSON literal.";
+            ExpectationFulfilled = 0;
+            doc = SUTLJsonParse(SUTLStringViewP("[truex]"));
+            SHRN_TEST(ExpectationFulfilled == 1)
+            SUTLJsonDocumentFree(doc);
+
+            ExpectedMsg = "Unexpected data after JSON value.";
+            ExpectationFulfilled = 0;
+            doc = SUTLJsonParse(SUTLStringViewP("{} []"));
+            SHRN_TEST(ExpectationFulfilled == 1)
+            SUTLJsonDocumentFree(doc);
+
+            ExpectedMsg = "Unexpected end of JSON input.";
+            ExpectationFulfilled = 0;
+            doc = SUTLJsonParse(SUTLStringViewP("{\"a\":"));
+            SHRN_TEST(ExpectationFulfilled == 1)
+            SUTLJsonDocumentFree(doc);
+
+            /* Only space, tab, newline and carriage return are whitespace */
+            ExpectedMsg = "Invalid JSON value.";
+            ExpectationFulfilled = 0;
+            doc = SUTLJsonParse(SUTLStringViewP("[1,\x01 2]"));
+            SHRN_TEST(ExpectationFulfilled == 1 && SUTLVectorSize(doc.Nodes) == 0)
+            SUTLJsonDocumentFree(doc);
+
+            doc = SUTLJsonParse(SUTLStringViewP("[1,\t\r\n 2]"));
+            SHRN_TEST(doc.Error == NULL && doc.Nodes[0].Size == 2)
+            SUTLJsonDocumentFree(doc);
+
+            /* Lone surrogates and truncated escapes */
+            unescaped = SUTLStringNew();
+            ExpectedMsg = "Invalid escape sequence in JSON string.";
+            ExpectationFulfilled = 0;
+            SHRN_TEST(SUTLJsonUnescape(SUTLStringViewP("\\uD800xyz"), unescaped) == 0 && ExpectationFulfilled == 1)
+            ExpectationFulfilled = 0;
+            SHRN_TEST(SUTLJsonUnescape(SUTLStringViewP("\\uDC00"), unescaped) == 0 && ExpectationFulfilled == 1)
+            ExpectationFulfilled = 0;
+            SHRN_TEST(SUTLJsonUnescape(SUTLStringViewP("ab\\u12"), unescaped) == 0 && ExpectationFulfilled == 1)
+            ExpectationFulfilled = 0;
+
+            doc = SUTLJsonParse(SUTLStringViewP("[\"\\uD800\"]"));
+            tags = SUTLJsonToStrings(doc, 0);
+            SHRN_TEST(doc.Error == NULL && SUTLVectorSize(tags) == 1 && ExpectationFulfilled == 1)
+            SUTLStringFree(tags[0]);
+            SUTLVectorFree(tags);
+            SUTLJsonDocumentFree(doc);
+            SUTLStringFree(unescaped);
+
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+        )
+
+        SHRN_TEST_GROUP(JSON_WRITER,
+
+            const char * expected = "{\"id\":-42,\"name\":\"a\\\"b\\\\c\\n\\u0001 long enough to scan\",\"ratio\":0.1,"
+                "\"list\":[true,false,null,1e+300,null,[]],\"empty\":{}}\n[1]";
+            SUTLJsonWriter jw = SUTLJsonWriterNew(NULL);
+            SUTLString numbers = SUTLStringNew();
+            SUTLString fields = SUTLStringNew();
+            FILE * file = tmpfile();
+            SUTLWriter w = SUTLWriterNew(fileno(file), 0);
+            SUTLJsonDocument doc;
+            char * content = SUTLVectorNew(char);
+            char space = ' ';
+            int64_t k;
+
+            /* Separators, escaping and numbers */
+            SUTLJsonWriterBeginObject(jw);
+            SUTLJsonWriterKeyP(jw, "id");
+            SUTLJsonWriterInt(jw, -42);
+            SUTLJsonWriterKeyP(jw, "name");
+            SUTLJsonWriterStringP(jw, "a\"b\\c\n\x01 long enough to scan");
+            SUTLJsonWriterKeyP(jw, "ratio");
+            SUTLJsonWriterDouble(jw, 0.1);
+            SUTLJsonWriterKeyP(jw, "list");
+            SUTLJsonWriterBeginArray(jw);
+            SUTLJsonWriterBool(jw, 1);
+            SUTLJsonWriterBool(jw, 0);
+            SUTLJsonWriterNull(jw);
+            SUTLJsonWriterDouble(jw, 1e300);
+            SUTLJsonWriterDouble(jw, 1e300 * 1e300);
+            SUTLJsonWriterBeginArray(jw);
+            SUTLJsonWriterEndArray(jw);
+            SUTLJsonWriterEndArray(jw);
+            SUTLJsonWriterKeyP(jw, "empty");
+            SUTLJsonWriterBeginObject(jw);
+            SUTLJsonWriterEndObject(jw);
+            SHRN_TEST(SUTLJsonWriterEndObject(jw) == 1)
+
+            /* Top level values are separated by newlines */
+            SUTLJsonWriterBeginArray(jw);
+            SUTLJsonWriterInt(jw, 1);
+            SUTLJsonWriterEndArray(jw);
+
+            SHRN_TEST(jw.Error == 0 && SUTLStringSize(jw.Buffer) == strlen(expected) && memcmp(jw.Buffer, expected, strlen(expected)) == 0)
+
+            /* Misuse is reported and stops the writer */
+            ExpectedMsg = "Expected a key before a value in JSON object.";
+            SUTLJsonWriterBeginObject(jw);
+            SHRN_TEST(SUTLJsonWriterInt(jw, 1) == 0 && jw.Error == 1)
+            SHRN_TEST(ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLJsonWriterFree(jw);
+
+            /* Streaming through a small flush size reads back intact */
+            jw = SUTLJsonWriterNew(&w);
+            jw.FlushSize = 64;
+
+            SUTLJsonWriterBeginArray(jw);
+
+            for (k = 0; k < 1000; k++)
+            {
+                SUTLJsonWriterBeginObject(jw);
+                SUTLJsonWriterKeyP(jw, "k");
+                SUTLJsonWriterInt(jw, k * 1000003);
+                SUTLJsonWriterKeyP(jw, "v");
+                SUTLJsonWriterDouble(jw, (double)k / 8);
+                SUTLJsonWriterEndObject(jw);
+            }
+
+            SUTLJsonWriterEndArray(jw);
+            SHRN_TEST(SUTLJsonWriterFlush(jw) == 1 && SUTLStringSize(jw.Buffer) == 0)
+            SHRN_TEST(SUTLWriterFlush(w) == 1 && w.BytesWritten > 20000)
+
+            SUTLVectorResize(content, (size_t)w.BytesWritten);
+            lseek(fileno(file), 0, SEEK_SET);
+            SHRN_TEST(read(fileno(file), content, SUTLVectorSize(content)) == (long)w.BytesWritten)
+
+            doc = SUTLJsonParse(SUTLStringViewOf(content));
+            SHRN_TEST(doc.Error == NULL && doc.Nodes[0].Size == 1000)
+            SHRN_TEST(doc.Nodes[SUTLJsonGet(doc, SUTLJsonAt(doc, 0, 999), "k")].Value.Int == 999 * 1000003)
+            SHRN_TEST(doc.Nodes[SUTLJsonGet(doc, SUTLJsonAt(doc, 0, 999), "v")].Value.Double == 999.0 / 8)
+
+            /* Number formatting is shortest and round trips */
+            SUTLStringAppendDouble(numbers, 0.30000000000000004);
+            SUTLStringAppendC(numbers, space);
+            SUTLStringAppendDouble(numbers, -0.00125);
+            SUTLStringAppendC(numbers, space);
+            SUTLStringAppendDouble(numbers, 5e-324);
+            SUTLStringAppendC(numbers, space);
+            SUTLStringAppendInt(numbers, INT64_MIN);
+            SHRN_TEST(SUTLStringSize(numbers) == 56 && memcmp(numbers, "0.30000000000000004 -0.00125 5e-324 -9223372036854775808", 56) == 0)
+
+            SUTLStringResize(numbers, 0);
+            SUTLStringAppendDouble(numbers, 0.7999999999999999);
+            SUTLStringAppendC(numbers, space);
+            SUTLStringAppendDouble(numbers, 1.2345678901234567e-300);
+            SHRN_TEST(SUTLStringSize(numbers) == 42 && memcmp(numbers, "0.7999999999999999 1.2345678901234568e-300", 42) == 0)
+
+            /* CSV fields are quoted only when needed */
+            SUTLCsvAppendField(fields, SUTLStringViewP("plain field value"), ',');
+            SUTLCsvAppendField(fields, SUTLStringViewP("a,b"), ',');
+            SUTLCsvAppendField(fields, SUTLStringViewP("say \"hi\""), ',');
+            SHRN_TEST(SUTLStringSize(fields) == 34 && memcmp(fields, "plain field value\"a,b\"\"say \"\"hi\"\"\"", 34) == 0)
+
+            SUTLJsonDocumentFree(doc);
+            SUTLVectorFree(content);
+            SUTLWriterFree(w);
+            SUTLJsonWriterFree(jw);
+            SUTLStringFree(fields);
+            SUTLStringFree(numbers);
+            fclose(file);
+        )
+        SHRN_TEST_GROUP(LZ,
+
+            SUTLString text = SUTLStringNew();
+            SUTLString noise = SUTLStringNew();
+            SUTLString packed = SUTLStringNew();
+            SUTLString unpacked = SUTLStringNew();
+            uint32_t * ids = SUTLVectorNew(uint32_t);
+            uint32_t seed = 12345;
+            uint32_t id;
+            size_t size;
+            size_t at;
+            size_t blocks = 0;
+            size_t k;
+
+            SUTLStringReserve(text, 20000 * 40);
+
+            for (k = 0; k < 20000; k++)
+                SUTLStringAppendP(text, k % 7 ? "{\"level\":\"info\",\"msg\":\"request served\"}\n" : "{\"level\":\"warn\",\"msg\":\"slow\"}\n");
+
+            SUTLStringReserve(noise, 100000);
+
+            for (k = 0; k < 100000; k++)
+            {
+                seed = seed * 1103515245 + 12345;
+                SUTLStringAppendC(noise, ((char *)&seed)[3]);
+            }
+
+            /* Raw blocks round trip and shrink repetitive data */
+            size = SUTLLzCompress(text, SUTLStringSize(text), packed);
+            SHRN_TEST(size == SUTLStringSize(packed) && size * 20 < SUTLStringSize(text))
+            SHRN_TEST(SUTLLzDecompress(packed, size, unpacked, SUTLStringSize(text)) == 1)
+            SHRN_TEST(SUTLStringSize(unpacked) == SUTLStringSize(text) && memcmp(unpacked, text, SUTLStringSize(text)) == 0)
+
+            /* Tiny and empty inputs are stored as literals */
+            SUTLStringSize(packed) = 0;
+            SUTLStringSize(unpacked) = 0;
+            size = SUTLLzCompress("abc", 3, packed);
+            SHRN_TEST(size == 4 && SUTLLzDecompress(packed, size, unpacked, 3) == 1 && memcmp(unpacked, "abc", 3) == 0)
+            SHRN_TEST(SUTLLzCompress("", 0, packed) == 1)
+
+            /* A block which doesn't decompress to the expected size is rejected */
+            ExpectedMsg = "Corrupted compressed data.";
+            SHRN_TEST(SUTLLzDecompress(packed, size, unpacked, 4) == 0 && SUTLStringSize(unpacked) == 3)
+            SHRN_TEST(ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            /* Frames of vectors, with several blocks and stored incompressible data */
+            SUTLVectorReserve(ids, 1200000);
+
+            for (k = 0; k < 1200000; k++)
+            {
+                id = (uint32_t)(k % 1000);
+                SUTLVectorPush(ids, id);
+            }
+
+            SUTLStringSize(packed) = 0;
+            SUTLStringSize(unpacked) = 0;
+            SUTLLzFrameBegin(packed);
+            SUTLLzFrameBlock(packed, ids, SUTLVectorSize(ids) * sizeof(*ids));
+            SUTLLzFrameBlock(packed, noise, SUTLStringSize(noise));
+            SUTLLzFrameEnd(packed);
+            SHRN_TEST(SUTLStringSize(packed) < SUTLVectorSize(ids) * sizeof(*ids) / 2)
+
+            SHRN_TEST(SUTLLzFrameOpen(SUTLStringViewOf(packed), at) == 1)
+
+            while (SUTLLzFrameNext(SUTLStringViewOf(packed), at, unpacked) == 1)
+                blocks++;
+
+            SHRN_TEST(blocks == 3 && at == SUTLStringSize(packed))
+            SHRN_TEST(SUTLStringSize(unpacked) == SUTLVectorSize(ids) * sizeof(*ids) + SUTLStringSize(noise))
+            SHRN_TEST(memcmp(unpacked, ids, SUTLVectorSize(ids) * sizeof(*ids)) == 0)
+            SHRN_TEST(memcmp(unpacked + SUTLVectorSize(ids) * sizeof(*ids), noise, SUTLStringSize(noise)) == 0)
+
+            /* Whole frames, and frames cut short */
+            SUTLStringSize(packed) = 0;
+            SUTLStringSize(unpacked) = 0;
+            SUTLLzFrameCompress(text, SUTLStringSize(text), packed);
+            SHRN_TEST(SUTLLzFrameDecompress(SUTLStringViewOf(packed), unpacked) == 1)
+            SHRN_TEST(SUTLStringSize(unpacked) == SUTLStringSize(text) && memcmp(unpacked, text, SUTLStringSize(text)) == 0)
+
+            ExpectedMsg = "Corrupted compressed data.";
+            SHRN_TEST(SUTLLzFrameDecompress(SUTLStringViewNew(packed, SUTLStringSize(packed) - 5), unpacked) == 0)
+            SHRN_TEST(ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            /* Damage to stored data is caught by the checksum */
+            SUTLStringSize(packed) = 0;
+            SUTLStringSize(unpacked) = 0;
+            SUTLLzFrameCompress(noise, SUTLStringSize(noise), packed);
+            packed[1000]++;
+
+            ExpectedMsg = "Compressed data checksum mismatch.";
+            SHRN_TEST(SUTLLzFrameDecompress(SUTLStringViewOf(packed), unpacked) == 0 && SUTLStringSize(unpacked) == 0)
+            SHRN_TEST(ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLVectorFree(ids);
+            SUTLStringFree(unpacked);
+            SUTLStringFree(packed);
+            SUTLStringFree(noise);
+            SUTLStringFree(text);
+        )
+        SHRN_TEST_GROUP(CRC32C,
+
+            SUTLString data = SUTLStringNew();
+            uint8_t bytes[32];
+            uint32_t crc = 0;
+            size_t k;
+
+            /* Known values from RFC 3720 */
+            SHRN_TEST(SUTLCrc32c(0, "123456789", 9) == 0xE3069283UL)
+
+            SHRN_MEMSET(bytes, 0, sizeof(bytes));
+            SHRN_TEST(SUTLCrc32c(0, bytes, sizeof(bytes)) == 0x8A9136AAUL)
+
+            SHRN_MEMSET(bytes, 0xFF, sizeof(bytes));
+            SHRN_TEST(SUTLCrc32c(0, bytes, sizeof(bytes)) == 0x62A8AB43UL)
+
+            for (k = 0; k < sizeof(bytes); k++)
+                bytes[k] = (uint8_t)k;
+
+            SHRN_TEST(SUTLCrc32c(0, bytes, sizeof(bytes)) == 0x46DD794EUL)
+
+            /* Long unaligned buffers match the table driven version, in one piece or several */
+            SUTLStringResize(data, 100001);
+
+            for (k = 0; k < SUTLStringSize(data); k++)
+                data[k] = (char)(k * 2654435761UL >> 13);
+
+            SHRN_TEST(SUTLCrc32c(0, data + 1, 100000) == ~SUTL_InternalCrc32cSoftware(0xFFFFFFFFUL, (uint8_t *)data + 1, 100000))
+
+            for (k = 0; k < 100001; k += 7919)
+                crc = SUTLCrc32c(crc, data + k, k + 7919 < 100001 ? 7919 : 100001 - k);
+
+            SHRN_TEST(crc == SUTLCrc32cS(0, data))
+
+            SUTLStringFree(data);
+        )
+        SHRN_TEST_GROUP(SHARED_VECTOR,
+
+            int * v = SUTLVectorNew(int);
+            int * w;
+            int * x;
+            SUTLString str = SUTLStringNew();
+            SUTLString copy;
+            int k;
+
+            for (k = 0; k < 100; k++)
+                SUTLVectorPush(v, k);
+
+            /* Sharing a plain vector moves it once, later shares are O(1) */
+            w = SUTLVectorShare(v);
+            SHRN_TEST(w == v && SUTLVectorRefCount(v) == 2 && SUTLVectorSize(w) == 100 && w[99] == 99)
+
+            x = SUTLVectorShare(w);
+            SHRN_TEST(x == v && SUTLVectorRefCount(v) == 3)
+
+            /* Changing a shared vector copies it, and the other owners keep the old elements */
+            k = 100;
+            SUTLVectorPush(x, k);
+            SHRN_TEST(x != v && SUTLVectorRefCount(x) == 1 && SUTLVectorRefCount(v) == 2)
+            SHRN_TEST(SUTLVectorSize(x) == 101 && SUTLVectorSize(v) == 100 && x[100] == 100)
+
+            SUTLVectorMakeUnique(w);
+            w[0] = -1;
+            SHRN_TEST(w != v && SUTLVectorRefCount(v) == 1 && v[0] == 0 && w[0] == -1)
+
+            /* The last owner changes the vector in place */
+            SUTLVectorErase(v, 0);
+            SHRN_TEST(SUTLVectorSize(v) == 99 && v[0] == 1)
+
+            SUTLVectorFree(x);
+            SUTLVectorFree(w);
+            SUTLVectorFree(v);
+
+            /* Strings, and vectors created shared */
+            SUTLStringAppendP(str, "shared text");
+            copy = SUTLStringShare(str);
+            SUTLStringAppendP(copy, "!");
+            SHRN_TEST(SUTLStringSize(str) == 11 && SUTLStringSize(copy) == 12 && copy[11] == '!')
+
+            SUTLStringFree(copy);
+            SUTLStringFree(str);
+
+            v = SUTLVectorNewShared(int);
+            w = SUTLVectorShare(v);
+            SHRN_TEST(w == v && SUTLVectorRefCount(v) == 2)
+
+            SUTLVectorFree(v);
+            SHRN_TEST(SUTLVectorRefCount(w) == 1)
+
+            SUTLVectorFree(w);
+        )
+        SHRN_TEST_GROUP(PERSISTENT,
+
+            SUTLPersistentVector pv = SUTLPersistentVectorNew(int);
+            SUTLPersistentVector snap;
+            SUTLPersistentMap pm = SUTLPersistentMapNew(int, int, SUTLHash_int, SUTLCmp_int);
+            SUTLPersistentMap msnap;
+            SUTLPersistentMap bad = SUTLPersistentMapNew(int, int, CollidingHash, SUTLCmp_int);
+            int ok = 1;
+            int sum = 0;
+            int count = 0;
+            int k;
+            int v;
+
+            for (k = 0; k < 5000; k++)
+                SUTLPersistentVectorPush(pv, k);
+
+            SHRN_TEST(pv.Size == 5000 && *SUTLPersistentVectorAt(int, pv, 0) == 0 && *SUTLPersistentVectorAt(int, pv, 4999) == 4999)
+
+            /* A snapshot keeps its elements while the original is changed */
+            snap = SUTLPersistentVectorCopy(pv);
+
+            for (k = 0; k < 5000; k += 7)
+            {
+                v = -k;
+                SUTLPersistentVectorSet(pv, k, v);
+            }
+
+            for (k = 0; k < 1000; k++)
+                SUTLPersistentVectorPush(pv, k);
+
+            for (k = 0; k < 5000; k++)
+                if (*SUTLPersistentVectorAt(int, snap, k) != k || *SUTLPersistentVectorAt(int, pv, k) != (k % 7 ? k : -k))
+                    ok = 0;
+
+            SHRN_TEST(ok && snap.Size == 5000 && pv.Size == 6000 && *SUTLPersistentVectorAt(int, pv, 5999) == 999)
+
+            /* Popping shrinks the trie, and pushing again leaves the snapshot unchanged */
+            for (k = 0; k < 5990; k++)
+                SUTLPersistentVectorPop(pv);
+
+            SHRN_TEST(pv.Size == 10 && pv.Shift == 5 && *SUTLPersistentVectorAt(int, pv, 9) == 9)
+
+            for (k = 0; k < 100; k++)
+                SUTLPersistentVectorPush(pv, k);
+
+            SHRN_TEST(*SUTLPersistentVectorAt(int, pv, 10) == 0 && *SUTLPersistentVectorAt(int, snap, 10) == 10 && *SUTLPersistentVectorAt(int, pv, 109) == 99)
+
+            ExpectedMsg = "Index out of range.";
+            SHRN_TEST(SUTLPersistentVectorAt(int, pv, 110) == NULL && ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLPersistentVectorFree(pv);
+            SUTLPersistentVectorFree(snap);
+
+            /* Map */
+            for (k = 0; k < 3000; k++)
+            {
+                v = k * 2;
+                SUTLPersistentMapSet(pm, &k, &v);
+            }
+
+            msnap = SUTLPersistentMapCopy(pm);
+
+            for (k = 0; k < 3000; k += 2)
+                SUTLPersistentMapErase(pm, &k);
+
+            v = 1;
+            k = 1;
+            SUTLPersistentMapSet(pm, &k, &v);
+
+            SHRN_TEST(pm.Size == 1500 && msnap.Size == 3000 && *SUTLPersistentMapGet(int, pm, &k) == 1 && *SUTLPersistentMapGet(int, msnap, &k) == 2)
+
+            ok = 1;
+
+            for (k = 0; k < 3000; k++)
+                if (*SUTLPersistentMapGet(int, msnap, &k) != k * 2 || (SUTLPersistentMapGet(int, pm, &k) == NULL) != (k % 2 == 0))
+                    ok = 0;
+
+            SHRN_TEST(ok)
+
+            SUTLPersistentMapEach(int, int, msnap, e,
+                sum += *e_v - *e_k;
+                count++;
+            )
+
+            SHRN_TEST(count == 3000 && sum == 2999 * 3000 / 2)
+
+            /* Keys with equal hashes share collision nodes */
+            for (k = 0; k < 200; k++)
+                SUTLPersistentMapSet(bad, &k, &k);
+
+            for (k = 0; k < 200; k += 3)
+                SUTLPersistentMapErase(bad, &k);
+
+            ok = 1;
+
+            for (k = 0; k < 200; k++)
+                if ((SUTLPersistentMapGet(int, bad, &k) == NULL) != (k % 3 == 0))
+                    ok = 0;
+
+            SHRN_TEST(ok && bad.Size == 133)
+
+            for (k = 0; k < 200; k++)
+                SUTLPersistentMapErase(bad, &k);
+
+            SHRN_TEST(bad.Size == 0 && bad.Root == NULL)
+
+            SUTLPersistentMapFree(pm);
+            SUTLPersistentMapFree(msnap);
+            SUTLPersistentMapFree(bad);
+        )
+        SHRN_TEST_GROUP(ATOMIC,
+
+            SHRN_ATOMIC(size_t) counter = 5;
+            SHRN_ATOMIC(void *) ptr = NULL;
+            size_t expected = 4;
+
+            SHRN_TEST(SHRN_ATOMIC_FETCH_ADD(&counter, 3, SHRN_ORDER_RELAXED) == 5 && SHRN_ATOMIC_LOAD(&counter, SHRN_ORDER_ACQUIRE) == 8)
+            SHRN_TEST(SHRN_ATOMIC_FETCH_SUB(&counter, 2, SHRN_ORDER_ACQ_REL) == 8 && SHRN_ATOMIC_EXCHANGE(&counter, 1, SHRN_ORDER_SEQ_CST) == 6)
+
+            /* A failed compare-and-swap reports the current value */
+            SHRN_TEST(SHRN_ATOMIC_CAS(&counter, &expected, 2, SHRN_ORDER_ACQ_REL, SHRN_ORDER_ACQUIRE) == 0 && expected == 1)
+            SHRN_TEST(SHRN_ATOMIC_CAS(&counter, &expected, 2, SHRN_ORDER_ACQ_REL, SHRN_ORDER_ACQUIRE) == 1 && SHRN_ATOMIC_LOAD(&counter, SHRN_ORDER_RELAXED) == 2)
+
+            SHRN_ATOMIC_STORE(&ptr, &tmp, SHRN_ORDER_RELEASE);
+            SHRN_ATOMIC_FENCE(SHRN_ORDER_SEQ_CST);
+            SHRN_PAUSE();
+            SHRN_TEST(SHRN_ATOMIC_LOAD(&ptr, SHRN_ORDER_ACQUIRE) == &tmp)
+        )
+        SHRN_TEST_GROUP(RCU,
+
+            RcuVersion * first = malloc(sizeof(RcuVersion));
+            RcuVersion * next;
+            RcuVersion * ver;
+            SUTLRcu rcu;
+            SHRN_THREAD threads[4];
+            size_t slot;
+            int started = 0;
+            int k;
+
+            first->A = 0;
+            first->B = 0;
+            rcu = SUTLRcuNew(first, 4, RcuFreeVersion);
+
+            /* A reader keeps its version while a writer publishes a new one */
+            slot = SUTLRcuRegister(rcu);
+            ver = SUTLRcuReadLock(RcuVersion, rcu, slot);
+
+            SHRN_TEST(slot == 0 && ver == first && SUTLRcuWriteLock(RcuVersion, rcu) == first)
+            SUTLRcuWriteUnlock(rcu, first);
+
+            SUTLRcuReadUnlock(rcu, slot);
+
+            next = malloc(sizeof(RcuVersion));
+            next->A = 1;
+            next->B = 1;
+            SUTLRcuWriteLock(RcuVersion, rcu);
+            SUTLRcuWriteUnlock(rcu, next);
+
+            ver = SUTLRcuReadLock(RcuVersion, rcu, slot);
+            SHRN_TEST(ver == next && RcuFrees == 1)
+            SUTLRcuReadUnlock(rcu, slot);
+
+            /* Readers never see a freed or half written version */
+            for (k = 0; k < 3; k++)
+                started += SHRN_THREAD_CREATE(threads[k], RcuReader, &rcu);
+
+            for (k = 2; k < 200; k++)
+            {
+                ver = SUTLRcuWriteLock(RcuVersion, rcu);
+                next = malloc(sizeof(RcuVersion));
+                next->A = ver->A + 1;
+                next->B = ver->B + 1;
+                SUTLRcuWriteUnlock(rcu, next);
+            }
+
+            SHRN_ATOMIC_STORE(&RcuStop, 1, SHRN_ORDER_RELAXED);
+
+            for (k = 0; k < 3; k++)
+                SHRN_THREAD_JOIN(threads[k]);
+
+            SHRN_TEST(started == 3 && RcuTorn == 0 && RcuFrees == 199 && SUTLRcuReadLock(RcuVersion, rcu, slot)->A == 199)
+            SUTLRcuReadUnlock(rcu, slot);
+
+            ExpectedMsg = "Too many RCU readers.";
+            SHRN_TEST(SUTLRcuRegister(rcu) == (size_t)-1 && ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLRcuFree(rcu);
+            SHRN_TEST(RcuFrees == 200)
+        )
+        SHRN_TEST_GROUP(CONCURRENT_VECTOR,
+
+            SUTLConcurrentVector cv = SUTLConcurrentVectorNew(unsigned);
+            SUTLConcurrentVector shared = SUTLConcurrentVectorNew(unsigned);
+            CvPusher pushers[4];
+            SHRN_THREAD threads[4];
+            unsigned next[4];
+            const unsigned * first;
+            unsigned v;
+            int started = 0;
+            int ok = 1;
+            int k;
+
+            for (k = 0; k < 5000; k++)
+            {
+                v = (unsigned)k * 3;
+                if (SUTLConcurrentVectorPush(cv, v) != (size_t)k)
+                    ok = 0;
+            }
+
+            first = SUTLConcurrentVectorAt(unsigned, cv, 0);
+            SHRN_TEST(ok && SUTLConcurrentVectorSize(cv) == 5000 && *first == 0 && *SUTLConcurrentVectorAt(unsigned, cv, 4999) == 14997)
+
+            /* Growing never moves published elements */
+            for (k = 0; k < 100000; k++)
+            {
+                v = (unsigned)k;
+                SUTLConcurrentVectorPush(cv, v);
+            }
+
+            SHRN_TEST(SUTLConcurrentVectorAt(unsigned, cv, 0) == first && *SUTLConcurrentVectorAt(unsigned, cv, 104999) == 99999)
+
+            ExpectedMsg = "Index out of range.";
+            SHRN_TEST(SUTLConcurrentVectorAt(unsigned, cv, 105000) == NULL && ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            /* Concurrent pushes keep every element, in the order of each thread */
+            for (k = 0; k < 4; k++)
+            {
+                next[k] = 0;
+                pushers[k].Vector = &shared;
+                pushers[k].Id = (unsigned)k;
+                started += SHRN_THREAD_CREATE(threads[k], CvPush, &pushers[k]);
+            }
+
+            for (k = 0; k < 4; k++)
+                SHRN_THREAD_JOIN(threads[k]);
+
+            SUTLConcurrentVectorEach(unsigned, shared, e,
+                if ((*e & 0xFFFFFF) != next[*e >> 24]++)
+                    ok = 0;
+            )
+
+            SHRN_TEST(started == 4 && ok && SUTLConcurrentVectorSize(shared) == 80000 && next[0] == 20000 && next[3] == 20000)
+
+            SUTLConcurrentVectorFree(cv);
+            SUTLConcurrentVectorFree(shared);
+        )
+        SHRN_TEST_GROUP(METRICS,
+
+            SUTLCounter counter = SUTLCounterNew(3);
+            SUTLHistogram total = SUTLHistogramNew();
+            MetricsThread threads[4];
+            SHRN_THREAD handles[4];
+            uint64_t value;
+            uint64_t upper;
+            int started = 0;
+            int ok = 1;
+            int k;
+
+            SHRN_TEST(counter.Shards == 4 && SUTLCounterRead(counter) == 0 && SUTLHistogramPercentile(total, 50) == 0)
+
+            /* Values are bucketed exactly when small, and to within 1/32 above */
+            for (value = 0; value < 1000000; value = value * 9 / 8 + 1)
+            {
+                upper = SUTL_InternalHistogramUpper(SUTL_InternalHistogramBucket(value));
+
+                if (upper < value || (value < 32 && upper != value) || (double)(upper - value) > (double)value / 32)
+                    ok = 0;
+            }
+
+            SHRN_TEST(ok && SUTL_InternalHistogramUpper(SUTL_HISTOGRAM_BUCKETS - 1) == UINT64_MAX)
+
+            /* Threads update without sharing cache lines, and their histograms merge */
+            for (k = 0; k < 4; k++)
+            {
+                threads[k].Counter = &counter;
+                threads[k].Histogram = SUTLHistogramNew();
+                threads[k].Id = (unsigned)k;
+                started += SHRN_THREAD_CREATE(handles[k], MetricsRecord, &threads[k]);
+            }
+
+            for (k = 0; k < 4; k++)
+            {
+                SHRN_THREAD_JOIN(handles[k]);
+                SUTLHistogramMerge(total, threads[k].Histogram);
+                SUTLHistogramFree(threads[k].Histogram);
+            }
+
+            SHRN_TEST(started == 4 && SUTLCounterRead(counter) == 400000)
+            SHRN_TEST(total.Count == 200000 && total.Min == 4 && total.Max == 200003)
+
+            value = SUTLHistogramPercentile(total, 50);
+            SHRN_TEST(value >= 100000 && value <= 100000 + 100000 / 32)
+
+            value = SUTLHistogramPercentile(total, 99.9);
+            SHRN_TEST(value >= 199800 && value <= 200003 && SUTLHistogramPercentile(total, 100) == 200003)
+
+            SUTLHistogramReset(total);
+            SUTLHistogramRecord(total, 7);
+            SHRN_TEST(total.Count == 1 && SUTLHistogramPercentile(total, 0) == 7 && SUTLHistogramPercentile(total, 100) == 7)
+
+            SUTLCounterFree(counter);
+            SUTLHistogramFree(total);
+        )
+        SHRN_TEST_GROUP(INTRUSIVE,
+
+            IntrusiveItem * items = malloc(1000 * sizeof(IntrusiveItem));
+            SUTLList lru;
+            SUTLHList chain;
+            SUTLIntrusiveHash ht = SUTLIntrusiveHashNew(4);
+            IntrusiveItem * found;
+            int order[5];
+            int count = 0;
+            int ok = 1;
+            int k;
+
+            SUTLListInit(lru);
+            SUTLHListInit(chain);
+            SHRN_TEST(SUTLListEmpty(lru) && SUTLListFirst(IntrusiveItem, Lru, lru) == NULL)
+
+            for (k = 0; k < 1000; k++)
+            {
+                items[k].Key = k;
+
+                if (k < 5)
+                {
+                    SUTLListPushBack(lru, items[k].Lru);
+                    SUTLHListPushFront(chain, items[k].Chain);
+                }
+
+                SUTLIntrusiveHashInsert(ht, items[k].ByKey, SUTLHash_int(&k));
+            }
+
+            /* Touching an item moves it to the front, and the back is the least recently used */
+            SUTLListMoveToFront(lru, items[3].Lru);
+            SUTLListRemove(items[1].Lru);
+            SUTLListRemove(items[1].Lru);
+            SUTLListInsertAfter(items[3].Lru, items[1].Lru);
+
+            SUTLListEach(IntrusiveItem, Lru, lru, it,
+                order[count++] = it->Key;
+            )
+
+            SHRN_TEST(count == 5 && order[0] == 3 && order[1] == 1 && order[2] == 0 && order[3] == 2 && order[4] == 4)
+            SHRN_TEST(SUTLListFirst(IntrusiveItem, Lru, lru) == &items[3] && SUTLListLast(IntrusiveItem, Lru, lru) == &items[4])
+
+            /* Removing while iterating */
+            SUTLHListRemove(items[2].Chain);
+            count = 0;
+
+            SUTLHListEach(IntrusiveItem, Chain, chain, it,
+                count += it->Key;
+                SUTLHListRemove(it->Chain);
+            )
+
+            SHRN_TEST(count == 0 + 1 + 3 + 4 && chain.First == NULL)
+
+            /* The table grows as items are inserted, without moving them */
+            for (k = 0; k < 1000; k++)
+                if (SUTLIntrusiveHashFind(IntrusiveItem, ByKey, ht, SUTLHash_int(&k), &k, IntrusiveMatch) != &items[k])
+                    ok = 0;
+
+            SHRN_TEST(ok && ht.Size == 1000 && ht.BucketCount >= 1000)
+
+            for (k = 0; k < 1000; k += 2)
+                SUTLIntrusiveHashRemove(ht, items[k].ByKey);
+
+            k = 10;
+            found = SUTLIntrusiveHashFind(IntrusiveItem, ByKey, ht, SUTLHash_int(&k), &k, IntrusiveMatch);
+            k = 11;
+            SHRN_TEST(found == NULL && SUTLIntrusiveHashFind(IntrusiveItem, ByKey, ht, SUTLHash_int(&k), &k, IntrusiveMatch) == &items[11])
+
+            count = 0;
+
+            SUTLIntrusiveHashEach(IntrusiveItem, ByKey, ht, it,
+                if (it->Key % 2 == 1)
+                    count++;
+            )
+
+            SHRN_TEST(count == 500 && ht.Size == 500)
+
+            SUTLIntrusiveHashFree(ht);
+            free(items);
+        )
+        SHRN_TEST_GROUP(SKIP_LIST,
+
+            SUTLSkipList sl = SUTLSkipListNew(int, int, SUTL_ORDFN(int));
+            SUTLSkipList shared = SUTLSkipListNew(int, int, SUTL_ORDFN(int));
+            SUTLSkipListIter it;
+            SkipReader reader;
+            SHRN_THREAD thread;
+            int started = 0;
+            int last = -1;
+            int count = 0;
+            int ok = 1;
+            int lo;
+            int hi;
+            int v;
+            int k;
+
+            SHRN_TEST(SUTLSkipListSize(sl) == 0 && !SUTLSkipListIterValid(SUTLSkipListSeek(sl, NULL)))
+
+            /* Insert in a scrambled order */
+            for (k = 0; k < 10000; k++)
+            {
+                lo = (k * 7919) % 10000;
+                v = lo * 2;
+                if (!SUTLSkipListInsert(sl, &lo, &v))
+                    ok = 0;
+            }
+
+            SHRN_TEST(ok && SUTLSkipListSize(sl) == 10000)
+
+            k = 1234;
+            v = 0;
+            SHRN_TEST(!SUTLSkipListInsert(sl, &k, &v) && *SUTLSkipListGet(int, sl, &k) == 2468 && SUTLSkipListSize(sl) == 10000)
+
+            k = 10000;
+            SHRN_TEST(SUTLSkipListGet(int, sl, &k) == NULL)
+
+            for (it = SUTLSkipListSeek(sl, NULL); SUTLSkipListIterValid(it); SUTLSkipListIterNext(it))
+            {
+                if (*SUTLSkipListIterKey(int, it) != last + 1 || *SUTLSkipListIterValue(int, it) != *SUTLSkipListIterKey(int, it) * 2)
+                    ok = 0;
+                last = *SUTLSkipListIterKey(int, it);
+            }
+
+            SHRN_TEST(ok && last == 9999)
+
+            /* Seeking lands on the first key not less than the probe */
+            for (k = 0; k < 5000; k++)
+            {
+                v = k * 2;
+                SUTLSkipListInsert(shared, &v, &k);
+            }
+
+            k = 101;
+            it = SUTLSkipListSeek(shared, &k);
+            SHRN_TEST(SUTLSkipListIterValid(it) && *SUTLSkipListIterKey(int, it) == 102)
+
+            lo = 100;
+            hi = 200;
+            last = 99;
+
+            SUTLSkipListRange(int, int, sl, &lo, &hi, e,
+                if (*e_k != last + 1 || *e_v != *e_k * 2)
+                    ok = 0;
+                last = *e_k;
+                count++;
+            )
+
+            SHRN_TEST(ok && count == 100)
+
+            count = 0;
+
+            SUTLSkipListRange(int, int, sl, &hi, NULL, e,
+                count += *e_v == *e_k * 2;
+            )
+
+            SHRN_TEST(count == 9800)
+
+            SUTLSkipListFree(shared);
+
+            /* Readers see a sorted, consistent list while one writer inserts */
+            shared = SUTLSkipListNew(int, int, SUTL_ORDFN(int));
+            reader.List = &shared;
+            reader.Ok = 1;
+            SHRN_ATOMIC_STORE(&reader.Stop, 0, SHRN_ORDER_RELAXED);
+            started += SHRN_THREAD_CREATE(thread, SkipRead, &reader);
+
+            for (k = 0; k < 50000; k++)
+            {
+                lo = (k * 7919) % 50000;
+                v = lo * 2;
+                SUTLSkipListInsert(shared, &lo, &v);
+            }
+
+            SHRN_ATOMIC_STORE(&reader.Stop, 1, SHRN_ORDER_RELEASE);
+            SHRN_THREAD_JOIN(thread);
+
+            SHRN_TEST(started == 1 && reader.Ok && SUTLSkipListSize(shared) == 50000)
+
+            SUTLSkipListFree(shared);
+            SUTLSkipListFree(sl);
+        )
+        SHRN_TEST_GROUP(ORDER,
+
+            SUTLString strs[3];
+            SUTLStringView view;
+            double nan = 0.0;
+            double doubles[4];
+            int * ints = malloc(10000 * sizeof(int));
+            unsigned u0 = 1;
+            unsigned u1 = 4000000000u;
+            size_t at;
+            int ok = 1;
+            int k;
+
+            SHRN_TEST(SUTL_ORDFN(uint)(&u0, &u1) < 0 && SUTL_ORDFN(uint)(&u1, &u0) > 0 && SUTL_ORDFN(uint)(&u0, &u0) == 0)
+
+            k = -5;
+            SHRN_TEST(SUTL_ORDFN(int)(&k, &u0) < 0 && SUTL_ORDER(k, 3) == -1 && SUTL_ORDER(3, 3) == 0)
+
+            strs[0] = SUTLStringNew();
+            strs[1] = SUTLStringNew();
+            strs[2] = SUTLStringNew();
+            SUTLStringAppendP(strs[0], "abc");
+            SUTLStringAppendP(strs[1], "ab");
+            SUTLStringAppendP(strs[2], "abd");
+            view = SUTLStringViewNew("abc", 3);
+            SHRN_TEST(SUTL_ORDFN(string)(&strs[1], &strs[0]) < 0 && SUTL_ORDFN(string)(&strs[2], &strs[0]) > 0 && SUTL_PROBEORDFN(string)(&view, &strs[0]) == 0)
+
+            SUTLSort(SUTLString, strs, 3, SUTL_ORDFN(string));
+            SHRN_TEST(SUTLStringSize(strs[0]) == 2 && strs[1][2] == 'c' && strs[2][2] == 'd' && SUTLLowerBound(SUTLString, strs, 3, &view, SUTL_PROBEORDFN(string)) == 1)
+
+            /* NaNs sort after every number */
+            nan = nan / nan;
+            doubles[0] = 2.5;
+            doubles[1] = nan;
+            doubles[2] = -1.0;
+            doubles[3] = 0.0;
+            SUTLSort(double, doubles, 4, SUTL_ORDFN(double));
+            SHRN_TEST(doubles[0] == -1.0 && doubles[1] == 0.0 && doubles[2] == 2.5 && doubles[3] != doubles[3] && SUTL_ORDER_FLOAT(nan, nan) == 0)
+
+            /* Sorting many duplicates and searching both ways agree */
+            for (k = 0; k < 10000; k++)
+                ints[k] = (k * 7919) % 2500;
+
+            SUTLSort(int, ints, 10000, SUTL_ORDFN(int));
+
+            for (k = 1; k < 10000; k++)
+                if (ints[k - 1] > ints[k])
+                    ok = 0;
+
+            SHRN_TEST(ok && ints[0] == 0 && ints[9999] == 2499)
+
+            for (k = -1; k <= 2500; k++)
+            {
+                SUTLLowerBoundInline(ints, 10000, k, at)
+                if (at != SUTLLowerBound(int, ints, 10000, &k, SUTL_ORDFN(int)) || at != (size_t)(k < 0 ? 0 : k * 4))
+                    ok = 0;
+            }
+
+            SHRN_TEST(ok)
+
+            SUTLStringFree(strs[0]);
+            SUTLStringFree(strs[1]);
+            SUTLStringFree(strs[2]);
+            free(ints);
+        )
+
+        SHRN_TEST_GROUP(GRAPH,
+
+            size_t * from = SUTLVectorNew(size_t);
+            size_t * to = SUTLVectorNew(size_t);
+            size_t order[6];
+            size_t pos[6];
+            SUTLGraph g;
+            SUTLGraph serial;
+            SUTLGraph parallel;
+            SUTLGraphWalk walk;
+            size_t count = 0;
+            size_t node;
+            size_t v;
+            int ok = 1;
+            int k;
+
+            /* 0 -> 1, 0 -> 2, 1 -> 3, 2 -> 3, 3 -> 4, 5 -> 4 */
+            v = 0; SUTLVectorPush(from, v); v = 1; SUTLVectorPush(to, v);
+            v = 0; SUTLVectorPush(from, v); v = 2; SUTLVectorPush(to, v);
+            v = 1; SUTLVectorPush(from, v); v = 3; SUTLVectorPush(to, v);
+            v = 2; SUTLVectorPush(from, v); v = 3; SUTLVectorPush(to, v);
+            v = 3; SUTLVectorPush(from, v); v = 4; SUTLVectorPush(to, v);
+            v = 5; SUTLVectorPush(from, v); v = 4; SUTLVectorPush(to, v);
+
+            g = SUTLGraphNew(6, from, to, 1);
+            SHRN_TEST(g.NodeCount == 6 && g.EdgeCount == 6 && SUTLGraphDegree(g, 0) == 2 && SUTLGraphDegree(g, 4) == 0)
+            SHRN_TEST(SUTLGraphNeighbours(g, 0)[0] == 1 && SUTLGraphNeighbours(g, 0)[1] == 2 && SUTLGraphNeighbours(g, 5)[0] == 4)
+
+            SUTLGraphEachNeighbour(g, 3, n,
+                count += n;
+            )
+
+            SHRN_TEST(count == 4)
+
+            /* Breadth-first from 0 never reaches 5 */
+            walk = SUTLGraphBfs(g, 0);
+            count = 0;
+
+            SUTLGraphWalkEach(walk, n,
+                order[count++] = n;
+            )
+
+            SHRN_TEST(count == 5 && order[0] == 0 && order[1] == 1 && order[2] == 2 && order[3] == 3 && order[4] == 4)
+            SUTLGraphWalkFree(walk);
+
+            walk = SUTLGraphDfs(g, 0);
+            count = 0;
+
+            while (SUTLGraphWalkNext(walk, node))
+                order[count++] = node;
+
+            SHRN_TEST(count == 5 && order[0] == 0 && order[1] == 1 && order[2] == 3 && order[3] == 4 && order[4] == 2)
+            SUTLGraphWalkFree(walk);
+
+            /* Every edge goes forward in topological order */
+            walk = SUTLGraphTopological(g);
+            count = 0;
+
+            SUTLGraphWalkEach(walk, n,
+                pos[n] = count++;
+            )
+
+            for (k = 0; k < 6; k++)
+                if (pos[from[k]] >= pos[to[k]])
+                    ok = 0;
+
+            SHRN_TEST(ok && count == 6)
+            SUTLGraphWalkFree(walk);
+            SUTLGraphFree(g);
+
+            /* 4 -> 1 closes a cycle */
+            v = 4; SUTLVectorPush(from, v); v = 1; SUTLVectorPush(to, v);
+            g = SUTLGraphNew(6, from, to, 1);
+            walk = SUTLGraphTopological(g);
+            count = 0;
+
+            ExpectedMsg = "Graph has a cycle.";
+            SUTLGraphWalkEach(walk, n,
+                count++;
+            )
+            SHRN_TEST(count == 3 && ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLGraphWalkFree(walk);
+
+            ExpectedMsg = "Node out of range.";
+            walk = SUTLGraphBfs(g, 6);
+            SHRN_TEST(!SUTLGraphWalkNext(walk, node) && ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLGraphWalkFree(walk);
+            SUTLGraphFree(g);
+
+            ExpectedMsg = "Node out of range.";
+            g = SUTLGraphNew(5, from, to, 1);
+            SHRN_TEST(g.NodeCount == 0 && g.Offsets == NULL && ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            SUTLVectorPop(to);
+
+            ExpectedMsg = "Edge vectors differ in size.";
+            g = SUTLGraphNew(6, from, to, 1);
+            SHRN_TEST(g.NodeCount == 0 && ExpectationFulfilled == 1)
+            ExpectedMsg = NULL;
+            ExpectationFulfilled = 0;
+
+            /* Building with threads places every edge exactly where building without them does */
+            SUTLVectorResize(from, 0);
+            SUTLVectorResize(to, 0);
+            SUTLVectorReserve(from, 300000);
+            SUTLVectorReserve(to, 300000);
+
+            for (k = 0; k < 300000; k++)
+            {
+                v = ((size_t)k * 7919) % 1000;
+                SUTLVectorPush(from, v);
+                v = ((size_t)k * 104729 + 13) % 1000;
+                SUTLVectorPush(to, v);
+            }
+
+            serial = SUTLGraphNew(1000, from, to, 1);
+            parallel = SUTLGraphNew(1000, from, to, 4);
+
+            SHRN_TEST(parallel.EdgeCount == 300000 && memcmp(serial.Offsets, parallel.Offsets, 1001 * sizeof(size_t)) == 0 && memcmp(serial.Targets, parallel.Targets, 300000 * sizeof(size_t)) == 0)
+
+            SUTLGraphFree(parallel);
+            SUTLGraphFree(serial);
+            SUTLVectorFree(from);
+            SUTLVectorFree(to);
+        )
     )
 }
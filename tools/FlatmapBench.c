@@ -0,0 +1,128 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures the latency of hits in SUTLHashmap and in SUTLFlatmap with both layouts, for a small
+ * (4 byte) and a large (64 byte) value type with uint32_t keys.
+ *
+ * Usage: FlatmapBench [count] [lookups]
+ *
+ * Count defaults to 100000 entries and lookups to 1000000 random hits.
+ */
+#include <stdio.h>
+
+#define SUTL_IMPLEMENTATION
+#include "../include/Shroon/Utils/Flatmap.h"
+#include "../include/Shroon/Utils/Hashmap.h"
+#include "../include/Shroon/Utils/System.h"
+
+typedef struct Large
+{
+    uint32_t Data[16];
+} Large;
+
+/*
+ * Defines a function which fills each map with `count` entries of value type `tv` and returns the
+ * nanoseconds per hit in `ns`, in the order hashmap, AoS flatmap, SoA flatmap.
+ */
+#define DEFINE_BENCH(name, tv) \
+    uint32_t name(long count, const uint32_t * probes, long lookups, double * ns)\
+    {\
+        SUTLHashmap hm = SUTLHashmapNew(uint32_t, tv, SUTL_HASHFN(u32), SUTL_CMPFN(u32));\
+        SUTLFlatmap fm[2];\
+        tv value;\
+        uint32_t key, sum = 0;\
+        double start;\
+        long i;\
+        int k;\
+\
+        SHRN_MEMSET(&value, 0, sizeof(value));\
+        fm[0] = SUTLFlatmapNew(uint32_t, tv, SUTL_HASHFN(u32), SUTL_CMPFN(u32), SUTL_FLATMAP_LAYOUT_AOS);\
+        fm[1] = SUTLFlatmapNew(uint32_t, tv, SUTL_HASHFN(u32), SUTL_CMPFN(u32), SUTL_FLATMAP_LAYOUT_SOA);\
+\
+        for (i = 0; i < count; i++)\
+        {\
+            key = (uint32_t)i;\
+            *(uint32_t *)&value = key;\
+            SUTLHashmapInsert(uint32_t, tv, hm, key, value);\
+            SUTLFlatmapInsert(uint32_t, tv, fm[0], key, value);\
+            SUTLFlatmapInsert(uint32_t, tv, fm[1], key, value);\
+        }\
+\
+        start = SHRN_NOW();\
+\
+        for (i = 0; i < lookups; i++)\
+            sum += *(uint32_t *)SUTLHashmapGet(uint32_t, tv, hm, probes[i]);\
+\
+        ns[0] = (SHRN_NOW() - start) * 1e9 / lookups;\
+\
+        for (k = 0; k < 2; k++)\
+        {\
+            start = SHRN_NOW();\
+\
+            for (i = 0; i < lookups; i++)\
+                sum += *(uint32_t *)SUTLFlatmapGet(uint32_t, tv, fm[k], probes[i]);\
+\
+            ns[k + 1] = (SHRN_NOW() - start) * 1e9 / lookups;\
+            SUTLFlatmapFree(fm[k]);\
+        }\
+\
+        SUTLHashmapFree(hm);\
+\
+        return sum;\
+    }
+
+DEFINE_BENCH(BenchSmall, uint32_t)
+DEFINE_BENCH(BenchLarge, Large)
+
+int main(int argc, char ** argv)
+{
+    long count = argc > 1 ? atol(argv[1]) : 100000;
+    long lookups = argc > 2 ? atol(argv[2]) : 1000000;
+    uint32_t * probes = SUTLVectorNew(uint32_t);
+    uint32_t seed = 1;
+    uint32_t sum;
+    double ns[3];
+    long i;
+
+    if (count <= 0 || lookups <= 0)
+    {
+        printf("Count and lookups must be positive.\n");
+        return 1;
+    }
+
+    SUTLVectorReserve(probes, (size_t)lookups);
+
+    for (i = 0; i < lookups; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        probes[i] = (uint32_t)(((uint64_t)seed * (uint64_t)count) >> 32);
+    }
+
+    SUTLVectorResize(probes, (size_t)lookups);
+
+    sum = BenchSmall(count, probes, lookups, ns);
+    printf("4 byte values:   hashmap %.1f ns, flatmap AoS %.1f ns, flatmap SoA %.1f ns\n", ns[0], ns[1], ns[2]);
+
+    sum += BenchLarge(count, probes, lookups, ns);
+    printf("64 byte values:  hashmap %.1f ns, flatmap AoS %.1f ns, flatmap SoA %.1f ns\n", ns[0], ns[1], ns[2]);
+
+    printf("Checksum:        %lu\n", (unsigned long)sum);
+
+    SUTLVectorFree(probes);
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures the throughput of SUTLJsonParse.
+ *
+ * Usage: JsonBench [json file] [iterations]
+ *
+ * Without a file a document of about 64 MB with records of mixed types is generated. Iterations
+ * defaults to 10.
+ */
+#include <stdio.h>
+
+#define SUTL_IMPLEMENTATION
+#include "../include/Shroon/Utils/Json.h"
+#include "../include/Shroon/Utils/MappedFile.h"
+#include "../include/Shroon/Utils/System.h"
+
+int main(int argc, char ** argv)
+{
+    long iterations = argc > 2 ? atol(argv[2]) : 10;
+    SUTLString text = SUTLStringNew();
+    SUTLMappedFile mf;
+    SUTLStringView json;
+    SUTLJsonDocument doc;
+    double start, elapsed;
+    char record[160];
+    long i;
+
+    mf.Data = NULL;
+    mf.Size = 0;
+
+    if (argc > 1 && strcmp(argv[1], "-") != 0)
+    {
+        mf = SUTLMappedFileOpen(argv[1], SUTL_MAPPED_FILE_SEQUENTIAL | SUTL_MAPPED_FILE_WILL_NEED);
+
+        if (!mf.Data)
+            return 1;
+
+        json = SUTLMappedFileView(mf);
+    }
+    else
+    {
+        SUTLStringReserve(text, 65 << 20);
+        SUTLStringAppendP(text, "[");
+
+        for (i = 0; SUTLStringSize(text) < (64 << 20); i++)
+        {
+            sprintf(record, "%s{\"id\": %ld, \"name\": \"user %ld\", \"score\": %ld.%02ld, \"active\": %s, \"tags\": [\"a\", \"b\\n\"]}",
+                i ? ", " : "", i, i, i % 1000, i % 100, i % 2 ? "true" : "false");
+            SUTLStringAppendP(text, record);
+        }
+
+        SUTLStringAppendP(text, "]");
+        json = SUTLStringViewOf(text);
+    }
+
+    /*
+     * The first parse allocates the memory which the following ones reuse.
+     */
+    doc = SUTLJsonParse(json);
+
+    if (doc.Error)
+        return 1;
+
+    start = SHRN_NOW();
+
+    for (i = 0; i < iterations; i++)
+        SUTLJsonReparse(doc, json);
+
+    elapsed = SHRN_NOW() - start;
+
+    printf("%lu bytes, %lu nodes: %.2f GB/s\n", (unsigned long)json.Size, (unsigned long)SUTLVectorSize(doc.Nodes),
+        (double)json.Size * (double)iterations / elapsed * 1e-9);
+
+    SUTLJsonDocumentFree(doc);
+
+    SUTLMappedFileClose(mf);
+    SUTLStringFree(text);
+
+    return 0;
+}
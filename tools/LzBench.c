@@ -0,0 +1,106 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures the ratio and the throughput of SUTLLzFrameCompress and SUTLLzFrameDecompress.
+ *
+ * Usage: LzBench [file] [iterations]
+ *
+ * Without a file about 64 MB of JSON records are generated. Iterations defaults to 10.
+ */
+#include <stdio.h>
+
+#define SUTL_IMPLEMENTATION
+#include "../include/Shroon/Utils/Lz.h"
+#include "../include/Shroon/Utils/MappedFile.h"
+#include "../include/Shroon/Utils/System.h"
+
+int main(int argc, char ** argv)
+{
+    long iterations = argc > 2 ? atol(argv[2]) : 10;
+    SUTLString text = SUTLStringNew();
+    SUTLString packed = SUTLStringNew();
+    SUTLString unpacked = SUTLStringNew();
+    SUTLMappedFile mf;
+    SUTLStringView data;
+    double start, compress, decompress;
+    char record[160];
+    long i;
+
+    mf.Data = NULL;
+    mf.Size = 0;
+
+    if (argc > 1 && strcmp(argv[1], "-") != 0)
+    {
+        mf = SUTLMappedFileOpen(argv[1], SUTL_MAPPED_FILE_SEQUENTIAL | SUTL_MAPPED_FILE_WILL_NEED);
+
+        if (!mf.Data)
+            return 1;
+
+        data = SUTLMappedFileView(mf);
+    }
+    else
+    {
+        SUTLStringReserve(text, 65 << 20);
+
+        for (i = 0; SUTLStringSize(text) < (64 << 20); i++)
+        {
+            sprintf(record, "{\"id\": %ld, \"name\": \"user %ld\", \"score\": %ld.%02ld, \"active\": %s}\n",
+                i, i % 5000, i % 1000, i % 100, i % 2 ? "true" : "false");
+            SUTLStringAppendP(text, record);
+        }
+
+        data = SUTLStringViewOf(text);
+    }
+
+    /*
+     * Both output strings keep their memory between iterations.
+     */
+    start = SHRN_NOW();
+
+    for (i = 0; i < iterations; i++)
+    {
+        SUTLStringSize(packed) = 0;
+        SUTLLzFrameCompress(data.Data, data.Size, packed);
+    }
+
+    compress = SHRN_NOW() - start;
+    start = SHRN_NOW();
+
+    for (i = 0; i < iterations; i++)
+    {
+        SUTLStringSize(unpacked) = 0;
+
+        if (!SUTLLzFrameDecompress(SUTLStringViewOf(packed), unpacked))
+            return 1;
+    }
+
+    decompress = SHRN_NOW() - start;
+
+    if (SUTLStringSize(unpacked) != data.Size || memcmp(unpacked, data.Data, data.Size) != 0)
+        return 1;
+
+    printf("%lu -> %lu bytes (%.2fx): compress %.2f GB/s, decompress %.2f GB/s\n", (unsigned long)data.Size,
+        (unsigned long)SUTLStringSize(packed), (double)data.Size / (double)SUTLStringSize(packed),
+        (double)data.Size * (double)iterations / compress * 1e-9, (double)data.Size * (double)iterations / decompress * 1e-9);
+
+    SUTLMappedFileClose(mf);
+    SUTLStringFree(unpacked);
+    SUTLStringFree(packed);
+    SUTLStringFree(text);
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Generates a constant lookup table for a list of keys at build time.
+ *
+ * Usage: PerfectHashGen <name> [keys file]
+ *
+ * The keys are read one per line from the file, or from stdin if it isn't given. Empty lines are
+ * skipped. The generated C source is written to stdout, see SUTLPerfectHashGenerate.
+ */
+#include <stdio.h>
+
+#define SUTL_IMPLEMENTATION
+#include "../include/Shroon/Utils/PerfectHash.h"
+
+int main(int argc, char ** argv)
+{
+    FILE * in = stdin;
+    SUTLString * keys = SUTLVectorNew(SUTLString);
+    SUTLString key = SUTLStringNew();
+    SUTLString out = SUTLStringNew();
+    int result = 0;
+    size_t i;
+    char ch;
+    int c;
+
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s <name> [keys file]\n", argv[0]);
+        return 1;
+    }
+
+    if (argc == 3 && !(in = fopen(argv[2], "rb")))
+    {
+        fprintf(stderr, "Can't open '%s'.\n", argv[2]);
+        return 1;
+    }
+
+    /*
+     * Split the input into lines, dropping the '\r' of CRLF line endings.
+     */
+    while ((c = fgetc(in)) != EOF)
+    {
+        if (c != '\n')
+        {
+            ch = (char)c;
+            SUTLStringAppendC(key, ch);
+            continue;
+        }
+
+        if (SUTLStringSize(key) && key[SUTLStringSize(key) - 1] == '\r')
+            SUTLStringPop(key);
+
+        if (SUTLStringSize(key))
+        {
+            SUTLVectorPush(keys, key);
+            key = SUTLStringNew();
+        }
+    }
+
+    if (SUTLStringSize(key) && key[SUTLStringSize(key) - 1] == '\r')
+        SUTLStringPop(key);
+
+    if (SUTLStringSize(key))
+        SUTLVectorPush(keys, key);
+    else
+        SUTLStringFree(key);
+
+    if (SUTLPerfectHashGenerate(keys, argv[1], out))
+        fwrite(out, 1, SUTLStringSize(out), stdout);
+    else
+        result = 1;
+
+    for (i = 0; i < SUTLVectorSize(keys); i++)
+        SUTLStringFree(keys[i]);
+
+    SUTLStringFree(out);
+    SUTLVectorFree(keys);
+
+    if (in != stdin)
+        fclose(in);
+
+    return result;
+}
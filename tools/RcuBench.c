@@ -0,0 +1,178 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures lookups in a SUTLHashmap which a writer rebuilds every millisecond, read under a mutex
+ * and under SUTLRcu.
+ *
+ * Usage: RcuBench [readers] [seconds]
+ *
+ * Readers defaults to 64 and seconds to 2, for each of the two runs.
+ */
+#include <stdio.h>
+
+#define SUTL_IMPLEMENTATION
+#include "../include/Shroon/Utils/Hashmap.h"
+#include "../include/Shroon/Utils/Rcu.h"
+
+#define ROUTES 10000
+
+typedef struct Bench
+{
+    int UseRcu;
+    SUTLRcu Rcu;
+    SUTLHashmap * Locked;
+    SHRN_MUTEX Mutex;
+    SHRN_ATOMIC(int) Stop;
+    SHRN_ATOMIC(size_t) Lookups;
+} Bench;
+
+SUTLHashmap * BuildRoutes(int generation)
+{
+    SUTLHashmap * hm = malloc(sizeof(SUTLHashmap));
+    SUTLHashmap routes = SUTLHashmapNew(int, int, SUTLHash_int, SUTLCmp_int);
+    int k;
+
+    for (k = 0; k < ROUTES; k++)
+        SUTLHashmapInsert(int, int, routes, k, k + generation);
+
+    *hm = routes;
+
+    return hm;
+}
+
+void FreeRoutes(void * ptr)
+{
+    SUTLHashmap * hm = ptr;
+
+    SUTLHashmapFree(*hm);
+    free(hm);
+}
+
+void * Reader(void * arg)
+{
+    Bench * bench = arg;
+    size_t slot = bench->UseRcu ? SUTLRcuRegister(bench->Rcu) : 0;
+    size_t lookups = 0;
+    unsigned key = (unsigned)(size_t)&slot;
+    SUTLHashmap * hm;
+    int k;
+
+    while (!SHRN_ATOMIC_LOAD(&bench->Stop, SHRN_ORDER_RELAXED))
+    {
+        key = key * 1103515245 + 12345;
+        k = (int)(key >> 8) % ROUTES;
+
+        if (bench->UseRcu)
+        {
+            hm = SUTLRcuReadLock(SUTLHashmap, bench->Rcu, slot);
+            SUTLHashmapGetWith(int, *hm, &k, SUTLHash_int, SUTLCmp_int);
+            SUTLRcuReadUnlock(bench->Rcu, slot);
+        }
+        else
+        {
+            SHRN_MUTEX_LOCK(bench->Mutex);
+            SUTLHashmapGetWith(int, *bench->Locked, &k, SUTLHash_int, SUTLCmp_int);
+            SHRN_MUTEX_UNLOCK(bench->Mutex);
+        }
+
+        lookups++;
+    }
+
+    SHRN_ATOMIC_FETCH_ADD(&bench->Lookups, lookups, SHRN_ORDER_RELAXED);
+
+    return NULL;
+}
+
+double Run(int usercu, long readers, double seconds, long * updates)
+{
+    SHRN_THREAD * threads = malloc(readers * sizeof(SHRN_THREAD));
+    SUTLHashmap * next;
+    SUTLHashmap * old;
+    Bench bench;
+    double start, now;
+    long i;
+
+    bench.UseRcu = usercu;
+    SHRN_ATOMIC_STORE(&bench.Stop, 0, SHRN_ORDER_RELAXED);
+    SHRN_ATOMIC_STORE(&bench.Lookups, 0, SHRN_ORDER_RELAXED);
+    bench.Rcu = SUTLRcuNew(BuildRoutes(0), readers, FreeRoutes);
+    bench.Locked = BuildRoutes(0);
+    SHRN_MUTEX_INIT(bench.Mutex);
+
+    for (i = 0; i < readers; i++)
+        if (!SHRN_THREAD_CREATE(threads[i], Reader, &bench))
+            break;
+
+    readers = i;
+
+    /*
+     * The writer builds each version outside of the lock, like a routing table loaded from a file.
+     */
+    start = SHRN_NOW();
+
+    for (*updates = 0; (now = SHRN_NOW()) - start < seconds; (*updates)++)
+    {
+        next = BuildRoutes((int)*updates + 1);
+
+        if (usercu)
+        {
+            SUTLRcuWriteLock(SUTLHashmap, bench.Rcu);
+            SUTLRcuWriteUnlock(bench.Rcu, next);
+        }
+        else
+        {
+            SHRN_MUTEX_LOCK(bench.Mutex);
+            old = bench.Locked;
+            bench.Locked = next;
+            SHRN_MUTEX_UNLOCK(bench.Mutex);
+
+            FreeRoutes(old);
+        }
+
+        while (SHRN_NOW() - now < 1e-3)
+            SHRN_THREAD_YIELD();
+    }
+
+    SHRN_ATOMIC_STORE(&bench.Stop, 1, SHRN_ORDER_RELAXED);
+
+    for (i = 0; i < readers; i++)
+        SHRN_THREAD_JOIN(threads[i]);
+
+    SUTLRcuFree(bench.Rcu);
+    FreeRoutes(bench.Locked);
+    SHRN_MUTEX_DESTROY(bench.Mutex);
+    free(threads);
+
+    return (double)SHRN_ATOMIC_LOAD(&bench.Lookups, SHRN_ORDER_RELAXED) / (SHRN_NOW() - start);
+}
+
+int main(int argc, char ** argv)
+{
+    long readers = argc > 1 ? atol(argv[1]) : 64;
+    double seconds = argc > 2 ? atof(argv[2]) : 2;
+    double locked, rcu;
+    long lockedupdates, rcuupdates;
+
+    locked = Run(0, readers, seconds, &lockedupdates);
+    rcu = Run(1, readers, seconds, &rcuupdates);
+
+    printf("Readers:  %ld\n", readers);
+    printf("Mutex:    %.1f M lookups/s, %ld updates\n", locked / 1e6, lockedupdates);
+    printf("RCU:      %.1f M lookups/s, %ld updates (%.1fx)\n", rcu / 1e6, rcuupdates, rcu / locked);
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares SUTLRoaring with a SUTLHashset of uint32_t holding the same random IDs: the time to
+ * build them, their memory, lookups and the intersection of two sets.
+ *
+ * Usage: RoaringBench [count] [universe]
+ *
+ * Count defaults to 100000 IDs per set and universe to 10000000, the range the IDs are drawn from.
+ */
+#include <stdio.h>
+
+#define SUTL_IMPLEMENTATION
+#include "../include/Shroon/Utils/Hashset.h"
+#include "../include/Shroon/Utils/Roaring.h"
+#include "../include/Shroon/Utils/System.h"
+
+uint32_t * RandomIds(long count, uint32_t universe, uint32_t seed)
+{
+    uint32_t * ids = SUTLVectorNew(uint32_t);
+    uint32_t id;
+    long i;
+
+    SUTLVectorReserve(ids, (size_t)count);
+
+    for (i = 0; i < count; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        id = (uint32_t)(((uint64_t)seed * universe) >> 32);
+        SUTLVectorPush(ids, id);
+    }
+
+    return ids;
+}
+
+size_t HashsetByteSize(const SUTLHashset * hs)
+{
+    size_t size = sizeof(*hs) + hs->KeySize;
+    size_t i;
+
+    for (i = 0; i < SUTL_HASHSET_BUCKET_COUNT; i++)
+        size += 3 * sizeof(size_t) + SUTLVectorCapacity(hs->Keys[i]) * hs->KeySize;
+
+    return size;
+}
+
+int main(int argc, char ** argv)
+{
+    long count = argc > 1 ? atol(argv[1]) : 100000;
+    uint32_t universe = argc > 2 ? (uint32_t)atol(argv[2]) : 10000000;
+    uint32_t * ids[2];
+    uint32_t * probes;
+    SUTLRoaring r[2];
+    SUTLRoaring both;
+    SUTLHashset hs[2];
+    double start, roaringBuild, hashsetBuild, roaringLookup, hashsetLookup, roaringAnd, hashsetAnd;
+    size_t roaringHits = 0, hashsetHits = 0, hashsetBoth = 0;
+    long i;
+    int k;
+
+    ids[0] = RandomIds(count, universe, 1);
+    ids[1] = RandomIds(count, universe, 2);
+    probes = RandomIds(count, universe, 3);
+
+    start = SHRN_NOW();
+
+    for (k = 0; k < 2; k++)
+    {
+        r[k] = SUTLRoaringNew();
+
+        for (i = 0; i < count; i++)
+            SUTLRoaringAdd(r[k], ids[k][i]);
+
+        SUTLRoaringRunOptimize(r[k]);
+    }
+
+    roaringBuild = SHRN_NOW() - start;
+    start = SHRN_NOW();
+
+    for (k = 0; k < 2; k++)
+    {
+        hs[k] = SUTLHashsetNew(uint32_t, SUTL_HASHFN(u32), SUTL_CMPFN(u32));
+
+        for (i = 0; i < count; i++)
+            SUTLHashsetInsert(uint32_t, hs[k], ids[k][i]);
+    }
+
+    hashsetBuild = SHRN_NOW() - start;
+
+    /*
+     * Probes are drawn from the same range, so the hit rate is the density of the sets.
+     */
+    start = SHRN_NOW();
+
+    for (i = 0; i < count; i++)
+        roaringHits += SUTLRoaringContains(r[0], probes[i]);
+
+    roaringLookup = SHRN_NOW() - start;
+    start = SHRN_NOW();
+
+    for (i = 0; i < count; i++)
+        hashsetHits += SUTLHashsetGetWith(uint32_t, hs[0], &probes[i], SUTL_HASHFN(u32), SUTL_CMPFN(u32)) != NULL;
+
+    hashsetLookup = SHRN_NOW() - start;
+
+    start = SHRN_NOW();
+    both = SUTLRoaringIntersect(r[0], r[1]);
+    roaringAnd = SHRN_NOW() - start;
+
+    start = SHRN_NOW();
+
+    SUTLHashsetEach(uint32_t, hs[0], id,
+        hashsetBoth += SUTLHashsetGetWith(uint32_t, hs[1], id, SUTL_HASHFN(u32), SUTL_CMPFN(u32)) != NULL;
+    )
+
+    hashsetAnd = SHRN_NOW() - start;
+
+    printf("IDs:        %lu per set out of %lu, %lu hits, %lu in both\n", (unsigned long)r[0].Size,
+        (unsigned long)universe, (unsigned long)roaringHits, (unsigned long)both.Size);
+    printf("Memory:     roaring %.2f MB, hashset %.2f MB (%.1fx)\n", SUTLRoaringByteSize(r[0]) / 1e6,
+        HashsetByteSize(&hs[0]) / 1e6, (double)HashsetByteSize(&hs[0]) / SUTLRoaringByteSize(r[0]));
+    printf("Build:      roaring %.1f ms, hashset %.1f ms\n", roaringBuild * 1e3, hashsetBuild * 1e3);
+    printf("Lookup:     roaring %.1f ns, hashset %.1f ns\n", roaringLookup * 1e9 / count, hashsetLookup * 1e9 / count);
+    printf("Intersect:  roaring %.3f ms, hashset %.3f ms\n", roaringAnd * 1e3, hashsetAnd * 1e3);
+
+    if (roaringHits != hashsetHits || both.Size != hashsetBoth)
+    {
+        printf("Results differ.\n");
+        return 1;
+    }
+
+    SUTLRoaringFree(both);
+
+    for (k = 0; k < 2; k++)
+    {
+        SUTLRoaringFree(r[k]);
+        SUTLHashsetFree(hs[k]);
+        SUTLVectorFree(ids[k]);
+    }
+
+    SUTLVectorFree(probes);
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2021 Saroj Kumar.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares writing many small strings with one write call each to writing them with SUTLWriter.
+ *
+ * Usage: WriterBench [output file] [count]
+ *
+ * The output file defaults to /dev/null and count to 1000000.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+
+#define SUTL_IMPLEMENTATION
+#include "../include/Shroon/Utils/Writer.h"
+
+int main(int argc, char ** argv)
+{
+    const char * path = argc > 1 ? argv[1] : "/dev/null";
+    long count = argc > 2 ? atol(argv[2]) : 1000000;
+    SUTLString record = SUTLStringNew();
+    SUTLWriter w;
+    double start, naive, buffered;
+    long i;
+    int fd;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+    {
+        fprintf(stderr, "Can't open '%s'.\n", path);
+        return 1;
+    }
+
+    SUTLStringAppendP(record, "2021-01-01 00:00:00 INFO ok\n");
+
+    /*
+     * One system call for every record.
+     */
+    start = SHRN_NOW();
+
+    for (i = 0; i < count; i++)
+        if (SHRN_WRITE(fd, record, SUTLStringSize(record)) < 0)
+            return 1;
+
+    naive = SHRN_NOW() - start;
+
+    /*
+     * The same records through the writer.
+     */
+    w = SUTLWriterNew(fd, 0);
+    start = SHRN_NOW();
+
+    for (i = 0; i < count; i++)
+        SUTLWriterAppendS(w, record);
+
+    SUTLWriterFlush(w);
+    buffered = SHRN_NOW() - start;
+
+    printf("write:      %12.0f ops/s\n", count / naive);
+    printf("SUTLWriter: %12.0f ops/s (%llu system calls)\n", count / buffered, (unsigned long long)w.WriteCount);
+
+    SUTLWriterFree(w);
+    SUTLStringFree(record);
+    close(fd);
+
+    return w.Error;
+}